@@ -0,0 +1,480 @@
+// Fuzzer target which looks for inputs that make nghttp2 spend
+// excessive CPU time or perform excessive number of memory
+// allocations compared to the input size.
+//
+// The first byte of input selects the component to exercise:
+//
+//   0: nghttp2_session_mem_recv() with raw input
+//   1: HPACK inflater with raw input
+//   2: PRIORITY/HEADERS storm built from input against stream
+//      dependency tree
+//
+// The cost of each input is compared against the threshold
+// base + per_byte * size.  The thresholds can be changed by the
+// following environment variables:
+//
+//   NGHTTP2_FUZZ_NS_BASE, NGHTTP2_FUZZ_NS_PER_BYTE,
+//   NGHTTP2_FUZZ_ALLOCS_BASE, NGHTTP2_FUZZ_ALLOCS_PER_BYTE
+//
+// If NGHTTP2_FUZZ_SLOW_CORPUS is set, an input which exceeds the
+// thresholds is saved under that directory.  If
+// NGHTTP2_FUZZ_ABORT_ON_SLOW is set, abort() is called instead so
+// that fuzzer records it as crash.
+//
+// Defining NGHTTP2_FUZZ_COMPLEXITY_MAIN builds standalone driver
+// which runs given files (or files under given directories) and
+// reports the cost of each input.
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+
+#include <openssl/sha.h>
+
+#include <nghttp2/nghttp2.h>
+
+namespace {
+enum {
+  TARGET_SESSION,
+  TARGET_HPACK,
+  TARGET_PRIORITY,
+  TARGET_MAX,
+};
+} // namespace
+
+namespace {
+const char *target_names[] = {"session", "hpack", "priority"};
+} // namespace
+
+namespace {
+struct Cost {
+  uint64_t ns;
+  size_t allocs;
+};
+} // namespace
+
+namespace {
+struct Config {
+  uint64_t ns_base;
+  uint64_t ns_per_byte;
+  size_t allocs_base;
+  size_t allocs_per_byte;
+  const char *slow_corpus;
+  bool abort_on_slow;
+};
+} // namespace
+
+namespace {
+size_t num_allocs;
+} // namespace
+
+namespace {
+void *count_malloc(size_t size, void *mem_user_data) {
+  ++num_allocs;
+  return malloc(size);
+}
+} // namespace
+
+namespace {
+void count_free(void *ptr, void *mem_user_data) { free(ptr); }
+} // namespace
+
+namespace {
+void *count_calloc(size_t nmemb, size_t size, void *mem_user_data) {
+  ++num_allocs;
+  return calloc(nmemb, size);
+}
+} // namespace
+
+namespace {
+void *count_realloc(void *ptr, size_t size, void *mem_user_data) {
+  ++num_allocs;
+  return realloc(ptr, size);
+}
+} // namespace
+
+namespace {
+nghttp2_mem count_mem{nullptr, count_malloc, count_free, count_calloc,
+                      count_realloc};
+} // namespace
+
+namespace {
+uint64_t cputime_ns() {
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+} // namespace
+
+namespace {
+uint64_t getenv_uint(const char *name, uint64_t default_value) {
+  auto s = getenv(name);
+  if (s == nullptr || *s == '\0') {
+    return default_value;
+  }
+  return strtoull(s, nullptr, 10);
+}
+} // namespace
+
+namespace {
+const Config &get_config() {
+  static Config config{
+      getenv_uint("NGHTTP2_FUZZ_NS_BASE", 10000000),
+      getenv_uint("NGHTTP2_FUZZ_NS_PER_BYTE", 20000),
+      static_cast<size_t>(getenv_uint("NGHTTP2_FUZZ_ALLOCS_BASE", 256)),
+      static_cast<size_t>(getenv_uint("NGHTTP2_FUZZ_ALLOCS_PER_BYTE", 4)),
+      getenv("NGHTTP2_FUZZ_SLOW_CORPUS"),
+      getenv("NGHTTP2_FUZZ_ABORT_ON_SLOW") != nullptr,
+  };
+  return config;
+}
+} // namespace
+
+namespace {
+int on_header_callback2(nghttp2_session *session, const nghttp2_frame *frame,
+                        nghttp2_rcbuf *name, nghttp2_rcbuf *value,
+                        uint8_t flags, void *user_data) {
+  return 0;
+}
+} // namespace
+
+namespace {
+void send_pending(nghttp2_session *session) {
+  for (;;) {
+    const uint8_t *data;
+    auto n = nghttp2_session_mem_send(session, &data);
+    if (n <= 0) {
+      return;
+    }
+  }
+}
+} // namespace
+
+namespace {
+void run_session(const uint8_t *data, size_t size) {
+  nghttp2_session *session;
+  nghttp2_session_callbacks *callbacks;
+
+  nghttp2_session_callbacks_new(&callbacks);
+  nghttp2_session_callbacks_set_on_header_callback2(callbacks,
+                                                    on_header_callback2);
+
+  if (nghttp2_session_server_new3(&session, callbacks, nullptr, nullptr,
+                                  &count_mem) != 0) {
+    nghttp2_session_callbacks_del(callbacks);
+    return;
+  }
+  nghttp2_session_callbacks_del(callbacks);
+
+  nghttp2_settings_entry iv{NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS, 100};
+  nghttp2_submit_settings(session, NGHTTP2_FLAG_NONE, &iv, 1);
+  send_pending(session);
+  nghttp2_session_mem_recv(session, data, size);
+  send_pending(session);
+
+  nghttp2_session_del(session);
+}
+} // namespace
+
+namespace {
+void run_hpack(const uint8_t *data, size_t size) {
+  nghttp2_hd_inflater *inflater;
+
+  if (nghttp2_hd_inflate_new2(&inflater, &count_mem) != 0) {
+    return;
+  }
+
+  for (;;) {
+    nghttp2_nv nv;
+    int inflate_flags = 0;
+
+    auto rv =
+        nghttp2_hd_inflate_hd2(inflater, &nv, &inflate_flags, data, size, 1);
+    if (rv < 0) {
+      break;
+    }
+
+    data += rv;
+    size -= rv;
+
+    if (inflate_flags & NGHTTP2_HD_INFLATE_FINAL) {
+      nghttp2_hd_inflate_end_headers(inflater);
+      break;
+    }
+
+    if ((inflate_flags & NGHTTP2_HD_INFLATE_EMIT) == 0) {
+      break;
+    }
+  }
+
+  nghttp2_hd_inflate_del(inflater);
+}
+} // namespace
+
+namespace {
+void put_frame_hd(std::vector<uint8_t> &buf, size_t length, uint8_t type,
+                  uint8_t flags, int32_t stream_id) {
+  buf.push_back((length >> 16) & 0xff);
+  buf.push_back((length >> 8) & 0xff);
+  buf.push_back(length & 0xff);
+  buf.push_back(type);
+  buf.push_back(flags);
+  buf.push_back((stream_id >> 24) & 0x7f);
+  buf.push_back((stream_id >> 16) & 0xff);
+  buf.push_back((stream_id >> 8) & 0xff);
+  buf.push_back(stream_id & 0xff);
+}
+} // namespace
+
+namespace {
+void put_priority_spec(std::vector<uint8_t> &buf, int32_t dep_stream_id,
+                       uint8_t weight, bool exclusive) {
+  buf.push_back(((dep_stream_id >> 24) & 0x7f) | (exclusive ? 0x80 : 0));
+  buf.push_back((dep_stream_id >> 16) & 0xff);
+  buf.push_back((dep_stream_id >> 8) & 0xff);
+  buf.push_back(dep_stream_id & 0xff);
+  buf.push_back(weight);
+}
+} // namespace
+
+namespace {
+// Translates input into a sequence of HEADERS and PRIORITY frames.
+// Each 5 bytes of input forms one operation: 2 bytes stream ID, 2
+// bytes dependency stream ID, and 1 byte weight.  The stream IDs
+// are kept small so that operations collide on the same part of the
+// dependency tree.  The least significant bit of weight byte selects
+// exclusive flag, and the second bit opens new stream with HEADERS
+// instead of sending PRIORITY.
+void run_priority(const uint8_t *data, size_t size) {
+  // :method: GET, :scheme: http, :path: /, :authority: a
+  static const uint8_t hdblock[] = {0x82, 0x86, 0x84, 0x41, 0x01, 'a'};
+  std::vector<uint8_t> buf(
+      reinterpret_cast<const uint8_t *>(NGHTTP2_CLIENT_MAGIC),
+      reinterpret_cast<const uint8_t *>(NGHTTP2_CLIENT_MAGIC) +
+          NGHTTP2_CLIENT_MAGIC_LEN);
+  int32_t last_stream_id = 0;
+
+  put_frame_hd(buf, 0, NGHTTP2_SETTINGS, NGHTTP2_FLAG_NONE, 0);
+
+  for (; size >= 5; data += 5, size -= 5) {
+    auto stream_id = static_cast<int32_t>((data[0] << 8) | data[1]);
+    auto dep_stream_id = static_cast<int32_t>((data[2] << 8) | data[3]);
+    auto exclusive = (data[4] & 0x1) != 0;
+
+    if (stream_id == 0) {
+      continue;
+    }
+
+    if (data[4] & 0x2) {
+      stream_id = stream_id * 2 + 1;
+      if (stream_id <= last_stream_id) {
+        stream_id = last_stream_id + 2;
+      }
+      last_stream_id = stream_id;
+
+      if (stream_id == dep_stream_id) {
+        continue;
+      }
+
+      put_frame_hd(buf, 5 + sizeof(hdblock), NGHTTP2_HEADERS,
+                   NGHTTP2_FLAG_END_HEADERS | NGHTTP2_FLAG_PRIORITY |
+                       NGHTTP2_FLAG_END_STREAM,
+                   stream_id);
+      put_priority_spec(buf, dep_stream_id, data[4], exclusive);
+      buf.insert(std::end(buf), hdblock, hdblock + sizeof(hdblock));
+
+      continue;
+    }
+
+    if (stream_id == dep_stream_id) {
+      continue;
+    }
+
+    put_frame_hd(buf, 5, NGHTTP2_PRIORITY, NGHTTP2_FLAG_NONE, stream_id);
+    put_priority_spec(buf, dep_stream_id, data[4], exclusive);
+  }
+
+  run_session(buf.data(), buf.size());
+}
+} // namespace
+
+namespace {
+Cost measure(const uint8_t *data, size_t size) {
+  num_allocs = 0;
+
+  auto start = cputime_ns();
+
+  if (size > 0) {
+    switch (data[0] % TARGET_MAX) {
+    case TARGET_SESSION:
+      run_session(data + 1, size - 1);
+      break;
+    case TARGET_HPACK:
+      run_hpack(data + 1, size - 1);
+      break;
+    case TARGET_PRIORITY:
+      run_priority(data + 1, size - 1);
+      break;
+    }
+  }
+
+  return Cost{cputime_ns() - start, num_allocs};
+}
+} // namespace
+
+namespace {
+bool is_slow(const Cost &cost, size_t size) {
+  auto &config = get_config();
+
+  return cost.ns > config.ns_base + config.ns_per_byte * size ||
+         cost.allocs > config.allocs_base + config.allocs_per_byte * size;
+}
+} // namespace
+
+namespace {
+// Saves |data| of length |size| under |dir|.  The file name is the
+// lower-cased hex string of SHA-256 hash of |data|, just like the
+// files under corpus directory.
+void save_input(const char *dir, const uint8_t *data, size_t size) {
+  static const char LOWER_XDIGITS[] = "0123456789abcdef";
+  uint8_t md[SHA256_DIGEST_LENGTH];
+
+  SHA256(data, size, md);
+
+  std::string path = dir;
+  path += '/';
+  for (auto c : md) {
+    path += LOWER_XDIGITS[c >> 4];
+    path += LOWER_XDIGITS[c & 0xf];
+  }
+
+  auto f = fopen(path.c_str(), "wb");
+  if (f == nullptr) {
+    perror(path.c_str());
+    return;
+  }
+
+  fwrite(data, 1, size, f);
+  fclose(f);
+}
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  auto cost = measure(data, size);
+
+  if (!is_slow(cost, size)) {
+    return 0;
+  }
+
+  auto &config = get_config();
+
+  fprintf(stderr,
+          "slow input: target=%s size=%zu cputime=%luns allocs=%zu\n",
+          size ? target_names[data[0] % TARGET_MAX] : "none", size,
+          static_cast<unsigned long>(cost.ns), cost.allocs);
+
+  if (config.slow_corpus) {
+    save_input(config.slow_corpus, data, size);
+  }
+
+  if (config.abort_on_slow) {
+    abort();
+  }
+
+  return 0;
+}
+
+#ifdef NGHTTP2_FUZZ_COMPLEXITY_MAIN
+namespace {
+bool read_file(std::vector<uint8_t> &buf, const char *path) {
+  auto f = fopen(path, "rb");
+  if (f == nullptr) {
+    perror(path);
+    return false;
+  }
+
+  buf.clear();
+
+  uint8_t b[4096];
+  size_t n;
+  while ((n = fread(b, 1, sizeof(b), f)) > 0) {
+    buf.insert(std::end(buf), b, b + n);
+  }
+
+  fclose(f);
+
+  return true;
+}
+} // namespace
+
+namespace {
+// Runs the input in |path| and prints its cost.  Returns the number
+// of inputs which exceeded the thresholds.
+int run_path(const std::string &path) {
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0) {
+    perror(path.c_str());
+    return 1;
+  }
+
+  if (S_ISDIR(st.st_mode)) {
+    auto dir = opendir(path.c_str());
+    if (dir == nullptr) {
+      perror(path.c_str());
+      return 1;
+    }
+
+    int nslow = 0;
+    for (auto ent = readdir(dir); ent; ent = readdir(dir)) {
+      if (ent->d_name[0] == '.') {
+        continue;
+      }
+      nslow += run_path(path + '/' + ent->d_name);
+    }
+
+    closedir(dir);
+
+    return nslow;
+  }
+
+  std::vector<uint8_t> buf;
+  if (!read_file(buf, path.c_str())) {
+    return 1;
+  }
+
+  auto cost = measure(buf.data(), buf.size());
+  auto slow = is_slow(cost, buf.size());
+
+  printf("%s size=%zu cputime=%luns allocs=%zu%s\n", path.c_str(),
+         buf.size(), static_cast<unsigned long>(cost.ns), cost.allocs,
+         slow ? " SLOW" : "");
+
+  if (slow && get_config().slow_corpus) {
+    save_input(get_config().slow_corpus, buf.data(), buf.size());
+  }
+
+  return slow;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s <FILE|DIR>...\n", argv[0]);
+    return 1;
+  }
+
+  int nslow = 0;
+  for (int i = 1; i < argc; ++i) {
+    nslow += run_path(argv[i]);
+  }
+
+  return nslow == 0 ? 0 : 1;
+}
+#endif // NGHTTP2_FUZZ_COMPLEXITY_MAIN
@@ -175,6 +175,33 @@ OPTIONS = [
     "tls13-ciphers",
     "tls13-client-ciphers",
     "no-strip-incoming-early-data",
+    "worker-event-budget",
+    "worker-event-queue-size",
+    "accesslog-async",
+    "accesslog-async-buffer-size",
+    "accesslog-async-overflow",
+    "splice-relay",
+    "splice-relay-min-length",
+    "io-engine",
+    "tls-ktls",
+    "zerocopy-send",
+    "zerocopy-send-min-length",
+    "zerocopy-send-max-pinned",
+    "frontend-timer-wheel-tick",
+    "frontend-idle-release",
+    "backend-outlier-detection-interval",
+    "backend-outlier-error-rate",
+    "backend-outlier-latency-factor",
+    "backend-outlier-min-requests",
+    "backend-outlier-ejection-time",
+    "backend-outlier-max-ejection",
+    "backend-hedge-budget",
+    "backend-hedge-min-delay",
+    "backend-concurrency-min-limit",
+    "backend-concurrency-retry-after",
+    "backend-collapse-vary",
+    "backend-collapse-max-waiters",
+    "backend-collapse-timeout",
 ]
 
 LOGVARS = [
@@ -577,6 +577,32 @@ typedef struct {
   uint8_t flags;
 } nghttp2_nv;
 
+/**
+ * @struct
+ *
+ * The name/value pair whose name and value are held by
+ * :type:`nghttp2_rcbuf`.  This is used to submit header fields
+ * without copying them, typically the ones received by
+ * :type:`nghttp2_on_header_callback2`.  See
+ * `nghttp2_submit_request_rcnv()` and `nghttp2_submit_response_rcnv()`.
+ */
+typedef struct {
+  /**
+   * The header field name.  It must be lower-cased.
+   */
+  nghttp2_rcbuf *name;
+  /**
+   * The header field value.
+   */
+  nghttp2_rcbuf *value;
+  /**
+   * Bitwise OR of one or more of :type:`nghttp2_nv_flag`.
+   * :enum:`nghttp2_nv_flag.NGHTTP2_NV_FLAG_NO_COPY_NAME` and
+   * :enum:`nghttp2_nv_flag.NGHTTP2_NV_FLAG_NO_COPY_VALUE` are implied.
+   */
+  uint8_t flags;
+} nghttp2_rcnv;
+
 /**
  * @enum
  *
@@ -2739,6 +2765,8 @@ NGHTTP2_EXTERN void nghttp2_option_set_max_settings(nghttp2_option *option,
  *
  * :enum:`nghttp2_error.NGHTTP2_ERR_NOMEM`
  *     Out of memory.
+ * :enum:`nghttp2_error.NGHTTP2_ERR_INVALID_STATE`
+ *     The library was built with server role only.
  */
 NGHTTP2_EXTERN int
 nghttp2_session_client_new(nghttp2_session **session_ptr,
@@ -2765,6 +2793,8 @@ nghttp2_session_client_new(nghttp2_session **session_ptr,
  *
  * :enum:`nghttp2_error.NGHTTP2_ERR_NOMEM`
  *     Out of memory.
+ * :enum:`nghttp2_error.NGHTTP2_ERR_INVALID_STATE`
+ *     The library was built with client role only.
  */
 NGHTTP2_EXTERN int
 nghttp2_session_server_new(nghttp2_session **session_ptr,
@@ -3357,6 +3387,22 @@ nghttp2_session_get_hd_inflate_dynamic_table_size(nghttp2_session *session);
 NGHTTP2_EXTERN size_t
 nghttp2_session_get_hd_deflate_dynamic_table_size(nghttp2_session *session);
 
+/**
+ * @function
+ *
+ * Frees the buffer which |session| uses to serialize outgoing frames.
+ * The buffer is allocated again when the next frame is sent.  An
+ * application which keeps a large number of idle sessions may call
+ * this function to reduce the memory held by each of them.
+ *
+ * This function returns 0 if it succeeds, or one of the following
+ * negative error codes:
+ *
+ * :enum:`nghttp2_error.NGHTTP2_ERR_INVALID_STATE`
+ *     A frame is being sent, or it has not been sent completely.
+ */
+NGHTTP2_EXTERN int nghttp2_session_release_buffers(nghttp2_session *session);
+
 /**
  * @function
  *
@@ -4118,6 +4164,83 @@ NGHTTP2_EXTERN int32_t nghttp2_submit_headers(
     const nghttp2_priority_spec *pri_spec, const nghttp2_nv *nva, size_t nvlen,
     void *stream_user_data);
 
+/**
+ * @function
+ *
+ * Same as `nghttp2_submit_request()`, but header fields are given as
+ * an array of :type:`nghttp2_rcnv` with |nvlen| elements.
+ *
+ * This function does not copy header field names and values.
+ * Instead, it increments the reference count of each
+ * :type:`nghttp2_rcbuf` in |nva|, and the library decrements them
+ * after the frame is serialized or discarded.  The application can
+ * call `nghttp2_rcbuf_decref()` for its own references right after
+ * this function returns.  This makes it possible to forward header
+ * fields received by :type:`nghttp2_on_header_callback2` in one
+ * session to another session without copying them.  Header field
+ * names are not lower-cased by this function.
+ *
+ * :type:`nghttp2_rcbuf` is not thread-safe.  The sessions which share
+ * :type:`nghttp2_rcbuf` must be used in the same thread.
+ *
+ * This function returns assigned stream ID if it succeeds, or one of
+ * the negative error codes described in `nghttp2_submit_request()`.
+ */
+NGHTTP2_EXTERN int32_t nghttp2_submit_request_rcnv(
+    nghttp2_session *session, const nghttp2_priority_spec *pri_spec,
+    const nghttp2_rcnv *nva, size_t nvlen,
+    const nghttp2_data_provider *data_prd, void *stream_user_data);
+
+/**
+ * @function
+ *
+ * Same as `nghttp2_submit_response()`, but header fields are given as
+ * an array of :type:`nghttp2_rcnv` with |nvlen| elements.  See
+ * `nghttp2_submit_request_rcnv()` for how the references to
+ * :type:`nghttp2_rcbuf` are managed.
+ *
+ * This function returns 0 if it succeeds, or one of the negative
+ * error codes described in `nghttp2_submit_response()`.
+ */
+NGHTTP2_EXTERN int
+nghttp2_submit_response_rcnv(nghttp2_session *session, int32_t stream_id,
+                             const nghttp2_rcnv *nva, size_t nvlen,
+                             const nghttp2_data_provider *data_prd);
+
+/**
+ * @function
+ *
+ * Same as `nghttp2_submit_trailer()`, but header fields are given as
+ * an array of :type:`nghttp2_rcnv` with |nvlen| elements.  See
+ * `nghttp2_submit_request_rcnv()` for how the references to
+ * :type:`nghttp2_rcbuf` are managed.
+ *
+ * This function returns 0 if it succeeds, or one of the negative
+ * error codes described in `nghttp2_submit_trailer()`.
+ */
+NGHTTP2_EXTERN int nghttp2_submit_trailer_rcnv(nghttp2_session *session,
+                                               int32_t stream_id,
+                                               const nghttp2_rcnv *nva,
+                                               size_t nvlen);
+
+/**
+ * @function
+ *
+ * Same as `nghttp2_submit_headers()`, but header fields are given as
+ * an array of :type:`nghttp2_rcnv` with |nvlen| elements.  See
+ * `nghttp2_submit_request_rcnv()` for how the references to
+ * :type:`nghttp2_rcbuf` are managed.
+ *
+ * This function returns newly assigned stream ID if it succeeds and
+ * |stream_id| is -1.  Otherwise, this function returns 0 if it
+ * succeeds, or one of the negative error codes described in
+ * `nghttp2_submit_headers()`.
+ */
+NGHTTP2_EXTERN int32_t nghttp2_submit_headers_rcnv(
+    nghttp2_session *session, uint8_t flags, int32_t stream_id,
+    const nghttp2_priority_spec *pri_spec, const nghttp2_rcnv *nva,
+    size_t nvlen, void *stream_user_data);
+
 /**
  * @function
  *
@@ -4305,6 +4428,8 @@ NGHTTP2_EXTERN int nghttp2_submit_settings(nghttp2_session *session,
  * :enum:`nghttp2_error.NGHTTP2_ERR_PROTO`
  *     This function was invoked when |session| is initialized as
  *     client.
+ * :enum:`nghttp2_error.NGHTTP2_ERR_PUSH_DISABLED`
+ *     The library was built without server push support.
  * :enum:`nghttp2_error.NGHTTP2_ERR_STREAM_ID_NOT_AVAILABLE`
  *     No stream ID is available because maximum stream ID was
  *     reached.
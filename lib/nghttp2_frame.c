@@ -1042,6 +1042,63 @@ int nghttp2_nv_array_copy(nghttp2_nv **nva_ptr, const nghttp2_nv *nva,
   return 0;
 }
 
+int nghttp2_nv_array_copy_rcnv(nghttp2_nv **nva_ptr, const nghttp2_rcnv *rcnva,
+                               size_t nvlen, nghttp2_mem *mem) {
+  size_t i;
+  nghttp2_nv *p;
+  nghttp2_rcbuf **rcbufs;
+
+  if (nvlen == 0) {
+    *nva_ptr = NULL;
+
+    return 0;
+  }
+
+  *nva_ptr = nghttp2_mem_malloc(
+      mem, (sizeof(nghttp2_nv) + sizeof(nghttp2_rcbuf *) * 2) * nvlen);
+
+  if (*nva_ptr == NULL) {
+    return NGHTTP2_ERR_NOMEM;
+  }
+
+  p = *nva_ptr;
+  rcbufs = (nghttp2_rcbuf **)(void *)(p + nvlen);
+
+  for (i = 0; i < nvlen; ++i) {
+    p->name = rcnva[i].name->base;
+    p->namelen = rcnva[i].name->len;
+    p->value = rcnva[i].value->base;
+    p->valuelen = rcnva[i].value->len;
+    p->flags = (uint8_t)(rcnva[i].flags | NGHTTP2_NV_FLAG_NO_COPY_NAME |
+                         NGHTTP2_NV_FLAG_NO_COPY_VALUE);
+
+    nghttp2_rcbuf_incref(rcnva[i].name);
+    nghttp2_rcbuf_incref(rcnva[i].value);
+
+    *rcbufs++ = rcnva[i].name;
+    *rcbufs++ = rcnva[i].value;
+
+    ++p;
+  }
+
+  return 0;
+}
+
+void nghttp2_nv_array_rcnv_release(nghttp2_nv *nva, size_t nvlen) {
+  size_t i;
+  nghttp2_rcbuf **rcbufs;
+
+  if (nvlen == 0) {
+    return;
+  }
+
+  rcbufs = (nghttp2_rcbuf **)(void *)(nva + nvlen);
+
+  for (i = 0; i < nvlen * 2; ++i) {
+    nghttp2_rcbuf_decref(rcbufs[i]);
+  }
+}
+
 int nghttp2_iv_check(const nghttp2_settings_entry *iv, size_t niv) {
   size_t i;
   for (i = 0; i < niv; ++i) {
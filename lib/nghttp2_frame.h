@@ -583,6 +583,34 @@ void nghttp2_nv_array_sort(nghttp2_nv *nva, size_t nvlen);
 int nghttp2_nv_array_copy(nghttp2_nv **nva_ptr, const nghttp2_nv *nva,
                           size_t nvlen, nghttp2_mem *mem);
 
+/*
+ * Creates name/value pairs from |rcnva|, which contains |nvlen|
+ * pairs, and assigns it to |*nva_ptr|.  Unlike
+ * nghttp2_nv_array_copy(), name and value are not copied.  Instead,
+ * the resulting nghttp2_nv points to the buffers of nghttp2_rcbuf,
+ * and this function increments the reference count of each of them.
+ * The pointers to nghttp2_rcbuf are stored just after the nghttp2_nv
+ * array in the same allocation.  Names are not lower-cased.
+ *
+ * The references must be released by nghttp2_nv_array_rcnv_release(),
+ * and then |*nva_ptr| must be freed using nghttp2_nv_array_del().
+ *
+ * This function returns 0 if it succeeds or one of the following
+ * negative error codes:
+ *
+ * NGHTTP2_ERR_NOMEM
+ *     Out of memory.
+ */
+int nghttp2_nv_array_copy_rcnv(nghttp2_nv **nva_ptr, const nghttp2_rcnv *rcnva,
+                               size_t nvlen, nghttp2_mem *mem);
+
+/*
+ * Decrements the reference count of nghttp2_rcbuf held by |nva| of
+ * length |nvlen|, which must be created by
+ * nghttp2_nv_array_copy_rcnv().  This function does not free |nva|.
+ */
+void nghttp2_nv_array_rcnv_release(nghttp2_nv *nva, size_t nvlen);
+
 /*
  * Returns nonzero if the name/value pair |a| equals to |b|. The name
  * is compared in case-sensitive, because we ensure that this function
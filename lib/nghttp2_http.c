@@ -381,9 +381,10 @@ int nghttp2_http_on_header(nghttp2_session *session, nghttp2_stream *stream,
     return NGHTTP2_ERR_IGN_HTTP_HEADER;
   }
 
-  if (session->server || frame->hd.type == NGHTTP2_PUSH_PROMISE) {
+  if (nghttp2_session_server(session) ||
+      frame->hd.type == NGHTTP2_PUSH_PROMISE) {
     return http_request_on_header(stream, nv, trailer,
-                                  session->server &&
+                                  nghttp2_session_server(session) &&
                                       session->pending_enable_connect_protocol);
   }
 
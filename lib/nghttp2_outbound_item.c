@@ -49,6 +49,9 @@ void nghttp2_outbound_item_free(nghttp2_outbound_item *item, nghttp2_mem *mem) {
     nghttp2_frame_data_free(&frame->data);
     break;
   case NGHTTP2_HEADERS:
+    if (item->aux_data.headers.rcnv) {
+      nghttp2_nv_array_rcnv_release(frame->headers.nva, frame->headers.nvlen);
+    }
     nghttp2_frame_headers_free(&frame->headers, mem);
     break;
   case NGHTTP2_PRIORITY:
@@ -43,6 +43,10 @@ typedef struct {
   /* nonzero if request HEADERS is canceled.  The error code is stored
      in |error_code|. */
   uint8_t canceled;
+  /* nonzero if name/value pairs of HEADERS are created by
+     nghttp2_nv_array_copy_rcnv(), and they hold the references to
+     nghttp2_rcbuf. */
+  uint8_t rcnv;
 } nghttp2_headers_aux_data;
 
 /* struct used for DATA frame */
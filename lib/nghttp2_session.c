@@ -95,7 +95,7 @@ static int session_trailer_headers(nghttp2_session *session,
   if (!stream || frame->hd.type != NGHTTP2_HEADERS) {
     return 0;
   }
-  if (session->server) {
+  if (nghttp2_session_server(session)) {
     return frame->headers.cat == NGHTTP2_HCAT_HEADERS;
   }
 
@@ -270,7 +270,7 @@ int nghttp2_session_is_my_stream_id(nghttp2_session *session,
     return 0;
   }
   rem = stream_id & 0x1;
-  if (session->server) {
+  if (nghttp2_session_server(session)) {
     return rem == 0;
   }
   return rem == 1;
@@ -409,6 +409,16 @@ static int session_new(nghttp2_session **session_ptr,
   size_t max_deflate_dynamic_table_size =
       NGHTTP2_HD_DEFAULT_MAX_DEFLATE_BUFFER_SIZE;
 
+#if defined(NGHTTP2_SERVER_ONLY)
+  if (!server) {
+    return NGHTTP2_ERR_INVALID_STATE;
+  }
+#elif defined(NGHTTP2_CLIENT_ONLY)
+  if (server) {
+    return NGHTTP2_ERR_INVALID_STATE;
+  }
+#endif
+
   if (mem == NULL) {
     mem = nghttp2_mem_default();
   }
@@ -441,7 +451,7 @@ static int session_new(nghttp2_session **session_ptr,
 
   (*session_ptr)->pending_local_max_concurrent_stream =
       NGHTTP2_DEFAULT_MAX_CONCURRENT_STREAMS;
-  (*session_ptr)->pending_enable_push = 1;
+  (*session_ptr)->pending_enable_push = NGHTTP2_PUSH_ENABLED;
 
   if (server) {
     (*session_ptr)->server = 1;
@@ -973,7 +983,8 @@ int nghttp2_session_add_rst_stream(nghttp2_session *session, int32_t stream_id,
 
   /* Cancel pending request HEADERS in ob_syn if this RST_STREAM
      refers to that stream. */
-  if (!session->server && nghttp2_session_is_my_stream_id(session, stream_id) &&
+  if (!nghttp2_session_server(session) &&
+      nghttp2_session_is_my_stream_id(session, stream_id) &&
       nghttp2_outbound_queue_top(&session->ob_syn)) {
     nghttp2_headers_aux_data *aux_data;
     nghttp2_frame *headers_frame;
@@ -1230,12 +1241,15 @@ int nghttp2_session_close_stream(nghttp2_session *session, int32_t stream_id,
   /* Closes both directions just in case they are not closed yet */
   stream->flags |= NGHTTP2_STREAM_FLAG_CLOSED;
 
-  if ((session->opt_flags & NGHTTP2_OPTMASK_NO_CLOSED_STREAMS) == 0 &&
-      session->server && !is_my_stream_id &&
+  if (NGHTTP2_REMOTE_PRIORITY_ENABLED &&
+      (session->opt_flags & NGHTTP2_OPTMASK_NO_CLOSED_STREAMS) == 0 &&
+      nghttp2_session_server(session) && !is_my_stream_id &&
       nghttp2_stream_in_dep_tree(stream)) {
     /* On server side, retain stream at most MAX_CONCURRENT_STREAMS
        combined with the current active incoming streams to make
-       dependency tree work better. */
+       dependency tree work better.  Without remote priority, client
+       never refers to closed streams, so there is nothing to
+       retain. */
     nghttp2_session_keep_closed_stream(session, stream);
   } else {
     rv = nghttp2_session_destroy_stream(session, stream);
@@ -1490,7 +1504,8 @@ static int session_predicate_for_stream_send(nghttp2_session *session,
 }
 
 int nghttp2_session_check_request_allowed(nghttp2_session *session) {
-  return !session->server && session->next_stream_id <= INT32_MAX &&
+  return !nghttp2_session_server(session) &&
+         session->next_stream_id <= INT32_MAX &&
          (session->goaway_flags & NGHTTP2_GOAWAY_RECV) == 0 &&
          !session_is_closing(session);
 }
@@ -1556,7 +1571,7 @@ static int session_predicate_response_headers_send(nghttp2_session *session,
     return rv;
   }
   assert(stream);
-  if (!session->server) {
+  if (!nghttp2_session_server(session)) {
     return NGHTTP2_ERR_PROTO;
   }
   if (nghttp2_session_is_my_stream_id(session, stream->stream_id)) {
@@ -1606,7 +1621,7 @@ session_predicate_push_response_headers_send(nghttp2_session *session,
     return rv;
   }
   assert(stream);
-  if (!session->server) {
+  if (!nghttp2_session_server(session)) {
     return NGHTTP2_ERR_PROTO;
   }
   if (stream->state != NGHTTP2_STREAM_RESERVED) {
@@ -1689,7 +1704,7 @@ static int session_predicate_push_promise_send(nghttp2_session *session,
                                                nghttp2_stream *stream) {
   int rv;
 
-  if (!session->server) {
+  if (!nghttp2_session_server(session)) {
     return NGHTTP2_ERR_PROTO;
   }
 
@@ -1700,7 +1715,7 @@ static int session_predicate_push_promise_send(nghttp2_session *session,
 
   assert(stream);
 
-  if (session->remote_settings.enable_push == 0) {
+  if (!NGHTTP2_PUSH_ENABLED || session->remote_settings.enable_push == 0) {
     return NGHTTP2_ERR_PUSH_DISABLED;
   }
   if (stream->state == NGHTTP2_STREAM_CLOSING) {
@@ -2675,7 +2690,7 @@ static int session_after_frame_sent1(nghttp2_session *session) {
     }
   }
   case NGHTTP2_PRIORITY:
-    if (session->server) {
+    if (nghttp2_session_server(session)) {
       return 0;
       ;
     }
@@ -2924,6 +2939,18 @@ static ssize_t nghttp2_session_mem_send_internal(nghttp2_session *session,
     case NGHTTP2_OB_POP_ITEM: {
       nghttp2_outbound_item *item;
 
+      if (framebufs->head == NULL) {
+        /* nghttp2_session_release_buffers() freed the buffer. */
+        if (nghttp2_session_get_next_ob_item(session) == NULL) {
+          return 0;
+        }
+
+        rv = nghttp2_bufs_realloc(framebufs, NGHTTP2_FRAMEBUF_CHUNKLEN);
+        if (rv != 0) {
+          return rv;
+        }
+      }
+
       item = nghttp2_session_pop_next_ob_item(session);
       if (item == NULL) {
         return 0;
@@ -3776,7 +3803,7 @@ static int session_after_header_block_received(nghttp2_session *session) {
         break;
       case NGHTTP2_HCAT_HEADERS:
         if (stream->http_flags & NGHTTP2_HTTP_FLAG_EXPECT_FINAL_RESPONSE) {
-          assert(!session->server);
+          assert(!nghttp2_session_server(session));
           rv = nghttp2_http_on_response_headers(stream);
         } else {
           rv = nghttp2_http_on_trailer_headers(stream, frame);
@@ -3830,6 +3857,9 @@ int nghttp2_session_on_request_headers_received(nghttp2_session *session,
                                                 nghttp2_frame *frame) {
   int rv = 0;
   nghttp2_stream *stream;
+  nghttp2_priority_spec pri_spec_default;
+  nghttp2_priority_spec *pri_spec = &frame->headers.pri_spec;
+
   if (frame->hd.stream_id == 0) {
     return session_inflate_handle_invalid_connection(
         session, frame, NGHTTP2_ERR_PROTO, "request HEADERS: stream_id == 0");
@@ -3838,7 +3868,7 @@ int nghttp2_session_on_request_headers_received(nghttp2_session *session,
   /* If client receives idle stream from server, it is invalid
      regardless stream ID is even or odd.  This is because client is
      not expected to receive request from server. */
-  if (!session->server) {
+  if (!nghttp2_session_server(session)) {
     if (session_detect_idle_stream(session, frame->hd.stream_id)) {
       return session_inflate_handle_invalid_connection(
           session, frame, NGHTTP2_ERR_PROTO,
@@ -3848,7 +3878,7 @@ int nghttp2_session_on_request_headers_received(nghttp2_session *session,
     return NGHTTP2_ERR_IGN_HEADER_BLOCK;
   }
 
-  assert(session->server);
+  assert(nghttp2_session_server(session));
 
   if (!session_is_new_peer_stream_id(session, frame->hd.stream_id)) {
     if (frame->hd.stream_id == 0 ||
@@ -3909,9 +3939,15 @@ int nghttp2_session_on_request_headers_received(nghttp2_session *session,
                                                  NGHTTP2_ERR_REFUSED_STREAM);
   }
 
-  stream = nghttp2_session_open_stream(
-      session, frame->hd.stream_id, NGHTTP2_STREAM_FLAG_NONE,
-      &frame->headers.pri_spec, NGHTTP2_STREAM_OPENING, NULL);
+  if (!NGHTTP2_REMOTE_PRIORITY_ENABLED) {
+    /* Ignore priority signal from client */
+    nghttp2_priority_spec_default_init(&pri_spec_default);
+    pri_spec = &pri_spec_default;
+  }
+
+  stream = nghttp2_session_open_stream(session, frame->hd.stream_id,
+                                       NGHTTP2_STREAM_FLAG_NONE, pri_spec,
+                                       NGHTTP2_STREAM_OPENING, NULL);
   if (!stream) {
     return NGHTTP2_ERR_NOMEM;
   }
@@ -3973,7 +4009,7 @@ int nghttp2_session_on_push_response_headers_received(nghttp2_session *session,
         "push response HEADERS: stream_id == 0");
   }
 
-  if (session->server) {
+  if (nghttp2_session_server(session)) {
     return session_inflate_handle_invalid_connection(
         session, frame, NGHTTP2_ERR_PROTO,
         "HEADERS: no HEADERS allowed from client in reserved state");
@@ -4101,7 +4137,7 @@ int nghttp2_session_on_priority_received(nghttp2_session *session,
         session, NGHTTP2_PROTOCOL_ERROR, "depend on itself");
   }
 
-  if (!session->server) {
+  if (!nghttp2_session_server(session) || !NGHTTP2_REMOTE_PRIORITY_ENABLED) {
     /* Re-prioritization works only in server */
     return session_call_on_frame_received(session, frame);
   }
@@ -4467,7 +4503,7 @@ int nghttp2_session_on_settings_received(nghttp2_session *session,
             "SETTINGS: invalid SETTINGS_ENBLE_PUSH");
       }
 
-      if (!session->server && entry->value != 0) {
+      if (!nghttp2_session_server(session) && entry->value != 0) {
         return session_handle_invalid_connection(
             session, frame, NGHTTP2_ERR_PROTO,
             "SETTINGS: server attempted to enable push");
@@ -4531,7 +4567,7 @@ int nghttp2_session_on_settings_received(nghttp2_session *session,
             "SETTINGS: invalid SETTINGS_ENABLE_CONNECT_PROTOCOL");
       }
 
-      if (!session->server &&
+      if (!nghttp2_session_server(session) &&
           session->remote_settings.enable_connect_protocol &&
           entry->value == 0) {
         return session_handle_invalid_connection(
@@ -4610,7 +4646,8 @@ int nghttp2_session_on_push_promise_received(nghttp2_session *session,
     return session_inflate_handle_invalid_connection(
         session, frame, NGHTTP2_ERR_PROTO, "PUSH_PROMISE: stream_id == 0");
   }
-  if (session->server || session->local_settings.enable_push == 0) {
+  if (nghttp2_session_server(session) ||
+      session->local_settings.enable_push == 0) {
     return session_inflate_handle_invalid_connection(
         session, frame, NGHTTP2_ERR_PROTO, "PUSH_PROMISE: push disabled");
   }
@@ -5799,6 +5836,14 @@ ssize_t nghttp2_session_mem_recv(nghttp2_session *session, const uint8_t *in,
       default:
         DEBUGF("recv: extension frame\n");
 
+        if (!NGHTTP2_EXTENSIONS_ENABLED) {
+          busy = 1;
+
+          iframe->state = NGHTTP2_IB_IGN_PAYLOAD;
+
+          break;
+        }
+
         if (check_ext_type_set(session->user_recv_ext_types,
                                iframe->frame.hd.type)) {
           if (!session->callbacks.unpack_extension_callback) {
@@ -5831,7 +5876,7 @@ ssize_t nghttp2_session_mem_recv(nghttp2_session *session, const uint8_t *in,
             iframe->frame.hd.flags = NGHTTP2_FLAG_NONE;
             iframe->frame.ext.payload = &iframe->ext_frame_payload.altsvc;
 
-            if (session->server) {
+            if (nghttp2_session_server(session)) {
               busy = 1;
               iframe->state = NGHTTP2_IB_IGN_PAYLOAD;
               break;
@@ -5860,7 +5905,7 @@ ssize_t nghttp2_session_mem_recv(nghttp2_session *session, const uint8_t *in,
 
             iframe->frame.ext.payload = &iframe->ext_frame_payload.origin;
 
-            if (session->server || iframe->frame.hd.stream_id ||
+            if (nghttp2_session_server(session) || iframe->frame.hd.stream_id ||
                 (iframe->frame.hd.flags & 0xf0)) {
               busy = 1;
               iframe->state = NGHTTP2_IB_IGN_PAYLOAD;
@@ -7008,11 +7053,57 @@ session_append_inflight_settings(nghttp2_session *session,
   *i = settings;
 }
 
+/*
+ * Creates a copy of |iv| of length |niv| in which
+ * SETTINGS_ENABLE_PUSH is 0, and assigns it to |*iv_ptr| and its
+ * length to |*niv_ptr|.  The entry is appended if |iv| does not have
+ * one and the remote endpoint has not acknowledged that push is
+ * disabled yet.  This is used by client when server push is compiled
+ * out.
+ *
+ * This function returns 0 if it succeeds, or NGHTTP2_ERR_NOMEM.
+ */
+static int settings_disable_push(nghttp2_session *session,
+                                 nghttp2_settings_entry **iv_ptr,
+                                 size_t *niv_ptr,
+                                 const nghttp2_settings_entry *iv, size_t niv,
+                                 nghttp2_mem *mem) {
+  nghttp2_settings_entry *iv_copy;
+  size_t i;
+  int found = 0;
+
+  iv_copy = nghttp2_mem_malloc(mem, sizeof(nghttp2_settings_entry) * (niv + 1));
+  if (iv_copy == NULL) {
+    return NGHTTP2_ERR_NOMEM;
+  }
+
+  for (i = 0; i < niv; ++i) {
+    iv_copy[i] = iv[i];
+
+    if (iv_copy[i].settings_id == NGHTTP2_SETTINGS_ENABLE_PUSH) {
+      iv_copy[i].value = 0;
+      found = 1;
+    }
+  }
+
+  if (!found && session->local_settings.enable_push) {
+    iv_copy[niv].settings_id = NGHTTP2_SETTINGS_ENABLE_PUSH;
+    iv_copy[niv].value = 0;
+    ++niv;
+  }
+
+  *iv_ptr = iv_copy;
+  *niv_ptr = niv;
+
+  return 0;
+}
+
 int nghttp2_session_add_settings(nghttp2_session *session, uint8_t flags,
                                  const nghttp2_settings_entry *iv, size_t niv) {
   nghttp2_outbound_item *item;
   nghttp2_frame *frame;
   nghttp2_settings_entry *iv_copy;
+  nghttp2_settings_entry *iv_nopush = NULL;
   size_t i;
   int rv;
   nghttp2_mem *mem;
@@ -7034,8 +7125,21 @@ int nghttp2_session_add_settings(nghttp2_session *session, uint8_t flags,
     return NGHTTP2_ERR_INVALID_ARGUMENT;
   }
 
+  if (!NGHTTP2_PUSH_ENABLED && !nghttp2_session_server(session) &&
+      (flags & NGHTTP2_FLAG_ACK) == 0) {
+    /* Tell server that we never accept push, instead of refusing
+       each PUSH_PROMISE. */
+    rv = settings_disable_push(session, &iv_nopush, &niv, iv, niv, mem);
+    if (rv != 0) {
+      return rv;
+    }
+
+    iv = iv_nopush;
+  }
+
   item = nghttp2_mem_malloc(mem, sizeof(nghttp2_outbound_item));
   if (item == NULL) {
+    nghttp2_mem_free(mem, iv_nopush);
     return NGHTTP2_ERR_NOMEM;
   }
 
@@ -7043,6 +7147,7 @@ int nghttp2_session_add_settings(nghttp2_session *session, uint8_t flags,
     iv_copy = nghttp2_frame_iv_copy(iv, niv, mem);
     if (iv_copy == NULL) {
       nghttp2_mem_free(mem, item);
+      nghttp2_mem_free(mem, iv_nopush);
       return NGHTTP2_ERR_NOMEM;
     }
   } else {
@@ -7055,6 +7160,7 @@ int nghttp2_session_add_settings(nghttp2_session *session, uint8_t flags,
       assert(nghttp2_is_fatal(rv));
       nghttp2_mem_free(mem, iv_copy);
       nghttp2_mem_free(mem, item);
+      nghttp2_mem_free(mem, iv_nopush);
       return rv;
     }
   }
@@ -7073,6 +7179,7 @@ int nghttp2_session_add_settings(nghttp2_session *session, uint8_t flags,
 
     nghttp2_frame_settings_free(&frame->settings, mem);
     nghttp2_mem_free(mem, item);
+    nghttp2_mem_free(mem, iv_nopush);
 
     return rv;
   }
@@ -7108,6 +7215,8 @@ int nghttp2_session_add_settings(nghttp2_session *session, uint8_t flags,
     }
   }
 
+  nghttp2_mem_free(mem, iv_nopush);
+
   return 0;
 }
 
@@ -7273,7 +7382,8 @@ int nghttp2_session_set_stream_user_data(nghttp2_session *session,
     return 0;
   }
 
-  if (session->server || !nghttp2_session_is_my_stream_id(session, stream_id) ||
+  if (nghttp2_session_server(session) ||
+      !nghttp2_session_is_my_stream_id(session, stream_id) ||
       !nghttp2_outbound_queue_top(&session->ob_syn)) {
     return NGHTTP2_ERR_INVALID_ARGUMENT;
   }
@@ -7461,8 +7571,8 @@ static int nghttp2_session_upgrade_internal(nghttp2_session *session,
 
   mem = &session->mem;
 
-  if ((!session->server && session->next_stream_id != 1) ||
-      (session->server && session->last_recv_stream_id >= 1)) {
+  if ((!nghttp2_session_server(session) && session->next_stream_id != 1) ||
+      (nghttp2_session_server(session) && session->last_recv_stream_id >= 1)) {
     return NGHTTP2_ERR_PROTO;
   }
   if (settings_payloadlen % NGHTTP2_FRAME_SETTINGS_ENTRY_LENGTH) {
@@ -7479,7 +7589,7 @@ static int nghttp2_session_upgrade_internal(nghttp2_session *session,
     return rv;
   }
 
-  if (session->server) {
+  if (nghttp2_session_server(session)) {
     nghttp2_frame_hd_init(&frame.hd, settings_payloadlen, NGHTTP2_SETTINGS,
                           NGHTTP2_FLAG_NONE, 0);
     frame.settings.iv = iv;
@@ -7497,7 +7607,7 @@ static int nghttp2_session_upgrade_internal(nghttp2_session *session,
 
   stream = nghttp2_session_open_stream(
       session, 1, NGHTTP2_STREAM_FLAG_NONE, &pri_spec, NGHTTP2_STREAM_OPENING,
-      session->server ? NULL : stream_user_data);
+      nghttp2_session_server(session) ? NULL : stream_user_data);
   if (stream == NULL) {
     return NGHTTP2_ERR_NOMEM;
   }
@@ -7505,7 +7615,7 @@ static int nghttp2_session_upgrade_internal(nghttp2_session *session,
   /* We don't call nghttp2_session_adjust_closed_stream(), since this
      should be the first stream open. */
 
-  if (session->server) {
+  if (nghttp2_session_server(session)) {
     nghttp2_stream_shutdown(stream, NGHTTP2_SHUT_RD);
     session->last_recv_stream_id = 1;
     session->last_proc_stream_id = 1;
@@ -7680,7 +7790,7 @@ int nghttp2_session_set_next_stream_id(nghttp2_session *session,
     return NGHTTP2_ERR_INVALID_ARGUMENT;
   }
 
-  if (session->server) {
+  if (nghttp2_session_server(session)) {
     if (next_stream_id % 2) {
       return NGHTTP2_ERR_INVALID_ARGUMENT;
     }
@@ -7714,7 +7824,7 @@ nghttp2_stream *nghttp2_session_get_root_stream(nghttp2_session *session) {
 }
 
 int nghttp2_session_check_server_session(nghttp2_session *session) {
-  return session->server;
+  return nghttp2_session_server(session);
 }
 
 int nghttp2_session_change_stream_priority(
@@ -7794,6 +7904,23 @@ nghttp2_session_get_hd_deflate_dynamic_table_size(nghttp2_session *session) {
   return nghttp2_hd_deflate_get_dynamic_table_size(&session->hd_deflater);
 }
 
+int nghttp2_session_release_buffers(nghttp2_session *session) {
+  nghttp2_active_outbound_item *aob;
+
+  aob = &session->aob;
+
+  if (aob->item || aob->state != NGHTTP2_OB_POP_ITEM) {
+    return NGHTTP2_ERR_INVALID_STATE;
+  }
+
+  nghttp2_bufs_free(&aob->framebufs);
+
+  aob->framebufs.cur = NULL;
+  aob->framebufs.chunk_used = 0;
+
+  return 0;
+}
+
 void nghttp2_session_set_user_data(nghttp2_session *session, void *user_data) {
   session->user_data = user_data;
 }
@@ -44,6 +44,49 @@
    preface handling. */
 extern int nghttp2_enable_strict_preface;
 
+/*
+ * Build time specializations.  Defining NGHTTP2_SERVER_ONLY or
+ * NGHTTP2_CLIENT_ONLY restricts the library to the given role so
+ * that role dependent branches are resolved at compile time.
+ * NGHTTP2_NO_PUSH compiles out server push, and a client announces
+ * SETTINGS_ENABLE_PUSH = 0 so that server never sends PUSH_PROMISE.
+ * NGHTTP2_NO_REMOTE_PRIORITY ignores PRIORITY frames and the priority
+ * in HEADERS from the remote endpoint, and server does not retain
+ * closed streams for them.  The dependency tree itself stays because
+ * it also schedules the frames prioritized by the local endpoint.
+ * NGHTTP2_NO_EXTENSIONS compiles out the handling of extension
+ * frames.
+ */
+#if defined(NGHTTP2_SERVER_ONLY) && defined(NGHTTP2_CLIENT_ONLY)
+#  error "NGHTTP2_SERVER_ONLY and NGHTTP2_CLIENT_ONLY are mutually exclusive"
+#endif
+
+#if defined(NGHTTP2_SERVER_ONLY)
+#  define nghttp2_session_server(S) ((void)(S), 1)
+#elif defined(NGHTTP2_CLIENT_ONLY)
+#  define nghttp2_session_server(S) ((void)(S), 0)
+#else
+#  define nghttp2_session_server(S) ((S)->server)
+#endif
+
+#ifdef NGHTTP2_NO_PUSH
+#  define NGHTTP2_PUSH_ENABLED 0
+#else
+#  define NGHTTP2_PUSH_ENABLED 1
+#endif
+
+#ifdef NGHTTP2_NO_REMOTE_PRIORITY
+#  define NGHTTP2_REMOTE_PRIORITY_ENABLED 0
+#else
+#  define NGHTTP2_REMOTE_PRIORITY_ENABLED 1
+#endif
+
+#ifdef NGHTTP2_NO_EXTENSIONS
+#  define NGHTTP2_EXTENSIONS_ENABLED 0
+#else
+#  define NGHTTP2_EXTENSIONS_ENABLED 1
+#endif
+
 /*
  * Option flags.
  */
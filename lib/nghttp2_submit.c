@@ -63,11 +63,14 @@ static int detect_self_dependency(nghttp2_session *session, int32_t stream_id,
 
 /* This function takes ownership of |nva_copy|. Regardless of the
    return value, the caller must not free |nva_copy| after this
-   function returns. */
+   function returns.  If |rcnv| is nonzero, |nva_copy| must be
+   created by nghttp2_nv_array_copy_rcnv(), and the references to
+   nghttp2_rcbuf it holds are released when the frame is freed. */
 static int32_t submit_headers_shared(nghttp2_session *session, uint8_t flags,
                                      int32_t stream_id,
                                      const nghttp2_priority_spec *pri_spec,
                                      nghttp2_nv *nva_copy, size_t nvlen,
+                                     uint8_t rcnv,
                                      const nghttp2_data_provider *data_prd,
                                      void *stream_user_data) {
   int rv;
@@ -92,6 +95,7 @@ static int32_t submit_headers_shared(nghttp2_session *session, uint8_t flags,
   }
 
   item->aux_data.headers.stream_user_data = stream_user_data;
+  item->aux_data.headers.rcnv = rcnv;
 
   flags_copy =
       (uint8_t)((flags & (NGHTTP2_FLAG_END_STREAM | NGHTTP2_FLAG_PRIORITY)) |
@@ -120,8 +124,7 @@ static int32_t submit_headers_shared(nghttp2_session *session, uint8_t flags,
   rv = nghttp2_session_add_item(session, item);
 
   if (rv != 0) {
-    nghttp2_frame_headers_free(&frame->headers, mem);
-    goto fail2;
+    goto fail;
   }
 
   if (hcat == NGHTTP2_HCAT_REQUEST) {
@@ -131,9 +134,10 @@ static int32_t submit_headers_shared(nghttp2_session *session, uint8_t flags,
   return 0;
 
 fail:
-  /* nghttp2_frame_headers_init() takes ownership of nva_copy. */
+  if (rcnv) {
+    nghttp2_nv_array_rcnv_release(nva_copy, nvlen);
+  }
   nghttp2_nv_array_del(nva_copy, mem);
-fail2:
   nghttp2_mem_free(mem, item);
 
   return rv;
@@ -165,7 +169,36 @@ static int32_t submit_headers_shared_nva(nghttp2_session *session,
   }
 
   return submit_headers_shared(session, flags, stream_id, &copy_pri_spec,
-                               nva_copy, nvlen, data_prd, stream_user_data);
+                               nva_copy, nvlen, 0, data_prd, stream_user_data);
+}
+
+static int32_t submit_headers_shared_rcnv(nghttp2_session *session,
+                                          uint8_t flags, int32_t stream_id,
+                                          const nghttp2_priority_spec *pri_spec,
+                                          const nghttp2_rcnv *nva, size_t nvlen,
+                                          const nghttp2_data_provider *data_prd,
+                                          void *stream_user_data) {
+  int rv;
+  nghttp2_nv *nva_copy;
+  nghttp2_priority_spec copy_pri_spec;
+  nghttp2_mem *mem;
+
+  mem = &session->mem;
+
+  if (pri_spec) {
+    copy_pri_spec = *pri_spec;
+    nghttp2_priority_spec_normalize_weight(&copy_pri_spec);
+  } else {
+    nghttp2_priority_spec_default_init(&copy_pri_spec);
+  }
+
+  rv = nghttp2_nv_array_copy_rcnv(&nva_copy, nva, nvlen, mem);
+  if (rv < 0) {
+    return rv;
+  }
+
+  return submit_headers_shared(session, flags, stream_id, &copy_pri_spec,
+                               nva_copy, nvlen, 1, data_prd, stream_user_data);
 }
 
 int nghttp2_submit_trailer(nghttp2_session *session, int32_t stream_id,
@@ -187,7 +220,7 @@ int32_t nghttp2_submit_headers(nghttp2_session *session, uint8_t flags,
   int rv;
 
   if (stream_id == -1) {
-    if (session->server) {
+    if (nghttp2_session_server(session)) {
       return NGHTTP2_ERR_PROTO;
     }
   } else if (stream_id <= 0) {
@@ -211,6 +244,49 @@ int32_t nghttp2_submit_headers(nghttp2_session *session, uint8_t flags,
                                    nvlen, NULL, stream_user_data);
 }
 
+int nghttp2_submit_trailer_rcnv(nghttp2_session *session, int32_t stream_id,
+                                const nghttp2_rcnv *nva, size_t nvlen) {
+  if (stream_id <= 0) {
+    return NGHTTP2_ERR_INVALID_ARGUMENT;
+  }
+
+  return (int)submit_headers_shared_rcnv(session, NGHTTP2_FLAG_END_STREAM,
+                                         stream_id, NULL, nva, nvlen, NULL,
+                                         NULL);
+}
+
+int32_t nghttp2_submit_headers_rcnv(nghttp2_session *session, uint8_t flags,
+                                    int32_t stream_id,
+                                    const nghttp2_priority_spec *pri_spec,
+                                    const nghttp2_rcnv *nva, size_t nvlen,
+                                    void *stream_user_data) {
+  int rv;
+
+  if (stream_id == -1) {
+    if (nghttp2_session_server(session)) {
+      return NGHTTP2_ERR_PROTO;
+    }
+  } else if (stream_id <= 0) {
+    return NGHTTP2_ERR_INVALID_ARGUMENT;
+  }
+
+  flags &= NGHTTP2_FLAG_END_STREAM;
+
+  if (pri_spec && !nghttp2_priority_spec_check_default(pri_spec)) {
+    rv = detect_self_dependency(session, stream_id, pri_spec);
+    if (rv != 0) {
+      return rv;
+    }
+
+    flags |= NGHTTP2_FLAG_PRIORITY;
+  } else {
+    pri_spec = NULL;
+  }
+
+  return submit_headers_shared_rcnv(session, flags, stream_id, pri_spec, nva,
+                                    nvlen, NULL, stream_user_data);
+}
+
 int nghttp2_submit_ping(nghttp2_session *session, uint8_t flags,
                         const uint8_t *opaque_data) {
   flags &= NGHTTP2_FLAG_ACK;
@@ -290,7 +366,7 @@ int nghttp2_submit_goaway(nghttp2_session *session, uint8_t flags,
 }
 
 int nghttp2_submit_shutdown_notice(nghttp2_session *session) {
-  if (!session->server) {
+  if (!nghttp2_session_server(session)) {
     return NGHTTP2_ERR_INVALID_STATE;
   }
   if (session->goaway_flags) {
@@ -326,10 +402,14 @@ int32_t nghttp2_submit_push_promise(nghttp2_session *session, uint8_t flags,
     return NGHTTP2_ERR_INVALID_ARGUMENT;
   }
 
-  if (!session->server) {
+  if (!nghttp2_session_server(session)) {
     return NGHTTP2_ERR_PROTO;
   }
 
+  if (!NGHTTP2_PUSH_ENABLED) {
+    return NGHTTP2_ERR_PUSH_DISABLED;
+  }
+
   /* All 32bit signed stream IDs are spent. */
   if (session->next_stream_id > INT32_MAX) {
     return NGHTTP2_ERR_STREAM_ID_NOT_AVAILABLE;
@@ -512,7 +592,7 @@ int nghttp2_submit_altsvc(nghttp2_session *session, uint8_t flags,
 
   mem = &session->mem;
 
-  if (!session->server) {
+  if (!NGHTTP2_EXTENSIONS_ENABLED || !nghttp2_session_server(session)) {
     return NGHTTP2_ERR_INVALID_STATE;
   }
 
@@ -596,7 +676,7 @@ int nghttp2_submit_origin(nghttp2_session *session, uint8_t flags,
 
   mem = &session->mem;
 
-  if (!session->server) {
+  if (!NGHTTP2_EXTENSIONS_ENABLED || !nghttp2_session_server(session)) {
     return NGHTTP2_ERR_INVALID_STATE;
   }
 
@@ -686,7 +766,7 @@ int32_t nghttp2_submit_request(nghttp2_session *session,
   uint8_t flags;
   int rv;
 
-  if (session->server) {
+  if (nghttp2_session_server(session)) {
     return NGHTTP2_ERR_PROTO;
   }
 
@@ -722,7 +802,7 @@ int nghttp2_submit_response(nghttp2_session *session, int32_t stream_id,
     return NGHTTP2_ERR_INVALID_ARGUMENT;
   }
 
-  if (!session->server) {
+  if (!nghttp2_session_server(session)) {
     return NGHTTP2_ERR_PROTO;
   }
 
@@ -731,6 +811,51 @@ int nghttp2_submit_response(nghttp2_session *session, int32_t stream_id,
                                    data_prd, NULL);
 }
 
+int32_t nghttp2_submit_request_rcnv(nghttp2_session *session,
+                                    const nghttp2_priority_spec *pri_spec,
+                                    const nghttp2_rcnv *nva, size_t nvlen,
+                                    const nghttp2_data_provider *data_prd,
+                                    void *stream_user_data) {
+  uint8_t flags;
+  int rv;
+
+  if (nghttp2_session_server(session)) {
+    return NGHTTP2_ERR_PROTO;
+  }
+
+  if (pri_spec && !nghttp2_priority_spec_check_default(pri_spec)) {
+    rv = detect_self_dependency(session, -1, pri_spec);
+    if (rv != 0) {
+      return rv;
+    }
+  } else {
+    pri_spec = NULL;
+  }
+
+  flags = set_request_flags(pri_spec, data_prd);
+
+  return submit_headers_shared_rcnv(session, flags, -1, pri_spec, nva, nvlen,
+                                    data_prd, stream_user_data);
+}
+
+int nghttp2_submit_response_rcnv(nghttp2_session *session, int32_t stream_id,
+                                 const nghttp2_rcnv *nva, size_t nvlen,
+                                 const nghttp2_data_provider *data_prd) {
+  uint8_t flags;
+
+  if (stream_id <= 0) {
+    return NGHTTP2_ERR_INVALID_ARGUMENT;
+  }
+
+  if (!nghttp2_session_server(session)) {
+    return NGHTTP2_ERR_PROTO;
+  }
+
+  flags = set_response_flags(data_prd);
+  return submit_headers_shared_rcnv(session, flags, stream_id, NULL, nva,
+                                    nvlen, data_prd, NULL);
+}
+
 int nghttp2_submit_data(nghttp2_session *session, uint8_t flags,
                         int32_t stream_id,
                         const nghttp2_data_provider *data_prd) {
@@ -799,7 +924,8 @@ int nghttp2_submit_extension(nghttp2_session *session, uint8_t type,
     return NGHTTP2_ERR_INVALID_ARGUMENT;
   }
 
-  if (!session->callbacks.pack_extension_callback) {
+  if (!NGHTTP2_EXTENSIONS_ENABLED ||
+      !session->callbacks.pack_extension_callback) {
     return NGHTTP2_ERR_INVALID_STATE;
   }
 
@@ -35,6 +35,7 @@ cdef extern from 'nghttp2/nghttp2.h':
     ctypedef enum nghttp2_error:
         NGHTTP2_ERR_TEMPORAL_CALLBACK_FAILURE
         NGHTTP2_ERR_DEFERRED
+        NGHTTP2_ERR_CALLBACK_FAILURE
 
     ctypedef enum nghttp2_flag:
         NGHTTP2_FLAG_NONE
@@ -66,6 +67,19 @@ cdef extern from 'nghttp2/nghttp2.h':
         uint16_t valuelen
         uint8_t flags
 
+    ctypedef struct nghttp2_vec:
+        uint8_t *base
+        size_t len
+
+    ctypedef struct nghttp2_rcbuf:
+        pass
+
+    void nghttp2_rcbuf_incref(nghttp2_rcbuf *rcbuf)
+
+    void nghttp2_rcbuf_decref(nghttp2_rcbuf *rcbuf)
+
+    nghttp2_vec nghttp2_rcbuf_get_buf(nghttp2_rcbuf *rcbuf)
+
     ctypedef enum nghttp2_settings_id:
         SETTINGS_HEADER_TABLE_SIZE
         NGHTTP2_SETTINGS_HEADER_TABLE_SIZE
@@ -156,6 +170,13 @@ cdef extern from 'nghttp2/nghttp2.h':
          uint8_t flags,
          void *user_data)
 
+    ctypedef int (*nghttp2_on_header_callback2)\
+        (nghttp2_session *session,
+         const nghttp2_frame *frame,
+         nghttp2_rcbuf *name, nghttp2_rcbuf *value,
+         uint8_t flags,
+         void *user_data)
+
     ctypedef int (*nghttp2_on_frame_send_callback)\
         (nghttp2_session *session, const nghttp2_frame *frame, void *user_data)
 
@@ -206,6 +227,10 @@ cdef extern from 'nghttp2/nghttp2.h':
         nghttp2_session_callbacks *cbs,
         nghttp2_on_header_callback on_header_callback)
 
+    void nghttp2_session_callbacks_set_on_header_callback2(
+        nghttp2_session_callbacks *cbs,
+        nghttp2_on_header_callback2 on_header_callback2)
+
     int nghttp2_session_client_new(nghttp2_session **session_ptr,
                                    const nghttp2_session_callbacks *callbacks,
                                    void *user_data)
@@ -236,6 +261,7 @@ cdef extern from 'nghttp2/nghttp2.h':
     ctypedef enum nghttp2_data_flag:
         NGHTTP2_DATA_FLAG_NONE
         NGHTTP2_DATA_FLAG_EOF
+        NGHTTP2_DATA_FLAG_NO_COPY
 
     ctypedef ssize_t (*nghttp2_data_source_read_callback)\
         (nghttp2_session *session, int32_t stream_id,
@@ -246,6 +272,15 @@ cdef extern from 'nghttp2/nghttp2.h':
         nghttp2_data_source source
         nghttp2_data_source_read_callback read_callback
 
+    ctypedef int (*nghttp2_send_data_callback)\
+        (nghttp2_session *session, nghttp2_frame *frame,
+         const uint8_t *framehd, size_t length,
+         nghttp2_data_source *source, void *user_data)
+
+    void nghttp2_session_callbacks_set_send_data_callback(
+        nghttp2_session_callbacks *cbs,
+        nghttp2_send_data_callback send_data_callback)
+
     ctypedef struct nghttp2_priority_spec:
         int32_t stream_id
         int32_t weight
@@ -22,7 +22,7 @@
 # WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 cimport cnghttp2
 
-from libc.stdlib cimport malloc, free
+from libc.stdlib cimport malloc, calloc, realloc, free
 from libc.string cimport memcpy, memset
 from libc.stdint cimport uint8_t, uint16_t, uint32_t, int32_t
 import logging
@@ -285,9 +285,9 @@ def wrap_body(body):
     if body is None:
         return body
     elif isinstance(body, str):
-        return _ByteIOWrapper(io.BytesIO(body.encode('utf-8'))).generate
-    elif isinstance(body, bytes):
-        return _ByteIOWrapper(io.BytesIO(body)).generate
+        return _BufferSource(body.encode('utf-8'))
+    elif isinstance(body, (bytes, bytearray, memoryview)):
+        return _BufferSource(body)
     elif isinstance(body, io.IOBase):
         return _ByteIOWrapper(body).generate
     else:
@@ -314,6 +314,101 @@ def set_application_protocol(ssl_ctx):
     if tls.HAS_ALPN:
         ssl_ctx.set_alpn_protocols(app_protos)
 
+# Per stream state used in batch mode.  Request header fields and
+# body are accumulated here while nghttp2_session_mem_recv() runs, and
+# they are handed to a request handler at once after it returns.
+cdef struct _StreamBuffer:
+    int32_t stream_id
+    # Borrowed reference to the request handler.  It is NULL until the
+    # request is dispatched.  The handler is kept alive by
+    # _HTTP2SessionCoreBase.handlers.
+    void *handler
+    # Received header fields.  Each field takes 2 elements, name and
+    # value.
+    cnghttp2.nghttp2_rcbuf **nva
+    size_t nvlen
+    size_t nvcap
+    # Received request body which is not dispatched yet.
+    uint8_t *data
+    size_t datalen
+    size_t datacap
+    # True if whole request was received.
+    bint request_done
+    # True if this object is in the list of streams to dispatch.
+    bint queued
+    # True if stream was closed while this object is queued.
+    bint closed
+    # Link to the next object in the list of streams to dispatch.
+    _StreamBuffer *ready_next
+    # Links in the list of all objects owned by a session.
+    _StreamBuffer *prev
+    _StreamBuffer *next
+
+# The amount of buffered request body which triggers dispatch before
+# the whole request is received.
+cdef size_t BATCH_DATA_FLUSH_SIZE = 65536
+
+cdef void _stream_buffer_free_nva(_StreamBuffer *sb):
+    cdef size_t i
+
+    for i in range(sb.nvlen * 2):
+        cnghttp2.nghttp2_rcbuf_decref(sb.nva[i])
+
+    free(sb.nva)
+    sb.nva = NULL
+    sb.nvlen = 0
+    sb.nvcap = 0
+
+cdef void _stream_buffer_free_data(_StreamBuffer *sb):
+    free(sb.data)
+    sb.data = NULL
+    sb.datalen = 0
+    sb.datacap = 0
+
+cdef int _stream_buffer_add_header(_StreamBuffer *sb,
+                                   cnghttp2.nghttp2_rcbuf *name,
+                                   cnghttp2.nghttp2_rcbuf *value):
+    cdef cnghttp2.nghttp2_rcbuf **nva
+    cdef size_t nvcap
+
+    if sb.nvlen == sb.nvcap:
+        nvcap = sb.nvcap * 2 if sb.nvcap else 16
+        nva = <cnghttp2.nghttp2_rcbuf**>realloc\
+              (sb.nva, sizeof(cnghttp2.nghttp2_rcbuf*) * nvcap * 2)
+        if nva == NULL:
+            return -1
+        sb.nva = nva
+        sb.nvcap = nvcap
+
+    cnghttp2.nghttp2_rcbuf_incref(name)
+    cnghttp2.nghttp2_rcbuf_incref(value)
+
+    sb.nva[sb.nvlen * 2] = name
+    sb.nva[sb.nvlen * 2 + 1] = value
+    sb.nvlen += 1
+
+    return 0
+
+cdef int _stream_buffer_add_data(_StreamBuffer *sb, const uint8_t *data,
+                                 size_t length):
+    cdef uint8_t *p
+    cdef size_t datacap
+
+    if sb.datalen + length > sb.datacap:
+        datacap = sb.datacap if sb.datacap else 4096
+        while datacap < sb.datalen + length:
+            datacap *= 2
+        p = <uint8_t*>realloc(sb.data, datacap)
+        if p == NULL:
+            return -1
+        sb.data = p
+        sb.datacap = datacap
+
+    memcpy(sb.data + sb.datalen, data, length)
+    sb.datalen += length
+
+    return 0
+
 cdef _get_stream_user_data(cnghttp2.nghttp2_session *session,
                            int32_t stream_id):
     cdef void *stream_user_data
@@ -325,6 +420,19 @@ cdef _get_stream_user_data(cnghttp2.nghttp2_session *session,
 
     return <object>stream_user_data
 
+cdef _get_handler(_HTTP2SessionCoreBase http2, int32_t stream_id):
+    cdef _StreamBuffer *sb
+
+    if not http2.batch:
+        return _get_stream_user_data(http2.session, stream_id)
+
+    sb = <_StreamBuffer*>cnghttp2.nghttp2_session_get_stream_user_data\
+         (http2.session, stream_id)
+    if sb == NULL or sb.handler == NULL:
+        return None
+
+    return <object>sb.handler
+
 cdef size_t _make_nva(cnghttp2.nghttp2_nv **nva_ptr, headers):
     cdef cnghttp2.nghttp2_nv *nva
     cdef size_t nvlen
@@ -478,13 +586,12 @@ cdef int on_data_chunk_recv(cnghttp2.nghttp2_session *session,
 cdef int server_on_frame_send(cnghttp2.nghttp2_session *session,
                               const cnghttp2.nghttp2_frame *frame,
                               void *user_data):
-    cdef http2 = <_HTTP2SessionCore>user_data
+    cdef _HTTP2SessionCore http2 = <_HTTP2SessionCore>user_data
     logging.debug('server_on_frame_send, type:%s, stream_id:%s', frame.hd.type, frame.hd.stream_id)
 
     if frame.hd.type == cnghttp2.NGHTTP2_PUSH_PROMISE:
         # For PUSH_PROMISE, send push response immediately
-        handler = _get_stream_user_data\
-                  (session, frame.push_promise.promised_stream_id)
+        handler = _get_handler(http2, frame.push_promise.promised_stream_id)
         if not handler:
             return 0
 
@@ -505,14 +612,16 @@ cdef int server_on_frame_not_send(cnghttp2.nghttp2_session *session,
                                   const cnghttp2.nghttp2_frame *frame,
                                   int lib_error_code,
                                   void *user_data):
-    cdef http2 = <_HTTP2SessionCore>user_data
+    cdef _HTTP2SessionCore http2 = <_HTTP2SessionCore>user_data
     logging.debug('server_on_frame_not_send, type:%s, stream_id:%s', frame.hd.type, frame.hd.stream_id)
 
     if frame.hd.type == cnghttp2.NGHTTP2_PUSH_PROMISE:
         # We have to remove handler here. Without this, it is not
         # removed until session is terminated.
-        handler = _get_stream_user_data\
-                  (session, frame.push_promise.promised_stream_id)
+        handler = _get_handler(http2, frame.push_promise.promised_stream_id)
+        if http2.batch:
+            http2._release_stream_buffer\
+                (frame.push_promise.promised_stream_id)
         if not handler:
             return 0
         http2._remove_handler(handler)
@@ -521,10 +630,13 @@ cdef int on_stream_close(cnghttp2.nghttp2_session *session,
                                 int32_t stream_id,
                                 uint32_t error_code,
                                 void *user_data):
-    cdef http2 = <_HTTP2SessionCoreBase>user_data
+    cdef _HTTP2SessionCoreBase http2 = <_HTTP2SessionCoreBase>user_data
     logging.debug('on_stream_close, stream_id:%s', stream_id)
 
-    handler = _get_stream_user_data(session, stream_id)
+    handler = _get_handler(http2, stream_id)
+    if http2.batch:
+        http2._release_stream_buffer(stream_id)
+
     if not handler:
         return 0
 
@@ -537,6 +649,97 @@ cdef int on_stream_close(cnghttp2.nghttp2_session *session,
 
     return 0
 
+cdef int batch_on_begin_headers(cnghttp2.nghttp2_session *session,
+                                const cnghttp2.nghttp2_frame *frame,
+                                void *user_data):
+    cdef _HTTP2SessionCore http2 = <_HTTP2SessionCore>user_data
+    cdef _StreamBuffer *sb
+
+    if frame.hd.type != cnghttp2.NGHTTP2_HEADERS or \
+       frame.headers.cat != cnghttp2.NGHTTP2_HCAT_REQUEST:
+        return 0
+
+    sb = http2._new_stream_buffer(frame.hd.stream_id)
+    if sb == NULL:
+        return cnghttp2.NGHTTP2_ERR_CALLBACK_FAILURE
+
+    cnghttp2.nghttp2_session_set_stream_user_data(session, frame.hd.stream_id,
+                                                  <void*>sb)
+
+    return 0
+
+cdef int batch_on_header(cnghttp2.nghttp2_session *session,
+                         const cnghttp2.nghttp2_frame *frame,
+                         cnghttp2.nghttp2_rcbuf *name,
+                         cnghttp2.nghttp2_rcbuf *value,
+                         uint8_t flags,
+                         void *user_data):
+    cdef _StreamBuffer *sb
+    cdef cnghttp2.nghttp2_vec namebuf, valuebuf
+
+    if frame.hd.type != cnghttp2.NGHTTP2_HEADERS:
+        return 0
+
+    sb = <_StreamBuffer*>cnghttp2.nghttp2_session_get_stream_user_data\
+         (session, frame.hd.stream_id)
+    if sb == NULL:
+        return 0
+
+    if sb.handler != NULL:
+        # Trailer fields after the request was dispatched
+        namebuf = cnghttp2.nghttp2_rcbuf_get_buf(name)
+        valuebuf = cnghttp2.nghttp2_rcbuf_get_buf(value)
+        return on_header(namebuf.base, namebuf.len,
+                         valuebuf.base, valuebuf.len, flags,
+                         <object>sb.handler)
+
+    if _stream_buffer_add_header(sb, name, value) != 0:
+        return cnghttp2.NGHTTP2_ERR_CALLBACK_FAILURE
+
+    return 0
+
+cdef int batch_on_frame_recv(cnghttp2.nghttp2_session *session,
+                             const cnghttp2.nghttp2_frame *frame,
+                             void *user_data):
+    cdef _HTTP2SessionCore http2 = <_HTTP2SessionCore>user_data
+    cdef _StreamBuffer *sb
+
+    if frame.hd.type == cnghttp2.NGHTTP2_DATA or \
+       frame.hd.type == cnghttp2.NGHTTP2_HEADERS:
+        if (frame.hd.flags & cnghttp2.NGHTTP2_FLAG_END_STREAM) == 0:
+            return 0
+        sb = <_StreamBuffer*>cnghttp2.nghttp2_session_get_stream_user_data\
+             (session, frame.hd.stream_id)
+        if sb == NULL:
+            return 0
+        sb.request_done = True
+        http2._queue_stream_buffer(sb)
+    elif frame.hd.type == cnghttp2.NGHTTP2_SETTINGS:
+        if (frame.hd.flags & cnghttp2.NGHTTP2_FLAG_ACK):
+            http2._stop_settings_timer()
+
+    return 0
+
+cdef int batch_on_data_chunk_recv(cnghttp2.nghttp2_session *session,
+                                  uint8_t flags,
+                                  int32_t stream_id, const uint8_t *data,
+                                  size_t length, void *user_data):
+    cdef _HTTP2SessionCore http2 = <_HTTP2SessionCore>user_data
+    cdef _StreamBuffer *sb
+
+    sb = <_StreamBuffer*>cnghttp2.nghttp2_session_get_stream_user_data\
+         (session, stream_id)
+    if sb == NULL:
+        return 0
+
+    if _stream_buffer_add_data(sb, data, length) != 0:
+        return cnghttp2.NGHTTP2_ERR_CALLBACK_FAILURE
+
+    if sb.datalen >= BATCH_DATA_FLUSH_SIZE:
+        http2._queue_stream_buffer(sb)
+
+    return 0
+
 cdef ssize_t data_source_read(cnghttp2.nghttp2_session *session,
                               int32_t stream_id,
                               uint8_t *buf, size_t length,
@@ -576,6 +779,76 @@ cdef ssize_t data_source_read(cnghttp2.nghttp2_session *session,
 
     return nread
 
+cdef class _BufferSource:
+    # Response (or request) body backed by an object supporting buffer
+    # protocol.  Its content is written to transport directly from
+    # send_data_callback, without copying it into nghttp2 buffer.
+    cdef object view
+    cdef size_t offset
+    cdef size_t length
+
+    def __cinit__(self, data):
+        self.view = memoryview(data).cast('B')
+        self.offset = 0
+        self.length = len(self.view)
+
+cdef ssize_t buffer_source_read(cnghttp2.nghttp2_session *session,
+                                int32_t stream_id,
+                                uint8_t *buf, size_t length,
+                                uint32_t *data_flags,
+                                cnghttp2.nghttp2_data_source *source,
+                                void *user_data):
+    cdef _HTTP2SessionCoreBase http2 = <_HTTP2SessionCoreBase>user_data
+    cdef _BufferSource body = <_BufferSource>source.ptr
+    cdef size_t nread
+
+    # offset is advanced in send_data_callback
+    nread = min(length, body.length - body.offset)
+
+    data_flags[0] = cnghttp2.NGHTTP2_DATA_FLAG_NO_COPY
+
+    if body.offset + nread == body.length:
+        data_flags[0] |= cnghttp2.NGHTTP2_DATA_FLAG_EOF
+        if cnghttp2.nghttp2_session_check_server_session(session):
+            # Send RST_STREAM if remote is not closed yet
+            if cnghttp2.nghttp2_session_get_stream_remote_close(
+                    session, stream_id) == 0:
+                http2._rst_stream(stream_id, cnghttp2.NGHTTP2_NO_ERROR)
+
+    return nread
+
+cdef int send_data_callback(cnghttp2.nghttp2_session *session,
+                            cnghttp2.nghttp2_frame *frame,
+                            const uint8_t *framehd, size_t length,
+                            cnghttp2.nghttp2_data_source *source,
+                            void *user_data):
+    cdef _HTTP2SessionCoreBase http2 = <_HTTP2SessionCoreBase>user_data
+    cdef _BufferSource body = <_BufferSource>source.ptr
+    cdef size_t padlen = frame.data.padlen
+
+    try:
+        http2.transport.write(framehd[:9])
+        if padlen > 0:
+            http2.transport.write(bytes([padlen - 1]))
+        if length > 0:
+            http2.transport.write(body.view[body.offset:body.offset + length])
+        if padlen > 1:
+            http2.transport.write(bytes(padlen - 1))
+    except:
+        sys.stderr.write(traceback.format_exc())
+        return cnghttp2.NGHTTP2_ERR_CALLBACK_FAILURE
+
+    body.offset += length
+
+    return 0
+
+cdef _set_data_provider(cnghttp2.nghttp2_data_provider *prd, body):
+    prd.source.ptr = <void*>body
+    if isinstance(body, _BufferSource):
+        prd.read_callback = buffer_source_read
+    else:
+        prd.read_callback = data_source_read
+
 cdef int client_on_begin_headers(cnghttp2.nghttp2_session *session,
                                  const cnghttp2.nghttp2_frame *frame,
                                  void *user_data):
@@ -666,18 +939,39 @@ cdef class _HTTP2SessionCoreBase:
     cdef handlers
     cdef settings_timer
     cdef inside_callback
-
-    def __cinit__(self, transport, handler_class=None):
+    # True if request handlers are invoked in batch mode.
+    cdef bint batch
+    # All _StreamBuffer objects owned by this session.
+    cdef _StreamBuffer *streams
+    # The list of _StreamBuffer objects to dispatch after
+    # nghttp2_session_mem_recv() returns.
+    cdef _StreamBuffer *ready_head
+    cdef _StreamBuffer *ready_tail
+
+    def __cinit__(self, transport, handler_class=None, batch=False):
         self.session = NULL
         self.transport = transport
         self.handler_class = handler_class
         self.handlers = set()
         self.settings_timer = None
         self.inside_callback = False
+        self.batch = batch
+        self.streams = NULL
+        self.ready_head = NULL
+        self.ready_tail = NULL
 
     def __dealloc__(self):
+        cdef _StreamBuffer *sb
+
         cnghttp2.nghttp2_session_del(self.session)
 
+        while self.streams != NULL:
+            sb = self.streams
+            self.streams = sb.next
+            _stream_buffer_free_nva(sb)
+            _stream_buffer_free_data(sb)
+            free(sb)
+
     def data_received(self, data):
         cdef ssize_t rv
 
@@ -685,8 +979,137 @@ cdef class _HTTP2SessionCoreBase:
         if rv < 0:
             raise Exception('nghttp2_session_mem_recv failed: {}'.format\
                             (_strerror(rv)))
+        if self.ready_head != NULL:
+            self._dispatch_batch()
         self.send_data()
 
+    cdef _StreamBuffer *_new_stream_buffer(self, int32_t stream_id):
+        cdef _StreamBuffer *sb
+
+        sb = <_StreamBuffer*>calloc(1, sizeof(_StreamBuffer))
+        if sb == NULL:
+            return NULL
+
+        sb.stream_id = stream_id
+
+        sb.next = self.streams
+        if self.streams != NULL:
+            self.streams.prev = sb
+        self.streams = sb
+
+        return sb
+
+    cdef void _delete_stream_buffer(self, _StreamBuffer *sb):
+        if sb.prev != NULL:
+            sb.prev.next = sb.next
+        else:
+            self.streams = sb.next
+        if sb.next != NULL:
+            sb.next.prev = sb.prev
+
+        _stream_buffer_free_nva(sb)
+        _stream_buffer_free_data(sb)
+        free(sb)
+
+    cdef void _release_stream_buffer(self, int32_t stream_id):
+        cdef _StreamBuffer *sb
+
+        sb = <_StreamBuffer*>cnghttp2.nghttp2_session_get_stream_user_data\
+             (self.session, stream_id)
+        if sb == NULL:
+            return
+
+        cnghttp2.nghttp2_session_set_stream_user_data(self.session, stream_id,
+                                                      NULL)
+
+        if sb.queued:
+            # _dispatch_batch() deletes it.
+            sb.closed = True
+            return
+
+        self._delete_stream_buffer(sb)
+
+    cdef void _queue_stream_buffer(self, _StreamBuffer *sb):
+        if sb.queued:
+            return
+
+        sb.queued = True
+        sb.ready_next = NULL
+
+        if self.ready_tail != NULL:
+            self.ready_tail.ready_next = sb
+        else:
+            self.ready_head = sb
+        self.ready_tail = sb
+
+    cdef _dispatch_batch(self):
+        cdef _StreamBuffer *sb
+
+        while self.ready_head != NULL:
+            sb = self.ready_head
+            self.ready_head = sb.ready_next
+            if self.ready_head == NULL:
+                self.ready_tail = NULL
+
+            sb.ready_next = NULL
+            sb.queued = False
+
+            if sb.closed:
+                self._delete_stream_buffer(sb)
+                continue
+
+            self._dispatch_stream_buffer(sb)
+
+    cdef _dispatch_stream_buffer(self, _StreamBuffer *sb):
+        cdef cnghttp2.nghttp2_vec name, value
+        cdef size_t i
+        cdef bint first
+
+        first = sb.handler == NULL
+
+        if first:
+            handler = self._make_handler(sb.stream_id)
+            sb.handler = <void*>handler
+
+            for i in range(sb.nvlen):
+                name = cnghttp2.nghttp2_rcbuf_get_buf(sb.nva[i * 2])
+                value = cnghttp2.nghttp2_rcbuf_get_buf(sb.nva[i * 2 + 1])
+                on_header(name.base, name.len, value.base, value.len, 0,
+                          handler)
+
+            _stream_buffer_free_nva(sb)
+
+            if handler.cookies:
+                handler.headers.append((b'cookie',
+                                        b'; '.join(handler.cookies)))
+                handler.cookies = None
+        else:
+            handler = <object>sb.handler
+
+        if sb.datalen:
+            data = sb.data[:sb.datalen]
+        else:
+            data = None
+
+        if sb.request_done:
+            _stream_buffer_free_data(sb)
+        else:
+            sb.datalen = 0
+
+        try:
+            if first and sb.request_done:
+                handler.on_request(data)
+            else:
+                if first:
+                    handler.on_headers()
+                if data is not None:
+                    handler.on_data(data)
+                if sb.request_done:
+                    handler.on_request_done()
+        except:
+            sys.stderr.write(traceback.format_exc())
+            self._rst_stream(sb.stream_id)
+
     OUTBUF_MAX = 65535
     SETTINGS_TIMEOUT = 5.0
 
@@ -826,20 +1249,32 @@ cdef class _HTTP2SessionCore(_HTTP2SessionCoreBase):
             raise Exception('nghttp2_session_callbacks_new failed: {}'.format\
                             (_strerror(rv)))
 
-        cnghttp2.nghttp2_session_callbacks_set_on_header_callback(
-            callbacks, server_on_header)
-        cnghttp2.nghttp2_session_callbacks_set_on_begin_headers_callback(
-            callbacks, server_on_begin_headers)
-        cnghttp2.nghttp2_session_callbacks_set_on_frame_recv_callback(
-            callbacks, server_on_frame_recv)
+        if self.batch:
+            cnghttp2.nghttp2_session_callbacks_set_on_header_callback2(
+                callbacks, batch_on_header)
+            cnghttp2.nghttp2_session_callbacks_set_on_begin_headers_callback(
+                callbacks, batch_on_begin_headers)
+            cnghttp2.nghttp2_session_callbacks_set_on_frame_recv_callback(
+                callbacks, batch_on_frame_recv)
+            cnghttp2.nghttp2_session_callbacks_set_on_data_chunk_recv_callback(
+                callbacks, batch_on_data_chunk_recv)
+        else:
+            cnghttp2.nghttp2_session_callbacks_set_on_header_callback(
+                callbacks, server_on_header)
+            cnghttp2.nghttp2_session_callbacks_set_on_begin_headers_callback(
+                callbacks, server_on_begin_headers)
+            cnghttp2.nghttp2_session_callbacks_set_on_frame_recv_callback(
+                callbacks, server_on_frame_recv)
+            cnghttp2.nghttp2_session_callbacks_set_on_data_chunk_recv_callback(
+                callbacks, on_data_chunk_recv)
         cnghttp2.nghttp2_session_callbacks_set_on_stream_close_callback(
             callbacks, on_stream_close)
         cnghttp2.nghttp2_session_callbacks_set_on_frame_send_callback(
             callbacks, server_on_frame_send)
         cnghttp2.nghttp2_session_callbacks_set_on_frame_not_send_callback(
             callbacks, server_on_frame_not_send)
-        cnghttp2.nghttp2_session_callbacks_set_on_data_chunk_recv_callback(
-            callbacks, on_data_chunk_recv)
+        cnghttp2.nghttp2_session_callbacks_set_send_data_callback(
+            callbacks, send_data_callback)
 
         rv = cnghttp2.nghttp2_session_server_new(&self.session, callbacks,
                                                  <void*>self)
@@ -876,8 +1311,7 @@ cdef class _HTTP2SessionCore(_HTTP2SessionCoreBase):
         nvlen = _make_nva(&nva, handler.response_headers)
 
         if handler.response_body:
-            prd.source.ptr = <void*>handler.response_body
-            prd.read_callback = data_source_read
+            _set_data_provider(&prd, handler.response_body)
             prd_ptr = &prd
         else:
             prd_ptr = NULL
@@ -899,9 +1333,22 @@ cdef class _HTTP2SessionCore(_HTTP2SessionCoreBase):
         cdef cnghttp2.nghttp2_nv *nva
         cdef size_t nvlen
         cdef int32_t promised_stream_id
+        cdef _StreamBuffer *sb
+        cdef void *stream_user_data
 
         self.handlers.add(promised_handler)
 
+        if self.batch:
+            sb = self._new_stream_buffer(-1)
+            if sb == NULL:
+                raise MemoryError()
+            sb.handler = <void*>promised_handler
+            sb.request_done = True
+            stream_user_data = <void*>sb
+        else:
+            sb = NULL
+            stream_user_data = <void*>promised_handler
+
         nva = NULL
         nvlen = _make_nva(&nva, promised_handler.headers)
 
@@ -910,11 +1357,18 @@ cdef class _HTTP2SessionCore(_HTTP2SessionCoreBase):
                               cnghttp2.NGHTTP2_FLAG_NONE,
                               handler.stream_id,
                               nva, nvlen,
-                              <void*>promised_handler)
+                              stream_user_data)
+        free(nva)
+
         if promised_stream_id < 0:
+            if sb != NULL:
+                self._delete_stream_buffer(sb)
             raise Exception('nghttp2_submit_push_promise failed: {}'.format\
                             (_strerror(promised_stream_id)))
 
+        if sb != NULL:
+            sb.stream_id = promised_stream_id
+
         promised_handler.stream_id = promised_stream_id
 
         logging.debug('push, stream_id:%s', promised_stream_id)
@@ -954,6 +1408,8 @@ cdef class _HTTP2ClientSessionCore(_HTTP2SessionCoreBase):
             callbacks, client_on_frame_send)
         cnghttp2.nghttp2_session_callbacks_set_on_data_chunk_recv_callback(
             callbacks, on_data_chunk_recv)
+        cnghttp2.nghttp2_session_callbacks_set_send_data_callback(
+            callbacks, send_data_callback)
 
         rv = cnghttp2.nghttp2_session_client_new(&self.session, callbacks,
                                                  <void*>self)
@@ -1000,8 +1456,9 @@ cdef class _HTTP2ClientSessionCore(_HTTP2SessionCoreBase):
         nvlen = _make_nva(&nva, headers)
 
         if body:
-            prd.source.ptr = <void*>body
-            prd.read_callback = data_source_read
+            # The data provider only holds a borrowed reference.
+            handler.request_body = body
+            _set_data_provider(&prd, body)
             prd_ptr = &prd
         else:
             prd_ptr = NULL
@@ -1069,6 +1526,10 @@ if asyncio:
 
         When whole request is received, on_request_done() is invoked.
 
+        If the server runs in batch mode, on_request(data) is invoked
+        instead of the above callbacks if whole request is received
+        at once.  See HTTP2Server for details.
+
         When stream is closed, on_close(error_code) is called.
 
         The application can send response using send_response() method. It
@@ -1159,6 +1620,20 @@ if asyncio:
             '''
             pass
 
+        def on_request(self, data):
+
+            '''Called in batch mode when whole request was received at
+            once.  The data is the request body, or None if it is
+            empty.  By default, this method calls on_headers(),
+            on_data(data) if data is not None, and on_request_done() in
+            this order.
+
+            '''
+            self.on_headers()
+            if data is not None:
+                self.on_data(data)
+            self.on_request_done()
+
         def on_close(self, error_code):
 
             '''Called when stream is about to close.
@@ -1172,7 +1647,8 @@ if asyncio:
             additional response headers. The :status header field is
             appended by the library. The body is the response body. It
             could be None if response body is empty. Or it must be
-            instance of either str, bytes, io.IOBase or callable,
+            instance of either str, bytes, bytearray, memoryview,
+            io.IOBase or callable,
             called body generator, which takes one parameter,
             size. The body generator generates response body. It can
             pause generation of response so that it can wait for slow
@@ -1193,6 +1669,11 @@ if asyncio:
             If instance of str is specified as body, it is encoded
             using UTF-8.
 
+            The content of bytes, bytearray and memoryview is written
+            to the transport without being copied into intermediate
+            buffers.  bytearray and memoryview must not be modified
+            until the stream is closed.
+
             The headers is a list of tuple of the form (name,
             value). The name and value can be either unicode string or
             byte string.
@@ -1289,9 +1770,10 @@ if asyncio:
 
     class _HTTP2Session(asyncio.Protocol):
 
-        def __init__(self, RequestHandlerClass):
+        def __init__(self, RequestHandlerClass, batch=False):
             asyncio.Protocol.__init__(self)
             self.RequestHandlerClass = RequestHandlerClass
+            self.batch = batch
             self.http2 = None
 
         def connection_made(self, transport):
@@ -1315,7 +1797,8 @@ if asyncio:
             try:
                 self.http2 = _HTTP2SessionCore\
                              (self.transport,
-                              self.RequestHandlerClass)
+                              self.RequestHandlerClass,
+                              self.batch)
             except Exception as err:
                 sys.stderr.write(traceback.format_exc())
                 self.transport.abort()
@@ -1353,7 +1836,8 @@ if asyncio:
         subclass of BaseRequestHandler class.
 
         '''
-        def __init__(self, address, RequestHandlerClass, ssl=None):
+        def __init__(self, address, RequestHandlerClass, ssl=None,
+                     batch=False):
 
             '''address is a tuple of the listening address and port (e.g.,
             ('127.0.0.1', 8080)). RequestHandlerClass must be a subclass
@@ -1361,9 +1845,17 @@ if asyncio:
             ssl can be ssl.SSLContext instance. If it is not None, the
             resulting server is SSL/TLS capable.
 
+            If batch is True, request header fields and body are
+            collected per stream without invoking Python code, and the
+            request handler is created and invoked after all received
+            data are processed.  If whole request is received, only
+            on_request(data) is called.  Otherwise, on_headers() and
+            on_data(data) are called when the buffered request body
+            exceeds 64KiB, and on_request_done() is called later.
+
             '''
             def session_factory():
-                return _HTTP2Session(RequestHandlerClass)
+                return _HTTP2Session(RequestHandlerClass, batch)
 
             self.loop = asyncio.get_event_loop()
 
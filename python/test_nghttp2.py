@@ -0,0 +1,206 @@
+#!/usr/bin/env python3
+
+# nghttp2 - HTTP/2 C Library
+
+# Copyright (c) 2026 Tatsuhiro Tsujikawa
+
+# Permission is hereby granted, free of charge, to any person obtaining
+# a copy of this software and associated documentation files (the
+# "Software"), to deal in the Software without restriction, including
+# without limitation the rights to use, copy, modify, merge, publish,
+# distribute, sublicense, and/or sell copies of the Software, and to
+# permit persons to whom the Software is furnished to do so, subject to
+# the following conditions:
+
+# The above copyright notice and this permission notice shall be
+# included in all copies or substantial portions of the Software.
+
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+# EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+# MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+# NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+# LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+# OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+# WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+# Tests for HTTP2Server batch mode and zero-copy response bodies.
+# Run this script in the directory where "setup.py build" was done,
+# or with the extension module in PYTHONPATH.
+
+import asyncio
+import glob
+import os
+import sys
+import unittest
+
+sys.path[:0] = glob.glob(os.path.join('build', 'lib*'))
+
+import nghttp2
+
+TIMEOUT = 10
+
+# Events recorded by RecordingHandler
+events = []
+
+class RecordingHandler(nghttp2.BaseRequestHandler):
+
+    def on_headers(self):
+        events.append(('on_headers', self.method, self.path))
+        self.body = b''
+
+    def on_data(self, data):
+        events.append(('on_data', len(data)))
+        self.body += data
+
+    def on_request_done(self):
+        events.append(('on_request_done',))
+        self.reply(self.body)
+
+    def on_request(self, data):
+        events.append(('on_request', self.method, self.path,
+                       None if data is None else len(data)))
+        self.reply(data or b'')
+
+    def reply(self, body):
+        self.send_response(status=200,
+                           headers=[('x-request-path', self.path)],
+                           body=make_response_body(self.path, body))
+
+def make_response_body(path, body):
+    if path == b'/echo':
+        return body
+    if path == b'/bytes':
+        return b'a' * 100000
+    if path == b'/bytearray':
+        return bytearray(b'b' * 100000)
+    if path == b'/memoryview':
+        return memoryview(b'0123456789' * 10000)[10:50010]
+    if path == b'/empty':
+        return b''
+    return None
+
+class ResponseHandler(nghttp2.BaseResponseHandler):
+
+    def __init__(self, done):
+        super().__init__()
+        self.done = done
+        self.body = b''
+
+    def on_data(self, data):
+        self.body += data
+
+    def on_response_done(self):
+        self.done.set_result(self)
+
+class HTTP2ServerTest(unittest.TestCase):
+
+    batch = False
+
+    def setUp(self):
+        del events[:]
+        self.loop = asyncio.new_event_loop()
+        asyncio.set_event_loop(self.loop)
+        self.server = nghttp2.HTTP2Server(('127.0.0.1', 0), RecordingHandler,
+                                          batch=self.batch)
+        port = self.server.server.sockets[0].getsockname()[1]
+        self.client = nghttp2.HTTP2Client(('127.0.0.1', port), loop=self.loop)
+
+    def tearDown(self):
+        self.client.close()
+        self.server.server.close()
+        self.loop.run_until_complete(self.server.server.wait_closed())
+        self.loop.close()
+        asyncio.set_event_loop(None)
+
+    def request(self, path, method='GET', body=None):
+        done = self.loop.create_future()
+        self.client.send_request(method=method, url=path, body=body,
+                                 handler=ResponseHandler(done))
+        return self.loop.run_until_complete(
+            asyncio.wait_for(done, TIMEOUT))
+
+    def assert_response(self, res, path, body):
+        self.assertEqual(b'200', res.status)
+        self.assertIn((b'x-request-path', path.encode('utf-8')), res.headers)
+        self.assertEqual(body, res.body)
+
+class NonBatchTest(HTTP2ServerTest):
+
+    def test_get(self):
+        res = self.request('/bytes')
+        self.assert_response(res, '/bytes', b'a' * 100000)
+        self.assertEqual([('on_headers', b'GET', b'/bytes'),
+                          ('on_request_done',)], events)
+
+    def test_post(self):
+        res = self.request('/echo', method='POST', body=b'hello')
+        self.assert_response(res, '/echo', b'hello')
+        self.assertEqual(('on_headers', b'POST', b'/echo'), events[0])
+        self.assertEqual(('on_request_done',), events[-1])
+        self.assertNotIn('on_request', [e[0] for e in events])
+
+class BatchTest(HTTP2ServerTest):
+
+    batch = True
+
+    def test_get(self):
+        res = self.request('/empty')
+        self.assert_response(res, '/empty', b'')
+        self.assertEqual([('on_request', b'GET', b'/empty', None)], events)
+
+    def test_post(self):
+        res = self.request('/echo', method='POST', body=b'hello')
+        self.assert_response(res, '/echo', b'hello')
+        self.assertEqual([('on_request', b'POST', b'/echo', 5)], events)
+
+    def test_post_large(self):
+        # The request body exceeding 64KiB is handed over before the
+        # request completes.
+        body = bytes(range(256)) * 1024
+        res = self.request('/echo', method='POST', body=body)
+        self.assert_response(res, '/echo', body)
+        names = [e[0] for e in events]
+        self.assertEqual('on_headers', names[0])
+        self.assertEqual('on_request_done', names[-1])
+        self.assertNotIn('on_request', names)
+        self.assertEqual(len(body),
+                         sum(e[1] for e in events if e[0] == 'on_data'))
+
+    def test_multiple_requests(self):
+        dones = []
+        for i in range(10):
+            done = self.loop.create_future()
+            self.client.send_request(url='/empty?{}'.format(i),
+                                     handler=ResponseHandler(done))
+            dones.append(done)
+        self.loop.run_until_complete(
+            asyncio.wait_for(asyncio.gather(*dones), TIMEOUT))
+        self.assertEqual(sorted('/empty?{}'.format(i).encode('utf-8')
+                                for i in range(10)),
+                         sorted(e[2] for e in events))
+        self.assertEqual({'on_request'}, set(e[0] for e in events))
+
+class ZeroCopyBodyTest(HTTP2ServerTest):
+
+    def test_bytes(self):
+        self.assert_response(self.request('/bytes'), '/bytes', b'a' * 100000)
+
+    def test_bytearray(self):
+        self.assert_response(self.request('/bytearray'), '/bytearray',
+                             b'b' * 100000)
+
+    def test_memoryview(self):
+        self.assert_response(self.request('/memoryview'), '/memoryview',
+                             (b'0123456789' * 10000)[10:50010])
+
+    def test_empty(self):
+        self.assert_response(self.request('/empty'), '/empty', b'')
+
+    def test_request_body(self):
+        # The client sends bytes request body through the same path.
+        body = memoryview(bytearray(b'c' * 70000))
+        res = self.request('/echo', method='POST', body=body)
+        self.assert_response(res, '/echo', b'c' * 70000)
+
+if __name__ == '__main__':
+    unittest.main()
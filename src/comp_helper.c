@@ -24,6 +24,7 @@
  */
 #include "comp_helper.h"
 #include <string.h>
+#include <stdlib.h>
 
 static void dump_val(json_t *jent, const char *key, uint8_t *val, size_t len) {
   json_object_set_new(jent, key, json_pack("s#", val, len));
@@ -131,3 +132,32 @@ void output_json_footer(void) {
   printf("  ]\n"
          "}\n");
 }
+
+static void *counting_malloc(size_t size, void *mem_user_data) {
+  ++*(size_t *)mem_user_data;
+  return malloc(size);
+}
+
+static void counting_free(void *ptr, void *mem_user_data) {
+  (void)mem_user_data;
+
+  free(ptr);
+}
+
+static void *counting_calloc(size_t nmemb, size_t size, void *mem_user_data) {
+  ++*(size_t *)mem_user_data;
+  return calloc(nmemb, size);
+}
+
+static void *counting_realloc(void *ptr, size_t size, void *mem_user_data) {
+  ++*(size_t *)mem_user_data;
+  return realloc(ptr, size);
+}
+
+void init_counting_mem(nghttp2_mem *mem, size_t *nallocs) {
+  mem->mem_user_data = nallocs;
+  mem->malloc = counting_malloc;
+  mem->free = counting_free;
+  mem->calloc = counting_calloc;
+  mem->realloc = counting_realloc;
+}
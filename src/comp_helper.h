@@ -50,6 +50,12 @@ void output_json_header(void);
 
 void output_json_footer(void);
 
+/*
+ * Initializes |mem| so that it allocates memory using malloc(3)
+ * family, and increments |*nallocs| on each allocation.
+ */
+void init_counting_mem(nghttp2_mem *mem, size_t *nallocs);
+
 #ifdef __cplusplus
 }
 #endif
@@ -37,7 +37,9 @@
 #include <cerrno>
 #include <cstdlib>
 #include <vector>
+#include <string>
 #include <iostream>
+#include <chrono>
 
 #include <jansson.h>
 
@@ -53,13 +55,29 @@ typedef struct {
   size_t deflate_table_size;
   int http1text;
   int dump_header_table;
+  size_t bench;
+  int indexing;
 } deflate_config;
 
+enum {
+  INDEXING_DEFAULT,
+  INDEXING_SENSITIVE,
+  INDEXING_NEVER,
+};
+
+struct BenchCase {
+  std::vector<std::string> names;
+  std::vector<std::string> values;
+  size_t inputlen;
+};
+
 static deflate_config config;
 
 static size_t input_sum;
 static size_t output_sum;
 
+static std::vector<BenchCase> bench_cases;
+
 static char to_hex_digit(uint8_t n) {
   if (n > 9) {
     return n - 10 + 'a';
@@ -109,12 +127,30 @@ static void output_to_json(nghttp2_hd_deflater *deflater, const uint8_t *buf,
   json_decref(obj);
 }
 
+static void add_bench_case(const std::vector<nghttp2_nv> &nva,
+                           size_t inputlen) {
+  bench_cases.emplace_back();
+  auto &c = bench_cases.back();
+
+  for (auto &nv : nva) {
+    c.names.emplace_back(nv.name, nv.name + nv.namelen);
+    c.values.emplace_back(nv.value, nv.value + nv.valuelen);
+  }
+
+  c.inputlen = inputlen;
+}
+
 static void deflate_hd(nghttp2_hd_deflater *deflater,
                        const std::vector<nghttp2_nv> &nva, size_t inputlen,
                        int seq) {
   ssize_t rv;
   std::array<uint8_t, 64_k> buf;
 
+  if (config.bench) {
+    add_bench_case(nva, inputlen);
+    return;
+  }
+
   rv = nghttp2_hd_deflate_hd(deflater, buf.data(), buf.size(),
                              (nghttp2_nv *)nva.data(), nva.size());
   if (rv < 0) {
@@ -214,7 +250,9 @@ static int perform(void) {
   }
 
   auto deflater = init_deflater();
-  output_json_header();
+  if (!config.bench) {
+    output_json_header();
+  }
   auto len = json_array_size(cases);
 
   for (size_t i = 0; i < len; ++i) {
@@ -226,11 +264,13 @@ static int perform(void) {
     if (deflate_hd_json(obj, deflater, i) != 0) {
       continue;
     }
-    if (i + 1 < len) {
+    if (!config.bench && i + 1 < len) {
       printf(",\n");
     }
   }
-  output_json_footer();
+  if (!config.bench) {
+    output_json_footer();
+  }
   deinit_deflater(deflater);
   json_decref(json);
   return 0;
@@ -241,7 +281,9 @@ static int perform_from_http1text(void) {
   int seq = 0;
 
   auto deflater = init_deflater();
-  output_json_header();
+  if (!config.bench) {
+    output_json_header();
+  }
   for (;;) {
     std::vector<nghttp2_nv> nva;
     int end = 0;
@@ -284,7 +326,7 @@ static int perform_from_http1text(void) {
     }
 
     if (!end) {
-      if (seq > 0) {
+      if (!config.bench && seq > 0) {
         printf(",\n");
       }
       deflate_hd(deflater, nva, inputlen, seq);
@@ -299,11 +341,113 @@ static int perform_from_http1text(void) {
       break;
     ++seq;
   }
-  output_json_footer();
+  if (!config.bench) {
+    output_json_footer();
+  }
   deinit_deflater(deflater);
   return 0;
 }
 
+static bool never_index(const std::string &name) {
+  switch (config.indexing) {
+  case INDEXING_NEVER:
+    return true;
+  case INDEXING_SENSITIVE:
+    return name == "authorization" || name == "proxy-authorization" ||
+           name == "cookie" || name == "set-cookie";
+  default:
+    return false;
+  }
+}
+
+static int perform_bench(void) {
+  std::vector<std::vector<nghttp2_nv>> nvas;
+  size_t nheaders = 0;
+  size_t inputlen = 0;
+
+  for (auto &c : bench_cases) {
+    nvas.emplace_back();
+    auto &nva = nvas.back();
+
+    for (size_t i = 0; i < c.names.size(); ++i) {
+      auto &name = c.names[i];
+      auto &value = c.values[i];
+      nva.push_back(nghttp2_nv{
+          (uint8_t *)name.c_str(), (uint8_t *)value.c_str(), name.size(),
+          value.size(),
+          static_cast<uint8_t>(never_index(name) ? NGHTTP2_NV_FLAG_NO_INDEX
+                                                 : NGHTTP2_NV_FLAG_NONE)});
+    }
+
+    nheaders += nva.size();
+    inputlen += c.inputlen;
+  }
+
+  size_t nallocs = 0;
+  nghttp2_mem mem;
+  init_counting_mem(&mem, &nallocs);
+
+  std::array<uint8_t, 64_k> buf;
+
+  auto start = std::chrono::steady_clock::now();
+
+  for (size_t n = 0; n < config.bench; ++n) {
+    nghttp2_hd_deflater *deflater;
+
+    if (nghttp2_hd_deflate_new2(&deflater, config.deflate_table_size, &mem) !=
+        0) {
+      fprintf(stderr, "nghttp2_hd_deflate_new2() failed\n");
+      exit(EXIT_FAILURE);
+    }
+    if (config.table_size != NGHTTP2_DEFAULT_HEADER_TABLE_SIZE) {
+      nghttp2_hd_deflate_change_table_size(deflater, config.table_size);
+    }
+
+    for (size_t i = 0; i < nvas.size(); ++i) {
+      auto &nva = nvas[i];
+      auto rv = nghttp2_hd_deflate_hd(deflater, buf.data(), buf.size(),
+                                      nva.data(), nva.size());
+      if (rv < 0) {
+        fprintf(stderr, "deflate failed with error code %zd at %zu\n", rv, i);
+        exit(EXIT_FAILURE);
+      }
+
+      output_sum += rv;
+    }
+
+    input_sum += inputlen;
+
+    nghttp2_hd_deflate_del(deflater);
+  }
+
+  auto elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+  if (elapsed == 0) {
+    elapsed = 1e-9;
+  }
+
+  auto comp_ratio = input_sum == 0 ? 0.0 : (double)output_sum / input_sum;
+
+  printf("iterations: %zu\n"
+         "header sets: %zu\n"
+         "header fields: %zu\n"
+         "time: %.06fs\n"
+         "input: %zu bytes, %.02f MB/s\n"
+         "output: %zu bytes, %.02f MB/s\n"
+         "headers/s: %.02f\n"
+         "ratio: %.04f\n"
+         "allocations: %zu, %.02f per header set\n",
+         config.bench, nvas.size() * config.bench, nheaders * config.bench,
+         elapsed, input_sum, input_sum / elapsed / 1e6, output_sum,
+         output_sum / elapsed / 1e6, nheaders * config.bench / elapsed,
+         comp_ratio,
+         nallocs,
+         nvas.empty() ? 0.0 : (double)nallocs / (nvas.size() * config.bench));
+
+  return 0;
+}
+
 static void print_help(void) {
   std::cout << R"(HPACK HTTP/2 header encoder
 Usage: deflatehd [OPTIONS] < INPUT
@@ -369,7 +513,20 @@ OPTIONS:
                       buffer.
                       Default: 4096
     -d, --dump-header-table
-                      Output dynamic header table.)"
+                      Output dynamic header table.
+    -b, --bench=<N>
+                      Instead of  outputting deflated  header block,
+                      load all  header  sets from  input, and  deflate
+                      them  N  times,  each  time  with  a  fresh
+                      compression context.  Then show throughput,
+                      compression ratio and the number of allocations.
+    -i, --indexing=<POLICY>
+                      Set indexing policy  used with --bench option.
+                      "default" lets the encoder decide.  "sensitive"
+                      never indexes  authorization, proxy-authorization,
+                      cookie  and set-cookie  header fields.   "never"
+                      never indexes any header field.
+                      Default: default)"
             << std::endl;
 }
 
@@ -378,6 +535,8 @@ constexpr static struct option long_options[] = {
     {"table-size", required_argument, nullptr, 's'},
     {"deflate-table-size", required_argument, nullptr, 'S'},
     {"dump-header-table", no_argument, nullptr, 'd'},
+    {"bench", required_argument, nullptr, 'b'},
+    {"indexing", required_argument, nullptr, 'i'},
     {nullptr, 0, nullptr, 0}};
 
 int main(int argc, char **argv) {
@@ -387,9 +546,12 @@ int main(int argc, char **argv) {
   config.deflate_table_size = 4_k;
   config.http1text = 0;
   config.dump_header_table = 0;
+  config.bench = 0;
+  config.indexing = INDEXING_DEFAULT;
   while (1) {
     int option_index = 0;
-    int c = getopt_long(argc, argv, "S:dhs:t", long_options, &option_index);
+    int c =
+        getopt_long(argc, argv, "S:b:dhi:s:t", long_options, &option_index);
     if (c == -1) {
       break;
     }
@@ -423,6 +585,28 @@ int main(int argc, char **argv) {
       // --dump-header-table
       config.dump_header_table = 1;
       break;
+    case 'b':
+      // --bench
+      errno = 0;
+      config.bench = strtoul(optarg, &end, 10);
+      if (errno == ERANGE || *end != '\0' || config.bench == 0) {
+        fprintf(stderr, "-b: Bad option value\n");
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'i':
+      // --indexing
+      if (strcmp(optarg, "default") == 0) {
+        config.indexing = INDEXING_DEFAULT;
+      } else if (strcmp(optarg, "sensitive") == 0) {
+        config.indexing = INDEXING_SENSITIVE;
+      } else if (strcmp(optarg, "never") == 0) {
+        config.indexing = INDEXING_NEVER;
+      } else {
+        fprintf(stderr, "-i: Bad option value\n");
+        exit(EXIT_FAILURE);
+      }
+      break;
     case '?':
       exit(EXIT_FAILURE);
     default:
@@ -435,6 +619,10 @@ int main(int argc, char **argv) {
     perform();
   }
 
+  if (config.bench) {
+    return perform_bench();
+  }
+
   auto comp_ratio = input_sum == 0 ? 0.0 : (double)output_sum / input_sum;
 
   fprintf(stderr, "Overall: input=%zu output=%zu ratio=%.02f\n", input_sum,
@@ -38,6 +38,7 @@
 #include <cstdlib>
 #include <vector>
 #include <iostream>
+#include <chrono>
 
 #include <jansson.h>
 
@@ -50,10 +51,19 @@ namespace nghttp2 {
 
 typedef struct {
   int dump_header_table;
+  size_t bench;
 } inflate_config;
 
 static inflate_config config;
 
+struct BenchCase {
+  std::vector<uint8_t> wire;
+  // new header table size, or -1 if it is not changed.
+  ssize_t table_size;
+};
+
+static std::vector<BenchCase> bench_cases;
+
 static uint8_t to_ud(char c) {
   if (c >= 'A' && c <= 'Z') {
     return c - 'A' + 10;
@@ -120,6 +130,9 @@ static int inflate_hd(json_t *obj, nghttp2_hd_inflater *inflater, int seq) {
               seq);
       return -1;
     }
+  }
+
+  if (table_size && !config.bench) {
     rv = nghttp2_hd_inflate_change_table_size(inflater,
                                               json_integer_value(table_size));
     if (rv != 0) {
@@ -142,6 +155,15 @@ static int inflate_hd(json_t *obj, nghttp2_hd_inflater *inflater, int seq) {
 
   decode_hex(buf.data(), json_string_value(wire), inputlen);
 
+  if (config.bench) {
+    bench_cases.push_back(
+        BenchCase{std::move(buf),
+                  table_size ? static_cast<ssize_t>(
+                                   json_integer_value(table_size))
+                             : -1});
+    return 0;
+  }
+
   auto headers = json_array();
 
   auto p = buf.data();
@@ -194,7 +216,9 @@ static int perform(void) {
   }
 
   nghttp2_hd_inflate_new(&inflater);
-  output_json_header();
+  if (!config.bench) {
+    output_json_header();
+  }
   auto len = json_array_size(cases);
 
   for (size_t i = 0; i < len; ++i) {
@@ -206,17 +230,112 @@ static int perform(void) {
     if (inflate_hd(obj, inflater, i) != 0) {
       continue;
     }
-    if (i + 1 < len) {
+    if (!config.bench && i + 1 < len) {
       printf(",\n");
     }
   }
-  output_json_footer();
+  if (!config.bench) {
+    output_json_footer();
+  }
   nghttp2_hd_inflate_del(inflater);
   json_decref(json);
 
   return 0;
 }
 
+static int perform_bench(void) {
+  size_t nallocs = 0;
+  nghttp2_mem mem;
+  init_counting_mem(&mem, &nallocs);
+
+  size_t input_sum = 0;
+  size_t output_sum = 0;
+  size_t nheaders = 0;
+
+  auto start = std::chrono::steady_clock::now();
+
+  for (size_t n = 0; n < config.bench; ++n) {
+    nghttp2_hd_inflater *inflater;
+
+    if (nghttp2_hd_inflate_new2(&inflater, &mem) != 0) {
+      fprintf(stderr, "nghttp2_hd_inflate_new2() failed\n");
+      exit(EXIT_FAILURE);
+    }
+
+    for (size_t i = 0; i < bench_cases.size(); ++i) {
+      auto &c = bench_cases[i];
+
+      if (c.table_size != -1) {
+        auto rv = nghttp2_hd_inflate_change_table_size(inflater, c.table_size);
+        if (rv != 0) {
+          fprintf(stderr,
+                  "nghttp2_hd_change_table_size() failed with error %s at "
+                  "%zu\n",
+                  nghttp2_strerror(rv), i);
+          exit(EXIT_FAILURE);
+        }
+      }
+
+      auto p = c.wire.data();
+      auto buflen = c.wire.size();
+
+      for (;;) {
+        nghttp2_nv nv;
+        int inflate_flags = 0;
+
+        auto rv =
+            nghttp2_hd_inflate_hd2(inflater, &nv, &inflate_flags, p, buflen, 1);
+        if (rv < 0) {
+          fprintf(stderr, "inflate failed with error code %zd at %zu\n", rv,
+                  i);
+          exit(EXIT_FAILURE);
+        }
+        p += rv;
+        buflen -= rv;
+        if (inflate_flags & NGHTTP2_HD_INFLATE_EMIT) {
+          output_sum += nv.namelen + nv.valuelen;
+          ++nheaders;
+        }
+        if (inflate_flags & NGHTTP2_HD_INFLATE_FINAL) {
+          break;
+        }
+      }
+      nghttp2_hd_inflate_end_headers(inflater);
+
+      input_sum += c.wire.size();
+    }
+
+    nghttp2_hd_inflate_del(inflater);
+  }
+
+  auto elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+  if (elapsed == 0) {
+    elapsed = 1e-9;
+  }
+
+  auto comp_ratio = output_sum == 0 ? 0.0 : (double)input_sum / output_sum;
+
+  printf("iterations: %zu\n"
+         "header sets: %zu\n"
+         "header fields: %zu\n"
+         "time: %.06fs\n"
+         "input: %zu bytes, %.02f MB/s\n"
+         "output: %zu bytes, %.02f MB/s\n"
+         "headers/s: %.02f\n"
+         "ratio: %.04f\n"
+         "allocations: %zu, %.02f per header set\n",
+         config.bench, bench_cases.size() * config.bench, nheaders, elapsed,
+         input_sum, input_sum / elapsed / 1e6, output_sum,
+         output_sum / elapsed / 1e6, nheaders / elapsed, comp_ratio, nallocs,
+         bench_cases.empty()
+             ? 0.0
+             : (double)nallocs / (bench_cases.size() * config.bench));
+
+  return 0;
+}
+
 static void print_help(void) {
   std::cout << R"(HPACK HTTP/2 header decoder
 Usage: inflatehd [OPTIONS] < INPUT
@@ -248,19 +367,31 @@ The output of this program can be used as input for deflatehd.
 
 OPTIONS:
     -d, --dump-header-table
-                      Output dynamic header table.)"
+                      Output dynamic header table.
+    -b, --bench=<N>
+                      Instead of  outputting inflated  header fields,
+                      load  all  header blocks  from  input,  and
+                      inflate them  N times,  each  time with  a
+                      fresh  decompression  context.   Then  show
+                      throughput,  compression ratio  and  the  number
+                      of allocations.)"
             << std::endl;
   ;
 }
 
 constexpr static struct option long_options[] = {
-    {"dump-header-table", no_argument, nullptr, 'd'}, {nullptr, 0, nullptr, 0}};
+    {"dump-header-table", no_argument, nullptr, 'd'},
+    {"bench", required_argument, nullptr, 'b'},
+    {nullptr, 0, nullptr, 0}};
 
 int main(int argc, char **argv) {
+  char *end;
+
   config.dump_header_table = 0;
+  config.bench = 0;
   while (1) {
     int option_index = 0;
-    int c = getopt_long(argc, argv, "dh", long_options, &option_index);
+    int c = getopt_long(argc, argv, "b:dh", long_options, &option_index);
     if (c == -1) {
       break;
     }
@@ -272,6 +403,15 @@ int main(int argc, char **argv) {
       // --dump-header-table
       config.dump_header_table = 1;
       break;
+    case 'b':
+      // --bench
+      errno = 0;
+      config.bench = strtoul(optarg, &end, 10);
+      if (errno == ERANGE || *end != '\0' || config.bench == 0) {
+        fprintf(stderr, "-b: Bad option value\n");
+        exit(EXIT_FAILURE);
+      }
+      break;
     case '?':
       exit(EXIT_FAILURE);
     default:
@@ -279,6 +419,11 @@ int main(int argc, char **argv) {
     }
   }
   perform();
+
+  if (config.bench) {
+    return perform_bench();
+  }
+
   return 0;
 }
 
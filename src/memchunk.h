@@ -60,14 +60,29 @@ namespace nghttp2 {
 
 template <size_t N> struct Memchunk {
   Memchunk(Memchunk *next_chunk)
-      : pos(std::begin(buf)), last(pos), knext(next_chunk), next(nullptr) {}
+      : pos(std::begin(buf)),
+        last(pos),
+        knext(next_chunk),
+        next(nullptr),
+        origin(nullptr),
+        nref(0),
+        orphan(false) {}
   size_t len() const { return last - pos; }
-  size_t left() const { return std::end(buf) - last; }
+  // A chunk which refers to the other chunk is read-only.
+  size_t left() const { return origin ? 0 : std::end(buf) - last; }
   void reset() { pos = last = std::begin(buf); }
   std::array<uint8_t, N> buf;
   uint8_t *pos, *last;
   Memchunk *knext;
   Memchunk *next;
+  // If this is not nullptr, pos and last point to the region of
+  // origin->buf instead of buf.
+  Memchunk *origin;
+  // The number of chunks whose origin is this chunk.
+  size_t nref;
+  // true if this chunk was recycled while it was still referenced.
+  // It goes back to the freelist when the last reference is gone.
+  bool orphan;
   static const size_t size = N;
 };
 
@@ -89,6 +104,27 @@ template <typename T> struct Pool {
     return pool;
   }
   void recycle(T *m) {
+    if (m->origin) {
+      release(m->origin);
+      m->origin = nullptr;
+    } else if (m->nref) {
+      m->orphan = true;
+      return;
+    }
+
+    m->next = freelist;
+    freelist = m;
+    freelistsize += T::size;
+  }
+  // Drops a reference to |m| which is taken by Memchunks::share().
+  void release(T *m) {
+    assert(m->nref);
+
+    if (--m->nref || !m->orphan) {
+      return;
+    }
+
+    m->orphan = false;
     m->next = freelist;
     freelist = m;
     freelistsize += T::size;
@@ -283,6 +319,55 @@ template <typename Memchunk> struct Memchunks {
 
     return n;
   }
+  // Moves first |count| bytes to |dest| without copying them.  A
+  // chunk which is entirely moved is relinked to |dest|.  If a chunk
+  // is partially moved, |dest| gets a chunk which refers to the moved
+  // region, and the region stays valid until |dest| drains it.  |dest|
+  // must share the same pool.  This function returns the number of
+  // bytes moved.
+  size_t share(Memchunks &dest, size_t count) {
+    assert(pool == dest.pool);
+
+    auto left = count;
+
+    while (head && left) {
+      auto m = head;
+      auto n = std::min(left, m->len());
+
+      assert(n);
+
+      if (n == m->len()) {
+        head = m->next;
+        m->next = nullptr;
+      } else {
+        auto r = pool->get();
+        r->origin = m;
+        ++m->nref;
+        r->pos = m->pos;
+        r->last = m->pos + n;
+        m->pos += n;
+        m = r;
+      }
+
+      if (dest.tail == nullptr) {
+        dest.head = m;
+      } else {
+        dest.tail->next = m;
+      }
+
+      dest.tail = m;
+      dest.len += n;
+
+      len -= n;
+      left -= n;
+    }
+
+    if (head == nullptr) {
+      tail = nullptr;
+    }
+
+    return count - left;
+  }
   size_t drain(size_t count) {
     auto ndata = count;
     auto m = head;
@@ -24,6 +24,8 @@
  */
 #include "memchunk_test.h"
 
+#include <numeric>
+
 #include <CUnit/CUnit.h>
 
 #include <nghttp2/nghttp2.h>
@@ -220,6 +222,52 @@ void test_memchunks_reset(void) {
   CU_ASSERT(nullptr == m->next->next);
 }
 
+void test_memchunks_share(void) {
+  MemchunkPool16 pool;
+  Memchunks16 src(&pool);
+  Memchunks16 dest(&pool);
+  std::array<uint8_t, 32> b;
+
+  std::iota(std::begin(b), std::end(b), 0);
+
+  src.append(b.data(), b.size());
+  dest.append("hd", 2);
+
+  // The first chunk is moved entirely, and the second one is shared.
+  CU_ASSERT(20 == src.share(dest, 20));
+  CU_ASSERT(12 == src.rleft());
+  CU_ASSERT(22 == dest.rleft());
+  CU_ASSERT(4 == pool.poolsize / 16);
+
+  std::array<struct iovec, 4> iov;
+  CU_ASSERT(3 == dest.riovec(iov.data(), iov.size()));
+  CU_ASSERT(2 == iov[0].iov_len);
+  CU_ASSERT(16 == iov[1].iov_len);
+  CU_ASSERT(0 == memcmp(b.data(), iov[1].iov_base, 16));
+  CU_ASSERT(4 == iov[2].iov_len);
+  CU_ASSERT(16 == *static_cast<uint8_t *>(iov[2].iov_base));
+  CU_ASSERT(src.head == dest.tail->origin);
+  CU_ASSERT(1 == src.head->nref);
+
+  // The shared chunk is read-only, so that appending data needs new
+  // chunk.
+  dest.append("tl", 2);
+  CU_ASSERT(5 == pool.poolsize / 16);
+
+  // Draining source does not make the shared region invalid.
+  src.reset();
+  CU_ASSERT(0 == pool.freelistsize);
+
+  std::array<uint8_t, 24> out;
+  CU_ASSERT(24 == dest.remove(out.data(), out.size()));
+  CU_ASSERT(0 == memcmp("hd", out.data(), 2));
+  CU_ASSERT(0 == memcmp(b.data(), out.data() + 2, 20));
+  CU_ASSERT(0 == memcmp("tl", out.data() + 22, 2));
+
+  // All chunks are back to freelist.
+  CU_ASSERT(pool.poolsize == pool.freelistsize);
+}
+
 void test_peek_memchunks_append(void) {
   MemchunkPool16 pool;
   PeekMemchunks16 pchunks(&pool);
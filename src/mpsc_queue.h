@@ -0,0 +1,145 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include "nghttp2_config.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <array>
+#include <memory>
+
+namespace nghttp2 {
+
+// MPSCQueue is a bounded lock-free queue which allows multiple
+// producer threads and a single consumer thread.  Each slot carries
+// a sequence number which tells whether it is ready to be written
+// or read.  T must be default constructible and move assignable.
+template <typename T> class MPSCQueue {
+public:
+  // |capacity| is rounded up to the power of 2.  It must be strictly
+  // positive.
+  explicit MPSCQueue(size_t capacity)
+      : cells_(std::make_unique<Cell[]>(round_up(capacity))),
+        mask_(round_up(capacity) - 1),
+        tail_(0),
+        head_(0) {
+    for (size_t i = 0; i <= mask_; ++i) {
+      cells_[i].seq.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  MPSCQueue(const MPSCQueue &) = delete;
+  MPSCQueue &operator=(const MPSCQueue &) = delete;
+
+  // Appends |v| to the queue.  This function returns true if it
+  // succeeds, or false if the queue is full.  This function can be
+  // called from any thread.
+  bool push(T v) {
+    auto pos = tail_.load(std::memory_order_relaxed);
+    Cell *cell;
+
+    for (;;) {
+      cell = &cells_[pos & mask_];
+      auto seq = cell->seq.load(std::memory_order_acquire);
+      auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed)) {
+          break;
+        }
+        continue;
+      }
+
+      if (diff < 0) {
+        return false;
+      }
+
+      pos = tail_.load(std::memory_order_relaxed);
+    }
+
+    cell->data = std::move(v);
+    cell->seq.store(pos + 1, std::memory_order_release);
+
+    return true;
+  }
+
+  // Removes the first element and assigns it to |out|.  This function
+  // returns true if it succeeds, or false if the queue is empty.
+  // Only the consumer thread can call this function.
+  bool pop(T &out) {
+    auto pos = head_.load(std::memory_order_relaxed);
+    auto &cell = cells_[pos & mask_];
+    auto seq = cell.seq.load(std::memory_order_acquire);
+
+    if (static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1) < 0) {
+      return false;
+    }
+
+    out = std::move(cell.data);
+    cell.seq.store(pos + mask_ + 1, std::memory_order_release);
+    head_.store(pos + 1, std::memory_order_relaxed);
+
+    return true;
+  }
+
+  // Returns the approximate number of elements in the queue.  This
+  // function can be called from any thread.
+  size_t size() const {
+    auto head = head_.load(std::memory_order_relaxed);
+    auto tail = tail_.load(std::memory_order_relaxed);
+    return tail > head ? tail - head : 0;
+  }
+
+  size_t capacity() const { return mask_ + 1; }
+
+private:
+  static size_t round_up(size_t n) {
+    size_t m = 1;
+    for (; m < n; m <<= 1)
+      ;
+    return m;
+  }
+
+  struct Cell {
+    std::atomic<size_t> seq;
+    T data;
+  };
+
+  std::unique_ptr<Cell[]> cells_;
+  size_t mask_;
+  // Producers and the consumer update tail_ and head_ respectively.
+  // The padding keeps them in separate cache lines.
+  std::atomic<size_t> tail_;
+  std::array<uint8_t, 64 - sizeof(std::atomic<size_t>)> pad_;
+  std::atomic<size_t> head_;
+};
+
+} // namespace nghttp2
+
+#endif // MPSC_QUEUE_H
@@ -0,0 +1,121 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "mpsc_queue_test.h"
+
+#include <thread>
+#include <vector>
+
+#include <CUnit/CUnit.h>
+
+#include "mpsc_queue.h"
+
+namespace nghttp2 {
+
+void test_mpsc_queue_push_pop(void) {
+  MPSCQueue<int> q(3);
+  int v;
+
+  CU_ASSERT(4 == q.capacity());
+  CU_ASSERT(0 == q.size());
+  CU_ASSERT(!q.pop(v));
+
+  for (int i = 0; i < 4; ++i) {
+    CU_ASSERT(q.push(i));
+  }
+
+  CU_ASSERT(4 == q.size());
+  CU_ASSERT(!q.push(4));
+
+  CU_ASSERT(q.pop(v));
+  CU_ASSERT(0 == v);
+  CU_ASSERT(q.push(4));
+
+  for (int i = 1; i < 5; ++i) {
+    CU_ASSERT(q.pop(v));
+    CU_ASSERT(i == v);
+  }
+
+  CU_ASSERT(0 == q.size());
+  CU_ASSERT(!q.pop(v));
+
+  // Wrap around several times.
+  for (int i = 0; i < 100; ++i) {
+    CU_ASSERT(q.push(i));
+    CU_ASSERT(q.pop(v));
+    CU_ASSERT(i == v);
+  }
+}
+
+void test_mpsc_queue_multi_producer(void) {
+  constexpr size_t NPRODUCER = 4;
+  constexpr size_t N = 10000;
+
+  MPSCQueue<size_t> q(64);
+
+  std::vector<std::thread> producers;
+  for (size_t i = 0; i < NPRODUCER; ++i) {
+    producers.emplace_back([&q, i] {
+      for (size_t j = 0; j < N;) {
+        if (q.push(i * N + j)) {
+          ++j;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  // Elements from the same producer must be dequeued in order.
+  std::vector<size_t> next(NPRODUCER);
+  size_t v;
+  bool ordered = true;
+
+  for (size_t n = 0; n < NPRODUCER * N;) {
+    if (!q.pop(v)) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    auto &e = next[v / N];
+    if (e != v % N) {
+      ordered = false;
+    }
+    e = v % N + 1;
+    ++n;
+  }
+
+  for (auto &t : producers) {
+    t.join();
+  }
+
+  CU_ASSERT(ordered);
+  CU_ASSERT(0 == q.size());
+
+  for (auto e : next) {
+    CU_ASSERT(N == e);
+  }
+}
+
+} // namespace nghttp2
@@ -34,10 +34,16 @@
 #include "shrpx_downstream_test.h"
 #include "shrpx_config_test.h"
 #include "shrpx_worker_test.h"
+#include "shrpx_accesslog_writer_test.h"
+#include "shrpx_timer_wheel_test.h"
+#include "shrpx_pipe_pool_test.h"
+#include "shrpx_connection_test.h"
+#include "shrpx_io_uring_test.h"
 #include "http2_test.h"
 #include "util_test.h"
 #include "nghttp2_gzip_test.h"
 #include "buffer_test.h"
+#include "mpsc_queue_test.h"
 #include "memchunk_test.h"
 #include "template_test.h"
 #include "shrpx_http_test.h"
@@ -119,6 +125,15 @@ int main(int argc, char *argv[]) {
                    shrpx::test_downstream_supports_non_final_response) ||
       !CU_add_test(pSuite, "downstream_find_affinity_cookie",
                    shrpx::test_downstream_find_affinity_cookie) ||
+      !CU_add_test(pSuite, "downstream_response_body_spliceable",
+                   shrpx::test_downstream_response_body_spliceable) ||
+      !CU_add_test(pSuite, "pipe_pool_reuse",
+                   shrpx::test_shrpx_pipe_pool_reuse) ||
+      !CU_add_test(pSuite, "connection_ktls_bio_ctrl",
+                   shrpx::test_shrpx_connection_ktls_bio_ctrl) ||
+      !CU_add_test(pSuite, "io_uring_recv", shrpx::test_shrpx_io_uring_recv) ||
+      !CU_add_test(pSuite, "io_uring_accept",
+                   shrpx::test_shrpx_io_uring_accept) ||
       !CU_add_test(pSuite, "config_parse_header",
                    shrpx::test_shrpx_config_parse_header) ||
       !CU_add_test(pSuite, "config_parse_log_format",
@@ -129,12 +144,45 @@ int main(int argc, char *argv[]) {
                    shrpx::test_shrpx_config_read_tls_ticket_key_file_aes_256) ||
       !CU_add_test(pSuite, "worker_match_downstream_addr_group",
                    shrpx::test_shrpx_worker_match_downstream_addr_group) ||
+      !CU_add_test(pSuite, "worker_select_downstream_addr_p2c",
+                   shrpx::test_shrpx_worker_select_downstream_addr_p2c) ||
+      !CU_add_test(pSuite, "worker_select_downstream_addr_bounded",
+                   shrpx::test_shrpx_worker_select_downstream_addr_bounded) ||
+      !CU_add_test(pSuite, "worker_affinity_hash_consistency",
+                   shrpx::test_shrpx_worker_affinity_hash_consistency) ||
+      !CU_add_test(pSuite, "worker_detect_downstream_outliers",
+                   shrpx::test_shrpx_worker_detect_downstream_outliers) ||
+      !CU_add_test(pSuite, "worker_hedge", shrpx::test_shrpx_worker_hedge) ||
+      !CU_add_test(pSuite, "worker_concurrency_limit",
+                   shrpx::test_shrpx_worker_concurrency_limit) ||
+      !CU_add_test(pSuite, "worker_match_downstream_addrs",
+                   shrpx::test_shrpx_worker_match_downstream_addrs) ||
+      !CU_add_test(pSuite, "worker_connection_budget",
+                   shrpx::test_shrpx_worker_connection_budget) ||
+      !CU_add_test(pSuite, "worker_keep_idle",
+                   shrpx::test_shrpx_worker_keep_idle) ||
+      !CU_add_test(pSuite, "worker_for_each_shared_downstream_addr",
+                   shrpx::test_shrpx_worker_for_each_shared_downstream_addr) ||
+      !CU_add_test(pSuite, "worker_shared_downstream_health",
+                   shrpx::test_shrpx_worker_shared_downstream_health) ||
+      !CU_add_test(pSuite, "accesslog_buffer",
+                   shrpx::test_shrpx_accesslog_buffer) ||
+      !CU_add_test(pSuite, "accesslog_writer_write_error",
+                   shrpx::test_shrpx_accesslog_writer_write_error) ||
+      !CU_add_test(pSuite, "timer_wheel_expire",
+                   shrpx::test_shrpx_timer_wheel_expire) ||
+      !CU_add_test(pSuite, "timer_wheel_reentrant",
+                   shrpx::test_shrpx_timer_wheel_reentrant) ||
       !CU_add_test(pSuite, "http_create_forwarded",
                    shrpx::test_shrpx_http_create_forwarded) ||
       !CU_add_test(pSuite, "http_create_via_header_value",
                    shrpx::test_shrpx_http_create_via_header_value) ||
       !CU_add_test(pSuite, "http_create_affinity_cookie",
                    shrpx::test_shrpx_http_create_affinity_cookie) ||
+      !CU_add_test(pSuite, "http_create_collapse_key",
+                   shrpx::test_shrpx_http_create_collapse_key) ||
+      !CU_add_test(pSuite, "http_collapsible_response",
+                   shrpx::test_shrpx_http_collapsible_response) ||
       !CU_add_test(pSuite, "router_match", shrpx::test_shrpx_router_match) ||
       !CU_add_test(pSuite, "router_match_wildcard",
                    shrpx::test_shrpx_router_match_wildcard) ||
@@ -206,6 +254,7 @@ int main(int argc, char *argv[]) {
       !CU_add_test(pSuite, "memchunk_recycle",
                    nghttp2::test_memchunks_recycle) ||
       !CU_add_test(pSuite, "memchunk_reset", nghttp2::test_memchunks_reset) ||
+      !CU_add_test(pSuite, "memchunk_share", nghttp2::test_memchunks_share) ||
       !CU_add_test(pSuite, "peek_memchunk_append",
                    nghttp2::test_peek_memchunks_append) ||
       !CU_add_test(pSuite, "peek_memchunk_disable_peek_drain",
@@ -214,6 +263,10 @@ int main(int argc, char *argv[]) {
                    nghttp2::test_peek_memchunks_disable_peek_no_drain) ||
       !CU_add_test(pSuite, "peek_memchunk_reset",
                    nghttp2::test_peek_memchunks_reset) ||
+      !CU_add_test(pSuite, "mpsc_queue_push_pop",
+                   nghttp2::test_mpsc_queue_push_pop) ||
+      !CU_add_test(pSuite, "mpsc_queue_multi_producer",
+                   nghttp2::test_mpsc_queue_multi_producer) ||
       !CU_add_test(pSuite, "template_immutable_string",
                    nghttp2::test_template_immutable_string) ||
       !CU_add_test(pSuite, "template_string_ref",
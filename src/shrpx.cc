@@ -39,6 +39,9 @@
 #  include <netinet/in.h>
 #endif // HAVE_NETINET_IN_H
 #include <netinet/tcp.h>
+#ifdef HAVE_LINUX_FILTER_H
+#  include <linux/filter.h>
+#endif // HAVE_LINUX_FILTER_H
 #ifdef HAVE_ARPA_INET_H
 #  include <arpa/inet.h>
 #endif // HAVE_ARPA_INET_H
@@ -453,16 +456,20 @@ void exec_binary() {
   auto config = get_config();
   auto &listenerconf = config->conn.listener;
 
+  auto nfds = listenerconf.addrs.size();
+  for (auto &addr : listenerconf.addrs) {
+    nfds += addr.reuseport_fds.size();
+  }
+
   // 2 for ENV_ORIG_PID and terminal nullptr.
-  auto envp =
-      std::make_unique<char *[]>(envlen + listenerconf.addrs.size() + 2);
+  auto envp = std::make_unique<char *[]>(envlen + nfds + 2);
   size_t envidx = 0;
 
   std::vector<ImmutableString> fd_envs;
-  for (size_t i = 0; i < listenerconf.addrs.size(); ++i) {
-    auto &addr = listenerconf.addrs[i];
+  fd_envs.reserve(nfds);
+  for (auto &addr : listenerconf.addrs) {
     auto s = ENV_ACCEPT_PREFIX.str();
-    s += util::utos(i + 1);
+    s += util::utos(fd_envs.size() + 1);
     s += '=';
     if (addr.host_unix) {
       s += "unix,";
@@ -476,6 +483,16 @@ void exec_binary() {
 
     fd_envs.emplace_back(s);
     envp[envidx++] = const_cast<char *>(fd_envs.back().c_str());
+
+    for (auto fd : addr.reuseport_fds) {
+      auto s = ENV_ACCEPT_PREFIX.str();
+      s += util::utos(fd_envs.size() + 1);
+      s += "=tcp,";
+      s += util::utos(fd);
+
+      fd_envs.emplace_back(s);
+      envp[envidx++] = const_cast<char *>(fd_envs.back().c_str());
+    }
   }
 
   auto ipc_fd_str = ENV_ORIG_PID.str();
@@ -791,6 +808,21 @@ int create_tcp_server_socket(UpstreamAddr &faddr,
       continue;
     }
 
+    if (faddr.reuseport) {
+#ifdef SO_REUSEPORT
+      if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &val,
+                     static_cast<socklen_t>(sizeof(val))) == -1) {
+        auto error = errno;
+        LOG(WARN) << "Failed to set SO_REUSEPORT option to listener socket: "
+                  << xsi_strerror(error, errbuf.data(), errbuf.size());
+        close(fd);
+        continue;
+      }
+#else  // !SO_REUSEPORT
+      LOG(WARN) << "SO_REUSEPORT is not supported on this platform";
+#endif // !SO_REUSEPORT
+    }
+
 #ifdef IPV6_V6ONLY
     if (faddr.family == AF_INET6) {
       if (setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &val,
@@ -864,6 +896,225 @@ int create_tcp_server_socket(UpstreamAddr &faddr,
 }
 } // namespace
 
+namespace {
+// Creates new listener socket which is bound to the same address as
+// the listener socket |lfd|.  SO_REUSEPORT must be set to |lfd|.
+// This function returns the new socket if it succeeds, or -1.
+int create_reuseport_socket(int lfd) {
+#ifdef SO_REUSEPORT
+  std::array<char, STRERROR_BUFSIZE> errbuf;
+  auto &listenerconf = get_config()->conn.listener;
+
+  sockaddr_union su;
+  socklen_t salen = sizeof(su);
+
+  if (getsockname(lfd, &su.sa, &salen) == -1) {
+    auto error = errno;
+    LOG(WARN) << "getsockname() syscall failed: "
+              << xsi_strerror(error, errbuf.data(), errbuf.size());
+    return -1;
+  }
+
+  auto fd = util::create_nonblock_socket(su.storage.ss_family);
+  if (fd == -1) {
+    auto error = errno;
+    LOG(WARN) << "socket() syscall failed: "
+              << xsi_strerror(error, errbuf.data(), errbuf.size());
+    return -1;
+  }
+
+  int val = 1;
+  if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &val,
+                 static_cast<socklen_t>(sizeof(val))) == -1 ||
+      setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &val,
+                 static_cast<socklen_t>(sizeof(val))) == -1) {
+    auto error = errno;
+    LOG(WARN) << "Failed to set SO_REUSEADDR or SO_REUSEPORT option to "
+                 "listener socket: "
+              << xsi_strerror(error, errbuf.data(), errbuf.size());
+    close(fd);
+    return -1;
+  }
+
+#  ifdef IPV6_V6ONLY
+  if (su.storage.ss_family == AF_INET6) {
+    if (setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &val,
+                   static_cast<socklen_t>(sizeof(val))) == -1) {
+      auto error = errno;
+      LOG(WARN) << "Failed to set IPV6_V6ONLY option to listener socket: "
+                << xsi_strerror(error, errbuf.data(), errbuf.size());
+      close(fd);
+      return -1;
+    }
+  }
+#  endif // IPV6_V6ONLY
+
+#  ifdef TCP_DEFER_ACCEPT
+  val = 3;
+  if (setsockopt(fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, &val,
+                 static_cast<socklen_t>(sizeof(val))) == -1) {
+    auto error = errno;
+    LOG(WARN) << "Failed to set TCP_DEFER_ACCEPT option to listener socket: "
+              << xsi_strerror(error, errbuf.data(), errbuf.size());
+  }
+#  endif // TCP_DEFER_ACCEPT
+
+  // This fails if the listener socket was inherited from the process
+  // which did not set SO_REUSEPORT to it.
+  if (bind(fd, &su.sa, salen) == -1) {
+    auto error = errno;
+    LOG(WARN) << "bind() syscall failed: "
+              << xsi_strerror(error, errbuf.data(), errbuf.size());
+    close(fd);
+    return -1;
+  }
+
+#  ifdef TCP_FASTOPEN
+  if (listenerconf.fastopen > 0) {
+    val = listenerconf.fastopen;
+    if (setsockopt(fd, SOL_TCP, TCP_FASTOPEN, &val,
+                   static_cast<socklen_t>(sizeof(val))) == -1) {
+      auto error = errno;
+      LOG(WARN) << "Failed to set TCP_FASTOPEN option to listener socket: "
+                << xsi_strerror(error, errbuf.data(), errbuf.size());
+    }
+  }
+#  endif // TCP_FASTOPEN
+
+  if (listen(fd, listenerconf.backlog) == -1) {
+    auto error = errno;
+    LOG(WARN) << "listen() syscall failed: "
+              << xsi_strerror(error, errbuf.data(), errbuf.size());
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+#else  // !SO_REUSEPORT
+  return -1;
+#endif // !SO_REUSEPORT
+}
+} // namespace
+
+namespace {
+// Attaches classic BPF program to the SO_REUSEPORT group which |fd|
+// belongs to.  The program selects the socket whose index in the
+// group equals to the current CPU modulo |nsocks|.  If the returned
+// index is out of range, the kernel falls back to the hash based
+// selection.
+void attach_reuseport_cpu_bpf(int fd, size_t nsocks) {
+#if defined(SO_ATTACH_REUSEPORT_CBPF) && defined(HAVE_LINUX_FILTER_H)
+  std::array<char, STRERROR_BUFSIZE> errbuf;
+
+  std::array<sock_filter, 3> code{{
+      // A = raw_smp_processor_id()
+      {BPF_LD | BPF_W | BPF_ABS, 0, 0,
+       static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU)},
+      // A = A % nsocks
+      {BPF_ALU | BPF_MOD | BPF_K, 0, 0, static_cast<uint32_t>(nsocks)},
+      // return A
+      {BPF_RET | BPF_A, 0, 0, 0},
+  }};
+
+  sock_fprog prog{};
+  prog.len = code.size();
+  prog.filter = code.data();
+
+  if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog,
+                 static_cast<socklen_t>(sizeof(prog))) == -1) {
+    auto error = errno;
+    LOG(WARN) << "Failed to attach SO_ATTACH_REUSEPORT_CBPF program: "
+              << xsi_strerror(error, errbuf.data(), errbuf.size());
+  }
+#else  // !(SO_ATTACH_REUSEPORT_CBPF && HAVE_LINUX_FILTER_H)
+  LOG(WARN) << "reuseport-cpu: SO_ATTACH_REUSEPORT_CBPF is not supported on "
+               "this platform";
+#endif // !(SO_ATTACH_REUSEPORT_CBPF && HAVE_LINUX_FILTER_H)
+}
+} // namespace
+
+namespace {
+// Sets up the additional SO_REUSEPORT listener sockets for |faddr|
+// so that each of |n| workers accepts connections on its own socket.
+// They are kept open by the main process, and are inherited by the
+// worker process created after reload, just like faddr.fd.  Because
+// of this, the connections queued on them are accepted by the new
+// worker process even after the old worker process closes its copy.
+// The sockets inherited in |iaddrs| are reused if possible.  If any
+// of them cannot be set up, faddr.reuseport_fds is left empty, and
+// the worker process accepts connections in the main thread.
+void create_reuseport_sockets(UpstreamAddr &faddr, size_t n,
+                              std::vector<InheritedAddr> &iaddrs) {
+  std::array<char, STRERROR_BUFSIZE> errbuf;
+  int rv;
+
+  sockaddr_union su;
+  socklen_t salen = sizeof(su);
+
+  if (getsockname(faddr.fd, &su.sa, &salen) == -1) {
+    auto error = errno;
+    LOG(WARN) << "getsockname() syscall failed: "
+              << xsi_strerror(error, errbuf.data(), errbuf.size());
+    return;
+  }
+
+  std::array<char, NI_MAXHOST> host;
+  rv = getnameinfo(&su.sa, salen, host.data(), host.size(), nullptr, 0,
+                   NI_NUMERICHOST);
+  if (rv != 0) {
+    LOG(WARN) << "getnameinfo() failed: " << gai_strerror(rv);
+    return;
+  }
+
+  std::vector<InheritedAddr *> inherited;
+  std::vector<int> created;
+  std::vector<int> fds;
+
+  for (size_t i = 1; i < n; ++i) {
+    auto found = std::find_if(std::begin(iaddrs), std::end(iaddrs),
+                              [&host, &faddr](const InheritedAddr &ia) {
+                                return !ia.used && !ia.host_unix &&
+                                       ia.host == host.data() &&
+                                       ia.port == faddr.port;
+                              });
+
+    if (found != std::end(iaddrs)) {
+      (*found).used = true;
+      inherited.push_back(&*found);
+      fds.push_back((*found).fd);
+
+      continue;
+    }
+
+    auto fd = create_reuseport_socket(faddr.fd);
+    if (fd == -1) {
+      LOG(WARN) << "Could not create SO_REUSEPORT listener for "
+                << faddr.hostport;
+
+      for (auto ia : inherited) {
+        // This socket is closed by close_unused_inherited_addr.
+        ia->used = false;
+      }
+
+      for (auto fd : created) {
+        close(fd);
+      }
+
+      return;
+    }
+
+    created.push_back(fd);
+    fds.push_back(fd);
+  }
+
+  if (faddr.reuseport_cpu) {
+    attach_reuseport_cpu_bpf(faddr.fd, n);
+  }
+
+  faddr.reuseport_fds = std::move(fds);
+}
+} // namespace
+
 namespace {
 // Returns array of InheritedAddr constructed from |config|.  This
 // function is intended to be used when reloading configuration, and
@@ -875,22 +1126,32 @@ get_inherited_addr_from_config(BlockAllocator &balloc, Config *config) {
 
   auto &listenerconf = config->conn.listener;
 
-  std::vector<InheritedAddr> iaddrs(listenerconf.addrs.size());
+  std::vector<InheritedAddr> iaddrs;
 
-  size_t idx = 0;
   for (auto &addr : listenerconf.addrs) {
-    auto &iaddr = iaddrs[idx++];
-
     if (addr.host_unix) {
+      InheritedAddr iaddr{};
       iaddr.host = addr.host;
       iaddr.host_unix = true;
       iaddr.fd = addr.fd;
+      iaddrs.push_back(std::move(iaddr));
 
       continue;
     }
 
+    auto first = iaddrs.size();
+
+    InheritedAddr iaddr{};
     iaddr.port = addr.port;
     iaddr.fd = addr.fd;
+    iaddrs.push_back(iaddr);
+
+    // The additional SO_REUSEPORT sockets share the address with
+    // addr.fd.
+    for (auto fd : addr.reuseport_fds) {
+      iaddr.fd = fd;
+      iaddrs.push_back(iaddr);
+    }
 
     // We have to getsockname/getnameinfo for fd, since we may have
     // '*' appear in addr.host, which makes comparison against "real"
@@ -920,7 +1181,11 @@ get_inherited_addr_from_config(BlockAllocator &balloc, Config *config) {
       continue;
     }
 
-    iaddr.host = make_string_ref(balloc, StringRef{host.data()});
+    auto hostref = make_string_ref(balloc, StringRef{host.data()});
+
+    for (auto i = first; i < iaddrs.size(); ++i) {
+      iaddrs[i].host = hostref;
+    }
   }
 
   return iaddrs;
@@ -1130,6 +1395,12 @@ int create_acceptor_socket(Config *config, std::vector<InheritedAddr> &iaddrs) {
     if (create_tcp_server_socket(addr, iaddrs) != 0) {
       return -1;
     }
+
+#ifndef NOTHREADS
+    if (addr.reuseport && config->num_worker > 1) {
+      create_reuseport_sockets(addr, config->num_worker, iaddrs);
+    }
+#endif // !NOTHREADS
   }
 
   return 0;
@@ -1224,6 +1495,10 @@ pid_t fork_worker_process(int &main_ipc_fd,
 
     for (auto &addr : config->conn.listener.addrs) {
       util::make_socket_closeonexec(addr.fd);
+
+      for (auto fd : addr.reuseport_fds) {
+        util::make_socket_closeonexec(fd);
+      }
     }
 
     // Remove all WorkerProcesses to stop any registered watcher on
@@ -1394,6 +1669,10 @@ constexpr auto DEFAULT_NPN_LIST =
     StringRef::from_lit("h2,h2-16,h2-14,http/1.1");
 } // namespace
 
+namespace {
+constexpr auto DEFAULT_COLLAPSE_VARY = StringRef::from_lit("accept-encoding");
+} // namespace
+
 namespace {
 constexpr auto DEFAULT_TLS_MIN_PROTO_VERSION = StringRef::from_lit("TLSv1.2");
 #ifdef TLS1_3_VERSION
@@ -1413,6 +1692,12 @@ constexpr auto DEFAULT_ACCESSLOG_FORMAT =
 namespace {
 void fill_default_config(Config *config) {
   config->num_worker = 1;
+  config->worker_event.budget = 16;
+  config->worker_event.queue_size = 1024;
+
+  config->splice_relay.min_length = 64_k;
+  config->zerocopy_send.min_length = 32_k;
+  config->zerocopy_send.max_pinned = 64_m;
   config->conf_path = StringRef::from_lit("/etc/nghttpx/nghttpx.conf");
   config->pid = getpid();
 
@@ -1553,6 +1838,7 @@ void fill_default_config(Config *config) {
     auto &accessconf = loggingconf.access;
     accessconf.format =
         parse_log_format(config->balloc, DEFAULT_ACCESSLOG_FORMAT);
+    accessconf.async.buffer_size = 1_m;
 
     auto &errorconf = loggingconf.error;
     errorconf.file = StringRef::from_lit("/dev/stderr");
@@ -1587,6 +1873,9 @@ void fill_default_config(Config *config) {
       // Keep alive timeout for HTTP/1 upstream connection
       timeoutconf.idle_read = 1_min;
     }
+
+    upstreamconf.timer_wheel_tick = 100_ms;
+    upstreamconf.idle_release = 0.;
   }
 
   {
@@ -1603,6 +1892,34 @@ void fill_default_config(Config *config) {
       timeoutconf.max_backoff = 120_s;
     }
 
+    {
+      auto &outlierconf = downstreamconf.outlier;
+      outlierconf.ejection_time = 30_s;
+      outlierconf.error_rate = 50;
+      outlierconf.latency_factor = 10;
+      outlierconf.min_requests = 20;
+      outlierconf.max_ejection = 50;
+    }
+
+    {
+      auto &hedgeconf = downstreamconf.hedge;
+      hedgeconf.min_delay = 10_ms;
+      hedgeconf.budget = 10;
+    }
+
+    {
+      auto &concurrencyconf = downstreamconf.concurrency;
+      concurrencyconf.retry_after = 1_s;
+      concurrencyconf.min_limit = 4;
+    }
+
+    {
+      auto &collapseconf = downstreamconf.collapse;
+      collapseconf.vary = util::split_str(DEFAULT_COLLAPSE_VARY, ',');
+      collapseconf.timeout = 5_s;
+      collapseconf.max_waiters = 100;
+    }
+
     downstreamconf.connections_per_host = 8;
     downstreamconf.request_buffer_size = 16_k;
     downstreamconf.response_buffer_size = 128_k;
@@ -1737,8 +2054,10 @@ Connections:
               The  parameters are  delimited  by  ";".  The  available
               parameters       are:      "proto=<PROTO>",       "tls",
               "sni=<SNI_HOST>",         "fall=<N>",        "rise=<N>",
-              "affinity=<METHOD>",    "dns",    "redirect-if-not-tls",
-              "upgrade-scheme",                        "mruby=<PATH>",
+              "affinity=<METHOD>",  "balance=<ALG>", "hedge=<PERCENTILE>",
+              "max-concurrency=<N>", "min-idle=<N>",
+              "max-connections=<N>", "collapse", "dns",
+              "redirect-if-not-tls", "upgrade-scheme", "mruby=<PATH>",
               "read-timeout=<DURATION>",   "write-timeout=<DURATION>",
               "group=<GROUP>",  "group-weight=<N>", and  "weight=<N>".
               The  parameter  consists   of  keyword,  and  optionally
@@ -1780,12 +2099,20 @@ Connections:
               backend  is permanently  offline, once  it goes  in that
               state, and this is the default behaviour.
 
+              If there are multiple worker threads, a dedicated thread
+              makes these connections once per backend on behalf of all
+              workers, and  a backend  which one worker  finds offline
+              is excluded from load balancing by all workers until the
+              dedicated thread finds it online.
+
               The     session     affinity    is     enabled     using
               "affinity=<METHOD>"  parameter.   If  "ip" is  given  in
               <METHOD>, client  IP based session affinity  is enabled.
               If "cookie"  is given in <METHOD>,  cookie based session
-              affinity is  enabled.  If  "none" is given  in <METHOD>,
-              session affinity  is disabled, and this  is the default.
+              affinity is  enabled.  If "hash"  is given in <METHOD>,
+              request attribute based session affinity is enabled.
+              If "none" is  given in <METHOD>,  session affinity is
+              disabled, and this is the default.
               The session  affinity is  enabled per <PATTERN>.   If at
               least  one backend  has  "affinity"  parameter, and  its
               <METHOD> is not "none",  session affinity is enabled for
@@ -1810,6 +2137,21 @@ Connections:
               the  Secure attribute  is  always set.   If <SECURE>  is
               "no", the Secure attribute is always omitted.
 
+              If "affinity=hash" is  used, a request attribute given by
+              "affinity-hash-key=<KEY>" is  hashed  with  consistent
+              hashing  with  bounded  loads.   <KEY>  is  one  of  the
+              following:  "path" (request path without  query, and this
+              is the default), "path-prefix:<N>" (the  first <N> segments
+              of request path), and "header:<NAME>" (the value of request
+              header  field <NAME>).   If  the  attribute  is  missing,
+              the request is load balanced as if "balance=p2c" is used.
+              The  optional  "affinity-hash-max-load=<PERCENT>" limits
+              the  outstanding  requests of  a backend to  <PERCENT> of
+              the mean of the  backends  sharing the  same  <PATTERN>.
+              If a  backend  is at  this limit,  the next  backend on
+              the hash ring is used.  <PERCENT> must be  at least 100.
+              The default value is 125.  The load is counted per worker.
+
               By default, name resolution of backend host name is done
               at  start  up,  or reloading  configuration.   If  "dns"
               parameter   is  given,   name  resolution   takes  place
@@ -1876,6 +2218,106 @@ Connections:
               weight  becomes  1.   "weight"  is  ignored  if  session
               affinity is enabled.
 
+              "balance=<ALG>" parameter specifies the load balancing
+              algorithm used when session affinity is disabled.  If
+              "wrr" is given  in <ALG>, the  weighted scheduling based
+              on "group-weight" and "weight" parameters is used, and
+              this is the default.  If "p2c" is given, nghttpx picks 2
+              backend  addresses at random,  and forwards  a request to
+              the one with  less outstanding requests.  The number of
+              outstanding  requests is multiplied  by the moving average
+              of response  header latency of  the address, and divided
+              by its "weight".   These numbers are counted per worker.
+              "group" and "group-weight" are ignored if "p2c" is used.
+              All backends  which share  the same  pattern  must have
+              the same <ALG>.
+
+              "hedge=<PERCENTILE>" parameter enables request hedging.
+              If  a GET or HEAD request without  request body does not
+              receive  response header  within  <PERCENTILE>-th  percentile
+              of the recent response header latency of the group, nghttpx
+              sends  the same request to  another backend address in the
+              same group which  uses the same protocol, and  uses the
+              response which arrives first.  The other request is canceled
+              by closing its  HTTP/1.1 connection, or by  resetting its
+              HTTP/2 stream with CANCEL.  <PERCENTILE> must be in
+              range [1, 99], inclusive.  The number of hedged requests is
+              limited by --backend-hedge-budget, and the delay is at
+              least --backend-hedge-min-delay.  All backends which
+              share the same pattern must have the same <PERCENTILE>.
+
+              "max-concurrency=<N>"  parameter  enables  adaptive
+              concurrency limiting.  nghttpx  keeps  the  number of
+              requests forwarded  to the group concurrently under the
+              limit,  which  is  adjusted  between
+              --backend-concurrency-min-limit  and <N> based on  the
+              ratio of the minimum response header latency to the
+              recent one.   The limit shrinks as  the  backends  slow
+              down, and  grows while  they respond  quickly.  A request
+              which exceeds the limit is rejected with 503 response
+              without  being  forwarded.  See
+              --backend-concurrency-retry-after.   The  limit  is
+              maintained per worker.  All backends which share the same
+              pattern must have the same <N>.
+
+              "min-idle=<N>" parameter makes each worker open at least
+              <N> connections to the backend address in advance and keep
+              them idle, so that requests after startup, reload, or
+              backend configuration update do not wait for TCP and TLS
+              handshakes.  For HTTP/2 backend, <N> is the number of
+              HTTP/2 sessions.  TLS sessions are resumed if possible.
+              Connections are  opened periodically  with random jitter
+              so  that workers do not connect at the same time.  Up to
+              <N>  idle  HTTP/1.1  connections  are  exempt  from
+              --backend-keep-alive-timeout, and stay open until the
+              backend closes them.  The  ones beyond <N> are closed
+              after the timeout as usual.  Since
+              each worker keeps its own connections, a backend receives
+              up to <N> times --workers connections.  The default
+              value is 0, which disables pre-warming.
+
+              "max-connections=<N>" parameter  limits the number of
+              connections to the backend address which all workers hold
+              in  total to  <N>.  For HTTP/2 backend, it is the number
+              of HTTP/2 sessions.   Workers draw connections  from the
+              shared budget as they need them, so a busy worker can use
+              more connections than an idle one.  If a worker needs a
+              new connection  while the budget is exhausted, the request
+              fails with 503 status code  with retry-after header field
+              set to  --backend-concurrency-retry-after, and an idle
+              connection held by any worker, including pre-warmed ones
+              and idle HTTP/2 sessions, is closed to make room.  Until
+              then, workers  do not pre-warm connections to the backend
+              address.   Backend addresses  which connect  to the  same
+              endpoint share the budget,  and if they specify different
+              values,  nghttpx refuses  the configuration.  The  default
+              value is 0, which means unlimited.
+
+              "collapse" parameter enables collapsed forwarding.  While
+              a GET request without  request body is forwarded to  the
+              group, the  other GET requests with  the same scheme,
+              authority, path, and the header fields listed in
+              --backend-collapse-vary wait  for its response instead
+              of  being forwarded.   Requests  with  authorization  or
+              range header field  are not collapsed.  Requests with
+              cookie header field are not collapsed either unless
+              "cookie" is listed in --backend-collapse-vary.  If  the response
+              can be  stored by a shared  cache, and does not vary on
+              the header fields other  than the listed ones, its header
+              fields and body are  sent to all waiting requests.  A
+              waiting request whose  client cannot receive the body
+              as fast as the  forwarded one, and buffers more than
+              --backend-response-buffer, is reset.
+              Otherwise, or if the response header does not arrive
+              within  --backend-collapse-timeout,  the  waiting
+              requests are forwarded to the backend separately.  The
+              number of waiting requests is limited by
+              --backend-collapse-max-waiters.  Requests are collapsed
+              only within a worker.  Collapsing is disabled if session
+              affinity is enabled.  If at least one backend enables
+              "collapse", it is enabled for  all backends which share
+              the same pattern.
+
               Since ";" and ":" are  used as delimiter, <PATTERN> must
               not contain  these characters.  In order  to include ":"
               in  <PATTERN>,  one  has  to  specify  "%3A"  (which  is
@@ -1921,6 +2363,31 @@ Connections:
               connection,  specify  "proxyproto" parameter.   This  is
               disabled by default.
 
+              If "reuseport" parameter is  used, SO_REUSEPORT socket
+              option is set  to the listener socket, and  each worker
+              thread  listens  on  its  own  socket  bound  to  this
+              address.  A  connection is accepted by  the worker whose
+              socket the kernel  selected, instead of  being accepted
+              by the main  thread and dispatched  to workers.  If the
+              additional sockets cannot be  created, the main thread
+              accepts connections  as usual.  This  parameter has no
+              effect with  --single-thread option,  and it  cannot be
+              used with "api" parameter or UNIX domain socket.  The
+              master process creates and keeps all these sockets, and
+              hands them over to the new worker process on reload, so
+              the connections  queued on  them are  not reset.  If the
+              number of workers  is reduced on reload, the connections
+              queued  on the  sockets  which  are  no longer used are
+              reset.
+
+              "reuseport-cpu" parameter  implies "reuseport",  and it
+              additionally attaches  BPF  program to the  listener
+              sockets which  selects  the socket  by  the CPU  which
+              processes the  incoming connection.  This  is useful if
+              the receive  queues of the  network interface are bound
+              to the CPUs 0, 1, ..., N-1 where N is the number of
+              worker threads.
+
               Default: *,3000
   --backlog=<N>
               Set listen backlog size.
@@ -1945,6 +2412,107 @@ Connections:
               timeouts when connecting and  making CONNECT request can
               be     specified    by     --backend-read-timeout    and
               --backend-write-timeout options.
+  --backend-outlier-detection-interval=<DURATION>
+              Enable  passive outlier  detection  and  evaluate backend
+              addresses at  this interval.   nghttpx records  the HTTP
+              status code, the stream reset, and the latency of each
+              response a backend address serves.  A backend address is
+              ejected  from  load  balancing  if  the  ratio  of  5xx
+              responses   and   reset   streams   exceeds
+              --backend-outlier-error-rate,   or   its   average
+              latency  exceeds --backend-outlier-latency-factor  times
+              the average latency of the  other addresses in the same
+              group.  Specify 0 to disable outlier detection.
+              Default: )"
+      << util::duration_str(config->conn.downstream->outlier.interval) << R"(
+  --backend-outlier-error-rate=<PERCENT>
+              Specify  the  percentage  of  5xx  responses  and  reset
+              streams  which makes a  backend address  an outlier.   0
+              disables error based detection.
+              Default: )"
+      << config->conn.downstream->outlier.error_rate << R"(
+  --backend-outlier-latency-factor=<N>
+              A backend  address whose average latency  is larger than
+              <N> times  the average latency  of the other  addresses
+              in the same group is ejected.  0 disables latency based
+              detection.
+              Default: )"
+      << config->conn.downstream->outlier.latency_factor << R"(
+  --backend-outlier-min-requests=<N>
+              Specify the minimum number of responses a backend address
+              must  serve in  the last  2 intervals  before it  is
+              evaluated.
+              Default: )"
+      << config->conn.downstream->outlier.min_requests << R"(
+  --backend-outlier-ejection-time=<DURATION>
+              Specify the base duration to eject an outlier.  Each
+              consecutive ejection  of the same address doubles  the
+              duration, up to --backend-max-backoff.  When the duration
+              elapses, the address is put back to load balancing.
+              Default: )"
+      << util::duration_str(config->conn.downstream->outlier.ejection_time)
+      << R"(
+  --backend-outlier-max-ejection=<PERCENT>
+              Specify the maximum percentage of backend addresses in a
+              group  that can  be  ejected  at the  same time.   At
+              least one address is always left in load balancing.
+              Default: )"
+      << config->conn.downstream->outlier.max_ejection << R"(
+  --backend-hedge-budget=<PERCENT>
+              Specify the maximum number of hedged requests relative to
+              the  number  of  requests  eligible  for  hedging  in  a
+              backend group, in percent.  See "hedge" parameter in
+              --backend option.
+              Default: )"
+      << config->conn.downstream->hedge.budget << R"(
+  --backend-hedge-min-delay=<DURATION>
+              Specify the minimum delay before a hedged request is sent.
+              The delay  computed from the  response latency of  the
+              backend group is never shorter than this value.
+              Default: )"
+      << util::duration_str(config->conn.downstream->hedge.min_delay) << R"(
+  --backend-concurrency-min-limit=<N>
+              Specify the lower bound of the adaptive concurrency limit
+              of a backend group.  See "max-concurrency" parameter in
+              --backend option.
+              Default: )"
+      << config->conn.downstream->concurrency.min_limit << R"(
+  --backend-concurrency-retry-after=<DURATION>
+              Specify the value of retry-after header field sent with
+              503 response  to the request  rejected by the  adaptive
+              concurrency  limit.   The value  is  rounded up  to  the
+              nearest second.  If 0 is given, retry-after header field
+              is not sent.
+              Default: )"
+      << util::duration_str(config->conn.downstream->concurrency.retry_after)
+      << R"(
+  --backend-collapse-vary=<LIST>
+              Comma delimited list of request header field names which
+              are  included  in  the key  of  collapsed  forwarding  in
+              addition to  authority and path.  Names are case
+              insensitive,  and white spaces around them are ignored.
+              Requests with different
+              values in these header  fields are not collapsed.  If the
+              response contains vary  header field which  names a header
+              field not in  <LIST>, the waiting requests are forwarded to
+              the backend separately.  See "collapse" parameter in
+              --backend option.
+              Default: )"
+      << DEFAULT_COLLAPSE_VARY << R"(
+  --backend-collapse-max-waiters=<N>
+              Specify the maximum number  of requests which wait for the
+              response of  a single  collapsed request.  If  the limit is
+              reached, the  next request  is forwarded to  the backend,
+              and the subsequent identical requests wait for it instead.
+              Default: )"
+      << config->conn.downstream->collapse.max_waiters << R"(
+  --backend-collapse-timeout=<DURATION>
+              Specify the maximum time  that a request waits for the
+              response header of the collapsed request.  If the response
+              header does not arrive within this time, the request is
+              forwarded to the backend separately.
+              Default: )"
+      << util::duration_str(config->conn.downstream->collapse.timeout) << R"(
 
 Performance:
   -n, --workers=<N>
@@ -2004,6 +2572,68 @@ Performance:
               accepts.  Setting 0 means unlimited.
               Default: )"
       << config->conn.upstream.worker_connections << R"(
+  --worker-event-budget=<N>
+              Set the maximum number of events, including accepted
+              connections dispatched from  the main thread,  which a
+              worker processes  in one event loop iteration.   Larger
+              value improves  connection acceptance  throughput, but
+              may delay the processing of existing connections.
+              Default: )"
+      << config->worker_event.budget << R"(
+  --worker-event-queue-size=<N>
+              Set the capacity of the lock-free queue which carries
+              accepted connections  from the main thread  to each
+              worker.   The value is rounded  up to  the power of 2.
+              If the queue is full, connections are passed through
+              the slower mutex protected queue.
+              Default: )"
+      << config->worker_event.queue_size << R"(
+  --splice-relay
+              Relay response body  with splice(2) without copying it
+              to  userspace  when  both frontend  and  backend  are
+              cleartext HTTP/1.1, and the response  body has content-
+              length.   The frontend  may also  be HTTPS  if  kTLS is
+              enabled for it with --tls-ktls.  Chunked response body
+              and  request  body are  always  relayed  through
+              userspace.  This option has no effect if the system does
+              not support splice(2).
+  --splice-relay-min-length=<SIZE>
+              Relay response  body with  splice(2) only if  the rest
+              of it after response header  fields is at least <SIZE>
+              bytes.
+              Default: )"
+      << util::utos_unit(config->splice_relay.min_length) << R"(
+  --io-engine=<ENGINE>
+              Set the  I/O engine  which workers use.   <ENGINE> is
+              either  "libev"  or  "io_uring".   If "io_uring"  is
+              given, each  worker receives  data  from cleartext
+              frontend  connections with  multishot recv  through
+              its own io_uring instance, and accepts connections on
+              "reuseport" frontend addresses  with multishot accept.
+              If io_uring  is not  available, libev  is used.   The
+              io_uring engine only  covers accept(2) and recv(2).
+              Writes, TLS  frontend  connections  and all backend
+              connections  are  still  handled  by  libev, one
+              system call per readiness event.
+              Default: libev
+  --zerocopy-send
+              Write response  to  cleartext  frontend  connection
+              with MSG_ZEROCOPY  if  a single write  is  large.  The
+              buffers are pinned until the kernel tells that it no
+              longer  needs them.   This option has no  effect if
+              the system does not support MSG_ZEROCOPY.
+  --zerocopy-send-min-length=<SIZE>
+              Use MSG_ZEROCOPY only if a single write is at least
+              <SIZE> bytes.
+              Default: )"
+      << util::utos_unit(config->zerocopy_send.min_length) << R"(
+  --zerocopy-send-max-pinned=<SIZE>
+              Set the maximum number of bytes per worker which have
+              been sent with MSG_ZEROCOPY, and are waiting for the
+              completion.  If it is exceeded, data are copied to the
+              kernel as usual.
+              Default: )"
+      << util::utos_unit(config->zerocopy_send.max_pinned) << R"(
   --backend-connections-per-host=<N>
               Set  maximum number  of  backend concurrent  connections
               (and/or  streams in  case  of HTTP/2)  per origin  host.
@@ -2066,6 +2696,23 @@ Timeout:
               connection.
               Default: )"
       << util::duration_str(config->conn.upstream.timeout.idle_read) << R"(
+  --frontend-timer-wheel-tick=<DURATION>
+              Specify  the  granularity   of  the  timer  wheel  which
+              schedules  read and  keep-alive  timeouts of  frontend
+              connections.  The timer  wheel is cheaper  than libev
+              timers when a worker handles a large number of frontend
+              connections, but these timeouts may  fire up to this
+              duration later.  0 disables the timer wheel.
+              Default: )"
+      << util::duration_str(config->conn.upstream.timer_wheel_tick) << R"(
+  --frontend-idle-release=<DURATION>
+              Release the  read and write buffers  of frontend connection
+              which has  been idle  for this duration.  The buffers are
+              allocated again  when the connection becomes active.  This
+              requires the timer wheel  (see --frontend-timer-wheel-tick).
+              0 disables this feature.
+              Default: )"
+      << util::duration_str(config->conn.upstream.idle_release) << R"(
   --stream-read-timeout=<DURATION>
               Specify  read timeout  for HTTP/2  streams.  0  means no
               timeout.
@@ -2446,6 +3093,13 @@ SSL/TLS:
               accepts.
               Default: )"
       << util::utos_unit(config->tls.max_early_data) << R"(
+  --tls-ktls
+              Let the kernel encrypt and decrypt TLS records (kTLS)
+              after TLSv1.3 handshake if the kernel and the negotiated
+              cipher suite support it.  Response body  then can be
+              relayed to  the  frontend  with  --splice-relay.  The
+              connection which cannot use kTLS falls back to userspace
+              TLS.
 
 HTTP/2:
   -c, --frontend-http2-max-concurrent-streams=<N>
@@ -2628,6 +3282,23 @@ Logging:
               Write  access  log  when   response  header  fields  are
               received   from  backend   rather   than  when   request
               transaction finishes.
+  --accesslog-async
+              Write access log in a dedicated thread.  Each thread puts
+              formatted lines to its own buffer, and the dedicated
+              thread  writes  them  to  the  access  log  in  batch.
+              This option has no effect if nghttpx is built without
+              thread support.
+  --accesslog-async-buffer-size=<SIZE>
+              Set  the  size of  access  log  buffer  per thread  when
+              --accesslog-async is used.
+              Default: )"
+      << util::utos_unit(config->logging.access.async.buffer_size) << R"(
+  --accesslog-async-overflow=<POLICY>
+              Specify what to do when access log  buffer is full.  If
+              "drop" is  given, the line is  discarded, and counted in
+              "accesslogDropped" of workerstats API.  If "block" is
+              given, the thread waits until the buffer has space.
+              Default: drop
   --errorlog-file=<PATH>
               Set path to write error  log.  To reopen file, send USR1
               signal  to nghttpx.   stderr will  be redirected  to the
@@ -2945,6 +3616,14 @@ int process_options(Config *config,
     config->num_worker = 1;
   }
 
+  {
+    auto &upstreamconf = config->conn.upstream;
+    if (upstreamconf.idle_release > 0. && upstreamconf.timer_wheel_tick == 0.) {
+      LOG(WARN) << "frontend-idle-release: requires timer wheel; disabled";
+      upstreamconf.idle_release = 0.;
+    }
+  }
+
   auto &http2conf = config->http2;
   {
     auto &dumpconf = http2conf.upstream.debug.dump;
@@ -3159,16 +3838,24 @@ void close_not_inherited_fd(Config *config,
                             const std::vector<InheritedAddr> &iaddrs) {
   auto &listenerconf = config->conn.listener;
 
-  for (auto &addr : listenerconf.addrs) {
+  auto close_fd = [&iaddrs](int fd) {
     auto inherited = std::find_if(
         std::begin(iaddrs), std::end(iaddrs),
-        [&addr](const InheritedAddr &iaddr) { return addr.fd == iaddr.fd; });
+        [fd](const InheritedAddr &iaddr) { return fd == iaddr.fd; });
 
     if (inherited != std::end(iaddrs)) {
-      continue;
+      return;
     }
 
-    close(addr.fd);
+    close(fd);
+  };
+
+  for (auto &addr : listenerconf.addrs) {
+    close_fd(addr.fd);
+
+    for (auto fd : addr.reuseport_fds) {
+      close_fd(fd);
+    }
   }
 }
 } // namespace
@@ -3531,6 +4218,54 @@ int main(int argc, char **argv) {
         {SHRPX_OPT_TLS13_CLIENT_CIPHERS.c_str(), required_argument, &flag, 165},
         {SHRPX_OPT_NO_STRIP_INCOMING_EARLY_DATA.c_str(), no_argument, &flag,
          166},
+        {SHRPX_OPT_WORKER_EVENT_BUDGET.c_str(), required_argument, &flag, 167},
+        {SHRPX_OPT_WORKER_EVENT_QUEUE_SIZE.c_str(), required_argument, &flag,
+         168},
+        {SHRPX_OPT_ACCESSLOG_ASYNC.c_str(), no_argument, &flag, 169},
+        {SHRPX_OPT_ACCESSLOG_ASYNC_BUFFER_SIZE.c_str(), required_argument,
+         &flag, 170},
+        {SHRPX_OPT_ACCESSLOG_ASYNC_OVERFLOW.c_str(), required_argument, &flag,
+         171},
+        {SHRPX_OPT_SPLICE_RELAY.c_str(), no_argument, &flag, 172},
+        {SHRPX_OPT_SPLICE_RELAY_MIN_LENGTH.c_str(), required_argument, &flag,
+         173},
+        {SHRPX_OPT_IO_ENGINE.c_str(), required_argument, &flag, 174},
+        {SHRPX_OPT_TLS_KTLS.c_str(), no_argument, &flag, 175},
+        {SHRPX_OPT_ZEROCOPY_SEND.c_str(), no_argument, &flag, 176},
+        {SHRPX_OPT_ZEROCOPY_SEND_MIN_LENGTH.c_str(), required_argument, &flag,
+         177},
+        {SHRPX_OPT_ZEROCOPY_SEND_MAX_PINNED.c_str(), required_argument, &flag,
+         178},
+        {SHRPX_OPT_FRONTEND_TIMER_WHEEL_TICK.c_str(), required_argument, &flag,
+         179},
+        {SHRPX_OPT_FRONTEND_IDLE_RELEASE.c_str(), required_argument, &flag,
+         180},
+        {SHRPX_OPT_BACKEND_OUTLIER_DETECTION_INTERVAL.c_str(),
+         required_argument, &flag, 181},
+        {SHRPX_OPT_BACKEND_OUTLIER_ERROR_RATE.c_str(), required_argument, &flag,
+         182},
+        {SHRPX_OPT_BACKEND_OUTLIER_LATENCY_FACTOR.c_str(), required_argument,
+         &flag, 183},
+        {SHRPX_OPT_BACKEND_OUTLIER_MIN_REQUESTS.c_str(), required_argument,
+         &flag, 184},
+        {SHRPX_OPT_BACKEND_OUTLIER_EJECTION_TIME.c_str(), required_argument,
+         &flag, 185},
+        {SHRPX_OPT_BACKEND_OUTLIER_MAX_EJECTION.c_str(), required_argument,
+         &flag, 186},
+        {SHRPX_OPT_BACKEND_HEDGE_BUDGET.c_str(), required_argument, &flag,
+         187},
+        {SHRPX_OPT_BACKEND_HEDGE_MIN_DELAY.c_str(), required_argument, &flag,
+         188},
+        {SHRPX_OPT_BACKEND_CONCURRENCY_MIN_LIMIT.c_str(), required_argument,
+         &flag, 189},
+        {SHRPX_OPT_BACKEND_CONCURRENCY_RETRY_AFTER.c_str(), required_argument,
+         &flag, 190},
+        {SHRPX_OPT_BACKEND_COLLAPSE_VARY.c_str(), required_argument, &flag,
+         191},
+        {SHRPX_OPT_BACKEND_COLLAPSE_MAX_WAITERS.c_str(), required_argument,
+         &flag, 192},
+        {SHRPX_OPT_BACKEND_COLLAPSE_TIMEOUT.c_str(), required_argument, &flag,
+         193},
         {nullptr, 0, nullptr, 0}};
 
     int option_index = 0;
@@ -4324,6 +5059,138 @@ int main(int argc, char **argv) {
         cmdcfgs.emplace_back(SHRPX_OPT_NO_STRIP_INCOMING_EARLY_DATA,
                              StringRef::from_lit("yes"));
         break;
+      case 167:
+        // --worker-event-budget
+        cmdcfgs.emplace_back(SHRPX_OPT_WORKER_EVENT_BUDGET, StringRef{optarg});
+        break;
+      case 168:
+        // --worker-event-queue-size
+        cmdcfgs.emplace_back(SHRPX_OPT_WORKER_EVENT_QUEUE_SIZE,
+                             StringRef{optarg});
+        break;
+      case 169:
+        // --accesslog-async
+        cmdcfgs.emplace_back(SHRPX_OPT_ACCESSLOG_ASYNC,
+                             StringRef::from_lit("yes"));
+        break;
+      case 170:
+        // --accesslog-async-buffer-size
+        cmdcfgs.emplace_back(SHRPX_OPT_ACCESSLOG_ASYNC_BUFFER_SIZE,
+                             StringRef{optarg});
+        break;
+      case 171:
+        // --accesslog-async-overflow
+        cmdcfgs.emplace_back(SHRPX_OPT_ACCESSLOG_ASYNC_OVERFLOW,
+                             StringRef{optarg});
+        break;
+      case 172:
+        // --splice-relay
+        cmdcfgs.emplace_back(SHRPX_OPT_SPLICE_RELAY,
+                             StringRef::from_lit("yes"));
+        break;
+      case 173:
+        // --splice-relay-min-length
+        cmdcfgs.emplace_back(SHRPX_OPT_SPLICE_RELAY_MIN_LENGTH,
+                             StringRef{optarg});
+        break;
+      case 174:
+        // --io-engine
+        cmdcfgs.emplace_back(SHRPX_OPT_IO_ENGINE, StringRef{optarg});
+        break;
+      case 175:
+        // --tls-ktls
+        cmdcfgs.emplace_back(SHRPX_OPT_TLS_KTLS, StringRef::from_lit("yes"));
+        break;
+      case 176:
+        // --zerocopy-send
+        cmdcfgs.emplace_back(SHRPX_OPT_ZEROCOPY_SEND,
+                             StringRef::from_lit("yes"));
+        break;
+      case 177:
+        // --zerocopy-send-min-length
+        cmdcfgs.emplace_back(SHRPX_OPT_ZEROCOPY_SEND_MIN_LENGTH,
+                             StringRef{optarg});
+        break;
+      case 178:
+        // --zerocopy-send-max-pinned
+        cmdcfgs.emplace_back(SHRPX_OPT_ZEROCOPY_SEND_MAX_PINNED,
+                             StringRef{optarg});
+        break;
+      case 179:
+        // --frontend-timer-wheel-tick
+        cmdcfgs.emplace_back(SHRPX_OPT_FRONTEND_TIMER_WHEEL_TICK,
+                             StringRef{optarg});
+        break;
+      case 180:
+        // --frontend-idle-release
+        cmdcfgs.emplace_back(SHRPX_OPT_FRONTEND_IDLE_RELEASE,
+                             StringRef{optarg});
+        break;
+      case 181:
+        // --backend-outlier-detection-interval
+        cmdcfgs.emplace_back(SHRPX_OPT_BACKEND_OUTLIER_DETECTION_INTERVAL,
+                             StringRef{optarg});
+        break;
+      case 182:
+        // --backend-outlier-error-rate
+        cmdcfgs.emplace_back(SHRPX_OPT_BACKEND_OUTLIER_ERROR_RATE,
+                             StringRef{optarg});
+        break;
+      case 183:
+        // --backend-outlier-latency-factor
+        cmdcfgs.emplace_back(SHRPX_OPT_BACKEND_OUTLIER_LATENCY_FACTOR,
+                             StringRef{optarg});
+        break;
+      case 184:
+        // --backend-outlier-min-requests
+        cmdcfgs.emplace_back(SHRPX_OPT_BACKEND_OUTLIER_MIN_REQUESTS,
+                             StringRef{optarg});
+        break;
+      case 185:
+        // --backend-outlier-ejection-time
+        cmdcfgs.emplace_back(SHRPX_OPT_BACKEND_OUTLIER_EJECTION_TIME,
+                             StringRef{optarg});
+        break;
+      case 186:
+        // --backend-outlier-max-ejection
+        cmdcfgs.emplace_back(SHRPX_OPT_BACKEND_OUTLIER_MAX_EJECTION,
+                             StringRef{optarg});
+        break;
+      case 187:
+        // --backend-hedge-budget
+        cmdcfgs.emplace_back(SHRPX_OPT_BACKEND_HEDGE_BUDGET,
+                             StringRef{optarg});
+        break;
+      case 188:
+        // --backend-hedge-min-delay
+        cmdcfgs.emplace_back(SHRPX_OPT_BACKEND_HEDGE_MIN_DELAY,
+                             StringRef{optarg});
+        break;
+      case 189:
+        // --backend-concurrency-min-limit
+        cmdcfgs.emplace_back(SHRPX_OPT_BACKEND_CONCURRENCY_MIN_LIMIT,
+                             StringRef{optarg});
+        break;
+      case 190:
+        // --backend-concurrency-retry-after
+        cmdcfgs.emplace_back(SHRPX_OPT_BACKEND_CONCURRENCY_RETRY_AFTER,
+                             StringRef{optarg});
+        break;
+      case 191:
+        // --backend-collapse-vary
+        cmdcfgs.emplace_back(SHRPX_OPT_BACKEND_COLLAPSE_VARY,
+                             StringRef{optarg});
+        break;
+      case 192:
+        // --backend-collapse-max-waiters
+        cmdcfgs.emplace_back(SHRPX_OPT_BACKEND_COLLAPSE_MAX_WAITERS,
+                             StringRef{optarg});
+        break;
+      case 193:
+        // --backend-collapse-timeout
+        cmdcfgs.emplace_back(SHRPX_OPT_BACKEND_COLLAPSE_TIMEOUT,
+                             StringRef{optarg});
+        break;
       default:
         break;
       }
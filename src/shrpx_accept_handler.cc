@@ -31,6 +31,7 @@
 #include <cerrno>
 
 #include "shrpx_connection_handler.h"
+#include "shrpx_worker.h"
 #include "shrpx_config.h"
 #include "shrpx_log.h"
 #include "util.h"
@@ -46,16 +47,67 @@ void acceptcb(struct ev_loop *loop, ev_io *w, int revent) {
 }
 } // namespace
 
+#ifdef HAVE_IO_URING
+namespace {
+void uring_acceptcb(IOUring *ring, IOUringOp *op, int res, Memchunk16K *m,
+                    bool more) {
+  auto h = static_cast<AcceptHandler *>(op->data);
+  h->on_uring_accept(res, more);
+}
+} // namespace
+#endif // HAVE_IO_URING
+
 AcceptHandler::AcceptHandler(const UpstreamAddr *faddr, ConnectionHandler *h)
-    : conn_hnr_(h), faddr_(faddr) {
-  ev_io_init(&wev_, acceptcb, faddr_->fd, EV_READ);
+    : conn_hnr_(h), worker_(nullptr), faddr_(faddr), fd_(faddr->fd) {
+  ev_io_init(&wev_, acceptcb, fd_, EV_READ);
   wev_.data = this;
+#ifdef HAVE_IO_URING
+  ring_ = nullptr;
+  enabled_ = true;
+#endif // HAVE_IO_URING
   ev_io_start(conn_hnr_->get_loop(), &wev_);
 }
 
+AcceptHandler::AcceptHandler(const UpstreamAddr *faddr, Worker *worker, int fd)
+    : conn_hnr_(worker->get_connection_handler()),
+      worker_(worker),
+      faddr_(faddr),
+      fd_(fd) {
+  ev_io_init(&wev_, acceptcb, fd_, EV_READ);
+  wev_.data = this;
+#ifdef HAVE_IO_URING
+  // Since a reuseport listener is owned by this worker only, accept
+  // can be done by the worker's io_uring.
+  ring_ = worker_->get_io_uring();
+  enabled_ = true;
+  if (ring_) {
+    io_uring_op_init(&uring_op_, uring_acceptcb, this, fd_,
+                     IOUringOpType::ACCEPT);
+    ring_->start(&uring_op_);
+    return;
+  }
+#endif // HAVE_IO_URING
+  ev_io_start(worker_->get_loop(), &wev_);
+}
+
 AcceptHandler::~AcceptHandler() {
-  ev_io_stop(conn_hnr_->get_loop(), &wev_);
-  close(faddr_->fd);
+#ifdef HAVE_IO_URING
+  if (ring_) {
+    // The in-flight accept keeps the socket listening.  Submit
+    // cancellation now before closing it.
+    ring_->stop(&uring_op_);
+    ring_->submit();
+  }
+#endif // HAVE_IO_URING
+  ev_io_stop(get_loop(), &wev_);
+  close(fd_);
+}
+
+struct ev_loop *AcceptHandler::get_loop() const {
+  if (worker_) {
+    return worker_->get_loop();
+  }
+  return conn_hnr_->get_loop();
 }
 
 void AcceptHandler::accept_connection() {
@@ -64,34 +116,14 @@ void AcceptHandler::accept_connection() {
 
 #ifdef HAVE_ACCEPT4
   auto cfd =
-      accept4(faddr_->fd, &sockaddr.sa, &addrlen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+      accept4(fd_, &sockaddr.sa, &addrlen, SOCK_NONBLOCK | SOCK_CLOEXEC);
 #else  // !HAVE_ACCEPT4
-  auto cfd = accept(faddr_->fd, &sockaddr.sa, &addrlen);
+  auto cfd = accept(fd_, &sockaddr.sa, &addrlen);
 #endif // !HAVE_ACCEPT4
 
   if (cfd == -1) {
-    switch (errno) {
-    case EINTR:
-    case ENETDOWN:
-    case EPROTO:
-    case ENOPROTOOPT:
-    case EHOSTDOWN:
-#ifdef ENONET
-    case ENONET:
-#endif // ENONET
-    case EHOSTUNREACH:
-    case EOPNOTSUPP:
-    case ENETUNREACH:
-      return;
-    case EMFILE:
-    case ENFILE:
-      LOG(WARN) << "acceptor: running out file descriptor; disable acceptor "
-                   "temporarily";
-      conn_hnr_->sleep_acceptor(get_config()->conn.listener.timeout.sleep);
-      return;
-    default:
-      return;
-    }
+    handle_accept_error(errno);
+    return;
   }
 
 #ifndef HAVE_ACCEPT4
@@ -99,13 +131,93 @@ void AcceptHandler::accept_connection() {
   util::make_socket_closeonexec(cfd);
 #endif // !HAVE_ACCEPT4
 
-  conn_hnr_->handle_connection(cfd, &sockaddr.sa, addrlen, faddr_);
+  handle_accepted(cfd, &sockaddr.sa, addrlen);
 }
 
-void AcceptHandler::enable() { ev_io_start(conn_hnr_->get_loop(), &wev_); }
+#ifdef HAVE_IO_URING
+void AcceptHandler::on_uring_accept(int res, bool more) {
+  if (res < 0) {
+    if (res != -ECANCELED) {
+      handle_accept_error(-res);
+    }
+  } else {
+    // Multishot accept does not tell the address of the peer.
+    sockaddr_union sockaddr;
+    socklen_t addrlen = sizeof(sockaddr);
+
+    if (getpeername(res, &sockaddr.sa, &addrlen) != 0) {
+      close(res);
+    } else {
+      handle_accepted(res, &sockaddr.sa, addrlen);
+    }
+  }
 
-void AcceptHandler::disable() { ev_io_stop(conn_hnr_->get_loop(), &wev_); }
+  if (!more && enabled_) {
+    ring_->start(&uring_op_);
+  }
+}
+#endif // HAVE_IO_URING
+
+void AcceptHandler::handle_accept_error(int error) {
+  switch (error) {
+  case EINTR:
+  case ENETDOWN:
+  case EPROTO:
+  case ENOPROTOOPT:
+  case EHOSTDOWN:
+#ifdef ENONET
+  case ENONET:
+#endif // ENONET
+  case EHOSTUNREACH:
+  case EOPNOTSUPP:
+  case ENETUNREACH:
+    return;
+  case EMFILE:
+  case ENFILE:
+    LOG(WARN) << "acceptor: running out file descriptor; disable acceptor "
+                 "temporarily";
+    if (worker_) {
+      worker_->sleep_acceptor(get_config()->conn.listener.timeout.sleep);
+    } else {
+      conn_hnr_->sleep_acceptor(get_config()->conn.listener.timeout.sleep);
+    }
+    return;
+  default:
+    return;
+  }
+}
+
+void AcceptHandler::handle_accepted(int cfd, sockaddr *addr, int addrlen) {
+  if (worker_) {
+    worker_->handle_connection(cfd, addr, addrlen, faddr_);
+    return;
+  }
+
+  conn_hnr_->handle_connection(cfd, addr, addrlen, faddr_);
+}
+
+void AcceptHandler::enable() {
+#ifdef HAVE_IO_URING
+  if (ring_) {
+    enabled_ = true;
+    ring_->start(&uring_op_);
+    return;
+  }
+#endif // HAVE_IO_URING
+  ev_io_start(get_loop(), &wev_);
+}
+
+void AcceptHandler::disable() {
+#ifdef HAVE_IO_URING
+  if (ring_) {
+    enabled_ = false;
+    ring_->cancel(&uring_op_);
+    return;
+  }
+#endif // HAVE_IO_URING
+  ev_io_stop(get_loop(), &wev_);
+}
 
-int AcceptHandler::get_fd() const { return faddr_->fd; }
+int AcceptHandler::get_fd() const { return fd_; }
 
 } // namespace shrpx
@@ -27,26 +27,59 @@
 
 #include "shrpx.h"
 
+#ifdef HAVE_SYS_SOCKET_H
+#  include <sys/socket.h>
+#endif // HAVE_SYS_SOCKET_H
+
 #include <ev.h>
 
+#include "shrpx_io_uring.h"
+
 namespace shrpx {
 
 class ConnectionHandler;
+class Worker;
 struct UpstreamAddr;
 
 class AcceptHandler {
 public:
+  // Creates acceptor which runs on the main event loop, and
+  // dispatches accepted connections to workers through |h|.
   AcceptHandler(const UpstreamAddr *faddr, ConnectionHandler *h);
+  // Creates acceptor which listens on |fd| on the event loop of
+  // |worker|, and hands accepted connections to |worker| directly.
+  // This is used for SO_REUSEPORT listener owned by a worker.
+  AcceptHandler(const UpstreamAddr *faddr, Worker *worker, int fd);
   ~AcceptHandler();
   void accept_connection();
+#ifdef HAVE_IO_URING
+  // Handles the result of multishot accept.  |res| is the accepted
+  // fd, or negative error code.
+  void on_uring_accept(int res, bool more);
+#endif // HAVE_IO_URING
   void enable();
   void disable();
   int get_fd() const;
 
 private:
+  struct ev_loop *get_loop() const;
+  void handle_accept_error(int error);
+  void handle_accepted(int cfd, sockaddr *addr, int addrlen);
+
   ev_io wev_;
+#ifdef HAVE_IO_URING
+  // Multishot accept.  This is used instead of wev_ if ring_ is not
+  // nullptr.
+  IOUringOp uring_op_;
+  IOUring *ring_;
+  // true if this acceptor is enabled.
+  bool enabled_;
+#endif // HAVE_IO_URING
   ConnectionHandler *conn_hnr_;
+  // Non-null if this acceptor is owned by a worker.
+  Worker *worker_;
   const UpstreamAddr *faddr_;
+  int fd_;
 };
 
 } // namespace shrpx
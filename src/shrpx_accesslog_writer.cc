@@ -0,0 +1,463 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_accesslog_writer.h"
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>
+#endif // HAVE_UNISTD_H
+#include <syslog.h>
+#include <climits>
+
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <string>
+
+#include "shrpx_config.h"
+#include "shrpx_log.h"
+
+namespace shrpx {
+
+namespace {
+#ifdef IOV_MAX
+constexpr size_t MAX_WRITER_IOVCNT = IOV_MAX;
+#else  // !IOV_MAX
+constexpr size_t MAX_WRITER_IOVCNT = 1024;
+#endif // !IOV_MAX
+} // namespace
+
+namespace {
+// The maximum number of writev(2) calls per wakeup before the writer
+// thread checks stop and reopen requests again.
+constexpr size_t MAX_WRITER_ROUNDS = 16;
+} // namespace
+
+namespace {
+size_t round_up_pow2(size_t n) {
+  size_t m = 1;
+  for (; m < n; m <<= 1)
+    ;
+  return m;
+}
+} // namespace
+
+AccessLogBuffer::AccessLogBuffer(size_t size)
+    : buf_(std::make_unique<uint8_t[]>(round_up_pow2(size))),
+      mask_(round_up_pow2(size) - 1),
+      tail_(0),
+      head_(0),
+      num_discarded_(0) {}
+
+bool AccessLogBuffer::write(const uint8_t *data, size_t len) {
+  auto tail = tail_.load(std::memory_order_relaxed);
+  auto head = head_.load(std::memory_order_acquire);
+
+  if (capacity() - (tail - head) < len) {
+    return false;
+  }
+
+  auto off = tail & mask_;
+  auto n = std::min(len, capacity() - off);
+
+  std::copy_n(data, n, buf_.get() + off);
+  std::copy_n(data + n, len - n, buf_.get());
+
+  tail_.store(tail + len, std::memory_order_release);
+
+  return true;
+}
+
+size_t AccessLogBuffer::riovec(struct iovec *iov, size_t iovcnt) const {
+  auto head = head_.load(std::memory_order_relaxed);
+  auto len = tail_.load(std::memory_order_acquire) - head;
+
+  if (len == 0 || iovcnt == 0) {
+    return 0;
+  }
+
+  auto off = head & mask_;
+  auto n = std::min(len, capacity() - off);
+
+  iov[0].iov_base = buf_.get() + off;
+  iov[0].iov_len = n;
+
+  if (n == len || iovcnt == 1) {
+    return 1;
+  }
+
+  iov[1].iov_base = buf_.get();
+  iov[1].iov_len = len - n;
+
+  return 2;
+}
+
+void AccessLogBuffer::drain(size_t n) {
+  auto head = head_.load(std::memory_order_relaxed);
+  head_.store(head + n, std::memory_order_release);
+}
+
+size_t AccessLogBuffer::rleft() const {
+  return tail_.load(std::memory_order_acquire) -
+         head_.load(std::memory_order_relaxed);
+}
+
+void AccessLogBuffer::add_num_discarded(size_t n) {
+  num_discarded_.fetch_add(n, std::memory_order_relaxed);
+}
+
+size_t AccessLogBuffer::take_num_discarded() {
+  if (num_discarded_.load(std::memory_order_relaxed) == 0) {
+    return 0;
+  }
+
+  return num_discarded_.exchange(0, std::memory_order_relaxed);
+}
+
+AccessLogWriter::AccessLogWriter(const LoggingConfig &loggingconf,
+                                 size_t buffer_size, bool block_on_overflow)
+    : file_(loggingconf.access.file.str()),
+      num_dropped_(0),
+      buffer_size_(buffer_size),
+      fd_(-1),
+      sleeping_(false),
+      pending_(false),
+      stop_(false),
+      reopen_(false),
+      syslog_(loggingconf.access.syslog),
+      block_on_overflow_(block_on_overflow),
+      started_(false) {}
+
+AccessLogWriter::~AccessLogWriter() { stop(); }
+
+int AccessLogWriter::start() {
+  if (!syslog_ && !file_.empty()) {
+    fd_ = open_log_file(file_.c_str());
+    if (fd_ == -1) {
+      LOG(ERROR) << "Failed to open accesslog file " << file_;
+      return -1;
+    }
+  }
+
+  thread_ = std::thread([this]() { run(); });
+  started_ = true;
+
+  return 0;
+}
+
+void AccessLogWriter::stop() {
+  if (!started_) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> g(mu_);
+    stop_ = true;
+  }
+  cv_.notify_one();
+
+  thread_.join();
+  started_ = false;
+
+  if (fd_ != -1) {
+    fsync(fd_);
+    close_log_file(fd_);
+  }
+}
+
+std::shared_ptr<AccessLogBuffer> AccessLogWriter::create_buffer() {
+  auto buf = std::make_shared<AccessLogBuffer>(buffer_size_);
+
+  std::lock_guard<std::mutex> g(mu_);
+  buffers_.push_back(buf);
+
+  return buf;
+}
+
+bool AccessLogWriter::write(AccessLogBuffer *buf, const uint8_t *data,
+                            size_t len) {
+  if (buf->write(data, len)) {
+    wakeup();
+    return true;
+  }
+
+  if (!block_on_overflow_ || len > buf->capacity()) {
+    ++num_dropped_;
+    return false;
+  }
+
+  std::unique_lock<std::mutex> lk(mu_);
+  for (;;) {
+    pending_ = true;
+    cv_.notify_one();
+
+    // Timeout guards against the missed notification because
+    // space_cv_ is signaled without holding mu_.
+    space_cv_.wait_for(lk, std::chrono::milliseconds(10));
+
+    if (buf->write(data, len)) {
+      return true;
+    }
+  }
+}
+
+void AccessLogWriter::wakeup() {
+  // Pairs with the fence in run().  Either we see sleeping_ == true,
+  // or the writer thread sees the data we have just written.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  if (!sleeping_.load(std::memory_order_relaxed)) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> g(mu_);
+    pending_ = true;
+  }
+  cv_.notify_one();
+}
+
+void AccessLogWriter::reopen() {
+  {
+    std::lock_guard<std::mutex> g(mu_);
+    reopen_ = true;
+  }
+  cv_.notify_one();
+}
+
+uint64_t AccessLogWriter::get_num_dropped() const {
+  return num_dropped_.load(std::memory_order_relaxed);
+}
+
+bool AccessLogWriter::has_pending_data() const {
+  return std::any_of(std::begin(buffers_), std::end(buffers_),
+                     [](const std::shared_ptr<AccessLogBuffer> &buf) {
+                       return buf->rleft() > 0;
+                     });
+}
+
+void AccessLogWriter::run() {
+  std::vector<std::shared_ptr<AccessLogBuffer>> bufs;
+
+  for (;;) {
+    bool stop, reopen;
+
+    {
+      std::unique_lock<std::mutex> lk(mu_);
+
+      // Remove buffers which belonged to the exited threads.
+      buffers_.erase(
+          std::remove_if(std::begin(buffers_), std::end(buffers_),
+                         [](const std::shared_ptr<AccessLogBuffer> &buf) {
+                           return buf.use_count() == 1 && buf->rleft() == 0;
+                         }),
+          std::end(buffers_));
+
+      sleeping_.store(true, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+
+      cv_.wait_for(lk, std::chrono::seconds(1), [this]() {
+        return pending_ || stop_ || reopen_ || has_pending_data();
+      });
+
+      sleeping_.store(false, std::memory_order_relaxed);
+
+      pending_ = false;
+      stop = stop_;
+      reopen = reopen_;
+      reopen_ = false;
+      bufs = buffers_;
+    }
+
+    flush(bufs);
+
+    if (block_on_overflow_) {
+      space_cv_.notify_all();
+    }
+
+    if (reopen) {
+      reopen_file();
+    }
+
+    if (stop) {
+      // All producer threads have gone, so this eventually finishes.
+      for (;;) {
+        std::lock_guard<std::mutex> g(mu_);
+        if (!has_pending_data()) {
+          break;
+        }
+        flush(buffers_);
+      }
+
+      return;
+    }
+  }
+}
+
+void AccessLogWriter::flush(
+    const std::vector<std::shared_ptr<AccessLogBuffer>> &bufs) {
+  if (syslog_) {
+    for (auto &buf : bufs) {
+      flush_syslog(buf.get());
+    }
+    return;
+  }
+
+  std::array<struct iovec, MAX_WRITER_IOVCNT> iov;
+  // Pairs of buffer and the index of its first iovec handed to
+  // writev(2).
+  std::vector<std::pair<AccessLogBuffer *, size_t>> srcs;
+  srcs.reserve(bufs.size());
+
+  for (size_t round = 0; round < MAX_WRITER_ROUNDS; ++round) {
+    size_t iovcnt = 0;
+
+    srcs.clear();
+
+    for (auto &buf : bufs) {
+      if (iovcnt + 2 > iov.size()) {
+        break;
+      }
+
+      auto n = buf->riovec(iov.data() + iovcnt, 2);
+      if (n == 0) {
+        continue;
+      }
+
+      srcs.emplace_back(buf.get(), iovcnt);
+      iovcnt += n;
+    }
+
+    if (iovcnt == 0) {
+      return;
+    }
+
+    ssize_t rv = -1;
+
+    if (fd_ != -1) {
+      while ((rv = writev(fd_, iov.data(), iovcnt)) == -1 && errno == EINTR)
+        ;
+    }
+
+    for (size_t i = 0; i < srcs.size(); ++i) {
+      auto buf = srcs[i].first;
+      auto first = srcs[i].second;
+      auto last = i + 1 == srcs.size() ? iovcnt : srcs[i + 1].second;
+
+      size_t len = 0;
+      for (size_t j = first; j < last; ++j) {
+        len += iov[j].iov_len;
+      }
+
+      if (fd_ == -1) {
+        buf->drain(len);
+        continue;
+      }
+
+      if (rv == -1) {
+        // We have no way to recover from the write error.  Discard
+        // lines to avoid blocking producers forever, and let the
+        // producer report them.
+        size_t nlines = 0;
+        for (size_t j = first; j < last; ++j) {
+          auto p = static_cast<const uint8_t *>(iov[j].iov_base);
+          nlines += std::count(p, p + iov[j].iov_len, '\n');
+        }
+
+        buf->add_num_discarded(nlines);
+        num_dropped_.fetch_add(nlines, std::memory_order_relaxed);
+        buf->drain(len);
+        continue;
+      }
+
+      if (rv == 0) {
+        break;
+      }
+
+      auto n = std::min(static_cast<size_t>(rv), len);
+      buf->drain(n);
+      rv -= n;
+    }
+  }
+}
+
+void AccessLogWriter::flush_syslog(AccessLogBuffer *buf) {
+  std::array<struct iovec, 2> iov;
+  auto iovcnt = buf->riovec(iov.data(), iov.size());
+  if (iovcnt == 0) {
+    return;
+  }
+
+  std::string s;
+  for (size_t i = 0; i < iovcnt; ++i) {
+    s.append(static_cast<const char *>(iov[i].iov_base), iov[i].iov_len);
+  }
+
+  for (size_t pos = 0; pos < s.size();) {
+    auto end = s.find('\n', pos);
+    if (end == std::string::npos) {
+      end = s.size();
+    }
+    s[end] = '\0';
+    syslog(LOG_INFO, "%s", s.c_str() + pos);
+    pos = end + 1;
+  }
+
+  buf->drain(s.size());
+}
+
+void AccessLogWriter::reopen_file() {
+  if (syslog_ || file_.empty()) {
+    return;
+  }
+
+  // Lines buffered before reopen request have been written to the
+  // old file.  Make them durable before switching to the new file.
+  if (fd_ != -1) {
+    fsync(fd_);
+  }
+
+  auto fd = open_log_file(file_.c_str());
+  if (fd == -1) {
+    // Keep writing to the old file.
+    return;
+  }
+
+  close_log_file(fd_);
+  fd_ = fd;
+}
+
+namespace {
+std::atomic<AccessLogWriter *> accesslog_writer;
+} // namespace
+
+void set_accesslog_writer(AccessLogWriter *writer) {
+  accesslog_writer.store(writer, std::memory_order_release);
+}
+
+AccessLogWriter *get_accesslog_writer() {
+  return accesslog_writer.load(std::memory_order_acquire);
+}
+
+} // namespace shrpx
@@ -0,0 +1,159 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef SHRPX_ACCESSLOG_WRITER_H
+#define SHRPX_ACCESSLOG_WRITER_H
+
+#include "shrpx.h"
+
+#include <sys/uio.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <array>
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#include "template.h"
+
+using namespace nghttp2;
+
+namespace shrpx {
+
+struct LoggingConfig;
+
+// AccessLogBuffer is a bounded byte ring which stores formatted
+// access log lines.  A single thread appends lines, and
+// AccessLogWriter thread consumes them.  A line is either stored
+// entirely or not at all.
+class AccessLogBuffer {
+public:
+  // |size| is rounded up to the power of 2.
+  explicit AccessLogBuffer(size_t size);
+
+  // Appends |len| bytes pointed by |data|.  This function returns
+  // true if it succeeds, or false if there is not enough space.  Only
+  // the producer thread can call this function.
+  bool write(const uint8_t *data, size_t len);
+  // Stores at most 2 iovecs which cover the readable region to |iov|,
+  // and returns the number of iovecs stored.  Only the consumer
+  // thread can call this function.
+  size_t riovec(struct iovec *iov, size_t iovcnt) const;
+  // Discards first |n| bytes of the readable region.  Only the
+  // consumer thread can call this function.
+  void drain(size_t n);
+  // Returns the number of bytes which are ready to be read.
+  size_t rleft() const;
+  size_t capacity() const { return mask_ + 1; }
+  // Records that |n| lines have been discarded because they could not
+  // be written.  Only the consumer thread can call this function.
+  void add_num_discarded(size_t n);
+  // Returns the number of lines discarded since the last call, and
+  // resets it.  Only the producer thread can call this function.
+  size_t take_num_discarded();
+
+private:
+  std::unique_ptr<uint8_t[]> buf_;
+  size_t mask_;
+  // The producer updates tail_, and the consumer updates head_.  Both
+  // increase monotonically.
+  std::atomic<size_t> tail_;
+  std::array<uint8_t, 64 - sizeof(std::atomic<size_t>)> pad_;
+  std::atomic<size_t> head_;
+  std::atomic<size_t> num_discarded_;
+};
+
+// AccessLogWriter owns a dedicated thread which writes access log
+// lines buffered by worker threads.  The lines are written with
+// writev(2) in batch, so that worker threads never block on the
+// file I/O.
+class AccessLogWriter {
+public:
+  AccessLogWriter(const LoggingConfig &loggingconf, size_t buffer_size,
+                  bool block_on_overflow);
+  ~AccessLogWriter();
+
+  // Opens the access log file and starts the writer thread.  This
+  // function returns 0 if it succeeds, or -1.
+  int start();
+  // Writes all buffered lines, and stops the writer thread.
+  void stop();
+  // Creates new AccessLogBuffer for the calling thread.
+  std::shared_ptr<AccessLogBuffer> create_buffer();
+  // Appends |len| bytes pointed by |data| to |buf|.  |data| must
+  // contain one or more complete lines.  If |buf| is full, this
+  // function waits for the space if block_on_overflow is true, or
+  // returns false.  Otherwise it returns true.
+  bool write(AccessLogBuffer *buf, const uint8_t *data, size_t len);
+  // Makes the writer thread write all buffered lines to the current
+  // file, fsync it, and open the file again.  This function can be
+  // called from any thread.
+  void reopen();
+  // Returns the total number of lines dropped due to overflow or
+  // write error.
+  uint64_t get_num_dropped() const;
+
+private:
+  void run();
+  // Writes the readable region of |bufs| to the current destination.
+  void flush(const std::vector<std::shared_ptr<AccessLogBuffer>> &bufs);
+  void flush_syslog(AccessLogBuffer *buf);
+  bool has_pending_data() const;
+  void wakeup();
+  void reopen_file();
+
+  std::vector<std::shared_ptr<AccessLogBuffer>> buffers_;
+  std::mutex mu_;
+  // Signaled when producers append lines, or stop() or reopen() is
+  // called.
+  std::condition_variable cv_;
+  // Signaled when the writer thread has consumed buffered lines.
+  std::condition_variable space_cv_;
+  std::thread thread_;
+  std::string file_;
+  std::atomic<uint64_t> num_dropped_;
+  size_t buffer_size_;
+  int fd_;
+  // true if the writer thread is waiting on cv_.
+  std::atomic<bool> sleeping_;
+  bool pending_;
+  bool stop_;
+  bool reopen_;
+  bool syslog_;
+  bool block_on_overflow_;
+  bool started_;
+};
+
+// Sets the process wide AccessLogWriter.  nullptr disables
+// asynchronous access logging.
+void set_accesslog_writer(AccessLogWriter *writer);
+AccessLogWriter *get_accesslog_writer();
+
+} // namespace shrpx
+
+#endif // SHRPX_ACCESSLOG_WRITER_H
@@ -0,0 +1,116 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_accesslog_writer_test.h"
+
+#include <string>
+
+#include <CUnit/CUnit.h>
+
+#include "shrpx_accesslog_writer.h"
+#include "shrpx_config.h"
+#include "shrpx_log.h"
+
+namespace shrpx {
+
+namespace {
+std::string read_all(AccessLogBuffer &buf) {
+  std::array<struct iovec, 2> iov;
+  auto iovcnt = buf.riovec(iov.data(), iov.size());
+
+  std::string s;
+  for (size_t i = 0; i < iovcnt; ++i) {
+    s.append(static_cast<const char *>(iov[i].iov_base), iov[i].iov_len);
+  }
+
+  buf.drain(s.size());
+
+  return s;
+}
+} // namespace
+
+void test_shrpx_accesslog_buffer(void) {
+  // Rounded up to 16
+  AccessLogBuffer buf(13);
+  std::array<struct iovec, 2> iov;
+
+  CU_ASSERT(16 == buf.capacity());
+  CU_ASSERT(0 == buf.rleft());
+  CU_ASSERT(0 == buf.riovec(iov.data(), iov.size()));
+
+  CU_ASSERT(buf.write(reinterpret_cast<const uint8_t *>("alpha\n"), 6));
+  CU_ASSERT(buf.write(reinterpret_cast<const uint8_t *>("bravo\n"), 6));
+  CU_ASSERT(12 == buf.rleft());
+
+  // Not enough space.  The line must not be stored partially.
+  CU_ASSERT(!buf.write(reinterpret_cast<const uint8_t *>("charlie\n"), 8));
+  CU_ASSERT(12 == buf.rleft());
+
+  CU_ASSERT("alpha\nbravo\n" == read_all(buf));
+  CU_ASSERT(0 == buf.rleft());
+
+  // This line wraps around the end of the buffer.
+  CU_ASSERT(buf.write(reinterpret_cast<const uint8_t *>("charlie\n"), 8));
+  CU_ASSERT(2 == buf.riovec(iov.data(), iov.size()));
+  CU_ASSERT(4 == iov[0].iov_len);
+  CU_ASSERT(4 == iov[1].iov_len);
+  CU_ASSERT("charlie\n" == read_all(buf));
+
+  CU_ASSERT(buf.write(reinterpret_cast<const uint8_t *>("0123456789abcde\n"),
+                      16));
+  CU_ASSERT(16 == buf.rleft());
+  CU_ASSERT(!buf.write(reinterpret_cast<const uint8_t *>("\n"), 1));
+  CU_ASSERT("0123456789abcde\n" == read_all(buf));
+}
+
+void test_shrpx_accesslog_writer_write_error(void) {
+  LoggingConfig loggingconf{};
+  // Every write to /dev/full fails with ENOSPC.
+  loggingconf.access.file = StringRef::from_lit("/dev/full");
+
+  AccessLogWriter writer(loggingconf, 4096, false);
+
+  if (writer.start() != 0) {
+    // /dev/full is not available in this environment.
+    return;
+  }
+
+  auto buf = writer.create_buffer();
+
+  CU_ASSERT(writer.write(buf.get(),
+                         reinterpret_cast<const uint8_t *>("alpha\nbravo\n"),
+                         12));
+  CU_ASSERT(writer.write(buf.get(),
+                         reinterpret_cast<const uint8_t *>("charlie\n"), 8));
+
+  writer.stop();
+
+  // The discarded lines are reported to the producer.
+  CU_ASSERT(0 == buf->rleft());
+  CU_ASSERT(3 == writer.get_num_dropped());
+  CU_ASSERT(3 == buf->take_num_discarded());
+  CU_ASSERT(0 == buf->take_num_discarded());
+}
+
+} // namespace shrpx
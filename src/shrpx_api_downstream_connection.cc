@@ -40,8 +40,8 @@ namespace shrpx {
 
 namespace {
 // List of API endpoints
-const std::array<APIEndpoint, 2> &apis() {
-  static const auto apis = new std::array<APIEndpoint, 2>{
+const std::array<APIEndpoint, 3> &apis() {
+  static const auto apis = new std::array<APIEndpoint, 3>{
       APIEndpoint{
           StringRef::from_lit("/api/v1beta1/backendconfig"),
           true,
@@ -54,6 +54,12 @@ const std::array<APIEndpoint, 2> &apis() {
           (1 << API_METHOD_GET),
           &APIDownstreamConnection::handle_configrevision,
       },
+      APIEndpoint{
+          StringRef::from_lit("/api/v1beta1/workerstats"),
+          true,
+          (1 << API_METHOD_GET),
+          &APIDownstreamConnection::handle_workerstats,
+      },
   };
 
   return *apis;
@@ -167,6 +173,15 @@ int APIDownstreamConnection::send_reply(unsigned int http_status,
 namespace {
 const APIEndpoint *lookup_api(const StringRef &path) {
   switch (path.size()) {
+  case 24:
+    switch (path[23]) {
+    case 's':
+      if (util::streq_l("/api/v1beta1/workerstat", std::begin(path), 23)) {
+        return &apis()[2];
+      }
+      break;
+    }
+    break;
   case 26:
     switch (path[25]) {
     case 'g':
@@ -371,6 +386,10 @@ int APIDownstreamConnection::handle_backendconfig() {
   downstreamconf->request_buffer_size = src->request_buffer_size;
   downstreamconf->response_buffer_size = src->response_buffer_size;
   downstreamconf->family = src->family;
+  downstreamconf->outlier = src->outlier;
+  downstreamconf->hedge = src->hedge;
+  downstreamconf->concurrency = src->concurrency;
+  downstreamconf->collapse = src->collapse;
 
   std::set<StringRef> include_set;
   std::map<StringRef, size_t> pattern_addr_indexer;
@@ -451,6 +470,131 @@ int APIDownstreamConnection::handle_configrevision() {
   return 0;
 }
 
+int APIDownstreamConnection::handle_workerstats() {
+  auto conn_handler = worker_->get_connection_handler();
+  auto &balloc = downstream_->get_block_allocator();
+
+  std::vector<Worker *> workers;
+  if (conn_handler->get_single_worker()) {
+    workers.push_back(conn_handler->get_single_worker());
+  } else {
+    for (auto &w : conn_handler->get_workers()) {
+      workers.push_back(w.get());
+    }
+  }
+
+  // Construct the following string:
+  //   ,
+  //   "data":{
+  //     "workers":[{"connEvents":N, ...}, ...]
+  //   }
+  std::string data = R"(,"data":{"workers":[)";
+
+  for (auto it = std::begin(workers); it != std::end(workers); ++it) {
+    auto w = *it;
+    auto stat = w->get_worker_stat();
+
+    auto nevents = stat->num_conn_events.load(std::memory_order_relaxed);
+    auto latency_total =
+        stat->conn_event_latency_total.load(std::memory_order_relaxed);
+
+    if (it != std::begin(workers)) {
+      data += ',';
+    }
+
+    data += R"({"connEvents":)";
+    data += util::utos(nevents);
+    data += R"(,"connEventOverflows":)";
+    data += util::utos(
+        stat->num_conn_event_overflows.load(std::memory_order_relaxed));
+    data += R"(,"connEventQueueDepth":)";
+    data += util::utos(w->get_conn_event_queue_depth());
+    data += R"(,"connEventQueueDepthMax":)";
+    data += util::utos(
+        stat->conn_event_queue_depth_max.load(std::memory_order_relaxed));
+    data += R"(,"connEventLatencyAvgNs":)";
+    data += util::utos(nevents == 0 ? 0 : latency_total / nevents);
+    data += R"(,"connEventLatencyMaxNs":)";
+    data += util::utos(
+        stat->conn_event_latency_max.load(std::memory_order_relaxed));
+    data += R"(,"accesslogDropped":)";
+    data += util::utos(
+        stat->num_accesslog_dropped.load(std::memory_order_relaxed));
+
+    auto nconns =
+        stat->num_connections_snapshot.load(std::memory_order_relaxed);
+    auto buffer_bytes =
+        stat->buffer_bytes_snapshot.load(std::memory_order_relaxed);
+
+    data += R"(,"connections":)";
+    data += util::utos(nconns);
+    data += R"(,"idleConnections":)";
+    data += util::utos(
+        stat->num_idle_connections.load(std::memory_order_relaxed));
+    data += R"(,"bufferBytes":)";
+    data += util::utos(buffer_bytes);
+    data += R"(,"bufferBytesPerConnection":)";
+    data += util::utos(nconns == 0 ? 0 : buffer_bytes / nconns);
+    data += R"(,"outlierEjections":)";
+    data += util::utos(
+        stat->num_outlier_ejections.load(std::memory_order_relaxed));
+    data += R"(,"ejectedBackends":)";
+    data += util::utos(stat->num_ejected_addrs.load(std::memory_order_relaxed));
+    data += R"(,"ejectedAddrs":[)";
+    {
+      std::lock_guard<std::mutex> g(stat->ejected_addrs_mu);
+
+      for (auto it = std::begin(stat->ejected_addrs);
+           it != std::end(stat->ejected_addrs); ++it) {
+        auto &ent = *it;
+
+        if (it != std::begin(stat->ejected_addrs)) {
+          data += ',';
+        }
+
+        data += R"({"addr":")";
+        data += ent.hostport;
+        data += R"(","ejectedUntil":)";
+        if (ent.ejected_until == 0.) {
+          data += "null";
+        } else {
+          data += '"';
+          data += util::iso8601_date(
+              static_cast<int64_t>(ent.ejected_until * 1000));
+          data += '"';
+        }
+        data += R"(,"ejections":)";
+        data += util::utos(ent.num_ejections);
+        data += '}';
+      }
+    }
+    data += ']';
+    data += R"(,"hedgedRequests":)";
+    data += util::utos(stat->num_hedges.load(std::memory_order_relaxed));
+    data += R"(,"hedgeWins":)";
+    data += util::utos(stat->num_hedge_wins.load(std::memory_order_relaxed));
+    data += R"(,"shedRequests":)";
+    data += util::utos(stat->num_shed_requests.load(std::memory_order_relaxed));
+    data += R"(,"collapsedRequests":)";
+    data += util::utos(
+        stat->num_collapsed_requests.load(std::memory_order_relaxed));
+    data += R"(,"concurrencyLimit":)";
+    data += util::utos(
+        stat->concurrency_limit_snapshot.load(std::memory_order_relaxed));
+    data += R"(,"concurrencyInflight":)";
+    data += util::utos(
+        stat->concurrency_inflight_snapshot.load(std::memory_order_relaxed));
+    data += '}';
+  }
+
+  data += "]}";
+
+  send_reply(200, APIStatusCode::SUCCESS,
+             make_string_ref(balloc, StringRef{data}));
+
+  return 0;
+}
+
 void APIDownstreamConnection::pause_read(IOCtrlReason reason) {}
 
 int APIDownstreamConnection::resume_read(IOCtrlReason reason, size_t consumed) {
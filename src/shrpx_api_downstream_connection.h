@@ -98,6 +98,8 @@ public:
   int handle_backendconfig();
   // Handles configrevision API request.
   int handle_configrevision();
+  // Handles workerstats API request.
+  int handle_workerstats();
 
 private:
   Worker *worker_;
@@ -50,6 +50,8 @@
 #include "shrpx_connect_blocker.h"
 #include "shrpx_api_downstream_connection.h"
 #include "shrpx_health_monitor_downstream_connection.h"
+#include "shrpx_collapsed_downstream_connection.h"
+#include "shrpx_http.h"
 #include "shrpx_log.h"
 #include "util.h"
 #include "template.h"
@@ -89,6 +91,12 @@ void readcb(struct ev_loop *loop, ev_io *w, int revents) {
   auto conn = static_cast<Connection *>(w->data);
   auto handler = static_cast<ClientHandler *>(conn->data);
 
+  handler->signal_activity();
+
+#ifdef HAVE_MSG_ZEROCOPY
+  conn->reap_zerocopy();
+#endif // HAVE_MSG_ZEROCOPY
+
   if (handler->do_read() != 0) {
     delete handler;
     return;
@@ -101,6 +109,12 @@ void writecb(struct ev_loop *loop, ev_io *w, int revents) {
   auto conn = static_cast<Connection *>(w->data);
   auto handler = static_cast<ClientHandler *>(conn->data);
 
+  handler->signal_activity();
+
+#ifdef HAVE_MSG_ZEROCOPY
+  conn->reap_zerocopy();
+#endif // HAVE_MSG_ZEROCOPY
+
   if (handler->do_write() != 0) {
     delete handler;
     return;
@@ -108,9 +122,23 @@ void writecb(struct ev_loop *loop, ev_io *w, int revents) {
 }
 } // namespace
 
+namespace {
+void idlecb(WheelTimer *w) {
+  auto handler = static_cast<ClientHandler *>(w->data);
+
+  handler->on_idle_timer();
+}
+} // namespace
+
 int ClientHandler::noop() { return 0; }
 
 int ClientHandler::read_clear() {
+#ifdef HAVE_IO_URING
+  if (conn_.uring.ring) {
+    return read_uring();
+  }
+#endif // HAVE_IO_URING
+
   auto should_break = false;
   rb_.ensure_chunk();
   for (;;) {
@@ -146,8 +174,41 @@ int ClientHandler::read_clear() {
   }
 }
 
+#ifdef HAVE_IO_URING
+int ClientHandler::read_uring() {
+  for (;;) {
+    if (rb_.chunk_avail()) {
+      if (rb_.rleft() && on_read() != 0) {
+        return -1;
+      }
+      if (rb_.rleft() == 0) {
+        rb_.reset();
+      } else if (rb_.wleft() == 0) {
+        // The rest of the data is read when the buffer is drained.
+        return 0;
+      }
+    }
+
+    auto nread = conn_.read_uring(rb_);
+
+    if (nread == 0) {
+      if (rb_.chunk_avail() && rb_.rleft() == 0) {
+        rb_.release_chunk();
+      }
+      return 0;
+    }
+
+    if (nread < 0) {
+      return -1;
+    }
+  }
+}
+#endif // HAVE_IO_URING
+
 int ClientHandler::write_clear() {
-  std::array<iovec, 2> iov;
+  // DATA frame header and its payload shared from the backend buffer
+  // are not contiguous.  Write several of them at once.
+  std::array<iovec, MAX_WR_IOVCNT> iov;
 
   for (;;) {
     if (on_write() != 0) {
@@ -156,10 +217,37 @@ int ClientHandler::write_clear() {
 
     auto iovcnt = upstream_->response_riovec(iov.data(), iov.size());
     if (iovcnt == 0) {
-      break;
+      // Response body in the pipe follows the buffered data.
+      auto pipe = upstream_->get_response_pipe();
+      if (!pipe || pipe->len == 0) {
+        break;
+      }
+
+      auto nwrite = conn_.splice_write_clear(pipe->rfd, pipe->len);
+      if (nwrite < 0) {
+        return -1;
+      }
+
+      if (nwrite == 0) {
+        return 0;
+      }
+
+      pipe->len -= nwrite;
+
+      continue;
     }
 
-    auto nwrite = conn_.writev_clear(iov.data(), iovcnt);
+    ssize_t nwrite;
+#ifdef HAVE_MSG_ZEROCOPY
+    if (conn_.zerocopy.ctx) {
+      nwrite = conn_.writev_zerocopy(iov.data(), iovcnt,
+                                     upstream_->get_response_buf()->head);
+    } else {
+      nwrite = conn_.writev_clear(iov.data(), iovcnt);
+    }
+#else  // !HAVE_MSG_ZEROCOPY
+    nwrite = conn_.writev_clear(iov.data(), iovcnt);
+#endif // !HAVE_MSG_ZEROCOPY
     if (nwrite < 0) {
       return -1;
     }
@@ -178,7 +266,7 @@ int ClientHandler::write_clear() {
 }
 
 int ClientHandler::tls_handshake() {
-  ev_timer_again(conn_.loop, &conn_.rt);
+  conn_.again_rt();
 
   ERR_clear_error();
 
@@ -201,7 +289,13 @@ int ClientHandler::tls_handshake() {
   }
 
   read_ = &ClientHandler::read_tls;
-  write_ = &ClientHandler::write_tls;
+  if (conn_.tls.ktls_tx) {
+    // The kernel encrypts data.  Write several buffers at once, and
+    // relay response body with splice.
+    write_ = &ClientHandler::write_clear;
+  } else {
+    write_ = &ClientHandler::write_tls;
+  }
 
   return 0;
 }
@@ -402,14 +496,17 @@ ClientHandler::ClientHandler(Worker *worker, int fd, SSL *ssl,
             get_config()->conn.upstream.ratelimit.read, writecb, readcb,
             timeoutcb, this, get_config()->tls.dyn_rec.warmup_threshold,
             get_config()->tls.dyn_rec.idle_timeout, Proto::NONE),
+      idle_timer_(idlecb, this),
       ipaddr_(make_string_ref(balloc_, ipaddr)),
       port_(make_string_ref(balloc_, port)),
       faddr_(faddr),
       worker_(worker),
+      last_active_(ev_now(conn_.loop)),
       left_connhd_len_(NGHTTP2_CLIENT_MAGIC_LEN),
       affinity_hash_(0),
       should_close_after_write_(false),
-      affinity_hash_computed_(false) {
+      affinity_hash_computed_(false),
+      idle_(false) {
 
   ++worker_->get_worker_stat()->num_connections;
 
@@ -417,11 +514,34 @@ ClientHandler::ClientHandler(Worker *worker, int fd, SSL *ssl,
 
   reneg_shutdown_timer_.data = this;
 
+  auto timer_wheel = worker_->get_timer_wheel();
+  if (timer_wheel) {
+    conn_.use_timer_wheel(timer_wheel);
+  }
+
   conn_.rlimit.startw();
-  ev_timer_again(conn_.loop, &conn_.rt);
+  conn_.again_rt();
 
   auto config = get_config();
 
+#ifdef HAVE_IO_URING
+  if (!conn_.tls.ssl && config->conn.upstream.ratelimit.read.rate == 0) {
+    auto ring = worker_->get_io_uring();
+    if (ring) {
+      conn_.start_uring_recv(ring);
+    }
+  }
+#endif // HAVE_IO_URING
+
+#ifdef HAVE_MSG_ZEROCOPY
+  if (!conn_.tls.ssl) {
+    auto zc = worker_->get_zerocopy();
+    if (zc) {
+      conn_.enable_zerocopy(zc);
+    }
+  }
+#endif // HAVE_MSG_ZEROCOPY
+
   if (faddr_->accept_proxy_protocol ||
       config->conn.upstream.accept_proxy_protocol) {
     read_ = &ClientHandler::read_clear;
@@ -503,6 +623,15 @@ ClientHandler::~ClientHandler() {
   auto worker_stat = worker_->get_worker_stat();
   --worker_stat->num_connections;
 
+  if (idle_) {
+    worker_stat->num_idle_connections.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  auto timer_wheel = worker_->get_timer_wheel();
+  if (timer_wheel) {
+    timer_wheel->stop(&idle_timer_);
+  }
+
   if (worker_stat->num_connections == 0) {
     worker_->schedule_clear_mcpool();
   }
@@ -527,10 +656,11 @@ struct ev_loop *ClientHandler::get_loop() const {
 }
 
 void ClientHandler::reset_upstream_read_timeout(ev_tstamp t) {
-  conn_.rt.repeat = t;
-  if (ev_is_active(&conn_.rt)) {
-    ev_timer_again(conn_.loop, &conn_.rt);
+  if (conn_.rt_active()) {
+    conn_.again_rt(t);
+    return;
   }
+  conn_.read_timeout = t;
 }
 
 void ClientHandler::reset_upstream_write_timeout(ev_tstamp t) {
@@ -540,11 +670,70 @@ void ClientHandler::reset_upstream_write_timeout(ev_tstamp t) {
   }
 }
 
-void ClientHandler::repeat_read_timer() {
-  ev_timer_again(conn_.loop, &conn_.rt);
+void ClientHandler::signal_activity() {
+  auto idle_release = get_config()->conn.upstream.idle_release;
+  if (idle_release == 0.) {
+    return;
+  }
+
+  last_active_ = ev_now(conn_.loop);
+
+  if (idle_) {
+    idle_ = false;
+    worker_->get_worker_stat()->num_idle_connections.fetch_sub(
+        1, std::memory_order_relaxed);
+  }
+
+  if (!idle_timer_.slot) {
+    worker_->get_timer_wheel()->start(&idle_timer_, idle_release);
+  }
+}
+
+void ClientHandler::on_idle_timer() {
+  auto idle_release = get_config()->conn.upstream.idle_release;
+  auto elapsed = ev_now(conn_.loop) - last_active_;
+
+  if (elapsed < idle_release) {
+    // There was an activity after this timer was scheduled.  We do
+    // not reschedule the timer on every activity to keep I/O path
+    // cheap.
+    worker_->get_timer_wheel()->start(&idle_timer_, idle_release - elapsed);
+    return;
+  }
+
+  if (idle_) {
+    return;
+  }
+
+  if (LOG_ENABLED(INFO)) {
+    CLOG(INFO, this) << "Release buffers of idle connection";
+  }
+
+  if (rb_.chunk_avail() && rb_.rleft() == 0) {
+    rb_.release_chunk();
+  }
+
+#if OPENSSL_1_1_API && !defined(OPENSSL_IS_BORINGSSL)
+  if (conn_.tls.ssl) {
+    // SSL_MODE_RELEASE_BUFFERS does this automatically for the most
+    // part, but we release them explicitly in case the last I/O left
+    // them allocated.
+    SSL_free_buffers(conn_.tls.ssl);
+  }
+#endif // OPENSSL_1_1_API && !defined(OPENSSL_IS_BORINGSSL)
+
+  if (upstream_) {
+    upstream_->release_buffers();
+  }
+
+  idle_ = true;
+  worker_->get_worker_stat()->num_idle_connections.fetch_add(
+      1, std::memory_order_relaxed);
 }
 
-void ClientHandler::stop_read_timer() { ev_timer_stop(conn_.loop, &conn_.rt); }
+void ClientHandler::repeat_read_timer() { conn_.again_rt(); }
+
+void ClientHandler::stop_read_timer() { conn_.stop_rt(); }
 
 int ClientHandler::validate_next_proto() {
   const unsigned char *next_proto = nullptr;
@@ -663,21 +852,31 @@ void ClientHandler::pool_downstream_connection(
   }
 
   auto addr = dconn->get_addr();
+
+  if (downstream_connection_reclaim(addr)) {
+    if (LOG_ENABLED(INFO)) {
+      CLOG(INFO, this) << "Close downstream connection DCONN:" << dconn.get()
+                       << " to give room to the other worker";
+    }
+
+    return;
+  }
+
   auto &dconn_pool = addr->dconn_pool;
   dconn_pool->add_downstream_connection(std::move(dconn));
 }
 
 namespace {
 // Computes 32bits hash for session affinity for IP address |ip|.
-uint32_t compute_affinity_from_ip(const StringRef &ip) {
+uint32_t compute_affinity_from_key(const StringRef &key) {
   int rv;
   std::array<uint8_t, 32> buf;
 
-  rv = util::sha256(buf.data(), ip);
+  rv = util::sha256(buf.data(), key);
   if (rv != 0) {
     // Not sure when sha256 failed.  Just fall back to another
     // function.
-    return util::hash32(ip);
+    return util::hash32(key);
   }
 
   return (static_cast<uint32_t>(buf[0]) << 24) |
@@ -727,6 +926,15 @@ Http2Session *ClientHandler::get_http2_session(
     return session;
   }
 
+  if (!downstream_connection_acquire(addr)) {
+    if (LOG_ENABLED(INFO)) {
+      CLOG(INFO, this) << "Backend " << addr->host << ":" << addr->port
+                       << " reached max-connections";
+    }
+
+    return nullptr;
+  }
+
   auto session = new Http2Session(conn_.loop, worker_->get_cl_ssl_ctx(),
                                   worker_, group, addr);
 
@@ -757,6 +965,44 @@ uint32_t ClientHandler::get_affinity_cookie(Downstream *downstream,
   return h;
 }
 
+namespace {
+// Returns the request attribute of |downstream| which is hashed for
+// SessionAffinity::HASH.  This function returns empty string if the
+// attribute is not available.
+StringRef get_affinity_hash_key(const Downstream *downstream,
+                                const AffinityConfig &affinity) {
+  const auto &req = downstream->request();
+  const auto &path = req.path;
+
+  switch (affinity.hash.key) {
+  case SessionAffinityHashKey::PATH:
+    return StringRef{std::begin(path),
+                     std::find(std::begin(path), std::end(path), '?')};
+  case SessionAffinityHashKey::PATH_PREFIX: {
+    auto end = std::find(std::begin(path), std::end(path), '?');
+    size_t n = 0;
+    for (auto it = std::begin(path); it != end; ++it) {
+      if (*it == '/' && it != std::begin(path) &&
+          ++n == affinity.hash.path_segments) {
+        return StringRef{std::begin(path), it};
+      }
+    }
+    return StringRef{std::begin(path), end};
+  }
+  case SessionAffinityHashKey::HEADER: {
+    auto h = req.fs.header(affinity.hash.header);
+    if (!h) {
+      return StringRef{};
+    }
+    return h->value;
+  }
+  default:
+    assert(0);
+    abort();
+  }
+}
+} // namespace
+
 namespace {
 void reschedule_addr(
     std::priority_queue<DownstreamAddrEntry, std::vector<DownstreamAddrEntry>,
@@ -800,12 +1046,37 @@ DownstreamAddr *ClientHandler::get_downstream_addr(int &err,
 
   auto &shared_addr = group->shared_addr;
 
+  if (shared_addr->affinity.type == SessionAffinity::HASH) {
+    auto key = get_affinity_hash_key(downstream, shared_addr->affinity);
+
+    DownstreamAddr *addr;
+    if (key.empty()) {
+      // Without the key, there is nothing to stick to.
+      addr = select_downstream_addr_p2c(shared_addr->addrs,
+                                        worker_->get_randgen());
+    } else {
+      addr = select_downstream_addr_bounded(
+          shared_addr->addrs, shared_addr->affinity_hash,
+          compute_affinity_from_key(key), shared_addr->affinity.hash.max_load);
+    }
+
+    if (addr == nullptr) {
+      if (LOG_ENABLED(INFO)) {
+        CLOG(INFO, this) << "No working downstream address found";
+      }
+      err = -1;
+      return nullptr;
+    }
+
+    return addr;
+  }
+
   if (shared_addr->affinity.type != SessionAffinity::NONE) {
     uint32_t hash;
     switch (shared_addr->affinity.type) {
     case SessionAffinity::IP:
       if (!affinity_hash_computed_) {
-        affinity_hash_ = compute_affinity_from_ip(ipaddr_);
+        affinity_hash_ = compute_affinity_from_key(ipaddr_);
         affinity_hash_computed_ = true;
       }
       hash = affinity_hash_;
@@ -854,6 +1125,20 @@ DownstreamAddr *ClientHandler::get_downstream_addr(int &err,
     return addr;
   }
 
+  if (shared_addr->balance == LoadBalancing::P2C) {
+    auto addr =
+        select_downstream_addr_p2c(shared_addr->addrs, worker_->get_randgen());
+    if (addr == nullptr) {
+      if (LOG_ENABLED(INFO)) {
+        CLOG(INFO, this) << "No working downstream address found";
+      }
+      err = -1;
+      return nullptr;
+    }
+
+    return addr;
+  }
+
   auto &wgpq = shared_addr->pq;
 
   for (;;) {
@@ -973,6 +1258,33 @@ ClientHandler::get_downstream_connection(int &err, Downstream *downstream) {
   }
 
   auto &group = groups[group_idx];
+  auto &shared_addr = group->shared_addr;
+
+  if (shared_addr->collapse.enabled && !downstream->is_collapse_leader() &&
+      !downstream->collapse_disabled()) {
+    auto dconn = get_collapsed_downstream_connection(group, downstream);
+    if (dconn) {
+      return dconn;
+    }
+  }
+
+  if (shared_addr->concurrency.max_limit &&
+      !downstream->holds_concurrency_slot()) {
+    if (!downstream_concurrency_acquire(shared_addr.get())) {
+      if (LOG_ENABLED(INFO)) {
+        CLOG(INFO, this) << "Downstream address group " << group_idx
+                         << " reached concurrency limit "
+                         << static_cast<size_t>(shared_addr->concurrency.limit);
+      }
+      worker_->get_worker_stat()->num_shed_requests.fetch_add(
+          1, std::memory_order_relaxed);
+      err = SHRPX_ERR_OVERLOADED;
+      return nullptr;
+    }
+
+    downstream->hold_concurrency_slot(shared_addr);
+  }
+
   auto addr = get_downstream_addr(err, group.get(), downstream);
   if (addr == nullptr) {
     return nullptr;
@@ -993,6 +1305,17 @@ ClientHandler::get_downstream_connection(int &err, Downstream *downstream) {
       return nullptr;
     }
 
+    if (!downstream_connection_acquire(addr)) {
+      if (LOG_ENABLED(INFO)) {
+        CLOG(INFO, this) << "Backend " << addr->host << ":" << addr->port
+                         << " reached max-connections";
+      }
+      worker_->get_worker_stat()->num_shed_requests.fetch_add(
+          1, std::memory_order_relaxed);
+      err = SHRPX_ERR_OVERLOADED;
+      return nullptr;
+    }
+
     if (LOG_ENABLED(INFO)) {
       CLOG(INFO, this) << "Downstream connection pool is empty."
                        << " Create new one";
@@ -1010,11 +1333,223 @@ ClientHandler::get_downstream_connection(int &err, Downstream *downstream) {
   }
 
   auto http2session = get_http2_session(group, addr);
+  if (!http2session) {
+    worker_->get_worker_stat()->num_shed_requests.fetch_add(
+        1, std::memory_order_relaxed);
+    err = SHRPX_ERR_OVERLOADED;
+    return nullptr;
+  }
+
   auto dconn = std::make_unique<Http2DownstreamConnection>(http2session);
   dconn->set_client_handler(this);
   return dconn;
 }
 
+std::unique_ptr<DownstreamConnection>
+ClientHandler::get_collapsed_downstream_connection(
+    const std::shared_ptr<DownstreamAddrGroup> &group, Downstream *downstream) {
+  auto &shared_addr = group->shared_addr;
+  const auto &req = downstream->request();
+  auto &collapseconf = worker_->get_downstream_config()->collapse;
+
+  // Only GET request without request body is collapsed.  The
+  // responses to the request with credentials, and range request are
+  // specific to the request.  Cookie is a credential unless it is a
+  // part of the key.
+  if (req.method != HTTP_GET || req.upgrade_request ||
+      req.connect_proto != ConnectProto::NONE || req.http2_expect_body ||
+      req.fs.content_length > 0 || downstream->get_chunked_request() ||
+      req.fs.header(StringRef::from_lit("authorization")) ||
+      req.fs.header(StringRef::from_lit("range")) ||
+      (req.fs.header(StringRef::from_lit("cookie")) &&
+       std::find(std::begin(collapseconf.vary), std::end(collapseconf.vary),
+                 StringRef::from_lit("cookie")) ==
+           std::end(collapseconf.vary)) ||
+      shared_addr->affinity.type != SessionAffinity::NONE) {
+    downstream->disable_collapse();
+    return nullptr;
+  }
+
+  auto &balloc = downstream->get_block_allocator();
+
+  auto key =
+      http::create_collapse_key(balloc, req.scheme, req.orig_authority,
+                                req.orig_path, req.fs.headers(),
+                                collapseconf.vary);
+
+  auto &leaders = shared_addr->collapse.leaders;
+  auto it = leaders.find(key);
+  if (it == std::end(leaders) ||
+      (*it).second->get_num_collapse_followers() >= collapseconf.max_waiters) {
+    if (LOG_ENABLED(INFO) && it != std::end(leaders)) {
+      CLOG(INFO, this) << "Too many requests wait for DOWNSTREAM:"
+                       << (*it).second;
+    }
+
+    // The subsequent identical requests wait for this request.
+    downstream->set_collapse_leader(shared_addr, key);
+    return nullptr;
+  }
+
+  auto leader = (*it).second;
+
+  auto dconn = std::make_unique<CollapsedDownstreamConnection>(
+      group, leader, conn_.loop, collapseconf.timeout);
+  dconn->set_client_handler(this);
+  return dconn;
+}
+
+namespace {
+// The maximum number of hedged requests which can be accumulated in
+// a backend group.
+constexpr double HEDGE_MAX_TOKENS = 10.;
+} // namespace
+
+void ClientHandler::schedule_hedge(Downstream *downstream) {
+  auto dconn = downstream->get_downstream_connection();
+  if (!dconn->get_request_addr()) {
+    return;
+  }
+
+  const auto &group = dconn->get_downstream_addr_group();
+  auto &hedge = group->shared_addr->hedge;
+
+  if (hedge.percentile == 0 || hedge.delay == 0.) {
+    return;
+  }
+
+  const auto &req = downstream->request();
+
+  if ((req.method != HTTP_GET && req.method != HTTP_HEAD) ||
+      req.upgrade_request || req.http2_expect_body ||
+      req.fs.content_length > 0 || downstream->get_chunked_request()) {
+    return;
+  }
+
+  auto &hedgeconf = worker_->get_downstream_config()->hedge;
+
+  hedge.tokens = std::min(hedge.tokens + hedgeconf.budget / 100.,
+                          HEDGE_MAX_TOKENS);
+
+  downstream->start_hedge_timer(std::max(hedge.delay, hedgeconf.min_delay));
+}
+
+void ClientHandler::hedge_downstream(Downstream *downstream) {
+  auto dconn = downstream->get_downstream_connection();
+
+  // Hedge only if the original request has been sent completely, and
+  // nothing has been received yet.  The request buffer is shared by
+  // both requests.
+  if (!dconn || downstream->get_hedge_downstream_connection() ||
+      downstream->get_request_state() != DownstreamState::MSG_COMPLETE ||
+      downstream->get_response_state() != DownstreamState::INITIAL ||
+      !downstream->get_request_header_sent() ||
+      downstream->get_request_buf()->rleft()) {
+    return;
+  }
+
+  const auto &group = dconn->get_downstream_addr_group();
+  if (group->retired) {
+    return;
+  }
+
+  auto &shared_addr = group->shared_addr;
+  auto &hedge = shared_addr->hedge;
+
+  if (hedge.tokens < 1.) {
+    return;
+  }
+
+  auto addr = select_downstream_addr_hedge(shared_addr->addrs,
+                                           dconn->get_request_addr());
+  if (!addr) {
+    return;
+  }
+
+  if (addr->proto == Proto::HTTP2) {
+    auto http2session = get_http2_session(group, addr);
+    if (!http2session) {
+      return;
+    }
+
+    auto hdconn = std::make_unique<Http2DownstreamConnection>(http2session);
+    hdconn->set_client_handler(this);
+    hdconn->set_hedge();
+
+    if (LOG_ENABLED(INFO)) {
+      CLOG(INFO, this) << "Send hedged request to " << addr->host << ":"
+                       << addr->port;
+    }
+
+    if (downstream->attach_hedge_downstream_connection(std::move(hdconn)) !=
+        0) {
+      return;
+    }
+
+    hedge.tokens -= 1.;
+
+    // The request is sent in the new stream, and the stream of the
+    // request which loses the race is reset with CANCEL.
+    if (downstream->get_hedge_downstream_connection()->push_request_headers() !=
+        0) {
+      downstream->cancel_hedge();
+      return;
+    }
+
+    worker_->get_worker_stat()->num_hedges.fetch_add(
+        1, std::memory_order_relaxed);
+
+    return;
+  }
+
+  auto hdconn = addr->dconn_pool->pop_downstream_connection();
+  if (!hdconn) {
+    if (worker_->get_connect_blocker()->blocked() ||
+        !downstream_connection_acquire(addr)) {
+      return;
+    }
+
+    hdconn = std::make_unique<HttpDownstreamConnection>(group, addr, conn_.loop,
+                                                        worker_);
+  }
+
+  hdconn->set_client_handler(this);
+
+  if (LOG_ENABLED(INFO)) {
+    CLOG(INFO, this) << "Send hedged request to " << addr->host << ":"
+                     << addr->port;
+  }
+
+  if (downstream->attach_hedge_downstream_connection(std::move(hdconn)) != 0) {
+    return;
+  }
+
+  hedge.tokens -= 1.;
+
+  // push_request_headers() overwrites the request downstream host of
+  // the original request.  Keep it until the hedged request wins.
+  auto request_downstream_host = downstream->get_request_downstream_host();
+
+  auto hedge_dconn = static_cast<HttpDownstreamConnection *>(
+      downstream->get_hedge_downstream_connection());
+  if (hedge_dconn->push_request_headers() != 0) {
+    downstream->set_request_downstream_host(request_downstream_host);
+    downstream->cancel_hedge();
+    return;
+  }
+
+  downstream->set_hedge_request_downstream_host(
+      downstream->get_request_downstream_host());
+  downstream->set_request_downstream_host(request_downstream_host);
+
+  // The request has no body.  Nothing will call signal_write()
+  // after this.
+  hedge_dconn->signal_write();
+
+  worker_->get_worker_stat()->num_hedges.fetch_add(1,
+                                                    std::memory_order_relaxed);
+}
+
 MemchunkPool *ClientHandler::get_mcpool() { return worker_->get_mcpool(); }
 
 SSL *ClientHandler::get_ssl() const { return conn_.tls.ssl; }
@@ -63,6 +63,11 @@ public:
   int noop();
   // Performs clear text I/O
   int read_clear();
+#ifdef HAVE_IO_URING
+  // Reads the data received through io_uring.  read_clear calls this
+  // function if io_uring is used for this connection.
+  int read_uring();
+#endif // HAVE_IO_URING
   int write_clear();
   // Performs TLS handshake
   int tls_handshake();
@@ -108,6 +113,14 @@ public:
   // error code to |err|.
   std::unique_ptr<DownstreamConnection>
   get_downstream_connection(int &err, Downstream *downstream);
+  // Starts hedge timer of |downstream| if its request is eligible for
+  // hedging.  This function is called when |downstream| is attached
+  // to a DownstreamConnection.
+  void schedule_hedge(Downstream *downstream);
+  // Sends the hedged request of |downstream| to another backend
+  // address in the same group.  This function is called when the
+  // hedge timer of |downstream| expires.
+  void hedge_downstream(Downstream *downstream);
   MemchunkPool *get_mcpool();
   SSL *get_ssl() const;
   // Call this function when HTTP/2 connection header is received at
@@ -150,10 +163,24 @@ public:
   // header field.
   StringRef get_forwarded_for() const;
 
+  // Returns Http2Session to |addr| which can take one more stream.
+  // This function returns nullptr if new session is needed, but
+  // |addr| reached max-connections.
   Http2Session *
   get_http2_session(const std::shared_ptr<DownstreamAddrGroup> &group,
                     DownstreamAddr *addr);
 
+  // Returns DownstreamConnection which makes |downstream| wait for
+  // the response of the identical request in flight to |group|.  If
+  // there is no such request, |downstream| is registered so that the
+  // subsequent identical requests can wait for it, and this function
+  // returns nullptr.  It also returns nullptr if |downstream| is not
+  // eligible for collapsed forwarding.
+  std::unique_ptr<DownstreamConnection>
+  get_collapsed_downstream_connection(
+      const std::shared_ptr<DownstreamAddrGroup> &group,
+      Downstream *downstream);
+
   // Returns an affinity cookie value for |downstream|.  |cookie_name|
   // is used to inspect cookie header field in request header fields.
   uint32_t get_affinity_cookie(Downstream *downstream,
@@ -177,6 +204,13 @@ public:
 
   BlockAllocator &get_block_allocator();
 
+  // Records that there was an I/O activity on this connection.  If
+  // the buffers have been released, they are allocated again on
+  // demand.
+  void signal_activity();
+  // Called when the idle release timer expires.
+  void on_idle_timer();
+
 private:
   // Allocator to allocate memory for connection-wide objects.  Make
   // sure that the allocations must be bounded, and not proportional
@@ -185,6 +219,9 @@ private:
   DefaultMemchunkBuffer rb_;
   Connection conn_;
   ev_timer reneg_shutdown_timer_;
+  // The timer to release buffers when this connection is idle.  It
+  // is scheduled in the timer wheel of the worker.
+  WheelTimer idle_timer_;
   std::unique_ptr<Upstream> upstream_;
   // IP address of client.  If UNIX domain socket is used, this is
   // "localhost".
@@ -202,6 +239,8 @@ private:
   // Address of frontend listening socket
   const UpstreamAddr *faddr_;
   Worker *worker_;
+  // The last time when signal_activity() was called.
+  ev_tstamp last_active_;
   // The number of bytes of HTTP/2 client connection header to read
   size_t left_connhd_len_;
   // hash for session affinity using client IP
@@ -209,6 +248,9 @@ private:
   bool should_close_after_write_;
   // true if affinity_hash_ is computed
   bool affinity_hash_computed_;
+  // true if the buffers have been released because this connection
+  // is idle.
+  bool idle_;
 };
 
 } // namespace shrpx
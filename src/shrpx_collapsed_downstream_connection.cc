@@ -0,0 +1,325 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_collapsed_downstream_connection.h"
+
+#include "shrpx_client_handler.h"
+#include "shrpx_upstream.h"
+#include "shrpx_downstream.h"
+#include "shrpx_worker.h"
+#include "shrpx_config.h"
+#include "shrpx_log.h"
+#include "http2.h"
+
+namespace shrpx {
+
+namespace {
+void timeoutcb(struct ev_loop *loop, ev_timer *w, int revents) {
+  auto dconn = static_cast<CollapsedDownstreamConnection *>(w->data);
+
+  dconn->on_timer();
+}
+} // namespace
+
+CollapsedDownstreamConnection::CollapsedDownstreamConnection(
+    std::shared_ptr<DownstreamAddrGroup> group, Downstream *leader,
+    struct ev_loop *loop, ev_tstamp timeout)
+    : dlnext(nullptr),
+      dlprev(nullptr),
+      group_(std::move(group)),
+      leader_(leader),
+      loop_(loop),
+      timeout_(timeout),
+      header_copied_(false) {
+  ev_timer_init(&timer_, timeoutcb, 0., 0.);
+  timer_.data = this;
+}
+
+CollapsedDownstreamConnection::~CollapsedDownstreamConnection() {
+  ev_timer_stop(loop_, &timer_);
+
+  if (leader_) {
+    leader_->remove_collapse_follower(this);
+  }
+}
+
+int CollapsedDownstreamConnection::attach_downstream(Downstream *downstream) {
+  if (LOG_ENABLED(INFO)) {
+    DCLOG(INFO, this) << "Attaching to DOWNSTREAM:" << downstream
+                      << ", waiting for DOWNSTREAM:" << leader_;
+  }
+
+  downstream_ = downstream;
+
+  leader_->add_collapse_follower(this);
+
+  ev_timer_set(&timer_, timeout_, 0.);
+  ev_timer_start(loop_, &timer_);
+
+  return 0;
+}
+
+void CollapsedDownstreamConnection::detach_downstream(Downstream *downstream) {
+  if (LOG_ENABLED(INFO)) {
+    DCLOG(INFO, this) << "Detaching from DOWNSTREAM:" << downstream;
+  }
+
+  ev_timer_stop(loop_, &timer_);
+
+  if (leader_) {
+    leader_->remove_collapse_follower(this);
+    leader_ = nullptr;
+  }
+
+  downstream_ = nullptr;
+}
+
+// The request is not sent anywhere.  Since request header is not
+// marked as sent, the request can still be forwarded to the backend
+// if the leader cannot share its response.
+int CollapsedDownstreamConnection::push_request_headers() { return 0; }
+
+int CollapsedDownstreamConnection::push_upload_data_chunk(const uint8_t *data,
+                                                          size_t datalen) {
+  return 0;
+}
+
+int CollapsedDownstreamConnection::end_upload_data() { return 0; }
+
+void CollapsedDownstreamConnection::pause_read(IOCtrlReason reason) {}
+
+int CollapsedDownstreamConnection::resume_read(IOCtrlReason reason,
+                                               size_t consumed) {
+  return 0;
+}
+
+void CollapsedDownstreamConnection::force_resume_read() {}
+
+int CollapsedDownstreamConnection::on_read() { return 0; }
+
+int CollapsedDownstreamConnection::on_write() { return 0; }
+
+void CollapsedDownstreamConnection::on_upstream_change(Upstream *uptream) {}
+
+bool CollapsedDownstreamConnection::poolable() const { return false; }
+
+const std::shared_ptr<DownstreamAddrGroup> &
+CollapsedDownstreamConnection::get_downstream_addr_group() const {
+  return group_;
+}
+
+DownstreamAddr *CollapsedDownstreamConnection::get_addr() const {
+  return nullptr;
+}
+
+void CollapsedDownstreamConnection::on_leader_response_header(
+    Downstream *leader) {
+  ev_timer_stop(loop_, &timer_);
+
+  // The response might have been already sent by mruby script.
+  if (downstream_->get_response_state() != DownstreamState::INITIAL) {
+    leader_->remove_collapse_follower(this);
+    leader_ = nullptr;
+
+    return;
+  }
+
+  const auto &src = leader->response();
+  const auto &req = downstream_->request();
+  auto &resp = downstream_->response();
+  auto &balloc = downstream_->get_block_allocator();
+
+  resp.http_status = src.http_status;
+  resp.http_major = src.http_major;
+  resp.http_minor = src.http_minor;
+
+  for (auto &kv : src.fs.headers()) {
+    // The framing of the response body is decided for this request
+    // below.
+    if (kv.token == http2::HD_TRANSFER_ENCODING) {
+      continue;
+    }
+
+    resp.fs.add_header_token(make_string_ref(balloc, kv.name),
+                             make_string_ref(balloc, kv.value), kv.no_index,
+                             kv.token);
+  }
+
+  resp.fs.content_length = src.fs.content_length;
+  resp.headers_only = src.headers_only;
+
+  if (resp.fs.content_length == -1 && downstream_->expect_response_body()) {
+    if (http2::legacy_http1(req.http_major, req.http_minor)) {
+      resp.connection_close = true;
+    } else {
+      resp.fs.add_header_token(StringRef::from_lit("transfer-encoding"),
+                               StringRef::from_lit("chunked"), false,
+                               http2::HD_TRANSFER_ENCODING);
+      downstream_->set_chunked_response(true);
+    }
+  }
+
+  downstream_->set_downstream_addr_group(group_);
+  downstream_->set_addr(leader->get_addr());
+  downstream_->set_response_state(DownstreamState::HEADER_COMPLETE);
+
+  header_copied_ = true;
+
+  auto upstream = downstream_->get_upstream();
+  auto handler = upstream->get_client_handler();
+
+  if (LOG_ENABLED(INFO)) {
+    DCLOG(INFO, this) << "Copied response header from DOWNSTREAM:" << leader;
+  }
+
+  handler->get_worker()->get_worker_stat()->num_collapsed_requests.fetch_add(
+      1, std::memory_order_relaxed);
+
+  auto &loggingconf = get_config()->logging;
+
+  if (loggingconf.access.write_early && downstream_->accesslog_ready()) {
+    handler->write_accesslog(downstream_);
+    downstream_->set_accesslog_written(true);
+  }
+
+  if (upstream->on_downstream_header_complete(downstream_) != 0) {
+    schedule_reset();
+
+    return;
+  }
+
+  handler->signal_write();
+}
+
+void CollapsedDownstreamConnection::on_leader_response_body(
+    const uint8_t *data, size_t len) {
+  if (!header_copied_) {
+    return;
+  }
+
+  auto &resp = downstream_->response();
+
+  resp.recv_body_length += len;
+
+  auto upstream = downstream_->get_upstream();
+  auto handler = upstream->get_client_handler();
+
+  if (upstream->on_downstream_body(downstream_, data, len, true) != 0) {
+    schedule_reset();
+
+    return;
+  }
+
+  auto &downstreamconf = *handler->get_worker()->get_downstream_config();
+
+  // The leader reads the response body as fast as its own client
+  // consumes it.  Reset this request if its client is slower than
+  // that instead of buffering the rest of the body.
+  if (downstream_->get_response_buf()->rleft() >
+      downstreamconf.response_buffer_size) {
+    if (LOG_ENABLED(INFO)) {
+      DCLOG(INFO, this) << "Response buffer is full; stop waiting for "
+                        << "DOWNSTREAM:" << leader_;
+    }
+
+    schedule_reset();
+
+    return;
+  }
+
+  handler->signal_write();
+}
+
+void CollapsedDownstreamConnection::on_leader_response_complete(
+    Downstream *leader) {
+  leader_ = nullptr;
+
+  if (!header_copied_) {
+    return;
+  }
+
+  const auto &src = leader->response();
+  auto &resp = downstream_->response();
+  auto &balloc = downstream_->get_block_allocator();
+
+  for (auto &kv : src.fs.trailers()) {
+    resp.fs.add_trailer_token(make_string_ref(balloc, kv.name),
+                              make_string_ref(balloc, kv.value), kv.no_index,
+                              kv.token);
+  }
+
+  downstream_->set_response_state(DownstreamState::MSG_COMPLETE);
+
+  auto upstream = downstream_->get_upstream();
+
+  if (upstream->on_downstream_body_complete(downstream_) != 0) {
+    schedule_reset();
+
+    return;
+  }
+
+  upstream->get_client_handler()->signal_write();
+}
+
+void CollapsedDownstreamConnection::on_leader_gone() {
+  leader_ = nullptr;
+
+  schedule_reset();
+}
+
+void CollapsedDownstreamConnection::schedule_reset() {
+  if (leader_) {
+    leader_->remove_collapse_follower(this);
+    leader_ = nullptr;
+  }
+
+  ev_timer_stop(loop_, &timer_);
+  ev_timer_set(&timer_, 0., 0.);
+  ev_timer_start(loop_, &timer_);
+}
+
+void CollapsedDownstreamConnection::on_timer() {
+  if (leader_) {
+    if (LOG_ENABLED(INFO)) {
+      DCLOG(INFO, this) << "Timed out waiting for DOWNSTREAM:" << leader_;
+    }
+
+    leader_->remove_collapse_follower(this);
+    leader_ = nullptr;
+  }
+
+  auto downstream = downstream_;
+  auto upstream = downstream->get_upstream();
+  auto handler = upstream->get_client_handler();
+
+  downstream->disable_collapse();
+
+  // If no response has been sent yet, this forwards the request to
+  // the backend.  This object is deleted.
+  if (upstream->on_downstream_reset(downstream, false) != 0) {
+    delete handler;
+  }
+}
+
+} // namespace shrpx
@@ -0,0 +1,108 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef SHRPX_COLLAPSED_DOWNSTREAM_CONNECTION_H
+#define SHRPX_COLLAPSED_DOWNSTREAM_CONNECTION_H
+
+#include "shrpx_downstream_connection.h"
+
+#include <ev.h>
+
+namespace shrpx {
+
+// CollapsedDownstreamConnection is attached to the request which
+// waits for the response of the other in-flight request (the
+// leader) with the same key instead of being forwarded to the
+// backend.  The response of the leader is copied to the attached
+// request.  If the leader cannot share its response, or the response
+// header does not arrive in time, the attached request is forwarded
+// to the backend separately.
+class CollapsedDownstreamConnection : public DownstreamConnection {
+public:
+  CollapsedDownstreamConnection(std::shared_ptr<DownstreamAddrGroup> group,
+                                Downstream *leader, struct ev_loop *loop,
+                                ev_tstamp timeout);
+  virtual ~CollapsedDownstreamConnection();
+  virtual int attach_downstream(Downstream *downstream);
+  virtual void detach_downstream(Downstream *downstream);
+
+  virtual int push_request_headers();
+  virtual int push_upload_data_chunk(const uint8_t *data, size_t datalen);
+  virtual int end_upload_data();
+
+  virtual void pause_read(IOCtrlReason reason);
+  virtual int resume_read(IOCtrlReason reason, size_t consumed);
+  virtual void force_resume_read();
+
+  virtual int on_read();
+  virtual int on_write();
+
+  virtual void on_upstream_change(Upstream *uptream);
+
+  // true if this object is poolable.
+  virtual bool poolable() const;
+
+  virtual const std::shared_ptr<DownstreamAddrGroup> &
+  get_downstream_addr_group() const;
+  virtual DownstreamAddr *get_addr() const;
+
+  // The following functions are called by |leader| when it receives
+  // the final response header, the response body, and the end of the
+  // response respectively.  |leader| removes this object from its
+  // followers before calling on_leader_response_complete().
+  void on_leader_response_header(Downstream *leader);
+  void on_leader_response_body(const uint8_t *data, size_t len);
+  void on_leader_response_complete(Downstream *leader);
+  // Called when the leader has removed this object from its
+  // followers without completing the response.
+  void on_leader_gone();
+  // Handles the expiry of timer_.  This function may delete this
+  // object.
+  void on_timer();
+
+  CollapsedDownstreamConnection *dlnext, *dlprev;
+
+private:
+  // Stops waiting for the leader, and schedules the reset of the
+  // attached request.  The request is forwarded to the backend
+  // separately if it has not received response yet.  Otherwise it is
+  // reset.
+  void schedule_reset();
+
+  std::shared_ptr<DownstreamAddrGroup> group_;
+  // The request which this object waits for, or nullptr.
+  Downstream *leader_;
+  struct ev_loop *loop_;
+  // The timer which limits the time waiting for the leader.  It is
+  // also used to reset the attached request outside the call stack
+  // of the leader.
+  ev_timer timer_;
+  ev_tstamp timeout_;
+  // true if the response header of the leader has been copied.
+  bool header_copied_;
+};
+
+} // namespace shrpx
+
+#endif // SHRPX_COLLAPSED_DOWNSTREAM_CONNECTION_H
@@ -48,6 +48,8 @@
 #include <limits>
 #include <fstream>
 #include <unordered_map>
+#include <map>
+#include <tuple>
 
 #include <nghttp2/nghttp2.h>
 
@@ -56,6 +58,7 @@
 #include "shrpx_log.h"
 #include "shrpx_tls.h"
 #include "shrpx_http.h"
+#include "shrpx_connection.h"
 #ifdef HAVE_MRUBY
 #  include "shrpx_mruby.h"
 #endif // HAVE_MRUBY
@@ -785,6 +788,8 @@ struct UpstreamParams {
   bool tls;
   bool sni_fwd;
   bool proxyproto;
+  bool reuseport;
+  bool reuseport_cpu;
 };
 
 namespace {
@@ -819,6 +824,11 @@ int parse_upstream_params(UpstreamParams &out, const StringRef &src_params) {
       out.alt_mode = UpstreamAltMode::HEALTHMON;
     } else if (util::strieq_l("proxyproto", param)) {
       out.proxyproto = true;
+    } else if (util::strieq_l("reuseport", param)) {
+      out.reuseport = true;
+    } else if (util::strieq_l("reuseport-cpu", param)) {
+      out.reuseport = true;
+      out.reuseport_cpu = true;
     } else if (!param.empty()) {
       LOG(ERROR) << "frontend: " << param << ": unknown keyword";
       return -1;
@@ -840,10 +850,15 @@ struct DownstreamParams {
   StringRef mruby;
   StringRef group;
   AffinityConfig affinity;
+  LoadBalancing balance;
+  uint32_t hedge;
+  uint32_t max_concurrency;
   ev_tstamp read_timeout;
   ev_tstamp write_timeout;
   size_t fall;
   size_t rise;
+  size_t min_idle;
+  size_t max_connections;
   uint32_t weight;
   uint32_t group_weight;
   Proto proto;
@@ -851,6 +866,7 @@ struct DownstreamParams {
   bool dns;
   bool redirect_if_not_tls;
   bool upgrade_scheme;
+  bool collapse;
 };
 
 namespace {
@@ -938,11 +954,79 @@ int parse_downstream_params(DownstreamParams &out,
         out.affinity.type = SessionAffinity::IP;
       } else if (util::strieq_l("cookie", valstr)) {
         out.affinity.type = SessionAffinity::COOKIE;
+      } else if (util::strieq_l("hash", valstr)) {
+        out.affinity.type = SessionAffinity::HASH;
       } else {
-        LOG(ERROR)
-            << "backend: affinity: value must be one of none, ip, and cookie";
+        LOG(ERROR) << "backend: affinity: value must be one of none, ip, "
+                      "cookie, and hash";
+        return -1;
+      }
+    } else if (util::istarts_with_l(param, "affinity-hash-key=")) {
+      auto valstr = StringRef{first + str_size("affinity-hash-key="), end};
+      if (util::strieq_l("path", valstr)) {
+        out.affinity.hash.key = SessionAffinityHashKey::PATH;
+      } else if (util::istarts_with_l(valstr, "path-prefix:")) {
+        auto n = util::parse_uint(StringRef{
+            std::begin(valstr) + str_size("path-prefix:"), std::end(valstr)});
+        if (n <= 0) {
+          LOG(ERROR) << "backend: affinity-hash-key: path-prefix: positive "
+                        "integer is expected";
+          return -1;
+        }
+        out.affinity.hash.key = SessionAffinityHashKey::PATH_PREFIX;
+        out.affinity.hash.path_segments = n;
+      } else if (util::istarts_with_l(valstr, "header:")) {
+        auto name = StringRef{std::begin(valstr) + str_size("header:"),
+                              std::end(valstr)};
+        if (name.empty()) {
+          LOG(ERROR) << "backend: affinity-hash-key: header: non empty string "
+                        "is expected";
+          return -1;
+        }
+        out.affinity.hash.key = SessionAffinityHashKey::HEADER;
+        out.affinity.hash.header = name;
+      } else {
+        LOG(ERROR) << "backend: affinity-hash-key: value must be one of path, "
+                      "path-prefix:<N>, and header:<NAME>";
         return -1;
       }
+    } else if (util::istarts_with_l(param, "affinity-hash-max-load=")) {
+      auto valstr =
+          StringRef{first + str_size("affinity-hash-max-load="), end};
+      auto n = util::parse_uint(valstr);
+      if (n < 100 || n > std::numeric_limits<uint32_t>::max()) {
+        LOG(ERROR) << "backend: affinity-hash-max-load: integer greater than "
+                      "or equal to 100 is expected";
+        return -1;
+      }
+      out.affinity.hash.max_load = n;
+    } else if (util::istarts_with_l(param, "balance=")) {
+      auto valstr = StringRef{first + str_size("balance="), end};
+      if (util::strieq_l("wrr", valstr)) {
+        out.balance = LoadBalancing::WRR;
+      } else if (util::strieq_l("p2c", valstr)) {
+        out.balance = LoadBalancing::P2C;
+      } else {
+        LOG(ERROR) << "backend: balance: value must be one of wrr and p2c";
+        return -1;
+      }
+    } else if (util::istarts_with_l(param, "hedge=")) {
+      auto valstr = StringRef{first + str_size("hedge="), end};
+      auto n = util::parse_uint(valstr);
+      if (n < 1 || n > 99) {
+        LOG(ERROR) << "backend: hedge: integer in range [1, 99], inclusive is "
+                      "expected";
+        return -1;
+      }
+      out.hedge = n;
+    } else if (util::istarts_with_l(param, "max-concurrency=")) {
+      auto valstr = StringRef{first + str_size("max-concurrency="), end};
+      auto n = util::parse_uint(valstr);
+      if (n < 1 || n > std::numeric_limits<int32_t>::max()) {
+        LOG(ERROR) << "backend: max-concurrency: non-zero integer is expected";
+        return -1;
+      }
+      out.max_concurrency = n;
     } else if (util::istarts_with_l(param, "affinity-cookie-name=")) {
       auto val = StringRef{first + str_size("affinity-cookie-name="), end};
       if (val.empty()) {
@@ -973,6 +1057,8 @@ int parse_downstream_params(DownstreamParams &out,
       out.redirect_if_not_tls = true;
     } else if (util::strieq_l("upgrade-scheme", param)) {
       out.upgrade_scheme = true;
+    } else if (util::strieq_l("collapse", param)) {
+      out.collapse = true;
     } else if (util::istarts_with_l(param, "mruby=")) {
       auto valstr = StringRef{first + str_size("mruby="), end};
       out.mruby = valstr;
@@ -1003,6 +1089,23 @@ int parse_downstream_params(DownstreamParams &out,
         return -1;
       }
       out.weight = n;
+    } else if (util::istarts_with_l(param, "min-idle=")) {
+      auto valstr = StringRef{first + str_size("min-idle="), end};
+      auto n = util::parse_uint(valstr);
+      if (n == -1) {
+        LOG(ERROR) << "backend: min-idle: non-negative integer is expected";
+        return -1;
+      }
+      out.min_idle = n;
+    } else if (util::istarts_with_l(param, "max-connections=")) {
+      auto valstr = StringRef{first + str_size("max-connections="), end};
+      auto n = util::parse_uint(valstr);
+      if (n == -1) {
+        LOG(ERROR)
+            << "backend: max-connections: non-negative integer is expected";
+        return -1;
+      }
+      out.max_connections = n;
     } else if (util::istarts_with_l(param, "group=")) {
       auto valstr = StringRef{first + str_size("group="), end};
       if (valstr.empty()) {
@@ -1062,6 +1165,7 @@ int parse_mapping(Config *config, DownstreamAddrConfig &addr,
   DownstreamParams params{};
   params.proto = Proto::HTTP1;
   params.weight = 1;
+  params.affinity.hash.max_load = 125;
 
   if (parse_downstream_params(params, src_params) != 0) {
     return -1;
@@ -1079,9 +1183,21 @@ int parse_mapping(Config *config, DownstreamAddrConfig &addr,
     return -1;
   }
 
+  if (params.affinity.type == SessionAffinity::HASH &&
+      params.affinity.hash.key == SessionAffinityHashKey::HEADER) {
+    auto &name = params.affinity.hash.header;
+    auto iov = make_byte_ref(downstreamconf.balloc, name.size() + 1);
+    auto p = std::copy(std::begin(name), std::end(name), iov.base);
+    util::inp_strlower(iov.base, p);
+    *p = '\0';
+    name = StringRef{iov.base, p};
+  }
+
   addr.fall = params.fall;
   addr.rise = params.rise;
   addr.weight = params.weight;
+  addr.min_idle = params.min_idle;
+  addr.max_connections = params.max_connections;
   addr.group = make_string_ref(downstreamconf.balloc, params.group);
   addr.group_weight = params.group_weight;
   addr.proto = params.proto;
@@ -1139,20 +1255,65 @@ int parse_mapping(Config *config, DownstreamAddrConfig &addr,
             }
             g.affinity.cookie.secure = params.affinity.cookie.secure;
           }
+          g.affinity.hash = params.affinity.hash;
         } else if (g.affinity.type != params.affinity.type ||
                    g.affinity.cookie.name != params.affinity.cookie.name ||
                    g.affinity.cookie.path != params.affinity.cookie.path ||
-                   g.affinity.cookie.secure != params.affinity.cookie.secure) {
+                   g.affinity.cookie.secure != params.affinity.cookie.secure ||
+                   g.affinity.hash.key != params.affinity.hash.key ||
+                   g.affinity.hash.header != params.affinity.hash.header ||
+                   g.affinity.hash.path_segments !=
+                       params.affinity.hash.path_segments ||
+                   g.affinity.hash.max_load != params.affinity.hash.max_load) {
           LOG(ERROR) << "backend: affinity: multiple different affinity "
                         "configurations found in a single group";
           return -1;
         }
       }
+      // All backends in the same group must use the same load
+      // balancing algorithm.  wrr is the default, and it is
+      // overridden by the other value.
+      if (params.balance != LoadBalancing::WRR) {
+        if (g.balance == LoadBalancing::WRR) {
+          g.balance = params.balance;
+        } else if (g.balance != params.balance) {
+          LOG(ERROR) << "backend: balance: multiple different balance "
+                        "found in a single group";
+          return -1;
+        }
+      }
+      // All backends in the same group must use the same hedge
+      // percentile if it is specified.
+      if (params.hedge) {
+        if (!g.hedge) {
+          g.hedge = params.hedge;
+        } else if (g.hedge != params.hedge) {
+          LOG(ERROR) << "backend: hedge: multiple different hedge found in a "
+                        "single group";
+          return -1;
+        }
+      }
+      // All backends in the same group must use the same
+      // max-concurrency if it is specified.
+      if (params.max_concurrency) {
+        if (!g.max_concurrency) {
+          g.max_concurrency = params.max_concurrency;
+        } else if (g.max_concurrency != params.max_concurrency) {
+          LOG(ERROR) << "backend: max-concurrency: multiple different "
+                        "max-concurrency found in a single group";
+          return -1;
+        }
+      }
       // If at least one backend requires frontend TLS connection,
       // enable it for all backends sharing the same pattern.
       if (params.redirect_if_not_tls) {
         g.redirect_if_not_tls = true;
       }
+      // If at least one backend enables collapsed forwarding, enable
+      // it for all backends sharing the same pattern.
+      if (params.collapse) {
+        g.collapse = true;
+      }
       // All backends in the same group must have the same mruby path.
       // If some backends do not specify mruby file, and there is at
       // least one backend with mruby file, it is used for all
@@ -1209,7 +1370,12 @@ int parse_mapping(Config *config, DownstreamAddrConfig &addr,
       }
       g.affinity.cookie.secure = params.affinity.cookie.secure;
     }
+    g.affinity.hash = params.affinity.hash;
+    g.balance = params.balance;
+    g.hedge = params.hedge;
+    g.max_concurrency = params.max_concurrency;
     g.redirect_if_not_tls = params.redirect_if_not_tls;
+    g.collapse = params.collapse;
     g.mruby_file = make_string_ref(downstreamconf.balloc, params.mruby);
     g.timeout.read = params.read_timeout;
     g.timeout.write = params.write_timeout;
@@ -1744,6 +1910,11 @@ int option_lookup_token(const char *name, size_t namelen) {
         return SHRPX_OPTID_FASTOPEN;
       }
       break;
+    case 's':
+      if (util::strieq_l("tls-ktl", name, 7)) {
+        return SHRPX_OPTID_TLS_KTLS;
+      }
+      break;
     case 't':
       if (util::strieq_l("npn-lis", name, 7)) {
         return SHRPX_OPTID_NPN_LIST;
@@ -1754,6 +1925,9 @@ int option_lookup_token(const char *name, size_t namelen) {
   case 9:
     switch (name[8]) {
     case 'e':
+      if (util::strieq_l("io-engin", name, 8)) {
+        return SHRPX_OPTID_IO_ENGINE;
+      }
       if (util::strieq_l("no-kqueu", name, 8)) {
         return SHRPX_OPTID_NO_KQUEUE;
       }
@@ -1858,6 +2032,9 @@ int option_lookup_token(const char *name, size_t namelen) {
       if (util::strieq_l("forwarded-b", name, 11)) {
         return SHRPX_OPTID_FORWARDED_BY;
       }
+      if (util::strieq_l("splice-rela", name, 11)) {
+        return SHRPX_OPTID_SPLICE_RELAY;
+      }
       break;
     }
     break;
@@ -1870,6 +2047,9 @@ int option_lookup_token(const char *name, size_t namelen) {
       if (util::strieq_l("single-threa", name, 12)) {
         return SHRPX_OPTID_SINGLE_THREAD;
       }
+      if (util::strieq_l("zerocopy-sen", name, 12)) {
+        return SHRPX_OPTID_ZEROCOPY_SEND;
+      }
       break;
     case 'e':
       if (util::strieq_l("dh-param-fil", name, 12)) {
@@ -1936,6 +2116,11 @@ int option_lookup_token(const char *name, size_t namelen) {
     break;
   case 15:
     switch (name[14]) {
+    case 'c':
+      if (util::strieq_l("accesslog-asyn", name, 14)) {
+        return SHRPX_OPTID_ACCESSLOG_ASYNC;
+      }
+      break;
     case 'e':
       if (util::strieq_l("no-host-rewrit", name, 14)) {
         return SHRPX_OPTID_NO_HOST_REWRITE;
@@ -2074,6 +2259,9 @@ int option_lookup_token(const char *name, size_t namelen) {
       if (util::strieq_l("stream-read-timeou", name, 18)) {
         return SHRPX_OPTID_STREAM_READ_TIMEOUT;
       }
+      if (util::strieq_l("worker-event-budge", name, 18)) {
+        return SHRPX_OPTID_WORKER_EVENT_BUDGET;
+      }
       break;
     }
     break;
@@ -2095,6 +2283,9 @@ int option_lookup_token(const char *name, size_t namelen) {
       }
       break;
     case 't':
+      if (util::strieq_l("backend-hedge-budge", name, 19)) {
+        return SHRPX_OPTID_BACKEND_HEDGE_BUDGET;
+      }
       if (util::strieq_l("backend-read-timeou", name, 19)) {
         return SHRPX_OPTID_BACKEND_READ_TIMEOUT;
       }
@@ -2119,6 +2310,11 @@ int option_lookup_token(const char *name, size_t namelen) {
         return SHRPX_OPTID_BACKEND_TLS_SNI_FIELD;
       }
       break;
+    case 'e':
+      if (util::strieq_l("frontend-idle-releas", name, 20)) {
+        return SHRPX_OPTID_FRONTEND_IDLE_RELEASE;
+      }
+      break;
     case 'l':
       if (util::strieq_l("accept-proxy-protoco", name, 20)) {
         return SHRPX_OPTID_ACCEPT_PROXY_PROTOCOL;
@@ -2154,6 +2350,9 @@ int option_lookup_token(const char *name, size_t namelen) {
       if (util::strieq_l("accesslog-write-earl", name, 20)) {
         return SHRPX_OPTID_ACCESSLOG_WRITE_EARLY;
       }
+      if (util::strieq_l("backend-collapse-var", name, 20)) {
+        return SHRPX_OPTID_BACKEND_COLLAPSE_VARY;
+      }
       break;
     }
     break;
@@ -2190,6 +2389,14 @@ int option_lookup_token(const char *name, size_t namelen) {
       if (util::strieq_l("private-key-passwd-fil", name, 22)) {
         return SHRPX_OPTID_PRIVATE_KEY_PASSWD_FILE;
       }
+      if (util::strieq_l("worker-event-queue-siz", name, 22)) {
+        return SHRPX_OPTID_WORKER_EVENT_QUEUE_SIZE;
+      }
+      break;
+    case 'h':
+      if (util::strieq_l("splice-relay-min-lengt", name, 22)) {
+        return SHRPX_OPTID_SPLICE_RELAY_MIN_LENGTH;
+      }
       break;
     case 'r':
       if (util::strieq_l("backend-response-buffe", name, 22)) {
@@ -2201,6 +2408,11 @@ int option_lookup_token(const char *name, size_t namelen) {
         return SHRPX_OPTID_BACKEND_CONNECT_TIMEOUT;
       }
       break;
+    case 'y':
+      if (util::strieq_l("backend-hedge-min-dela", name, 22)) {
+        return SHRPX_OPTID_BACKEND_HEDGE_MIN_DELAY;
+      }
+      break;
     }
     break;
   case 24:
@@ -2212,18 +2424,29 @@ int option_lookup_token(const char *name, size_t namelen) {
       if (util::strieq_l("tls-ticket-key-memcache", name, 23)) {
         return SHRPX_OPTID_TLS_TICKET_KEY_MEMCACHED;
       }
+      if (util::strieq_l("zerocopy-send-max-pinne", name, 23)) {
+        return SHRPX_OPTID_ZEROCOPY_SEND_MAX_PINNED;
+      }
       break;
     case 'e':
       if (util::strieq_l("fetch-ocsp-response-fil", name, 23)) {
         return SHRPX_OPTID_FETCH_OCSP_RESPONSE_FILE;
       }
       break;
+    case 'h':
+      if (util::strieq_l("zerocopy-send-min-lengt", name, 23)) {
+        return SHRPX_OPTID_ZEROCOPY_SEND_MIN_LENGTH;
+      }
+      break;
     case 'o':
       if (util::strieq_l("no-add-x-forwarded-prot", name, 23)) {
         return SHRPX_OPTID_NO_ADD_X_FORWARDED_PROTO;
       }
       break;
     case 't':
+      if (util::strieq_l("backend-collapse-timeou", name, 23)) {
+        return SHRPX_OPTID_BACKEND_COLLAPSE_TIMEOUT;
+      }
       if (util::strieq_l("listener-disable-timeou", name, 23)) {
         return SHRPX_OPTID_LISTENER_DISABLE_TIMEOUT;
       }
@@ -2231,6 +2454,11 @@ int option_lookup_token(const char *name, size_t namelen) {
         return SHRPX_OPTID_TLS_DYN_REC_IDLE_TIMEOUT;
       }
       break;
+    case 'w':
+      if (util::strieq_l("accesslog-async-overflo", name, 23)) {
+        return SHRPX_OPTID_ACCESSLOG_ASYNC_OVERFLOW;
+      }
+      break;
     }
     break;
   case 25:
@@ -2245,6 +2473,11 @@ int option_lookup_token(const char *name, size_t namelen) {
         return SHRPX_OPTID_HTTP2_NO_COOKIE_CRUMBLING;
       }
       break;
+    case 'k':
+      if (util::strieq_l("frontend-timer-wheel-tic", name, 24)) {
+        return SHRPX_OPTID_FRONTEND_TIMER_WHEEL_TICK;
+      }
+      break;
     case 's':
       if (util::strieq_l("backend-http2-window-bit", name, 24)) {
         return SHRPX_OPTID_BACKEND_HTTP2_WINDOW_BITS;
@@ -2263,6 +2496,9 @@ int option_lookup_token(const char *name, size_t namelen) {
       }
       break;
     case 'e':
+      if (util::strieq_l("backend-outlier-error-rat", name, 25)) {
+        return SHRPX_OPTID_BACKEND_OUTLIER_ERROR_RATE;
+      }
       if (util::strieq_l("frontend-http2-window-siz", name, 25)) {
         return SHRPX_OPTID_FRONTEND_HTTP2_WINDOW_SIZE;
       }
@@ -2292,6 +2528,11 @@ int option_lookup_token(const char *name, size_t namelen) {
         return SHRPX_OPTID_TLS_SESSION_CACHE_MEMCACHED;
       }
       break;
+    case 'e':
+      if (util::strieq_l("accesslog-async-buffer-siz", name, 26)) {
+        return SHRPX_OPTID_ACCESSLOG_ASYNC_BUFFER_SIZE;
+      }
+      break;
     case 'r':
       if (util::strieq_l("request-header-field-buffe", name, 26)) {
         return SHRPX_OPTID_REQUEST_HEADER_FIELD_BUFFER;
@@ -2324,12 +2565,23 @@ int option_lookup_token(const char *name, size_t namelen) {
         return SHRPX_OPTID_TLS_DYN_REC_WARMUP_THRESHOLD;
       }
       break;
+    case 'n':
+      if (util::strieq_l("backend-outlier-max-ejectio", name, 27)) {
+        return SHRPX_OPTID_BACKEND_OUTLIER_MAX_EJECTION;
+      }
+      break;
     case 'r':
       if (util::strieq_l("response-header-field-buffe", name, 27)) {
         return SHRPX_OPTID_RESPONSE_HEADER_FIELD_BUFFER;
       }
       break;
     case 's':
+      if (util::strieq_l("backend-collapse-max-waiter", name, 27)) {
+        return SHRPX_OPTID_BACKEND_COLLAPSE_MAX_WAITERS;
+      }
+      if (util::strieq_l("backend-outlier-min-request", name, 27)) {
+        return SHRPX_OPTID_BACKEND_OUTLIER_MIN_REQUESTS;
+      }
       if (util::strieq_l("http2-max-concurrent-stream", name, 27)) {
         return SHRPX_OPTID_HTTP2_MAX_CONCURRENT_STREAMS;
       }
@@ -2344,6 +2596,20 @@ int option_lookup_token(const char *name, size_t namelen) {
       break;
     }
     break;
+  case 29:
+    switch (name[28]) {
+    case 'e':
+      if (util::strieq_l("backend-outlier-ejection-tim", name, 28)) {
+        return SHRPX_OPTID_BACKEND_OUTLIER_EJECTION_TIME;
+      }
+      break;
+    case 't':
+      if (util::strieq_l("backend-concurrency-min-limi", name, 28)) {
+        return SHRPX_OPTID_BACKEND_CONCURRENCY_MIN_LIMIT;
+      }
+      break;
+    }
+    break;
   case 30:
     switch (name[29]) {
     case 'd':
@@ -2352,6 +2618,9 @@ int option_lookup_token(const char *name, size_t namelen) {
       }
       break;
     case 'r':
+      if (util::strieq_l("backend-outlier-latency-facto", name, 29)) {
+        return SHRPX_OPTID_BACKEND_OUTLIER_LATENCY_FACTOR;
+      }
       if (util::strieq_l("ignore-per-pattern-mruby-erro", name, 29)) {
         return SHRPX_OPTID_IGNORE_PER_PATTERN_MRUBY_ERROR;
       }
@@ -2368,6 +2637,11 @@ int option_lookup_token(const char *name, size_t namelen) {
     break;
   case 31:
     switch (name[30]) {
+    case 'r':
+      if (util::strieq_l("backend-concurrency-retry-afte", name, 30)) {
+        return SHRPX_OPTID_BACKEND_CONCURRENCY_RETRY_AFTER;
+      }
+      break;
     case 's':
       if (util::strieq_l("tls-session-cache-memcached-tl", name, 30)) {
         return SHRPX_OPTID_TLS_SESSION_CACHE_MEMCACHED_TLS;
@@ -2413,6 +2687,11 @@ int option_lookup_token(const char *name, size_t namelen) {
         return SHRPX_OPTID_TLS_TICKET_KEY_MEMCACHED_CERT_FILE;
       }
       break;
+    case 'l':
+      if (util::strieq_l("backend-outlier-detection-interva", name, 33)) {
+        return SHRPX_OPTID_BACKEND_OUTLIER_DETECTION_INTERVAL;
+      }
+      break;
     case 'r':
       if (util::strieq_l("frontend-http2-dump-request-heade", name, 33)) {
         return SHRPX_OPTID_FRONTEND_HTTP2_DUMP_REQUEST_HEADER;
@@ -2636,12 +2915,26 @@ int parse_config(Config *config, int optid, const StringRef &opt,
       return -1;
     }
 
+    if (params.reuseport && params.alt_mode == UpstreamAltMode::API) {
+      LOG(ERROR) << "frontend: api and reuseport are mutually exclusive";
+      return -1;
+    }
+
+    if (params.reuseport &&
+        util::istarts_with(optarg, SHRPX_UNIX_PATH_PREFIX)) {
+      LOG(ERROR) << "frontend: reuseport is not supported for UNIX domain "
+                    "socket";
+      return -1;
+    }
+
     UpstreamAddr addr{};
     addr.fd = -1;
     addr.tls = params.tls;
     addr.sni_fwd = params.sni_fwd;
     addr.alt_mode = params.alt_mode;
     addr.accept_proxy_protocol = params.proxyproto;
+    addr.reuseport = params.reuseport;
+    addr.reuseport_cpu = params.reuseport_cpu;
 
     if (addr.alt_mode == UpstreamAltMode::API) {
       apiconf.enabled = true;
@@ -3671,6 +3964,162 @@ int parse_config(Config *config, int optid, const StringRef &opt,
   case SHRPX_OPTID_FRONTEND_KEEP_ALIVE_TIMEOUT:
     return parse_duration(&config->conn.upstream.timeout.idle_read, opt,
                           optarg);
+  case SHRPX_OPTID_FRONTEND_TIMER_WHEEL_TICK:
+    return parse_duration(&config->conn.upstream.timer_wheel_tick, opt,
+                          optarg);
+  case SHRPX_OPTID_FRONTEND_IDLE_RELEASE:
+    return parse_duration(&config->conn.upstream.idle_release, opt, optarg);
+  case SHRPX_OPTID_BACKEND_OUTLIER_DETECTION_INTERVAL:
+    return parse_duration(&config->conn.downstream->outlier.interval, opt,
+                          optarg);
+  case SHRPX_OPTID_BACKEND_OUTLIER_ERROR_RATE: {
+    size_t n;
+
+    if (parse_uint(&n, opt, optarg) != 0) {
+      return -1;
+    }
+
+    if (n > 100) {
+      LOG(ERROR) << opt << ": specify an integer in range [0, 100], inclusive";
+
+      return -1;
+    }
+
+    config->conn.downstream->outlier.error_rate = n;
+
+    return 0;
+  }
+  case SHRPX_OPTID_BACKEND_OUTLIER_LATENCY_FACTOR:
+    return parse_uint(&config->conn.downstream->outlier.latency_factor, opt,
+                      optarg);
+  case SHRPX_OPTID_BACKEND_OUTLIER_MIN_REQUESTS: {
+    size_t n;
+
+    if (parse_uint(&n, opt, optarg) != 0) {
+      return -1;
+    }
+
+    if (n == 0) {
+      LOG(ERROR) << opt << ": specify an integer strictly more than 0";
+
+      return -1;
+    }
+
+    config->conn.downstream->outlier.min_requests = n;
+
+    return 0;
+  }
+  case SHRPX_OPTID_BACKEND_OUTLIER_EJECTION_TIME:
+    return parse_duration(&config->conn.downstream->outlier.ejection_time,
+                          opt, optarg);
+  case SHRPX_OPTID_BACKEND_OUTLIER_MAX_EJECTION: {
+    size_t n;
+
+    if (parse_uint(&n, opt, optarg) != 0) {
+      return -1;
+    }
+
+    if (n > 100) {
+      LOG(ERROR) << opt << ": specify an integer in range [0, 100], inclusive";
+
+      return -1;
+    }
+
+    config->conn.downstream->outlier.max_ejection = n;
+
+    return 0;
+  }
+  case SHRPX_OPTID_BACKEND_HEDGE_BUDGET: {
+    size_t n;
+
+    if (parse_uint(&n, opt, optarg) != 0) {
+      return -1;
+    }
+
+    if (n > 100) {
+      LOG(ERROR) << opt << ": specify an integer in range [0, 100], inclusive";
+
+      return -1;
+    }
+
+    config->conn.downstream->hedge.budget = n;
+
+    return 0;
+  }
+  case SHRPX_OPTID_BACKEND_HEDGE_MIN_DELAY:
+    return parse_duration(&config->conn.downstream->hedge.min_delay, opt,
+                          optarg);
+  case SHRPX_OPTID_BACKEND_CONCURRENCY_MIN_LIMIT: {
+    size_t n;
+
+    if (parse_uint(&n, opt, optarg) != 0) {
+      return -1;
+    }
+
+    if (n == 0) {
+      LOG(ERROR) << opt << ": specify an integer strictly more than 0";
+
+      return -1;
+    }
+
+    config->conn.downstream->concurrency.min_limit = n;
+
+    return 0;
+  }
+  case SHRPX_OPTID_BACKEND_CONCURRENCY_RETRY_AFTER:
+    return parse_duration(&config->conn.downstream->concurrency.retry_after,
+                          opt, optarg);
+  case SHRPX_OPTID_BACKEND_COLLAPSE_VARY: {
+    auto &vary = config->conn.downstream->collapse.vary;
+
+    vary.clear();
+
+    for (const auto &name : util::split_str(optarg, ',')) {
+      auto first = std::begin(name);
+      auto last = std::end(name);
+
+      // Optional white spaces around each element are removed as in
+      // the list of header field values.
+      for (; first != last && (*first == ' ' || *first == '\t'); ++first)
+        ;
+      for (; first != last && (*(last - 1) == ' ' || *(last - 1) == '\t');
+           --last)
+        ;
+
+      if (first == last) {
+        continue;
+      }
+
+      auto iov = make_byte_ref(config->balloc, last - first + 1);
+      auto p = std::copy(first, last, iov.base);
+      util::inp_strlower(iov.base, p);
+      *p = '\0';
+
+      vary.emplace_back(iov.base, p);
+    }
+
+    return 0;
+  }
+  case SHRPX_OPTID_BACKEND_COLLAPSE_MAX_WAITERS: {
+    size_t n;
+
+    if (parse_uint(&n, opt, optarg) != 0) {
+      return -1;
+    }
+
+    if (n == 0) {
+      LOG(ERROR) << opt << ": specify an integer strictly more than 0";
+
+      return -1;
+    }
+
+    config->conn.downstream->collapse.max_waiters = n;
+
+    return 0;
+  }
+  case SHRPX_OPTID_BACKEND_COLLAPSE_TIMEOUT:
+    return parse_duration(&config->conn.downstream->collapse.timeout, opt,
+                          optarg);
   case SHRPX_OPTID_PSK_SECRETS:
 #if !LIBRESSL_LEGACY_API
     return parse_psk_secrets(config, optarg);
@@ -3705,6 +4154,74 @@ int parse_config(Config *config, int optid, const StringRef &opt,
   case SHRPX_OPTID_ACCESSLOG_WRITE_EARLY:
     config->logging.access.write_early = util::strieq_l("yes", optarg);
 
+    return 0;
+  case SHRPX_OPTID_ACCESSLOG_ASYNC:
+    config->logging.access.async.enabled = util::strieq_l("yes", optarg);
+
+    return 0;
+  case SHRPX_OPTID_ACCESSLOG_ASYNC_BUFFER_SIZE: {
+    size_t n;
+    if (parse_uint_with_unit(&n, opt, optarg) != 0) {
+      return -1;
+    }
+
+    if (n < 4_k) {
+      LOG(ERROR) << opt << ": specify at least 4K";
+
+      return -1;
+    }
+
+    config->logging.access.async.buffer_size = n;
+
+    return 0;
+  }
+  case SHRPX_OPTID_SPLICE_RELAY:
+    config->splice_relay.enabled = util::strieq_l("yes", optarg);
+
+    return 0;
+  case SHRPX_OPTID_ZEROCOPY_SEND:
+#ifndef HAVE_MSG_ZEROCOPY
+    LOG(WARN) << opt << ": MSG_ZEROCOPY is not supported in this build; "
+                        "ignored";
+#endif // !HAVE_MSG_ZEROCOPY
+    config->zerocopy_send.enabled = util::strieq_l("yes", optarg);
+
+    return 0;
+  case SHRPX_OPTID_ZEROCOPY_SEND_MIN_LENGTH:
+    return parse_uint_with_unit(&config->zerocopy_send.min_length, opt,
+                                optarg);
+  case SHRPX_OPTID_ZEROCOPY_SEND_MAX_PINNED:
+    return parse_uint_with_unit(&config->zerocopy_send.max_pinned, opt,
+                                optarg);
+  case SHRPX_OPTID_SPLICE_RELAY_MIN_LENGTH:
+    return parse_uint_with_unit(&config->splice_relay.min_length, opt, optarg);
+  case SHRPX_OPTID_IO_ENGINE:
+    if (util::strieq_l("libev", optarg)) {
+      config->io_engine = IOEngine::LIBEV;
+    } else if (util::strieq_l("io_uring", optarg)) {
+#ifndef HAVE_IO_URING
+      LOG(WARN) << opt << ": io_uring is not supported in this build; libev "
+                          "is used instead";
+#endif // !HAVE_IO_URING
+      config->io_engine = IOEngine::IO_URING;
+    } else {
+      LOG(ERROR) << opt << ": must be either libev or io_uring";
+
+      return -1;
+    }
+
+    return 0;
+  case SHRPX_OPTID_ACCESSLOG_ASYNC_OVERFLOW:
+    if (util::strieq_l("drop", optarg)) {
+      config->logging.access.async.block_on_overflow = false;
+    } else if (util::strieq_l("block", optarg)) {
+      config->logging.access.async.block_on_overflow = true;
+    } else {
+      LOG(ERROR) << opt << ": must be either drop or block";
+
+      return -1;
+    }
+
     return 0;
   case SHRPX_OPTID_TLS_MIN_PROTO_VERSION:
     return parse_tls_proto_version(config->tls.min_proto_version, opt, optarg);
@@ -3758,6 +4275,13 @@ int parse_config(Config *config, int optid, const StringRef &opt,
   case SHRPX_OPTID_TLS_NO_POSTPONE_EARLY_DATA:
     config->tls.no_postpone_early_data = util::strieq_l("yes", optarg);
 
+    return 0;
+  case SHRPX_OPTID_TLS_KTLS:
+#ifndef SHRPX_KTLS
+    LOG(WARN) << opt << ": kTLS is not supported in this build; ignored";
+#endif // !SHRPX_KTLS
+    config->tls.ktls = util::strieq_l("yes", optarg);
+
     return 0;
   case SHRPX_OPTID_TLS_MAX_EARLY_DATA: {
     return parse_uint_with_unit(&config->tls.max_early_data, opt, optarg);
@@ -3766,6 +4290,38 @@ int parse_config(Config *config, int optid, const StringRef &opt,
     config->http.early_data.strip_incoming = !util::strieq_l("yes", optarg);
 
     return 0;
+  case SHRPX_OPTID_WORKER_EVENT_BUDGET: {
+    size_t n;
+    if (parse_uint(&n, opt, optarg) != 0) {
+      return -1;
+    }
+
+    if (n == 0) {
+      LOG(ERROR) << opt << ": specify an integer strictly more than 0";
+
+      return -1;
+    }
+
+    config->worker_event.budget = n;
+
+    return 0;
+  }
+  case SHRPX_OPTID_WORKER_EVENT_QUEUE_SIZE: {
+    size_t n;
+    if (parse_uint(&n, opt, optarg) != 0) {
+      return -1;
+    }
+
+    if (n == 0) {
+      LOG(ERROR) << opt << ": specify an integer strictly more than 0";
+
+      return -1;
+    }
+
+    config->worker_event.queue_size = n;
+
+    return 0;
+  }
   case SHRPX_OPTID_CONF:
     LOG(WARN) << "conf: ignored";
 
@@ -4210,6 +4766,49 @@ int configure_downstream_group(Config *config, bool http2_proxy,
     }
   }
 
+  // Workers share the connection budget of the backend addresses
+  // which connect to the same endpoint, so that they must agree on
+  // max-connections.
+  using EndpointKey =
+      std::tuple<StringRef, StringRef, Proto, uint16_t, bool, bool, bool>;
+  std::map<EndpointKey, size_t> mcchk;
+
+  for (auto &g : addr_groups) {
+    for (auto &addr : g.addrs) {
+      if (addr.max_connections == 0) {
+        continue;
+      }
+
+      auto key = EndpointKey{addr.host,      addr.sni, addr.proto, addr.port,
+                             addr.host_unix, addr.tls, addr.dns};
+      auto it = mcchk.find(key);
+      if (it == std::end(mcchk)) {
+        mcchk.emplace(key, addr.max_connections);
+      } else if ((*it).second != addr.max_connections) {
+        LOG(FATAL) << "backend: inconsistent max-connections for "
+                   << addr.host << ":" << addr.port;
+        return -1;
+      }
+    }
+  }
+
+  if (!mcchk.empty()) {
+    for (auto &g : addr_groups) {
+      for (auto &addr : g.addrs) {
+        if (addr.max_connections != 0) {
+          continue;
+        }
+
+        auto it =
+            mcchk.find(EndpointKey{addr.host, addr.sni, addr.proto, addr.port,
+                                   addr.host_unix, addr.tls, addr.dns});
+        if (it != std::end(mcchk)) {
+          addr.max_connections = (*it).second;
+        }
+      }
+    }
+  }
+
   return 0;
 }
 
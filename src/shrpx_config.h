@@ -356,6 +356,56 @@ constexpr auto SHRPX_OPT_TLS13_CLIENT_CIPHERS =
     StringRef::from_lit("tls13-client-ciphers");
 constexpr auto SHRPX_OPT_NO_STRIP_INCOMING_EARLY_DATA =
     StringRef::from_lit("no-strip-incoming-early-data");
+constexpr auto SHRPX_OPT_WORKER_EVENT_BUDGET =
+    StringRef::from_lit("worker-event-budget");
+constexpr auto SHRPX_OPT_WORKER_EVENT_QUEUE_SIZE =
+    StringRef::from_lit("worker-event-queue-size");
+constexpr auto SHRPX_OPT_ACCESSLOG_ASYNC =
+    StringRef::from_lit("accesslog-async");
+constexpr auto SHRPX_OPT_ACCESSLOG_ASYNC_BUFFER_SIZE =
+    StringRef::from_lit("accesslog-async-buffer-size");
+constexpr auto SHRPX_OPT_ACCESSLOG_ASYNC_OVERFLOW =
+    StringRef::from_lit("accesslog-async-overflow");
+constexpr auto SHRPX_OPT_SPLICE_RELAY = StringRef::from_lit("splice-relay");
+constexpr auto SHRPX_OPT_SPLICE_RELAY_MIN_LENGTH =
+    StringRef::from_lit("splice-relay-min-length");
+constexpr auto SHRPX_OPT_IO_ENGINE = StringRef::from_lit("io-engine");
+constexpr auto SHRPX_OPT_TLS_KTLS = StringRef::from_lit("tls-ktls");
+constexpr auto SHRPX_OPT_ZEROCOPY_SEND = StringRef::from_lit("zerocopy-send");
+constexpr auto SHRPX_OPT_ZEROCOPY_SEND_MIN_LENGTH =
+    StringRef::from_lit("zerocopy-send-min-length");
+constexpr auto SHRPX_OPT_ZEROCOPY_SEND_MAX_PINNED =
+    StringRef::from_lit("zerocopy-send-max-pinned");
+constexpr auto SHRPX_OPT_FRONTEND_TIMER_WHEEL_TICK =
+    StringRef::from_lit("frontend-timer-wheel-tick");
+constexpr auto SHRPX_OPT_FRONTEND_IDLE_RELEASE =
+    StringRef::from_lit("frontend-idle-release");
+constexpr auto SHRPX_OPT_BACKEND_OUTLIER_DETECTION_INTERVAL =
+    StringRef::from_lit("backend-outlier-detection-interval");
+constexpr auto SHRPX_OPT_BACKEND_OUTLIER_ERROR_RATE =
+    StringRef::from_lit("backend-outlier-error-rate");
+constexpr auto SHRPX_OPT_BACKEND_OUTLIER_LATENCY_FACTOR =
+    StringRef::from_lit("backend-outlier-latency-factor");
+constexpr auto SHRPX_OPT_BACKEND_OUTLIER_MIN_REQUESTS =
+    StringRef::from_lit("backend-outlier-min-requests");
+constexpr auto SHRPX_OPT_BACKEND_OUTLIER_EJECTION_TIME =
+    StringRef::from_lit("backend-outlier-ejection-time");
+constexpr auto SHRPX_OPT_BACKEND_OUTLIER_MAX_EJECTION =
+    StringRef::from_lit("backend-outlier-max-ejection");
+constexpr auto SHRPX_OPT_BACKEND_HEDGE_BUDGET =
+    StringRef::from_lit("backend-hedge-budget");
+constexpr auto SHRPX_OPT_BACKEND_HEDGE_MIN_DELAY =
+    StringRef::from_lit("backend-hedge-min-delay");
+constexpr auto SHRPX_OPT_BACKEND_CONCURRENCY_MIN_LIMIT =
+    StringRef::from_lit("backend-concurrency-min-limit");
+constexpr auto SHRPX_OPT_BACKEND_CONCURRENCY_RETRY_AFTER =
+    StringRef::from_lit("backend-concurrency-retry-after");
+constexpr auto SHRPX_OPT_BACKEND_COLLAPSE_VARY =
+    StringRef::from_lit("backend-collapse-vary");
+constexpr auto SHRPX_OPT_BACKEND_COLLAPSE_MAX_WAITERS =
+    StringRef::from_lit("backend-collapse-max-waiters");
+constexpr auto SHRPX_OPT_BACKEND_COLLAPSE_TIMEOUT =
+    StringRef::from_lit("backend-collapse-timeout");
 
 constexpr size_t SHRPX_OBFUSCATED_NODE_LENGTH = 8;
 
@@ -369,6 +419,13 @@ enum class Proto {
   MEMCACHED,
 };
 
+enum class IOEngine {
+  // I/O readiness is notified through libev watchers.
+  LIBEV,
+  // I/O is done through io_uring per worker.
+  IO_URING,
+};
+
 enum class SessionAffinity {
   // No session affinity
   NONE,
@@ -376,6 +433,26 @@ enum class SessionAffinity {
   IP,
   // Cookie based affinity
   COOKIE,
+  // Consistent hashing with bounded loads on a request attribute
+  HASH,
+};
+
+enum class SessionAffinityHashKey {
+  // Request path without query
+  PATH,
+  // The leading path segments of request path
+  PATH_PREFIX,
+  // Request header field
+  HEADER,
+};
+
+enum class LoadBalancing {
+  // Weighted scheduling based on the weight of each address and
+  // weight group.
+  WRR,
+  // Pick 2 addresses at random, and choose the one with less
+  // outstanding requests weighted by its response latency.
+  P2C,
 };
 
 enum class SessionAffinityCookieSecure {
@@ -399,6 +476,19 @@ struct AffinityConfig {
     // Secure attribute
     SessionAffinityCookieSecure secure;
   } cookie;
+  struct {
+    // The request attribute to hash.
+    SessionAffinityHashKey key;
+    // The lowercased header field name if key ==
+    // SessionAffinityHashKey::HEADER.
+    StringRef header;
+    // The number of path segments if key ==
+    // SessionAffinityHashKey::PATH_PREFIX.
+    size_t path_segments;
+    // The maximum load of an address in percentage of the mean load
+    // of the group.
+    uint32_t max_load;
+  } hash;
 };
 
 enum shrpx_forwarded_param {
@@ -454,7 +544,17 @@ struct UpstreamAddr {
   bool sni_fwd;
   // true if client is supposed to send PROXY protocol v1 header.
   bool accept_proxy_protocol;
+  // true if SO_REUSEPORT is set to the listener socket, and each
+  // worker accepts connections on its own listener.
+  bool reuseport;
+  // true if the kernel should select the listener by the CPU which
+  // handles the incoming connection.  This implies |reuseport|.
+  bool reuseport_cpu;
   int fd;
+  // Additional listener sockets bound to the same address as |fd|
+  // if |reuseport| is true.  The workers other than the first one
+  // accept connections on them.
+  std::vector<int> reuseport_fds;
 };
 
 struct DownstreamAddrConfig {
@@ -472,6 +572,12 @@ struct DownstreamAddrConfig {
   StringRef group;
   size_t fall;
   size_t rise;
+  // The number of idle connections to this address which each worker
+  // keeps open in advance.  0 if pre-warming is disabled.
+  size_t min_idle;
+  // The maximum number of connections to this address which all
+  // workers can hold in total.  0 means unlimited.
+  size_t max_connections;
   // weight of this address inside a weight group.  Its range is [1,
   // 256], inclusive.
   uint32_t weight;
@@ -505,7 +611,11 @@ struct DownstreamAddrGroupConfig {
   DownstreamAddrGroupConfig(const StringRef &pattern)
       : pattern(pattern),
         affinity{SessionAffinity::NONE},
+        balance(LoadBalancing::WRR),
+        hedge(0),
+        max_concurrency(0),
         redirect_if_not_tls(false),
+        collapse(false),
         timeout{} {}
 
   StringRef pattern;
@@ -516,9 +626,24 @@ struct DownstreamAddrGroupConfig {
   std::vector<AffinityHash> affinity_hash;
   // Cookie based session affinity configuration.
   AffinityConfig affinity;
+  // Load balancing algorithm used when session affinity is not
+  // enabled.
+  LoadBalancing balance;
+  // The percentile of the response latency of this group which is
+  // used as the delay to send a hedged request.  0 if request
+  // hedging is disabled.
+  uint32_t hedge;
+  // The maximum number of requests which can be forwarded to this
+  // group concurrently.  The actual limit is adjusted between
+  // DownstreamConfig.concurrency.min_limit and this value.  0 if
+  // adaptive concurrency limiting is disabled.
+  uint32_t max_concurrency;
   // true if this group requires that client connection must be TLS,
   // and the request must be redirected to https URI.
   bool redirect_if_not_tls;
+  // true if identical GET requests in flight are collapsed into a
+  // single backend request.
+  bool collapse;
   // Timeouts for backend connection.
   struct {
     ev_tstamp read;
@@ -692,6 +817,9 @@ struct TLSConfig {
   // true if forwarding requests included in TLS early data should not
   // be postponed until TLS handshake finishes.
   bool no_postpone_early_data;
+  // true if the kernel should encrypt and decrypt TLS records (kTLS)
+  // after handshake if possible.
+  bool ktls;
 };
 
 // custom error page
@@ -802,6 +930,15 @@ struct LoggingConfig {
     // Write accesslog when response headers are received from
     // backend, rather than response body is received and sent.
     bool write_early;
+    struct {
+      // The size of buffer which each thread appends lines to.
+      size_t buffer_size;
+      // Write accesslog in the dedicated thread.
+      bool enabled;
+      // true if a thread waits for the buffer space when it is full.
+      // Otherwise the line is dropped.
+      bool block_on_overflow;
+    } async;
   } access;
   struct {
     StringRef file;
@@ -850,7 +987,11 @@ struct DownstreamConfig {
         connections_per_frontend{0},
         request_buffer_size{0},
         response_buffer_size{0},
-        family{0} {}
+        family{0},
+        outlier{},
+        hedge{},
+        concurrency{},
+        collapse{} {}
 
   DownstreamConfig(const DownstreamConfig &) = delete;
   DownstreamConfig(DownstreamConfig &&) = delete;
@@ -884,6 +1025,60 @@ struct DownstreamConfig {
   // AF_INET6 or AF_UNSPEC.  This is ignored if backend connection
   // is made via Unix domain socket.
   int family;
+  // Passive outlier detection.  Backend addresses are evaluated
+  // every interval based on the outcome of the responses they
+  // served.  If interval is 0, outlier detection is disabled.
+  struct {
+    ev_tstamp interval;
+    // The base duration to eject outlier.  It is multiplied by the
+    // number of consecutive ejections.
+    ev_tstamp ejection_time;
+    // The percentage of 5xx responses and reset streams which makes
+    // backend address an outlier.
+    size_t error_rate;
+    // If the average latency of backend address is larger than this
+    // factor times the average latency of the other addresses, it is
+    // an outlier.  0 disables latency based detection.
+    size_t latency_factor;
+    // The minimum number of responses required to evaluate backend
+    // address.
+    size_t min_requests;
+    // The maximum percentage of backend addresses in a group which
+    // can be ejected at the same time.
+    size_t max_ejection;
+  } outlier;
+  // Request hedging.  It is enabled per backend group with "hedge"
+  // parameter.
+  struct {
+    // The minimum delay before a hedged request is sent.
+    ev_tstamp min_delay;
+    // The percentage of hedged requests relative to the requests
+    // eligible for hedging.
+    size_t budget;
+  } hedge;
+  // Adaptive concurrency limiting.  It is enabled per backend group
+  // with "max-concurrency" parameter.
+  struct {
+    // The value of retry-after header field sent with the response
+    // to the request rejected by the limit.  0 if the header field is
+    // not sent.
+    ev_tstamp retry_after;
+    // The lower bound of the concurrency limit.
+    size_t min_limit;
+  } concurrency;
+  // Collapsed forwarding.  It is enabled per backend group with
+  // "collapse" parameter.
+  struct {
+    // The request header field names which are included in the key
+    // of collapsed forwarding.
+    std::vector<StringRef> vary;
+    // The maximum time that a request waits for the response header
+    // of the collapsed request.
+    ev_tstamp timeout;
+    // The maximum number of requests which wait for a single
+    // collapsed request.
+    size_t max_waiters;
+  } collapse;
 };
 
 struct ConnectionConfig {
@@ -906,6 +1101,12 @@ struct ConnectionConfig {
       ev_tstamp write;
       ev_tstamp idle_read;
     } timeout;
+    // The granularity of the timer wheel which schedules read
+    // timeouts.  0 means libev timers are used.
+    ev_tstamp timer_wheel_tick;
+    // The duration after which the buffers of an idle frontend
+    // connection are released.  0 disables it.
+    ev_tstamp idle_release;
     struct {
       RateLimitConfig read;
       RateLimitConfig write;
@@ -946,6 +1147,10 @@ struct Config {
         conn{},
         api{},
         dns{},
+        worker_event{},
+        splice_relay{},
+        zerocopy_send{},
+        io_engine{IOEngine::LIBEV},
         config_revision{0},
         num_worker{0},
         padding{0},
@@ -979,6 +1184,35 @@ struct Config {
   ConnectionConfig conn;
   APIConfig api;
   DNSConfig dns;
+  struct {
+    // The maximum number of events which a worker processes in one
+    // event loop iteration.
+    size_t budget;
+    // The capacity of the lock-free queue which carries accepted
+    // connections to a worker.
+    size_t queue_size;
+  } worker_event;
+  struct {
+    // The minimum length of response body left to relay it with
+    // splice(2).
+    size_t min_length;
+    // true if response body is relayed with splice(2) when both
+    // frontend and backend are cleartext HTTP/1.1.
+    bool enabled;
+  } splice_relay;
+  struct {
+    // The minimum number of bytes in a single write to send them
+    // with MSG_ZEROCOPY.
+    size_t min_length;
+    // The maximum number of bytes per worker which have been sent
+    // with MSG_ZEROCOPY, and wait for completion.
+    size_t max_pinned;
+    // true if data are written to cleartext frontend connection with
+    // MSG_ZEROCOPY.
+    bool enabled;
+  } zerocopy_send;
+  // The I/O engine which workers use.
+  IOEngine io_engine;
   StringRef pid_file;
   StringRef conf_path;
   StringRef user;
@@ -1019,6 +1253,9 @@ void create_config();
 // generated by gennghttpxfun.py
 enum {
   SHRPX_OPTID_ACCEPT_PROXY_PROTOCOL,
+  SHRPX_OPTID_ACCESSLOG_ASYNC,
+  SHRPX_OPTID_ACCESSLOG_ASYNC_BUFFER_SIZE,
+  SHRPX_OPTID_ACCESSLOG_ASYNC_OVERFLOW,
   SHRPX_OPTID_ACCESSLOG_FILE,
   SHRPX_OPTID_ACCESSLOG_FORMAT,
   SHRPX_OPTID_ACCESSLOG_SYSLOG,
@@ -1031,9 +1268,16 @@ enum {
   SHRPX_OPTID_API_MAX_REQUEST_BODY,
   SHRPX_OPTID_BACKEND,
   SHRPX_OPTID_BACKEND_ADDRESS_FAMILY,
+  SHRPX_OPTID_BACKEND_COLLAPSE_MAX_WAITERS,
+  SHRPX_OPTID_BACKEND_COLLAPSE_TIMEOUT,
+  SHRPX_OPTID_BACKEND_COLLAPSE_VARY,
+  SHRPX_OPTID_BACKEND_CONCURRENCY_MIN_LIMIT,
+  SHRPX_OPTID_BACKEND_CONCURRENCY_RETRY_AFTER,
   SHRPX_OPTID_BACKEND_CONNECT_TIMEOUT,
   SHRPX_OPTID_BACKEND_CONNECTIONS_PER_FRONTEND,
   SHRPX_OPTID_BACKEND_CONNECTIONS_PER_HOST,
+  SHRPX_OPTID_BACKEND_HEDGE_BUDGET,
+  SHRPX_OPTID_BACKEND_HEDGE_MIN_DELAY,
   SHRPX_OPTID_BACKEND_HTTP_PROXY_URI,
   SHRPX_OPTID_BACKEND_HTTP1_CONNECTIONS_PER_FRONTEND,
   SHRPX_OPTID_BACKEND_HTTP1_CONNECTIONS_PER_HOST,
@@ -1052,6 +1296,12 @@ enum {
   SHRPX_OPTID_BACKEND_KEEP_ALIVE_TIMEOUT,
   SHRPX_OPTID_BACKEND_MAX_BACKOFF,
   SHRPX_OPTID_BACKEND_NO_TLS,
+  SHRPX_OPTID_BACKEND_OUTLIER_DETECTION_INTERVAL,
+  SHRPX_OPTID_BACKEND_OUTLIER_EJECTION_TIME,
+  SHRPX_OPTID_BACKEND_OUTLIER_ERROR_RATE,
+  SHRPX_OPTID_BACKEND_OUTLIER_LATENCY_FACTOR,
+  SHRPX_OPTID_BACKEND_OUTLIER_MAX_EJECTION,
+  SHRPX_OPTID_BACKEND_OUTLIER_MIN_REQUESTS,
   SHRPX_OPTID_BACKEND_READ_TIMEOUT,
   SHRPX_OPTID_BACKEND_REQUEST_BUFFER,
   SHRPX_OPTID_BACKEND_RESPONSE_BUFFER,
@@ -1098,10 +1348,12 @@ enum {
   SHRPX_OPTID_FRONTEND_HTTP2_SETTINGS_TIMEOUT,
   SHRPX_OPTID_FRONTEND_HTTP2_WINDOW_BITS,
   SHRPX_OPTID_FRONTEND_HTTP2_WINDOW_SIZE,
+  SHRPX_OPTID_FRONTEND_IDLE_RELEASE,
   SHRPX_OPTID_FRONTEND_KEEP_ALIVE_TIMEOUT,
   SHRPX_OPTID_FRONTEND_MAX_REQUESTS,
   SHRPX_OPTID_FRONTEND_NO_TLS,
   SHRPX_OPTID_FRONTEND_READ_TIMEOUT,
+  SHRPX_OPTID_FRONTEND_TIMER_WHEEL_TICK,
   SHRPX_OPTID_FRONTEND_WRITE_TIMEOUT,
   SHRPX_OPTID_HEADER_FIELD_BUFFER,
   SHRPX_OPTID_HOST_REWRITE,
@@ -1112,6 +1364,7 @@ enum {
   SHRPX_OPTID_IGNORE_PER_PATTERN_MRUBY_ERROR,
   SHRPX_OPTID_INCLUDE,
   SHRPX_OPTID_INSECURE,
+  SHRPX_OPTID_IO_ENGINE,
   SHRPX_OPTID_LISTENER_DISABLE_TIMEOUT,
   SHRPX_OPTID_LOG_LEVEL,
   SHRPX_OPTID_MAX_HEADER_FIELDS,
@@ -1147,6 +1400,8 @@ enum {
   SHRPX_OPTID_SERVER_NAME,
   SHRPX_OPTID_SINGLE_PROCESS,
   SHRPX_OPTID_SINGLE_THREAD,
+  SHRPX_OPTID_SPLICE_RELAY,
+  SHRPX_OPTID_SPLICE_RELAY_MIN_LENGTH,
   SHRPX_OPTID_STREAM_READ_TIMEOUT,
   SHRPX_OPTID_STREAM_WRITE_TIMEOUT,
   SHRPX_OPTID_STRIP_INCOMING_FORWARDED,
@@ -1155,6 +1410,7 @@ enum {
   SHRPX_OPTID_SYSLOG_FACILITY,
   SHRPX_OPTID_TLS_DYN_REC_IDLE_TIMEOUT,
   SHRPX_OPTID_TLS_DYN_REC_WARMUP_THRESHOLD,
+  SHRPX_OPTID_TLS_KTLS,
   SHRPX_OPTID_TLS_MAX_EARLY_DATA,
   SHRPX_OPTID_TLS_MAX_PROTO_VERSION,
   SHRPX_OPTID_TLS_MIN_PROTO_VERSION,
@@ -1182,6 +1438,8 @@ enum {
   SHRPX_OPTID_VERIFY_CLIENT,
   SHRPX_OPTID_VERIFY_CLIENT_CACERT,
   SHRPX_OPTID_VERIFY_CLIENT_TOLERATE_EXPIRED,
+  SHRPX_OPTID_WORKER_EVENT_BUDGET,
+  SHRPX_OPTID_WORKER_EVENT_QUEUE_SIZE,
   SHRPX_OPTID_WORKER_FRONTEND_CONNECTIONS,
   SHRPX_OPTID_WORKER_READ_BURST,
   SHRPX_OPTID_WORKER_READ_RATE,
@@ -1190,6 +1448,9 @@ enum {
   SHRPX_OPTID_WORKERS,
   SHRPX_OPTID_WRITE_BURST,
   SHRPX_OPTID_WRITE_RATE,
+  SHRPX_OPTID_ZEROCOPY_SEND,
+  SHRPX_OPTID_ZEROCOPY_SEND_MAX_PINNED,
+  SHRPX_OPTID_ZEROCOPY_SEND_MIN_LENGTH,
   SHRPX_OPTID_MAXIDX,
 };
 
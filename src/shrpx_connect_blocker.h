@@ -50,6 +50,11 @@ public:
   // timer and blocks connection establishment with exponential
   // backoff.
   void on_failure();
+  // Blocks connection establishment for |t| seconds regardless of the
+  // connection outcome.  This is used to eject backend address found
+  // to be an outlier.  If the connection is already blocked for longer
+  // than |t|, or peer is offline, this function does nothing.
+  void block(ev_tstamp t);
 
   size_t get_fail_count() const;
 
@@ -27,7 +27,14 @@
 #ifdef HAVE_UNISTD_H
 #  include <unistd.h>
 #endif // HAVE_UNISTD_H
+#ifdef HAVE_SYS_SOCKET_H
+#  include <sys/socket.h>
+#endif // HAVE_SYS_SOCKET_H
 #include <netinet/tcp.h>
+#include <fcntl.h>
+#ifdef HAVE_LINUX_TLS_H
+#  include <linux/tls.h>
+#endif // HAVE_LINUX_TLS_H
 
 #include <limits>
 
@@ -44,6 +51,13 @@ using namespace nghttp2;
 
 namespace shrpx {
 
+#ifdef SHRPX_KTLS
+namespace {
+constexpr uint8_t TLS_RECORD_TYPE_ALERT = 21;
+constexpr uint8_t TLS_RECORD_TYPE_APPLICATION_DATA = 23;
+} // namespace
+#endif // SHRPX_KTLS
+
 #if !LIBRESSL_2_7_API && !OPENSSL_1_1_API
 
 void *BIO_get_data(BIO *bio) { return bio->ptr; }
@@ -52,6 +66,20 @@ void BIO_set_init(BIO *bio, int init) { bio->init = init; }
 
 #endif // !LIBRESSL_2_7_API && !OPENSSL_1_1_API
 
+namespace {
+void rwtcb(WheelTimer *w) {
+  auto conn = static_cast<Connection *>(w->data);
+
+  // again_rt() only records the activity time while the timer is
+  // scheduled.  Reschedule the timer if there was activity since.
+  if (!conn->expired_rt()) {
+    return;
+  }
+
+  ev_invoke(conn->loop, &conn->rt, EV_TIMER);
+}
+} // namespace
+
 Connection::Connection(struct ev_loop *loop, int fd, SSL *ssl,
                        MemchunkPool *mcpool, ev_tstamp write_timeout,
                        ev_tstamp read_timeout,
@@ -62,6 +90,8 @@ Connection::Connection(struct ev_loop *loop, int fd, SSL *ssl,
                        ev_tstamp tls_dyn_rec_idle_timeout, Proto proto)
     : tls{DefaultMemchunks(mcpool), DefaultPeekMemchunks(mcpool),
           DefaultMemchunks(mcpool)},
+      rwt(rwtcb, this),
+      timer_wheel(nullptr),
       wlimit(loop, &wev, write_limit.rate, write_limit.burst),
       rlimit(loop, &rev, read_limit.rate, read_limit.burst, this),
       loop(loop),
@@ -88,6 +118,20 @@ Connection::Connection(struct ev_loop *loop, int fd, SSL *ssl,
   // set 0. to double field explicitly just in case
   tls.last_write_idle = 0.;
 
+#ifdef HAVE_IO_URING
+  uring.ring = nullptr;
+  uring.head = uring.tail = nullptr;
+  uring.buffered = 0;
+  uring.error = 0;
+  uring.paused = false;
+#endif // HAVE_IO_URING
+
+#ifdef HAVE_MSG_ZEROCOPY
+  zerocopy.ctx = nullptr;
+  zerocopy.next_seq = 0;
+  zerocopy.copied = false;
+#endif // HAVE_MSG_ZEROCOPY
+
   if (ssl) {
     set_ssl(ssl);
   }
@@ -126,7 +170,52 @@ void Connection::disconnect() {
     tls.reneg_started = false;
     tls.sct_requested = false;
     tls.early_data_finish = false;
+    tls.ktls_tx = false;
+    tls.ktls_rx = false;
+    tls.ktls_record_type = 0;
+  }
+
+#ifdef HAVE_IO_URING
+  if (uring.ring) {
+    // Cancel recv before closing fd, otherwise the in-flight request
+    // keeps the socket open.
+    uring.ring->stop(&uring.op);
+
+    auto mcpool = uring.ring->get_mcpool();
+    for (auto m = uring.head; m;) {
+      auto next = m->next;
+      mcpool->recycle(m);
+      m = next;
+    }
+
+    uring.ring = nullptr;
+    uring.head = uring.tail = nullptr;
+    uring.buffered = 0;
+    uring.error = 0;
+    uring.paused = false;
   }
+#endif // HAVE_IO_URING
+
+#ifdef HAVE_MSG_ZEROCOPY
+  if (zerocopy.ctx) {
+    if (!zerocopy.pins.empty()) {
+      zerocopy.ctx->reap(fd, zerocopy);
+    }
+
+    if (!zerocopy.pins.empty()) {
+      // The kernel still reads the pinned chunks.  Closing fd may
+      // discard the data which have not been sent yet, or we may
+      // reuse the chunks too early.  Zerocopy closes fd later.
+      shutdown(fd, SHUT_WR);
+      zerocopy.ctx->linger(fd, zerocopy);
+      fd = -1;
+    }
+
+    zerocopy.ctx = nullptr;
+    zerocopy.next_seq = 0;
+    zerocopy.copied = false;
+  }
+#endif // HAVE_MSG_ZEROCOPY
 
   if (fd != -1) {
     shutdown(fd, SHUT_WR);
@@ -136,7 +225,7 @@ void Connection::disconnect() {
 
   // Stop watchers here because they could be activated in
   // SSL_shutdown().
-  ev_timer_stop(loop, &rt);
+  stop_rt();
   ev_timer_stop(loop, &wt);
 
   rlimit.stopw();
@@ -167,6 +256,24 @@ int shrpx_bio_write(BIO *b, const char *buf, int len) {
 
   BIO_clear_retry_flags(b);
 
+  if (conn->tls.ktls_record_type) {
+    // The kernel encrypts the record, and it has to know the record
+    // type other than application data.
+    auto nwrite = conn->write_ktls_record(buf, len);
+    if (nwrite < 0) {
+      return -1;
+    }
+
+    if (nwrite == 0) {
+      BIO_set_retry_write(b);
+      return -1;
+    }
+
+    conn->tls.ktls_record_type = 0;
+
+    return nwrite;
+  }
+
   if (conn->tls.initial_handshake_done) {
     // After handshake finished, send |buf| of length |len| to the
     // socket directly.
@@ -244,6 +351,30 @@ long shrpx_bio_ctrl(BIO *b, int cmd, long num, void *ptr) {
   switch (cmd) {
   case BIO_CTRL_FLUSH:
     return 1;
+#ifdef SHRPX_KTLS
+  case SHRPX_BIO_CTRL_SET_KTLS: {
+    auto conn = static_cast<Connection *>(BIO_get_data(b));
+    return conn->enable_ktls(ptr, num);
+  }
+  case BIO_CTRL_GET_KTLS_SEND: {
+    auto conn = static_cast<Connection *>(BIO_get_data(b));
+    return conn->tls.ktls_tx;
+  }
+  case BIO_CTRL_GET_KTLS_RECV: {
+    auto conn = static_cast<Connection *>(BIO_get_data(b));
+    return conn->tls.ktls_rx;
+  }
+  case SHRPX_BIO_CTRL_SET_KTLS_TX_SEND_CTRL_MSG: {
+    auto conn = static_cast<Connection *>(BIO_get_data(b));
+    conn->tls.ktls_record_type = num;
+    return 0;
+  }
+  case SHRPX_BIO_CTRL_CLEAR_KTLS_TX_CTRL_MSG: {
+    auto conn = static_cast<Connection *>(BIO_get_data(b));
+    conn->tls.ktls_record_type = 0;
+    return 0;
+  }
+#endif // SHRPX_KTLS
   }
 
   return 0;
@@ -674,6 +805,13 @@ void Connection::start_tls_write_idle() {
 }
 
 ssize_t Connection::write_tls(const void *data, size_t len) {
+  if (tls.ktls_tx && tls.last_writelen == 0 &&
+      SSL_is_init_finished(tls.ssl)) {
+    // The kernel encrypts data.  The record size is also up to the
+    // kernel.
+    return write_clear(data, len);
+  }
+
   // SSL_write requires the same arguments (buf pointer and its
   // length) on SSL_ERROR_WANT_READ or SSL_ERROR_WANT_WRITE.
   // get_write_limit() may return smaller length than previously
@@ -752,6 +890,10 @@ ssize_t Connection::read_tls(void *data, size_t len) {
   }
 #endif // OPENSSL_1_1_1_API
 
+  if (tls.ktls_rx) {
+    return read_ktls(data, len);
+  }
+
   // SSL_read requires the same arguments (buf pointer and its
   // length) on SSL_ERROR_WANT_READ or SSL_ERROR_WANT_WRITE.
   // rlimit_.avail() or rlimit_.avail() may return different length
@@ -895,6 +1037,91 @@ ssize_t Connection::writev_clear(struct iovec *iov, int iovcnt) {
   return nwrite;
 }
 
+#ifdef HAVE_MSG_ZEROCOPY
+void Connection::enable_zerocopy(Zerocopy *zc) {
+  int val = 1;
+  if (setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &val, sizeof(val)) != 0) {
+    if (LOG_ENABLED(INFO)) {
+      auto error = errno;
+      LOG(INFO) << "zerocopy: setsockopt() SO_ZEROCOPY failed: errno="
+                << error;
+    }
+    return;
+  }
+
+  zerocopy.ctx = zc;
+}
+
+ssize_t Connection::writev_zerocopy(struct iovec *iov, int iovcnt,
+                                    Memchunk16K *head) {
+  auto zc = zerocopy.ctx;
+
+  if (!zerocopy.pins.empty()) {
+    zc->reap(fd, zerocopy);
+  }
+
+  if (zerocopy.copied) {
+    return writev_clear(iov, iovcnt);
+  }
+
+  iovcnt = limit_iovec(iov, iovcnt, wlimit.avail());
+  if (iovcnt == 0) {
+    return 0;
+  }
+
+  size_t len = 0;
+  for (int i = 0; i < iovcnt; ++i) {
+    len += iov[i].iov_len;
+  }
+
+  if (!zc->should_send(len)) {
+    return writev_clear(iov, iovcnt);
+  }
+
+  struct msghdr msg {};
+  msg.msg_iov = iov;
+  msg.msg_iovlen = iovcnt;
+
+  ssize_t nwrite;
+  while ((nwrite = sendmsg(fd, &msg, MSG_ZEROCOPY)) == -1 && errno == EINTR)
+    ;
+  if (nwrite == -1) {
+    switch (errno) {
+    case EAGAIN:
+#  if EAGAIN != EWOULDBLOCK
+    case EWOULDBLOCK:
+#  endif // EAGAIN != EWOULDBLOCK
+      wlimit.startw();
+      ev_timer_again(loop, &wt);
+      return 0;
+    case ENOBUFS:
+      // Too many notifications are outstanding (optmem_max).
+      return writev_clear(iov, iovcnt);
+    default:
+      return SHRPX_ERR_NETWORK;
+    }
+  }
+
+  zc->pin(zerocopy, head, nwrite);
+
+  wlimit.drain(nwrite);
+
+  if (ev_is_active(&wt)) {
+    ev_timer_again(loop, &wt);
+  }
+
+  return nwrite;
+}
+
+void Connection::reap_zerocopy() {
+  if (zerocopy.pins.empty()) {
+    return;
+  }
+
+  zerocopy.ctx->reap(fd, zerocopy);
+}
+#endif // HAVE_MSG_ZEROCOPY
+
 ssize_t Connection::read_clear(void *data, size_t len) {
   len = std::min(len, rlimit.avail());
   if (len == 0) {
@@ -920,6 +1147,413 @@ ssize_t Connection::read_clear(void *data, size_t len) {
   return nread;
 }
 
+bool Connection::enable_ktls(const void *crypto_info, bool tx) {
+#ifdef SHRPX_KTLS
+  // OpenSSL handles TLSv1.2 ChangeCipherSpec and Finished around
+  // the key change in a way which does not fit our buffering, and
+  // we cannot check HTTP/2 requirement before sending Finished.
+  // Just use kTLS for TLSv1.3.
+  if (SSL_version(tls.ssl) != TLS1_3_VERSION) {
+    return false;
+  }
+
+  if (tx) {
+    if (tls.ktls_tx) {
+      // The kernel cannot change the key in the middle of connection
+      // (e.g., KeyUpdate).  The peer would not be able to decrypt
+      // the data written after this.
+      if (LOG_ENABLED(INFO)) {
+        LOG(INFO) << "tls: kTLS cannot update key; close connection";
+      }
+      shutdown(fd, SHUT_RDWR);
+      return false;
+    }
+
+    // The handshake may be replayed with the cached session, and
+    // buffered data may be discarded.
+    if (tls.handshake_state == TLSHandshakeState::WAIT_FOR_SESSION_CACHE) {
+      return false;
+    }
+  } else if (!tls.server_handshake || tls.ktls_rx || tls.rbuf.rleft()) {
+    // The data which OpenSSL has not read yet are encrypted with the
+    // key.  Client side connection receives NewSessionTicket after
+    // handshake, which we cannot process without OpenSSL.
+    return false;
+  }
+
+  auto info = static_cast<const struct tls_crypto_info *>(crypto_info);
+  size_t infolen;
+
+  switch (info->cipher_type) {
+  case TLS_CIPHER_AES_GCM_128:
+    infolen = sizeof(struct tls12_crypto_info_aes_gcm_128);
+    break;
+  case TLS_CIPHER_AES_GCM_256:
+    infolen = sizeof(struct tls12_crypto_info_aes_gcm_256);
+    break;
+#  ifdef TLS_CIPHER_AES_CCM_128
+  case TLS_CIPHER_AES_CCM_128:
+    infolen = sizeof(struct tls12_crypto_info_aes_ccm_128);
+    break;
+#  endif // TLS_CIPHER_AES_CCM_128
+#  ifdef TLS_CIPHER_CHACHA20_POLY1305
+  case TLS_CIPHER_CHACHA20_POLY1305:
+    infolen = sizeof(struct tls12_crypto_info_chacha20_poly1305);
+    break;
+#  endif // TLS_CIPHER_CHACHA20_POLY1305
+  default:
+    return false;
+  }
+
+  if (setsockopt(fd, SOL_TCP, TCP_ULP, "tls", sizeof("tls")) != 0 &&
+      errno != EEXIST) {
+    if (LOG_ENABLED(INFO)) {
+      auto error = errno;
+      LOG(INFO) << "tls: kTLS is not available: errno=" << error;
+    }
+    return false;
+  }
+
+  if (tx) {
+    // The records encrypted by OpenSSL must go out before the kernel
+    // starts encrypting data.
+    while (tls.wbuf.rleft()) {
+      std::array<struct iovec, 4> iov;
+      auto iovcnt = tls.wbuf.riovec(iov.data(), iov.size());
+      auto nwrite = writev_clear(iov.data(), iovcnt);
+      if (nwrite <= 0) {
+        return false;
+      }
+      tls.wbuf.drain(nwrite);
+    }
+
+    if (tls.server_handshake &&
+        tls.handshake_state != TLSHandshakeState::WRITE_STARTED) {
+      tls.handshake_state = TLSHandshakeState::WRITE_STARTED;
+      tls.rbuf.disable_peek(true);
+    }
+  }
+
+  if (setsockopt(fd, SOL_TLS, tx ? TLS_TX : TLS_RX, info, infolen) != 0) {
+    if (LOG_ENABLED(INFO)) {
+      auto error = errno;
+      LOG(INFO) << "tls: could not set kTLS " << (tx ? "TX" : "RX")
+                << " key: errno=" << error;
+    }
+    return false;
+  }
+
+  if (LOG_ENABLED(INFO)) {
+    LOG(INFO) << "tls: kTLS " << (tx ? "TX" : "RX") << " enabled";
+  }
+
+  if (tx) {
+    tls.ktls_tx = true;
+  } else {
+    tls.ktls_rx = true;
+  }
+
+  return true;
+#else  // !SHRPX_KTLS
+  return false;
+#endif // !SHRPX_KTLS
+}
+
+ssize_t Connection::write_ktls_record(const void *data, size_t len) {
+#ifdef SHRPX_KTLS
+  // Send the records queued before this one first.
+  while (tls.wbuf.rleft()) {
+    std::array<struct iovec, 4> iov;
+    auto iovcnt = tls.wbuf.riovec(iov.data(), iov.size());
+    auto nwrite = writev_clear(iov.data(), iovcnt);
+    if (nwrite <= 0) {
+      return nwrite;
+    }
+    tls.wbuf.drain(nwrite);
+  }
+
+  union {
+    std::array<uint8_t, CMSG_SPACE(sizeof(uint8_t))> buf;
+    struct cmsghdr align;
+  } cmsgbuf{};
+
+  struct iovec iov {
+    const_cast<void *>(data), len
+  };
+  struct msghdr msg {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = cmsgbuf.buf.data();
+  msg.msg_controllen = cmsgbuf.buf.size();
+
+  auto cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_TLS;
+  cmsg->cmsg_type = TLS_SET_RECORD_TYPE;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(uint8_t));
+  *CMSG_DATA(cmsg) = tls.ktls_record_type;
+
+  ssize_t nwrite;
+  while ((nwrite = sendmsg(fd, &msg, 0)) == -1 && errno == EINTR)
+    ;
+  if (nwrite == -1) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      wlimit.startw();
+      ev_timer_again(loop, &wt);
+      return 0;
+    }
+    return SHRPX_ERR_NETWORK;
+  }
+
+  // The rest would be sent as application data.
+  if (static_cast<size_t>(nwrite) != len) {
+    return SHRPX_ERR_NETWORK;
+  }
+
+  // Control records are small, and they cannot be split.  Just
+  // account them.
+  wlimit.drain(nwrite);
+
+  return nwrite;
+#else  // !SHRPX_KTLS
+  return SHRPX_ERR_NETWORK;
+#endif // !SHRPX_KTLS
+}
+
+ssize_t Connection::read_ktls(void *data, size_t len) {
+#ifdef SHRPX_KTLS
+  len = std::min(len, rlimit.avail());
+  if (len == 0) {
+    return 0;
+  }
+
+  union {
+    std::array<uint8_t, CMSG_SPACE(sizeof(uint8_t))> buf;
+    struct cmsghdr align;
+  } cmsgbuf{};
+
+  struct iovec iov {
+    data, len
+  };
+  struct msghdr msg {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = cmsgbuf.buf.data();
+  msg.msg_controllen = cmsgbuf.buf.size();
+
+  ssize_t nread;
+  while ((nread = recvmsg(fd, &msg, 0)) == -1 && errno == EINTR)
+    ;
+  if (nread == -1) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      return 0;
+    }
+    return SHRPX_ERR_NETWORK;
+  }
+
+  if (nread == 0) {
+    return SHRPX_ERR_EOF;
+  }
+
+  auto cmsg = CMSG_FIRSTHDR(&msg);
+  if (cmsg && cmsg->cmsg_level == SOL_TLS &&
+      cmsg->cmsg_type == TLS_GET_RECORD_TYPE) {
+    auto record_type = *CMSG_DATA(cmsg);
+    if (record_type != TLS_RECORD_TYPE_APPLICATION_DATA) {
+      auto p = static_cast<uint8_t *>(data);
+      // close_notify
+      if (record_type == TLS_RECORD_TYPE_ALERT && nread == 2 && p[1] == 0) {
+        return SHRPX_ERR_EOF;
+      }
+
+      // Other alerts and post-handshake messages (e.g., KeyUpdate)
+      // need OpenSSL, which no longer reads from the socket.
+      if (LOG_ENABLED(INFO)) {
+        LOG(INFO) << "tls: unexpected record type "
+                  << static_cast<uint32_t>(record_type) << " from kTLS";
+      }
+      return SHRPX_ERR_NETWORK;
+    }
+  }
+
+  rlimit.drain(nread);
+
+  return nread;
+#else  // !SHRPX_KTLS
+  return SHRPX_ERR_NETWORK;
+#endif // !SHRPX_KTLS
+}
+
+ssize_t Connection::splice_write_clear(int pipefd, size_t len) {
+#ifdef HAVE_SPLICE
+  len = std::min(len, wlimit.avail());
+  if (len == 0) {
+    return 0;
+  }
+
+  ssize_t nwrite;
+  while ((nwrite = splice(pipefd, nullptr, fd, nullptr, len,
+                          SPLICE_F_MOVE | SPLICE_F_NONBLOCK)) == -1 &&
+         errno == EINTR)
+    ;
+  if (nwrite == -1) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      wlimit.startw();
+      ev_timer_again(loop, &wt);
+      return 0;
+    }
+    return SHRPX_ERR_NETWORK;
+  }
+
+  wlimit.drain(nwrite);
+
+  if (ev_is_active(&wt)) {
+    ev_timer_again(loop, &wt);
+  }
+
+  return nwrite;
+#else  // !HAVE_SPLICE
+  return SHRPX_ERR_NETWORK;
+#endif // !HAVE_SPLICE
+}
+
+ssize_t Connection::splice_read_clear(int pipefd, size_t len) {
+#ifdef HAVE_SPLICE
+  len = std::min(len, rlimit.avail());
+  if (len == 0) {
+    return 0;
+  }
+
+  ssize_t nread;
+  while ((nread = splice(fd, nullptr, pipefd, nullptr, len,
+                         SPLICE_F_MOVE | SPLICE_F_NONBLOCK)) == -1 &&
+         errno == EINTR)
+    ;
+  if (nread == -1) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      return 0;
+    }
+    return SHRPX_ERR_NETWORK;
+  }
+
+  if (nread == 0) {
+    return SHRPX_ERR_EOF;
+  }
+
+  rlimit.drain(nread);
+
+  return nread;
+#else  // !HAVE_SPLICE
+  return SHRPX_ERR_NETWORK;
+#endif // !HAVE_SPLICE
+}
+
+#ifdef HAVE_IO_URING
+namespace {
+// io_uring stops receiving data when the received data which have not
+// been read reach this size.
+constexpr size_t MAX_URING_RECV_BUFFERED = 64_k;
+} // namespace
+
+namespace {
+void uring_recvcb(IOUring *ring, IOUringOp *op, int res, Memchunk16K *m,
+                  bool more) {
+  auto conn = static_cast<Connection *>(op->data);
+  conn->on_uring_recv(res, m, more);
+}
+} // namespace
+
+void Connection::start_uring_recv(IOUring *ring) {
+  // Read readiness is no longer watched.  Since RateLimit does not
+  // start a watcher which has negative fd, |rev| only receives the
+  // events fed by on_uring_recv.
+  rlimit.stopw();
+  ev_io_set(&rev, -1, EV_READ);
+
+  io_uring_op_init(&uring.op, uring_recvcb, this, fd, IOUringOpType::RECV);
+  uring.ring = ring;
+
+  ring->start(&uring.op);
+}
+
+void Connection::on_uring_recv(int res, Memchunk16K *m, bool more) {
+  if (m) {
+    if (uring.tail) {
+      uring.tail->next = m;
+    } else {
+      uring.head = m;
+    }
+    uring.tail = m;
+    m->next = nullptr;
+
+    uring.buffered += m->len();
+
+    if (!uring.paused && uring.buffered >= MAX_URING_RECV_BUFFERED) {
+      uring.paused = true;
+      uring.ring->cancel(&uring.op);
+    }
+  } else if (res == 0) {
+    uring.error = SHRPX_ERR_EOF;
+  } else if (res != -ENOBUFS && res != -ECANCELED) {
+    // -ENOBUFS means that the provided buffers have run out.  They
+    // have been refilled by now.  -ECANCELED is the result of pause.
+    uring.error = SHRPX_ERR_NETWORK;
+  }
+
+  if (!more && !uring.error && !uring.paused) {
+    uring.ring->start(&uring.op);
+  }
+
+  if (m || uring.error) {
+    ev_feed_event(loop, &rev, EV_READ);
+  }
+}
+
+ssize_t Connection::read_uring(DefaultMemchunkBuffer &buf) {
+  auto m = uring.head;
+  if (!m) {
+    return uring.error;
+  }
+
+  size_t n;
+
+  if (!buf.chunk_avail() || buf.rleft() == 0) {
+    uring.head = m->next;
+    if (!uring.head) {
+      uring.tail = nullptr;
+    }
+
+    buf.release_chunk();
+    buf.chunk = m;
+    m->next = nullptr;
+
+    n = m->len();
+  } else {
+    n = buf.write(m->pos, m->len());
+    m->pos += n;
+
+    if (m->len() == 0) {
+      uring.head = m->next;
+      if (!uring.head) {
+        uring.tail = nullptr;
+      }
+
+      uring.ring->get_mcpool()->recycle(m);
+    }
+  }
+
+  uring.buffered -= n;
+
+  if (uring.paused && uring.buffered < MAX_URING_RECV_BUFFERED) {
+    uring.paused = false;
+    // If cancellation is still in flight, recv is restarted when it
+    // completes.
+    uring.ring->start(&uring.op);
+  }
+
+  return n;
+}
+#endif // HAVE_IO_URING
+
 void Connection::handle_tls_pending_read() {
   if (!ev_is_active(&rev)) {
     return;
@@ -994,15 +1628,27 @@ int Connection::get_tcp_hint(TCPHint *hint) const {
 
 void Connection::again_rt(ev_tstamp t) {
   read_timeout = t;
+  last_read = ev_now(loop);
+  if (timer_wheel) {
+    timer_wheel->start(&rwt, t);
+    return;
+  }
   rt.repeat = t;
   ev_timer_again(loop, &rt);
-  last_read = ev_now(loop);
 }
 
 void Connection::again_rt() {
+  last_read = ev_now(loop);
+  if (timer_wheel) {
+    // The deadline is checked again when the timer expires, so we
+    // just record the activity time here.
+    if (!rwt.slot) {
+      timer_wheel->start(&rwt, read_timeout);
+    }
+    return;
+  }
   rt.repeat = read_timeout;
   ev_timer_again(loop, &rt);
-  last_read = ev_now(loop);
 }
 
 bool Connection::expired_rt() {
@@ -1010,9 +1656,30 @@ bool Connection::expired_rt() {
   if (delta < 1e-9) {
     return true;
   }
+  if (timer_wheel) {
+    timer_wheel->start(&rwt, delta);
+    return false;
+  }
   rt.repeat = delta;
   ev_timer_again(loop, &rt);
   return false;
 }
 
+void Connection::stop_rt() {
+  if (timer_wheel) {
+    timer_wheel->stop(&rwt);
+    return;
+  }
+  ev_timer_stop(loop, &rt);
+}
+
+bool Connection::rt_active() const {
+  if (timer_wheel) {
+    return rwt.slot != nullptr;
+  }
+  return ev_is_active(&rt);
+}
+
+void Connection::use_timer_wheel(TimerWheel *wheel) { timer_wheel = wheel; }
+
 } // namespace shrpx
@@ -35,10 +35,34 @@
 
 #include "shrpx_rate_limit.h"
 #include "shrpx_error.h"
+#include "shrpx_io_uring.h"
+#include "shrpx_zerocopy.h"
+#include "shrpx_timer_wheel.h"
 #include "memchunk.h"
 
+// OpenSSL 3.x drives kTLS of the underlying BIO with BIO controls.
+// Some of them are internal to OpenSSL, and their values below have
+// been checked against OpenSSL 3.x only.
+#if defined(HAVE_LINUX_TLS_H) && defined(SSL_OP_ENABLE_KTLS) &&               \
+    OPENSSL_VERSION_NUMBER >= 0x30000000L &&                                   \
+    OPENSSL_VERSION_NUMBER < 0x40000000L
+#  define SHRPX_KTLS 1
+#endif // HAVE_LINUX_TLS_H && SSL_OP_ENABLE_KTLS && OpenSSL 3.x
+
 namespace shrpx {
 
+#ifdef SHRPX_KTLS
+// The internal controls are numbered around the public
+// BIO_CTRL_GET_KTLS_SEND and BIO_CTRL_GET_KTLS_RECV.  If the public
+// ones move, the internal ones have probably moved too.
+static_assert(BIO_CTRL_GET_KTLS_SEND == 73 && BIO_CTRL_GET_KTLS_RECV == 76,
+              "OpenSSL kTLS BIO controls have changed");
+
+constexpr int SHRPX_BIO_CTRL_SET_KTLS = 72;
+constexpr int SHRPX_BIO_CTRL_SET_KTLS_TX_SEND_CTRL_MSG = 74;
+constexpr int SHRPX_BIO_CTRL_CLEAR_KTLS_TX_CTRL_MSG = 75;
+#endif // SHRPX_KTLS
+
 struct MemcachedRequest;
 
 namespace tls {
@@ -82,6 +106,15 @@ struct TLSConnection {
   // This value is also true if this is client side connection for
   // convenience.
   bool early_data_finish;
+  // true if the kernel encrypts the data written to the socket
+  // (kTLS).  The data must be written with write_clear or
+  // writev_clear instead of SSL_write.
+  bool ktls_tx;
+  // true if the kernel decrypts the data read from the socket.
+  bool ktls_rx;
+  // The TLS record type of the next write by OpenSSL if it is not
+  // application data, and ktls_tx is true.  Otherwise 0.
+  uint8_t ktls_record_type;
 };
 
 struct TCPHint {
@@ -89,6 +122,25 @@ struct TCPHint {
   uint32_t rwin;
 };
 
+#ifdef HAVE_IO_URING
+// UringRecv is the state of receiving data through io_uring.
+struct UringRecv {
+  IOUringOp op;
+  // Non-null if data is received through io_uring.
+  IOUring *ring;
+  // The received data which have not been read yet.  They are linked
+  // through Memchunk::next.
+  Memchunk16K *head, *tail;
+  // The number of bytes in the chunks above.
+  size_t buffered;
+  // SHRPX_ERR_EOF or SHRPX_ERR_NETWORK if recv has been terminated by
+  // EOF or error respectively.  Otherwise 0.
+  int error;
+  // true if recv has been canceled because too much data is buffered.
+  bool paused;
+};
+#endif // HAVE_IO_URING
+
 template <typename T> using EVCb = void (*)(struct ev_loop *, T *, int);
 
 using IOCb = EVCb<ev_io>;
@@ -136,9 +188,54 @@ struct Connection {
   ssize_t write_clear(const void *data, size_t len);
   ssize_t writev_clear(struct iovec *iov, int iovcnt);
   ssize_t read_clear(void *data, size_t len);
+  // Moves at most |len| bytes from the pipe |pipefd| to fd.
+  ssize_t splice_write_clear(int pipefd, size_t len);
+  // Moves at most |len| bytes from fd to the pipe |pipefd|.
+  ssize_t splice_read_clear(int pipefd, size_t len);
 
   void handle_tls_pending_read();
 
+  // Hands the traffic keys of one direction to the kernel.
+  // |crypto_info| points to struct tls12_crypto_info_* given by
+  // OpenSSL.  This function returns true if the kernel takes over
+  // the direction.  If it returns false, OpenSSL keeps encrypting or
+  // decrypting records in userspace.
+  bool enable_ktls(const void *crypto_info, bool tx);
+  // Writes |data| of length |len| as a single TLS record of type
+  // tls.ktls_record_type through kTLS.  The return value is the same
+  // as write_clear.
+  ssize_t write_ktls_record(const void *data, size_t len);
+  // Reads application data decrypted by kTLS.  The return value is
+  // the same as read_clear.
+  ssize_t read_ktls(void *data, size_t len);
+
+#ifdef HAVE_IO_URING
+  // Starts receiving data through |ring| instead of |rev|.  After
+  // this call, |rev| is only used to notify that the data has
+  // arrived, and read_uring must be used to read data.
+  void start_uring_recv(IOUring *ring);
+  // Moves the data received through io_uring to |buf|.  If |buf| has
+  // no data, its buffer is replaced with the received one without
+  // copying.  The return value is the same as read_clear.
+  ssize_t read_uring(DefaultMemchunkBuffer &buf);
+  void on_uring_recv(int res, Memchunk16K *m, bool more);
+#endif // HAVE_IO_URING
+
+#ifdef HAVE_MSG_ZEROCOPY
+  // Enables MSG_ZEROCOPY on fd.  Large writes through
+  // writev_zerocopy are sent without copying if it succeeds.
+  void enable_zerocopy(Zerocopy *zc);
+  // Writes |iov| of length |iovcnt| like writev_clear.  |iov| must be
+  // filled with the chunks starting at |head| in order.  If the data
+  // are sent with MSG_ZEROCOPY, these chunks are pinned until the
+  // kernel notifies completion.
+  ssize_t writev_zerocopy(struct iovec *iov, int iovcnt, Memchunk16K *head);
+  // Processes completion notifications of MSG_ZEROCOPY.  This must be
+  // called when fd gets readable or writable, otherwise the pending
+  // notifications keep the event loop busy.
+  void reap_zerocopy();
+#endif // HAVE_MSG_ZEROCOPY
+
   void set_ssl(SSL *ssl);
 
   int get_tcp_hint(TCPHint *hint) const;
@@ -153,12 +250,29 @@ struct Connection {
   void again_rt();
   // Returns true if read timer expired.
   bool expired_rt();
+  // Stops read timer.
+  void stop_rt();
+  // Returns true if read timer is running.
+  bool rt_active() const;
+  // Schedules read timer in |wheel| instead of libev.  When it
+  // expires, the callback of |rt| is invoked as if |rt| expired.
+  // This must be called before read timer is started.
+  void use_timer_wheel(TimerWheel *wheel);
 
   TLSConnection tls;
+#ifdef HAVE_IO_URING
+  UringRecv uring;
+#endif // HAVE_IO_URING
+#ifdef HAVE_MSG_ZEROCOPY
+  ZerocopySend zerocopy;
+#endif // HAVE_MSG_ZEROCOPY
   ev_io wev;
   ev_io rev;
   ev_timer wt;
   ev_timer rt;
+  // Read timer scheduled in |timer_wheel| if it is not nullptr.
+  WheelTimer rwt;
+  TimerWheel *timer_wheel;
   RateLimit wlimit;
   RateLimit rlimit;
   struct ev_loop *loop;
@@ -47,6 +47,7 @@
 #include "shrpx_log.h"
 #include "util.h"
 #include "template.h"
+#include "xsi_strerror.h"
 
 using namespace nghttp2;
 
@@ -122,6 +123,7 @@ ConnectionHandler::ConnectionHandler(struct ev_loop *loop, std::mt19937 &gen)
       tls_ticket_key_memcached_fail_count_(0),
       worker_round_robin_cnt_(get_config()->api.enabled ? 1 : 0),
       graceful_shutdown_(false),
+      share_downstream_health_(false),
       enable_acceptor_on_ocsp_completion_(false) {
   ev_timer_init(&disable_acceptor_timer_, acceptor_disable_cb, 0., 0.);
   disable_acceptor_timer_.data = this;
@@ -165,6 +167,7 @@ ConnectionHandler::~ConnectionHandler() {
 
   // Free workers before destroying ev_loop
   workers_.clear();
+  health_worker_.reset();
 
   for (auto loop : worker_loops_) {
     ev_loop_destroy(loop);
@@ -186,6 +189,10 @@ void ConnectionHandler::worker_reopen_log_files() {
   for (auto &worker : workers_) {
     worker->send(wev);
   }
+
+  if (health_worker_) {
+    health_worker_->send(wev);
+  }
 }
 
 void ConnectionHandler::worker_replace_downstream(
@@ -198,6 +205,78 @@ void ConnectionHandler::worker_replace_downstream(
   for (auto &worker : workers_) {
     worker->send(wev);
   }
+
+  if (health_worker_) {
+    health_worker_->send(wev);
+  }
+}
+
+void ConnectionHandler::remove_unused_downstream_endpoints() {
+  std::lock_guard<std::mutex> g(downstream_endpoints_mu_);
+
+  for (auto it = std::begin(downstream_endpoints_);
+       it != std::end(downstream_endpoints_);) {
+    if ((*it).second.expired()) {
+      it = downstream_endpoints_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+std::shared_ptr<DownstreamEndpoint>
+ConnectionHandler::get_downstream_endpoint(const DownstreamAddr &addr) {
+  auto key = DownstreamEndpointKey{
+      std::string{std::begin(addr.host), std::end(addr.host)},
+      std::string{std::begin(addr.sni), std::end(addr.sni)},
+      addr.proto,
+      addr.port,
+      addr.host_unix,
+      addr.tls,
+      addr.dns};
+
+  std::lock_guard<std::mutex> g(downstream_endpoints_mu_);
+
+  auto &ent = downstream_endpoints_[std::move(key)];
+
+  auto endpoint = ent.lock();
+  if (!endpoint) {
+    endpoint = std::make_shared<DownstreamEndpoint>();
+    endpoint->conn_handler = this;
+    endpoint->num_connections = 0;
+    endpoint->exhausted = false;
+    endpoint->reclaim = false;
+    endpoint->offline = false;
+    endpoint->share_health = share_downstream_health_;
+
+    ent = endpoint;
+  }
+
+  return endpoint;
+}
+
+void ConnectionHandler::worker_update_downstream_health() {
+  WorkerEvent wev{};
+
+  wev.type = WorkerEventType::UPDATE_DOWNSTREAM_HEALTH;
+
+  for (auto &worker : workers_) {
+    worker->send(wev);
+  }
+
+  if (health_worker_) {
+    health_worker_->send(wev);
+  }
+}
+
+void ConnectionHandler::worker_reclaim_downstream_connection() {
+  WorkerEvent wev{};
+
+  wev.type = WorkerEventType::RECLAIM_DOWNSTREAM_CONNECTION;
+
+  for (auto &worker : workers_) {
+    worker->send(wev);
+  }
 }
 
 int ConnectionHandler::create_single_worker() {
@@ -274,6 +353,10 @@ int ConnectionHandler::create_worker_thread(size_t num) {
   auto &tlsconf = config->tls;
   auto &apiconf = config->api;
 
+  // Backends are probed by a dedicated worker, instead of each worker
+  // probing the same backend on its own.
+  share_downstream_health_ = num > 1;
+
   // We have dedicated worker for API request processing.
   if (apiconf.enabled) {
     ++num;
@@ -306,21 +389,83 @@ int ConnectionHandler::create_worker_thread(size_t num) {
     }
 #  endif // HAVE_MRUBY
 
-    workers_.push_back(std::move(worker));
-    worker_loops_.push_back(loop);
+    add_worker(std::move(worker));
 
     LLOG(NOTICE, this) << "Created worker thread #" << workers_.size() - 1;
   }
 
+  if (share_downstream_health_) {
+    auto loop = ev_loop_new(config->ev_loop_flags);
+
+    set_health_worker(std::make_unique<Worker>(
+        loop, sv_ssl_ctx, cl_ssl_ctx, session_cache_ssl_ctx, cert_tree_.get(),
+        ticket_keys_, this, config->conn.downstream));
+
+    LLOG(NOTICE, this) << "Created health check worker thread";
+  }
+
+  for (auto &addr : config->conn.listener.addrs) {
+    if (addr.reuseport) {
+      setup_reuseport_acceptor(addr);
+    }
+  }
+
   for (auto &worker : workers_) {
     worker->run_async();
   }
 
+  if (health_worker_) {
+    health_worker_->run_async();
+  }
+
 #endif // NOTHREADS
 
   return 0;
 }
 
+void ConnectionHandler::setup_reuseport_acceptor(const UpstreamAddr &faddr) {
+  // The dedicated API worker never accepts the connection for this
+  // address.
+  auto first = std::begin(workers_);
+  if (get_config()->api.enabled) {
+    ++first;
+  }
+
+  auto nworkers = static_cast<size_t>(std::end(workers_) - first);
+
+  if (faddr.reuseport_fds.size() + 1 != nworkers) {
+    LOG(WARN) << "SO_REUSEPORT listeners for " << faddr.hostport
+              << " are not available; accept connections in the main "
+                 "thread instead";
+
+    auto h = std::make_unique<AcceptHandler>(&faddr, this);
+    if (enable_acceptor_on_ocsp_completion_) {
+      h->disable();
+    }
+
+    add_acceptor(std::move(h));
+
+    return;
+  }
+
+  auto fd_it = std::begin(faddr.reuseport_fds);
+  for (auto it = first; it != std::end(workers_); ++it) {
+    auto &worker = *it;
+
+    auto fd = it == first ? faddr.fd : *fd_it++;
+
+    auto h = std::make_unique<AcceptHandler>(&faddr, worker.get(), fd);
+    if (enable_acceptor_on_ocsp_completion_) {
+      h->disable();
+    }
+
+    worker->add_acceptor(std::move(h));
+  }
+
+  LOG(NOTICE) << "Listening on " << faddr.hostport << " with " << nworkers
+              << " SO_REUSEPORT sockets";
+}
+
 void ConnectionHandler::join_worker() {
 #ifndef NOTHREADS
   int n = 0;
@@ -337,6 +482,13 @@ void ConnectionHandler::join_worker() {
     }
     ++n;
   }
+
+  if (health_worker_) {
+    health_worker_->wait();
+    if (LOG_ENABLED(INFO)) {
+      LLOG(INFO, this) << "Health check worker thread joined";
+    }
+  }
 #endif // NOTHREADS
 }
 
@@ -356,6 +508,10 @@ void ConnectionHandler::graceful_shutdown_worker() {
     worker->send(wev);
   }
 
+  if (health_worker_) {
+    health_worker_->send(wev);
+  }
+
 #ifndef NOTHREADS
   ev_async_start(loop_, &thread_join_asyncev_);
 
@@ -429,14 +585,7 @@ int ConnectionHandler::handle_connection(int fd, sockaddr *addr, int addrlen,
     }
   }
 
-  WorkerEvent wev{};
-  wev.type = WorkerEventType::NEW_CONNECTION;
-  wev.client_fd = fd;
-  memcpy(&wev.client_addr, addr, addrlen);
-  wev.client_addrlen = addrlen;
-  wev.faddr = faddr;
-
-  worker->send(wev);
+  worker->send_connection(fd, addr, addrlen, faddr);
 
   return 0;
 }
@@ -449,6 +598,29 @@ Worker *ConnectionHandler::get_single_worker() const {
   return single_worker_.get();
 }
 
+const std::vector<std::unique_ptr<Worker>> &
+ConnectionHandler::get_workers() const {
+  return workers_;
+}
+
+void ConnectionHandler::add_worker(std::unique_ptr<Worker> worker) {
+  worker_loops_.push_back(worker->get_loop());
+  workers_.push_back(std::move(worker));
+}
+
+void ConnectionHandler::set_health_worker(std::unique_ptr<Worker> worker) {
+  assert(!health_worker_);
+
+  worker->set_health_check_worker(true);
+
+  worker_loops_.push_back(worker->get_loop());
+  health_worker_ = std::move(worker);
+}
+
+Worker *ConnectionHandler::get_health_worker() const {
+  return health_worker_.get();
+}
+
 void ConnectionHandler::add_acceptor(std::unique_ptr<AcceptHandler> h) {
   acceptors_.push_back(std::move(h));
 }
@@ -484,6 +656,15 @@ void ConnectionHandler::accept_pending_connection() {
   }
 }
 
+void ConnectionHandler::enable_worker_acceptor() {
+  WorkerEvent wev{};
+  wev.type = WorkerEventType::ENABLE_ACCEPTOR;
+
+  for (auto &worker : workers_) {
+    worker->send(wev);
+  }
+}
+
 void ConnectionHandler::set_ticket_keys(
     std::shared_ptr<TicketKeys> ticket_keys) {
   ticket_keys_ = std::move(ticket_keys);
@@ -672,6 +853,7 @@ void ConnectionHandler::proceed_next_cert_ocsp() {
       if (enable_acceptor_on_ocsp_completion_) {
         enable_acceptor_on_ocsp_completion_ = false;
         enable_acceptor();
+        enable_worker_acceptor();
       }
 
       return;
@@ -833,11 +1015,13 @@ void ConnectionHandler::handle_serial_event() {
 
       if (single_worker_) {
         single_worker_->replace_downstream_config(sev.downstreamconf);
-
-        break;
+      } else {
+        worker_replace_downstream(sev.downstreamconf);
       }
 
-      worker_replace_downstream(sev.downstreamconf);
+      // Workers may still use the endpoints removed by this
+      // replacement.  They are removed next time.
+      remove_unused_downstream_endpoints();
 
       break;
     default:
@@ -36,6 +36,8 @@
 #include <memory>
 #include <vector>
 #include <random>
+#include <map>
+#include <tuple>
 #ifndef NOTHREADS
 #  include <future>
 #endif // NOTHREADS
@@ -59,6 +61,8 @@ class ConnectBlocker;
 class AcceptHandler;
 class Worker;
 struct WorkerStat;
+struct DownstreamAddr;
+struct DownstreamEndpoint;
 struct TicketKeys;
 class MemcachedDispatcher;
 struct UpstreamAddr;
@@ -99,6 +103,11 @@ struct SerialEvent {
   std::shared_ptr<DownstreamConfig> downstreamconf;
 };
 
+// The key to identify a backend endpoint whose state is shared among
+// workers: host, sni, proto, port, host_unix, tls, and dns.
+using DownstreamEndpointKey =
+    std::tuple<std::string, std::string, Proto, uint16_t, bool, bool, bool>;
+
 class ConnectionHandler {
 public:
   ConnectionHandler(struct ev_loop *loop, std::mt19937 &gen);
@@ -117,12 +126,24 @@ public:
   const std::shared_ptr<TicketKeys> &get_ticket_keys() const;
   struct ev_loop *get_loop() const;
   Worker *get_single_worker() const;
+  // Returns Worker objects for multi threaded configuration.
+  const std::vector<std::unique_ptr<Worker>> &get_workers() const;
+  // Adds |worker| for multi threaded configuration.  The ev_loop of
+  // |worker| is destroyed with this object.
+  void add_worker(std::unique_ptr<Worker> worker);
+  // Makes |worker| the dedicated health check worker.  The ev_loop of
+  // |worker| is destroyed with this object.
+  void set_health_worker(std::unique_ptr<Worker> worker);
+  // Returns the dedicated health check worker, or nullptr.
+  Worker *get_health_worker() const;
   void add_acceptor(std::unique_ptr<AcceptHandler> h);
   void delete_acceptor();
   void enable_acceptor();
   void disable_acceptor();
   void sleep_acceptor(ev_tstamp t);
   void accept_pending_connection();
+  // Sends WorkerEvent to make workers enable their own acceptors.
+  void enable_worker_acceptor();
   void graceful_shutdown_worker();
   void set_graceful_shutdown(bool f);
   bool get_graceful_shutdown() const;
@@ -175,10 +196,29 @@ public:
   // Sends WorkerEvent to make them replace downstream.
   void
   worker_replace_downstream(std::shared_ptr<DownstreamConfig> downstreamconf);
+  // Returns the state of the endpoint of |addr| shared by all
+  // workers.  This function can be called from any thread.
+  std::shared_ptr<DownstreamEndpoint>
+  get_downstream_endpoint(const DownstreamAddr &addr);
+  // Sends WorkerEvent to make workers apply the shared health of
+  // backends.  This function can be called from any thread.
+  void worker_update_downstream_health();
+  // Sends WorkerEvent to make workers close an idle connection to the
+  // backend which has run out of max-connections.  This function can
+  // be called from any thread.
+  void worker_reclaim_downstream_connection();
 
   void set_enable_acceptor_on_ocsp_completion(bool f);
 
 private:
+  // Distributes the listener sockets for |faddr| which has
+  // "reuseport" parameter among the workers.  This function must be
+  // called before the workers start running.
+  void setup_reuseport_acceptor(const UpstreamAddr &faddr);
+  // Removes the endpoints which are no longer used by any worker
+  // from downstream_endpoints_.
+  void remove_unused_downstream_endpoints();
+
   // Stores all SSL_CTX objects.
   std::vector<SSL_CTX *> all_ssl_ctx_;
   // Stores all SSL_CTX objects in a way that its index is stored in
@@ -195,6 +235,15 @@ private:
   // If at least one frontend enables API request, we allocate 1
   // additional worker dedicated to API request .
   std::vector<std::unique_ptr<Worker>> workers_;
+  // Worker dedicated to probing backends which are considered
+  // offline on behalf of all workers.  It is created when there are
+  // multiple workers serving connections.  Otherwise, nullptr.
+  std::unique_ptr<Worker> health_worker_;
+  // mutex for downstream_endpoints_
+  std::mutex downstream_endpoints_mu_;
+  // The state of backend endpoints shared by workers.
+  std::map<DownstreamEndpointKey, std::weak_ptr<DownstreamEndpoint>>
+      downstream_endpoints_;
   // mutex for serial event resive buffer handling
   std::mutex serial_event_mu_;
   // SerialEvent receive buffer
@@ -224,6 +273,9 @@ private:
   size_t tls_ticket_key_memcached_fail_count_;
   unsigned int worker_round_robin_cnt_;
   bool graceful_shutdown_;
+  // true if backends are probed by health_worker_, and their health
+  // is shared by all workers.
+  bool share_downstream_health_;
   // true if acceptors should be enabled after the initial ocsp update
   // has finished.
   bool enable_acceptor_on_ocsp_completion_;
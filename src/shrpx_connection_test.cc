@@ -0,0 +1,98 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_connection_test.h"
+
+#ifdef HAVE_LINUX_TLS_H
+#  include <linux/tls.h>
+#endif // HAVE_LINUX_TLS_H
+
+#include <CUnit/CUnit.h>
+
+#include "shrpx_connection.h"
+#include "shrpx_config.h"
+#include "shrpx_log.h"
+
+namespace shrpx {
+
+void test_shrpx_connection_ktls_bio_ctrl(void) {
+#ifdef SHRPX_KTLS
+  auto &tlsconf = mod_config()->tls;
+  tlsconf.bio_method = create_bio_method();
+
+  auto ssl_ctx = SSL_CTX_new(TLS_method());
+  auto ssl = SSL_new(ssl_ctx);
+  MemchunkPool mcpool;
+
+  {
+    Connection conn(EV_DEFAULT, -1, ssl, &mcpool, 0., 0., {}, {}, nullptr,
+                    nullptr, nullptr, nullptr, 0, 0., Proto::HTTP1);
+    auto bio = SSL_get_wbio(ssl);
+
+    CU_ASSERT(0 == BIO_get_ktls_send(bio));
+    CU_ASSERT(0 == BIO_get_ktls_recv(bio));
+
+    conn.tls.ktls_tx = true;
+
+    CU_ASSERT(1 == BIO_get_ktls_send(bio));
+    CU_ASSERT(0 == BIO_get_ktls_recv(bio));
+
+    conn.tls.ktls_rx = true;
+
+    CU_ASSERT(1 == BIO_get_ktls_recv(bio));
+
+    // OpenSSL sends an alert through kTLS with these internal
+    // controls.
+    BIO_ctrl(bio, SHRPX_BIO_CTRL_SET_KTLS_TX_SEND_CTRL_MSG, 21, nullptr);
+
+    CU_ASSERT(21 == conn.tls.ktls_record_type);
+
+    BIO_ctrl(bio, SHRPX_BIO_CTRL_CLEAR_KTLS_TX_CTRL_MSG, 0, nullptr);
+
+    CU_ASSERT(0 == conn.tls.ktls_record_type);
+
+    conn.tls.ktls_tx = false;
+    conn.tls.ktls_rx = false;
+
+    tls12_crypto_info_aes_gcm_128 info{};
+    info.info.version = TLS_1_3_VERSION;
+    info.info.cipher_type = TLS_CIPHER_AES_GCM_128;
+
+    // Client side connection never enables kTLS RX.
+    CU_ASSERT(0 == BIO_ctrl(bio, SHRPX_BIO_CTRL_SET_KTLS, 0, &info));
+    CU_ASSERT(!conn.tls.ktls_rx);
+
+    // No socket to enable kTLS TX on.
+    CU_ASSERT(0 == BIO_ctrl(bio, SHRPX_BIO_CTRL_SET_KTLS, 1, &info));
+    CU_ASSERT(!conn.tls.ktls_tx);
+  }
+
+  SSL_CTX_free(ssl_ctx);
+
+  BIO_meth_free(tlsconf.bio_method);
+  tlsconf.bio_method = nullptr;
+#endif // SHRPX_KTLS
+}
+
+} // namespace shrpx
@@ -33,10 +33,12 @@
 #include "shrpx_config.h"
 #include "shrpx_error.h"
 #include "shrpx_downstream_connection.h"
+#include "shrpx_collapsed_downstream_connection.h"
 #include "shrpx_downstream_queue.h"
 #include "shrpx_worker.h"
 #include "shrpx_http2_session.h"
 #include "shrpx_log.h"
+#include "shrpx_http.h"
 #ifdef HAVE_MRUBY
 #  include "shrpx_mruby.h"
 #endif // HAVE_MRUBY
@@ -111,6 +113,16 @@ void downstream_wtimeoutcb(struct ev_loop *loop, ev_timer *w, int revents) {
 }
 } // namespace
 
+namespace {
+void hedge_timeoutcb(struct ev_loop *loop, ev_timer *w, int revents) {
+  auto downstream = static_cast<Downstream *>(w->data);
+  auto upstream = downstream->get_upstream();
+  auto handler = upstream->get_client_handler();
+
+  handler->hedge_downstream(downstream);
+}
+} // namespace
+
 // upstream could be nullptr for unittests
 Downstream::Downstream(Upstream *upstream, MemchunkPool *mcpool,
                        int32_t stream_id)
@@ -124,6 +136,7 @@ Downstream::Downstream(Upstream *upstream, MemchunkPool *mcpool,
       blocked_request_buf_(mcpool),
       request_buf_(mcpool),
       response_buf_(mcpool),
+      response_pipe_{-1, -1, 0, 0},
       upstream_(upstream),
       blocked_link_(nullptr),
       addr_(nullptr),
@@ -145,7 +158,8 @@ Downstream::Downstream(Upstream *upstream, MemchunkPool *mcpool,
       accesslog_written_(false),
       new_affinity_cookie_(false),
       blocked_request_data_eof_(false),
-      expect_100_continue_(false) {
+      expect_100_continue_(false),
+      collapse_disabled_(false) {
 
   auto &timeoutconf = get_config()->http2.timeout;
 
@@ -157,11 +171,13 @@ Downstream::Downstream(Upstream *upstream, MemchunkPool *mcpool,
                 timeoutconf.stream_read);
   ev_timer_init(&downstream_wtimer_, &downstream_wtimeoutcb, 0.,
                 timeoutconf.stream_write);
+  ev_timer_init(&hedge_timer_, &hedge_timeoutcb, 0., 0.);
 
   upstream_rtimer_.data = this;
   upstream_wtimer_.data = this;
   downstream_rtimer_.data = this;
   downstream_wtimer_.data = this;
+  hedge_timer_.data = this;
 
   rcbufs_.reserve(32);
 }
@@ -179,6 +195,12 @@ Downstream::~Downstream() {
     ev_timer_stop(loop, &upstream_wtimer_);
     ev_timer_stop(loop, &downstream_rtimer_);
     ev_timer_stop(loop, &downstream_wtimer_);
+    ev_timer_stop(loop, &hedge_timer_);
+
+    if (response_pipe_.rfd != -1) {
+      auto worker = upstream_->get_client_handler()->get_worker();
+      worker->get_pipe_pool()->put(response_pipe_);
+    }
 
 #ifdef HAVE_MRUBY
     auto handler = upstream_->get_client_handler();
@@ -199,10 +221,16 @@ Downstream::~Downstream() {
   }
 #endif // HAVE_MRUBY
 
+  unregister_collapse_leader();
+  release_collapse_followers();
+
   // DownstreamConnection may refer to this object.  Delete it now
   // explicitly.
+  hedge_dconn_.reset();
   dconn_.reset();
 
+  release_concurrency_slot();
+
   for (auto rcbuf : rcbufs_) {
     nghttp2_rcbuf_decref(rcbuf);
   }
@@ -220,6 +248,8 @@ int Downstream::attach_downstream_connection(
 
   dconn_ = std::move(dconn);
 
+  upstream_->get_client_handler()->schedule_hedge(this);
+
   return 0;
 }
 
@@ -264,6 +294,202 @@ std::unique_ptr<DownstreamConnection> Downstream::pop_downstream_connection() {
   return std::unique_ptr<DownstreamConnection>(dconn_.release());
 }
 
+void Downstream::start_hedge_timer(ev_tstamp t) {
+  auto loop = upstream_->get_client_handler()->get_loop();
+
+  ev_timer_stop(loop, &hedge_timer_);
+  ev_timer_set(&hedge_timer_, t, 0.);
+  ev_timer_start(loop, &hedge_timer_);
+}
+
+int Downstream::attach_hedge_downstream_connection(
+    std::unique_ptr<DownstreamConnection> dconn) {
+  assert(!hedge_dconn_);
+
+  if (dconn->attach_downstream(this) != 0) {
+    return -1;
+  }
+
+  hedge_dconn_ = std::move(dconn);
+
+  return 0;
+}
+
+DownstreamConnection *Downstream::get_hedge_downstream_connection() const {
+  return hedge_dconn_.get();
+}
+
+void Downstream::promote_hedge_downstream_connection() {
+  assert(hedge_dconn_);
+
+  if (LOG_ENABLED(INFO)) {
+    DLOG(INFO, this) << "Hedged request won; cancel the original request";
+  }
+
+  // Both connections belong to the same group, so that per-pattern
+  // mruby context needs no update.
+  auto dconn = std::move(dconn_);
+
+  dconn_ = std::move(hedge_dconn_);
+  request_downstream_host_ = hedge_request_downstream_host_;
+
+  // The original request is still in flight.  Deleting it closes its
+  // HTTP/1 connection, or resets its HTTP/2 stream.
+  dconn.reset();
+}
+
+void Downstream::cancel_hedge() {
+  auto loop = upstream_->get_client_handler()->get_loop();
+
+  ev_timer_stop(loop, &hedge_timer_);
+
+  if (!hedge_dconn_) {
+    return;
+  }
+
+  if (LOG_ENABLED(INFO)) {
+    DLOG(INFO, this) << "Cancel hedged request";
+  }
+
+  hedge_dconn_.reset();
+}
+
+void Downstream::set_hedge_request_downstream_host(const StringRef &host) {
+  hedge_request_downstream_host_ = host;
+}
+
+void Downstream::hold_concurrency_slot(
+    std::shared_ptr<SharedDownstreamAddr> shared_addr) {
+  assert(!concurrency_shared_addr_);
+
+  concurrency_shared_addr_ = std::move(shared_addr);
+}
+
+bool Downstream::holds_concurrency_slot() const {
+  return concurrency_shared_addr_ != nullptr;
+}
+
+void Downstream::release_concurrency_slot() {
+  if (!concurrency_shared_addr_) {
+    return;
+  }
+
+  downstream_concurrency_release(concurrency_shared_addr_.get());
+
+  concurrency_shared_addr_.reset();
+}
+
+void Downstream::set_collapse_leader(
+    std::shared_ptr<SharedDownstreamAddr> shared_addr, const StringRef &key) {
+  assert(!collapse_shared_addr_);
+
+  // This replaces the existing leader which has too many followers.
+  shared_addr->collapse.leaders[key] = this;
+
+  collapse_shared_addr_ = std::move(shared_addr);
+  collapse_key_ = key;
+}
+
+bool Downstream::is_collapse_leader() const {
+  return collapse_shared_addr_ != nullptr;
+}
+
+void Downstream::add_collapse_follower(CollapsedDownstreamConnection *dconn) {
+  collapse_followers_.append(dconn);
+}
+
+void Downstream::remove_collapse_follower(
+    CollapsedDownstreamConnection *dconn) {
+  collapse_followers_.remove(dconn);
+}
+
+size_t Downstream::get_num_collapse_followers() const {
+  return collapse_followers_.size();
+}
+
+void Downstream::unregister_collapse_leader() {
+  if (!collapse_shared_addr_ || collapse_key_.empty()) {
+    return;
+  }
+
+  auto &leaders = collapse_shared_addr_->collapse.leaders;
+  auto it = leaders.find(collapse_key_);
+  if (it != std::end(leaders) && (*it).second == this) {
+    leaders.erase(it);
+  }
+
+  // The key is not needed anymore, but collapse_shared_addr_ is kept
+  // so that this object is not registered again on retry.
+  collapse_key_ = StringRef{};
+}
+
+void Downstream::release_collapse_followers() {
+  while (!collapse_followers_.empty()) {
+    auto dconn = collapse_followers_.head;
+    collapse_followers_.remove(dconn);
+    dconn->on_leader_gone();
+  }
+}
+
+void Downstream::collapse_response_header() {
+  if (!collapse_shared_addr_) {
+    return;
+  }
+
+  // The requests arriving from now on cannot receive the response
+  // from the beginning.
+  unregister_collapse_leader();
+
+  if (collapse_followers_.empty()) {
+    return;
+  }
+
+  auto worker = upstream_->get_client_handler()->get_worker();
+  auto &collapseconf = worker->get_downstream_config()->collapse;
+
+  if (!http::collapsible_response(resp_.http_status, resp_.fs.headers(),
+                                  collapseconf.vary)) {
+    if (LOG_ENABLED(INFO)) {
+      DLOG(INFO, this) << "Response cannot be shared with "
+                       << collapse_followers_.size() << " waiting requests";
+    }
+
+    release_collapse_followers();
+
+    return;
+  }
+
+  for (auto dconn = collapse_followers_.head; dconn;) {
+    auto next = dconn->dlnext;
+    dconn->on_leader_response_header(this);
+    dconn = next;
+  }
+}
+
+void Downstream::collapse_response_body(const uint8_t *data, size_t len) {
+  if (len == 0) {
+    return;
+  }
+
+  for (auto dconn = collapse_followers_.head; dconn;) {
+    auto next = dconn->dlnext;
+    dconn->on_leader_response_body(data, len);
+    dconn = next;
+  }
+}
+
+void Downstream::collapse_response_complete() {
+  while (!collapse_followers_.empty()) {
+    auto dconn = collapse_followers_.head;
+    collapse_followers_.remove(dconn);
+    dconn->on_leader_response_complete(this);
+  }
+}
+
+void Downstream::disable_collapse() { collapse_disabled_ = true; }
+
+bool Downstream::collapse_disabled() const { return collapse_disabled_; }
+
 void Downstream::pause_read(IOCtrlReason reason) {
   if (dconn_) {
     dconn_->pause_read(reason);
@@ -728,6 +954,10 @@ int Downstream::on_read() {
 
 void Downstream::set_response_state(DownstreamState state) {
   response_state_ = state;
+
+  if (state == DownstreamState::MSG_COMPLETE) {
+    release_concurrency_slot();
+  }
 }
 
 DownstreamState Downstream::get_response_state() const {
@@ -748,6 +978,31 @@ bool Downstream::response_buf_full() {
   return false;
 }
 
+int Downstream::start_response_splice() {
+  assert(response_pipe_.rfd == -1);
+
+  auto worker = upstream_->get_client_handler()->get_worker();
+
+  return worker->get_pipe_pool()->get(response_pipe_);
+}
+
+SplicePipe *Downstream::get_response_pipe() {
+  return response_pipe_.rfd == -1 ? nullptr : &response_pipe_;
+}
+
+bool Downstream::response_body_spliceable(size_t min_length) const {
+  if (response_state_ != DownstreamState::HEADER_COMPLETE || upgraded_ ||
+      chunked_response_ || response_pipe_.rfd != -1 ||
+      // The response body is also copied to the waiting requests.
+      get_num_collapse_followers()) {
+    return false;
+  }
+
+  return resp_.fs.content_length != -1 &&
+         resp_.fs.content_length - resp_.recv_body_length >=
+             static_cast<int64_t>(min_length);
+}
+
 bool Downstream::validate_request_recv_body_length() const {
   if (req_.fs.content_length == -1) {
     return true;
@@ -1068,6 +1323,10 @@ void Downstream::set_request_downstream_host(const StringRef &host) {
   request_downstream_host_ = host;
 }
 
+const StringRef &Downstream::get_request_downstream_host() const {
+  return request_downstream_host_;
+}
+
 void Downstream::set_request_pending(bool f) { request_pending_ = f; }
 
 bool Downstream::get_request_pending() const { return request_pending_; }
@@ -42,9 +42,11 @@
 
 #include "shrpx_io_control.h"
 #include "shrpx_log_config.h"
+#include "shrpx_pipe_pool.h"
 #include "http2.h"
 #include "memchunk.h"
 #include "allocator.h"
+#include "template.h"
 
 using namespace nghttp2;
 
@@ -52,9 +54,11 @@ namespace shrpx {
 
 class Upstream;
 class DownstreamConnection;
+class CollapsedDownstreamConnection;
 struct BlockedLink;
 struct DownstreamAddrGroup;
 struct DownstreamAddr;
+struct SharedDownstreamAddr;
 
 class FieldStore {
 public:
@@ -340,6 +344,56 @@ public:
   // Returns dconn_ and nullifies dconn_.
   std::unique_ptr<DownstreamConnection> pop_downstream_connection();
 
+  // Starts the timer to send a hedged request after |t| seconds.
+  void start_hedge_timer(ev_tstamp t);
+  // Attaches |dconn| which carries a hedged request of this object.
+  // It runs in parallel with dconn_ until either of them receives
+  // response.
+  int attach_hedge_downstream_connection(
+      std::unique_ptr<DownstreamConnection> dconn);
+  DownstreamConnection *get_hedge_downstream_connection() const;
+  // Replaces dconn_ with the connection of hedged request because it
+  // received response first.  The original connection is deleted.
+  void promote_hedge_downstream_connection();
+  // Cancels hedged request if any, and stops hedge timer.
+  void cancel_hedge();
+  // Sets the host which the hedged request is sent to.  It becomes
+  // the request downstream host if hedged request is promoted.
+  void set_hedge_request_downstream_host(const StringRef &host);
+
+  // Holds the slot of the concurrency limit of the backend group
+  // |shared_addr| taken by downstream_concurrency_acquire().  The slot
+  // is released when the response completes, or this object is
+  // deleted.
+  void
+  hold_concurrency_slot(std::shared_ptr<SharedDownstreamAddr> shared_addr);
+  // Returns true if this object holds the slot of the concurrency
+  // limit.
+  bool holds_concurrency_slot() const;
+  void release_concurrency_slot();
+
+  // Makes this object the request which the other requests with the
+  // same |key| can wait for instead of being forwarded to the backend
+  // group |shared_addr|.  |key| must be allocated by
+  // get_block_allocator().
+  void set_collapse_leader(std::shared_ptr<SharedDownstreamAddr> shared_addr,
+                           const StringRef &key);
+  // Returns true if set_collapse_leader() has been called.
+  bool is_collapse_leader() const;
+  void add_collapse_follower(CollapsedDownstreamConnection *dconn);
+  void remove_collapse_follower(CollapsedDownstreamConnection *dconn);
+  size_t get_num_collapse_followers() const;
+  // Shares the final response header fields, the response body, and
+  // the completion of the response with the waiting requests.  If the
+  // response cannot be shared, the waiting requests are forwarded to
+  // the backend separately.
+  void collapse_response_header();
+  void collapse_response_body(const uint8_t *data, size_t len);
+  void collapse_response_complete();
+  // Prevents this object from being collapsed into the other request.
+  void disable_collapse();
+  bool collapse_disabled() const;
+
   // Returns true if output buffer is full. If underlying dconn_ is
   // NULL, this function always returns false.
   bool request_buf_full();
@@ -388,6 +442,7 @@ public:
   // matches.
   bool validate_request_recv_body_length() const;
   void set_request_downstream_host(const StringRef &host);
+  const StringRef &get_request_downstream_host() const;
   bool expect_response_body() const;
   bool expect_response_trailer() const;
   void set_request_state(DownstreamState state);
@@ -421,6 +476,20 @@ public:
   DownstreamState get_response_state() const;
   DefaultMemchunks *get_response_buf();
   bool response_buf_full();
+  // Gets a pipe from the worker's pool so that the rest of response
+  // body is relayed with splice(2).  This function returns 0 if it
+  // succeeds, or -1.
+  int start_response_splice();
+  // Returns the pipe which holds response body after the data in
+  // response buffer, or nullptr if start_response_splice() has not
+  // been called.
+  SplicePipe *get_response_pipe();
+  // Returns true if the rest of response body may be relayed with
+  // splice(2).  The response header fields must have been received,
+  // the body must be delimited by content-length, and at least
+  // |min_length| bytes of it must be left.  Chunked response body is
+  // not eligible because its framing is parsed by llhttp.
+  bool response_body_spliceable(size_t min_length) const;
   // Validates that received response body length and content-length
   // matches.
   bool validate_response_recv_body_length() const;
@@ -524,6 +593,13 @@ public:
   int64_t response_sent_body_length;
 
 private:
+  // Removes this object from the requests which the other requests
+  // can wait for.
+  void unregister_collapse_leader();
+  // Lets the waiting requests be forwarded to the backend separately,
+  // or be reset if they have already received response header.
+  void release_collapse_followers();
+
   BlockAllocator balloc_;
 
   std::vector<nghttp2_rcbuf *> rcbufs_;
@@ -543,6 +619,9 @@ private:
   DefaultMemchunks blocked_request_buf_;
   DefaultMemchunks request_buf_;
   DefaultMemchunks response_buf_;
+  // Response body read from backend with splice(2) is kept here
+  // until it is written to frontend.
+  SplicePipe response_pipe_;
 
   // The Sec-WebSocket-Key field sent to the peer.  This field is used
   // if frontend uses RFC 8441 WebSocket bootstrapping via HTTP/2.
@@ -554,8 +633,25 @@ private:
   ev_timer downstream_rtimer_;
   ev_timer downstream_wtimer_;
 
+  // The timer to send a hedged request.
+  ev_timer hedge_timer_;
+
   Upstream *upstream_;
   std::unique_ptr<DownstreamConnection> dconn_;
+  // The connection carrying hedged request, or nullptr.
+  std::unique_ptr<DownstreamConnection> hedge_dconn_;
+  // The request downstream host of the hedged request.
+  StringRef hedge_request_downstream_host_;
+  // The backend group whose concurrency limit admitted this request,
+  // or nullptr.
+  std::shared_ptr<SharedDownstreamAddr> concurrency_shared_addr_;
+  // The backend group which the other requests wait for this object
+  // in, and the key of them.  collapse_shared_addr_ is nullptr if this
+  // object is not a leader of collapsed forwarding.
+  std::shared_ptr<SharedDownstreamAddr> collapse_shared_addr_;
+  StringRef collapse_key_;
+  // The requests waiting for the response of this object.
+  DList<CollapsedDownstreamConnection> collapse_followers_;
 
   // only used by HTTP/2 upstream
   BlockedLink *blocked_link_;
@@ -606,6 +702,9 @@ private:
   bool blocked_request_data_eof_;
   // true if request contains "expect: 100-continue" header field.
   bool expect_100_continue_;
+  // true if this request must not be collapsed into the other
+  // request.
+  bool collapse_disabled_;
 };
 
 } // namespace shrpx
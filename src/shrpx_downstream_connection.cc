@@ -27,11 +27,15 @@
 #include "shrpx_client_handler.h"
 #include "shrpx_downstream.h"
 #include "shrpx_log.h"
+#include "shrpx_worker.h"
 
 namespace shrpx {
 
 DownstreamConnection::DownstreamConnection()
-    : client_handler_(nullptr), downstream_(nullptr) {}
+    : client_handler_(nullptr),
+      downstream_(nullptr),
+      request_addr_(nullptr),
+      request_start_(0.) {}
 
 DownstreamConnection::~DownstreamConnection() {}
 
@@ -45,4 +49,69 @@ ClientHandler *DownstreamConnection::get_client_handler() {
 
 Downstream *DownstreamConnection::get_downstream() { return downstream_; }
 
+void DownstreamConnection::begin_request(DownstreamAddr *addr) {
+  end_request();
+
+  request_addr_ = addr;
+  request_start_ = ev_now(client_handler_->get_loop());
+
+  downstream_request_begin(addr);
+}
+
+void DownstreamConnection::on_response_header() {
+  if (!request_addr_ || request_start_ == 0.) {
+    return;
+  }
+
+  auto now = ev_now(client_handler_->get_loop());
+  auto t = now - request_start_;
+
+  downstream_record_response(request_addr_,
+                             downstream_->response().http_status, t);
+
+  const auto &group = get_downstream_addr_group();
+  if (group) {
+    auto &shared_addr = group->shared_addr;
+
+    if (shared_addr->hedge.percentile) {
+      downstream_record_hedge_latency(shared_addr.get(), t);
+    }
+
+    if (shared_addr->concurrency.max_limit) {
+      auto worker = client_handler_->get_worker();
+      auto &concurrencyconf = worker->get_downstream_config()->concurrency;
+
+      downstream_record_concurrency_latency(
+          shared_addr.get(), concurrencyconf.min_limit, t, now);
+    }
+  }
+
+  request_start_ = 0.;
+}
+
+void DownstreamConnection::on_request_error() {
+  if (!request_addr_ || request_start_ == 0.) {
+    return;
+  }
+
+  downstream_record_reset(request_addr_);
+
+  request_start_ = 0.;
+}
+
+void DownstreamConnection::end_request() {
+  if (!request_addr_) {
+    return;
+  }
+
+  downstream_request_end(request_addr_);
+
+  request_addr_ = nullptr;
+  request_start_ = 0.;
+}
+
+DownstreamAddr *DownstreamConnection::get_request_addr() const {
+  return request_addr_;
+}
+
 } // namespace shrpx
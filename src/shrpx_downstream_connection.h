@@ -29,6 +29,8 @@
 
 #include <memory>
 
+#include <ev.h>
+
 #include "shrpx_io_control.h"
 
 namespace shrpx {
@@ -71,9 +73,33 @@ public:
   ClientHandler *get_client_handler();
   Downstream *get_downstream();
 
+  // Records that the request of the attached Downstream is forwarded
+  // to |addr|.  The counters in |addr| are used for load balancing.
+  void begin_request(DownstreamAddr *addr);
+  // Records the latency of the request started by begin_request().
+  // This function should be called when the response header is
+  // received.  Only the first call after begin_request() is counted.
+  void on_response_header();
+  // Records that the request started by begin_request() failed before
+  // its response header was received (e.g., connection error, or
+  // stream reset).  This is used for passive outlier detection.
+  void on_request_error();
+  // Records that the request started by begin_request() finished.
+  // It is safe to call this function if no request is started.
+  void end_request();
+  // Returns the address which the current request is forwarded to,
+  // or nullptr.
+  DownstreamAddr *get_request_addr() const;
+
 protected:
   ClientHandler *client_handler_;
   Downstream *downstream_;
+  // The address which the current request is forwarded to, or
+  // nullptr.
+  DownstreamAddr *request_addr_;
+  // The time when the current request is forwarded.  0 if its latency
+  // has already been recorded.
+  ev_tstamp request_start_;
 };
 
 } // namespace shrpx
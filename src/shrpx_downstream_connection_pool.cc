@@ -37,6 +37,12 @@ void DownstreamConnectionPool::remove_all() {
   }
 
   pool_.clear();
+
+  for (auto dconn : warming_) {
+    delete dconn;
+  }
+
+  warming_.clear();
 }
 
 void DownstreamConnectionPool::add_downstream_connection(
@@ -60,7 +66,37 @@ DownstreamConnectionPool::pop_downstream_connection() {
 void DownstreamConnectionPool::remove_downstream_connection(
     DownstreamConnection *dconn) {
   pool_.erase(dconn);
+  warming_.erase(dconn);
   delete dconn;
 }
 
+void DownstreamConnectionPool::add_warming_downstream_connection(
+    std::unique_ptr<DownstreamConnection> dconn) {
+  warming_.insert(dconn.release());
+}
+
+void DownstreamConnectionPool::promote_downstream_connection(
+    DownstreamConnection *dconn) {
+  if (warming_.erase(dconn) == 0) {
+    return;
+  }
+
+  pool_.insert(dconn);
+}
+
+size_t DownstreamConnectionPool::size() const {
+  return pool_.size() + warming_.size();
+}
+
+void DownstreamConnectionPool::for_each(
+    const std::function<void(DownstreamConnection *)> &f) {
+  for (auto dconn : pool_) {
+    f(dconn);
+  }
+
+  for (auto dconn : warming_) {
+    f(dconn);
+  }
+}
+
 } // namespace shrpx
@@ -29,6 +29,7 @@
 
 #include <memory>
 #include <set>
+#include <functional>
 
 namespace shrpx {
 
@@ -43,9 +44,25 @@ public:
   std::unique_ptr<DownstreamConnection> pop_downstream_connection();
   void remove_downstream_connection(DownstreamConnection *dconn);
   void remove_all();
+  // Adds |dconn| which is still establishing a connection.  It is not
+  // returned by pop_downstream_connection() until
+  // promote_downstream_connection() is called.
+  void add_warming_downstream_connection(
+      std::unique_ptr<DownstreamConnection> dconn);
+  // Makes |dconn| added by add_warming_downstream_connection()
+  // available for reuse.
+  void promote_downstream_connection(DownstreamConnection *dconn);
+  // Returns the number of connections in this pool, including the
+  // ones which are still establishing a connection.
+  size_t size() const;
+  // Calls |f| for each connection in this pool, including the ones
+  // which are still establishing a connection.
+  void for_each(const std::function<void(DownstreamConnection *)> &f);
 
 private:
   std::set<DownstreamConnection *> pool_;
+  // Connections which are being established in advance.
+  std::set<DownstreamConnection *> warming_;
 };
 
 } // namespace shrpx
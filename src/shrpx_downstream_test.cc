@@ -223,4 +223,41 @@ void test_downstream_find_affinity_cookie(void) {
   CU_ASSERT(0 == aff);
 }
 
+void test_downstream_response_body_spliceable(void) {
+  Downstream d(nullptr, nullptr, 0);
+
+  auto &resp = d.response();
+  resp.fs.content_length = 100;
+
+  // Response header fields have not been received yet.
+  CU_ASSERT(!d.response_body_spliceable(100));
+
+  d.set_response_state(DownstreamState::HEADER_COMPLETE);
+
+  CU_ASSERT(d.response_body_spliceable(100));
+
+  // The rest of body is shorter than the minimum length.
+  resp.recv_body_length = 1;
+
+  CU_ASSERT(!d.response_body_spliceable(100));
+  CU_ASSERT(d.response_body_spliceable(99));
+
+  // Chunked response body goes through llhttp.
+  d.set_chunked_response(true);
+
+  CU_ASSERT(!d.response_body_spliceable(0));
+
+  d.set_chunked_response(false);
+
+  // Response body without content-length
+  resp.fs.content_length = -1;
+
+  CU_ASSERT(!d.response_body_spliceable(0));
+
+  resp.fs.content_length = 100;
+  d.set_response_state(DownstreamState::MSG_COMPLETE);
+
+  CU_ASSERT(!d.response_body_spliceable(0));
+}
+
 } // namespace shrpx
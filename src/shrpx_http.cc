@@ -220,6 +220,132 @@ bool require_cookie_secure_attribute(SessionAffinityCookieSecure secure,
   }
 }
 
+StringRef create_collapse_key(BlockAllocator &balloc, const StringRef &scheme,
+                              const StringRef &authority, const StringRef &path,
+                              const HeaderRefs &headers,
+                              const std::vector<StringRef> &vary) {
+  size_t len = scheme.size() + 1 + authority.size() + 1 + path.size();
+
+  for (auto &name : vary) {
+    ++len;
+    for (auto &kv : headers) {
+      if (util::strieq(kv.name, name)) {
+        len += kv.value.size() + 1;
+      }
+    }
+  }
+
+  auto iov = make_byte_ref(balloc, len + 1);
+  auto p = iov.base;
+  p = std::copy(std::begin(scheme), std::end(scheme), p);
+  *p++ = ' ';
+  p = std::copy(std::begin(authority), std::end(authority), p);
+  *p++ = ' ';
+  p = std::copy(std::begin(path), std::end(path), p);
+
+  for (auto &name : vary) {
+    // Header field value cannot contain '\n'.
+    *p++ = '\n';
+    for (auto &kv : headers) {
+      if (util::strieq(kv.name, name)) {
+        p = std::copy(std::begin(kv.value), std::end(kv.value), p);
+        *p++ = ',';
+      }
+    }
+  }
+
+  *p = '\0';
+
+  return StringRef{iov.base, p};
+}
+
+namespace {
+// Calls |f| with each element of comma delimited list |s| whose
+// leading and trailing white spaces are removed.  Empty elements are
+// skipped.  If |f| returns false, this function returns false
+// immediately.  Otherwise returns true.
+template <typename F> bool for_each_list_element(const StringRef &s, F f) {
+  auto first = std::begin(s);
+  auto last = std::end(s);
+
+  for (;;) {
+    auto end = std::find(first, last, ',');
+    auto a = first;
+    auto b = end;
+
+    for (; a != b && (*a == ' ' || *a == '\t'); ++a)
+      ;
+    for (; a != b && (*(b - 1) == ' ' || *(b - 1) == '\t'); --b)
+      ;
+
+    if (a != b && !f(StringRef{a, b})) {
+      return false;
+    }
+
+    if (end == last) {
+      return true;
+    }
+
+    first = end + 1;
+  }
+}
+} // namespace
+
+bool collapsible_response(unsigned int status_code, const HeaderRefs &headers,
+                          const std::vector<StringRef> &vary) {
+  // Only status codes which are cacheable by default, excluding 206.
+  switch (status_code) {
+  case 200:
+  case 203:
+  case 204:
+  case 300:
+  case 301:
+  case 308:
+  case 404:
+  case 405:
+  case 410:
+  case 414:
+  case 501:
+    break;
+  default:
+    return false;
+  }
+
+  for (auto &kv : headers) {
+    if (util::strieq_l("set-cookie", kv.name)) {
+      return false;
+    }
+
+    if (kv.token == http2::HD_CACHE_CONTROL) {
+      if (!for_each_list_element(kv.value, [](const StringRef &directive) {
+            auto name = StringRef{std::begin(directive),
+                                  std::find(std::begin(directive),
+                                            std::end(directive), '=')};
+            return !util::strieq_l("private", name) &&
+                   !util::strieq_l("no-store", name) &&
+                   !util::strieq_l("no-cache", name);
+          })) {
+        return false;
+      }
+
+      continue;
+    }
+
+    if (util::strieq_l("vary", kv.name)) {
+      if (!for_each_list_element(kv.value, [&vary](const StringRef &name) {
+            return std::find_if(std::begin(vary), std::end(vary),
+                                [&name](const StringRef &v) {
+                                  return util::strieq(v, name);
+                                }) != std::end(vary);
+          })) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
 } // namespace http
 
 } // namespace shrpx
@@ -28,11 +28,13 @@
 #include "shrpx.h"
 
 #include <string>
+#include <vector>
 
 #include <nghttp2/nghttp2.h>
 
 #include "shrpx_config.h"
 #include "util.h"
+#include "http2.h"
 #include "allocator.h"
 
 using namespace nghttp2;
@@ -79,6 +81,23 @@ StringRef create_affinity_cookie(BlockAllocator &balloc, const StringRef &name,
 bool require_cookie_secure_attribute(SessionAffinityCookieSecure secure,
                                      const StringRef &scheme);
 
+// Returns the key of collapsed forwarding made of |scheme|,
+// |authority|, |path|, and the values of request header fields
+// |headers| whose names are listed in |vary|.  The requests which
+// have the same key can share a single response.
+StringRef create_collapse_key(BlockAllocator &balloc, const StringRef &scheme,
+                              const StringRef &authority, const StringRef &path,
+                              const HeaderRefs &headers,
+                              const std::vector<StringRef> &vary);
+
+// Returns true if the response with |status_code| and header fields
+// |headers| can be sent to the requests collapsed into the request
+// which received it.  The response must be cacheable by a shared
+// cache without validation, and must not vary on request header
+// fields other than |vary|.
+bool collapsible_response(unsigned int status_code, const HeaderRefs &headers,
+                          const std::vector<StringRef> &vary);
+
 } // namespace http
 
 } // namespace shrpx
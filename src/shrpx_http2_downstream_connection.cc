@@ -51,13 +51,23 @@ Http2DownstreamConnection::Http2DownstreamConnection(Http2Session *http2session)
     : dlnext(nullptr),
       dlprev(nullptr),
       http2session_(http2session),
-      sd_(nullptr) {}
+      sd_(nullptr),
+      hedge_stream_id_(-1),
+      hedge_(false),
+      hedge_lost_(false) {}
 
 Http2DownstreamConnection::~Http2DownstreamConnection() {
   if (LOG_ENABLED(INFO)) {
     DCLOG(INFO, this) << "Deleting";
   }
-  if (downstream_) {
+  if (hedge_) {
+    // The hedged request lost, or failed.  Downstream is still used
+    // by the original request.
+    if (sd_ && http2session_->get_state() == Http2SessionState::CONNECTED) {
+      http2session_->submit_rst_stream(hedge_stream_id_, NGHTTP2_CANCEL);
+      http2session_->signal_write();
+    }
+  } else if (downstream_) {
     downstream_->disable_downstream_rtimer();
     downstream_->disable_downstream_wtimer();
 
@@ -67,6 +77,8 @@ Http2DownstreamConnection::~Http2DownstreamConnection() {
       // For upgraded connection, send NO_ERROR.  Should we consider
       // request states other than DownstreamState::STREAM_CLOSED ?
       error_code = NGHTTP2_NO_ERROR;
+    } else if (hedge_lost_) {
+      error_code = NGHTTP2_CANCEL;
     } else {
       error_code = NGHTTP2_INTERNAL_ERROR;
     }
@@ -85,6 +97,9 @@ Http2DownstreamConnection::~Http2DownstreamConnection() {
       http2session_->signal_write();
     }
   }
+
+  end_request();
+
   http2session_->remove_downstream_connection(this);
 
   if (LOG_ENABLED(INFO)) {
@@ -102,6 +117,8 @@ int Http2DownstreamConnection::attach_downstream(Downstream *downstream) {
   downstream_ = downstream;
   downstream_->reset_downstream_rtimer();
 
+  begin_request(http2session_->get_addr());
+
   auto &req = downstream_->request();
 
   // HTTP/2 disables HTTP Upgrade.
@@ -135,6 +152,8 @@ void Http2DownstreamConnection::detach_downstream(Downstream *downstream) {
   downstream->disable_downstream_rtimer();
   downstream->disable_downstream_wtimer();
   downstream_ = nullptr;
+
+  end_request();
 }
 
 int Http2DownstreamConnection::submit_rst_stream(Downstream *downstream,
@@ -235,12 +254,16 @@ int Http2DownstreamConnection::push_request_headers() {
     // The HTTP2 session to the backend has not been established or
     // connection is now being checked.  This function will be called
     // again just after it is established.
-    downstream_->set_request_pending(true);
+    if (!hedge_) {
+      downstream_->set_request_pending(true);
+    }
     http2session_->start_checking_connection();
     return 0;
   }
 
-  downstream_->set_request_pending(false);
+  if (!hedge_) {
+    downstream_->set_request_pending(false);
+  }
 
   const auto &req = downstream_->request();
 
@@ -270,7 +293,11 @@ int Http2DownstreamConnection::push_request_headers() {
     authority = req.authority;
   }
 
-  downstream_->set_request_downstream_host(authority);
+  if (hedge_) {
+    downstream_->set_hedge_request_downstream_host(authority);
+  } else {
+    downstream_->set_request_downstream_host(authority);
+  }
 
   size_t num_cookies = 0;
   if (!http2conf.no_cookie_crumbling) {
@@ -603,6 +630,58 @@ StreamData *Http2DownstreamConnection::detach_stream_data() {
   return nullptr;
 }
 
+void Http2DownstreamConnection::set_stream_id(int32_t stream_id) {
+  if (hedge_) {
+    hedge_stream_id_ = stream_id;
+    return;
+  }
+
+  downstream_->set_downstream_stream_id(stream_id);
+}
+
+bool Http2DownstreamConnection::get_request_pending() const {
+  if (hedge_) {
+    return hedge_stream_id_ == -1;
+  }
+
+  return downstream_->get_request_pending();
+}
+
+void Http2DownstreamConnection::set_hedge() { hedge_ = true; }
+
+bool Http2DownstreamConnection::get_hedge() const { return hedge_; }
+
+void Http2DownstreamConnection::win_hedge() {
+  assert(hedge_);
+
+  auto downstream = downstream_;
+  auto dconn = static_cast<Http2DownstreamConnection *>(
+      downstream->get_downstream_connection());
+
+  if (dconn->sd_) {
+    dconn->hedge_lost_ = true;
+  } else {
+    // The stream of the original request has been closed.
+    downstream->set_downstream_stream_id(-1);
+  }
+
+  // This deletes dconn.
+  downstream->promote_hedge_downstream_connection();
+
+  hedge_ = false;
+
+  downstream->set_downstream_stream_id(hedge_stream_id_);
+
+  if (hedge_stream_id_ == -1) {
+    // The hedged request is sent when the session gets ready.
+    downstream->set_request_pending(true);
+  } else {
+    hedge_stream_id_ = -1;
+  }
+
+  downstream->reset_downstream_rtimer();
+}
+
 int Http2DownstreamConnection::on_timeout() {
   if (!downstream_) {
     return 0;
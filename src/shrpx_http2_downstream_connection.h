@@ -76,11 +76,35 @@ public:
   int submit_rst_stream(Downstream *downstream,
                         uint32_t error_code = NGHTTP2_INTERNAL_ERROR);
 
+  // Sets the stream ID of the request this object carries.
+  void set_stream_id(int32_t stream_id);
+  // Returns true if the request waits for the session to get ready.
+  bool get_request_pending() const;
+
+  // Makes this object carry the hedged request of Downstream.  This
+  // must be called before attach_downstream().  The hedged request
+  // does not touch the stream of the original request until it wins.
+  void set_hedge();
+  // Returns true if this object carries the hedged request.
+  bool get_hedge() const;
+  // Makes the hedged request which this object carries win.  The
+  // original request is reset with NGHTTP2_CANCEL if its stream is
+  // still open, and this object becomes the downstream connection of
+  // Downstream.
+  void win_hedge();
+
   Http2DownstreamConnection *dlnext, *dlprev;
 
 private:
   Http2Session *http2session_;
   StreamData *sd_;
+  // The stream ID of the hedged request, or -1.  The stream ID of
+  // the other request is kept by Downstream.
+  int32_t hedge_stream_id_;
+  // true if this object carries the hedged request.
+  bool hedge_;
+  // true if the request of this object lost to the hedged request.
+  bool hedge_lost_;
 };
 
 } // namespace shrpx
@@ -174,6 +174,21 @@ void initiate_connection_cb(struct ev_loop *loop, ev_timer *w, int revents) {
 namespace {
 void prepare_cb(struct ev_loop *loop, ev_prepare *w, int revents) {
   auto http2session = static_cast<Http2Session *>(w->data);
+
+  // An idle session gives room to the worker which could not make a
+  // connection to the backend because of max-connections.
+  if (http2session->get_num_dconns() == 0 &&
+      downstream_connection_reclaim(http2session->get_addr())) {
+    if (LOG_ENABLED(INFO)) {
+      SSLOG(INFO, http2session)
+          << "Close idle session to give room to the other worker";
+    }
+
+    delete http2session;
+
+    return;
+  }
+
   http2session->check_retire();
 }
 } // namespace
@@ -229,6 +244,8 @@ Http2Session::Http2Session(struct ev_loop *loop, SSL_CTX *ssl_ctx,
 Http2Session::~Http2Session() {
   exclude_from_scheduling();
   disconnect(should_hard_fail());
+
+  downstream_connection_release(addr_);
 }
 
 int Http2Session::disconnect(bool hard) {
@@ -281,6 +298,31 @@ int Http2Session::disconnect(bool hard) {
   for (auto dc = dconns_.head; dc;) {
     auto next = dc->dlnext;
     auto downstream = dc->get_downstream();
+
+    if (dc->get_hedge()) {
+      // The original request is not affected.
+      downstream->cancel_hedge();
+
+      // dc was deleted
+      dc = next;
+
+      continue;
+    }
+
+    auto hedge_dconn = static_cast<Http2DownstreamConnection *>(
+        downstream->get_hedge_downstream_connection());
+    if (hedge_dconn) {
+      // Let the hedged request take over.  If it is next to dc, it is
+      // handled as the original request in the next iteration.
+      dc->on_request_error();
+      hedge_dconn->win_hedge();
+
+      // dc was deleted
+      dc = next;
+
+      continue;
+    }
+
     auto upstream = downstream->get_upstream();
 
     // Failure is allowed only for HTTP/1 upstream where upstream is
@@ -756,7 +798,7 @@ int Http2Session::submit_request(Http2DownstreamConnection *dconn,
   }
 
   dconn->attach_stream_data(sd.get());
-  dconn->get_downstream()->set_downstream_stream_id(stream_id);
+  dconn->set_stream_id(stream_id);
   streams_.append(sd.release());
 
   return 0;
@@ -829,8 +871,21 @@ int on_stream_close_callback(nghttp2_session *session, int32_t stream_id,
   if (dconn) {
     auto downstream = dconn->get_downstream();
     auto upstream = downstream->get_upstream();
+    auto hedge_dconn = static_cast<Http2DownstreamConnection *>(
+        downstream->get_hedge_downstream_connection());
+
+    if (hedge_dconn) {
+      // Either request of hedging failed before its response header
+      // arrived.  The other one is kept.
+      dconn->detach_stream_data();
+      dconn->on_request_error();
 
-    if (downstream->get_downstream_stream_id() % 2 == 0 &&
+      if (hedge_dconn == dconn) {
+        downstream->cancel_hedge();
+      } else {
+        hedge_dconn->win_hedge();
+      }
+    } else if (downstream->get_downstream_stream_id() % 2 == 0 &&
         downstream->get_request_state() == DownstreamState::INITIAL) {
       // Downstream is canceled in backend before it is submitted in
       // frontend session.
@@ -1030,6 +1085,25 @@ int on_invalid_header_callback2(nghttp2_session *session,
 }
 } // namespace
 
+namespace {
+// Keeps the request of |dconn| which receives response header first,
+// and cancels the other request of hedging if any.
+void resolve_hedge(Http2DownstreamConnection *dconn) {
+  auto downstream = dconn->get_downstream();
+
+  if (!dconn->get_hedge()) {
+    downstream->cancel_hedge();
+    return;
+  }
+
+  dconn->win_hedge();
+
+  auto handler = downstream->get_upstream()->get_client_handler();
+  handler->get_worker()->get_worker_stat()->num_hedge_wins.fetch_add(
+      1, std::memory_order_relaxed);
+}
+} // namespace
+
 namespace {
 int on_begin_headers_callback(nghttp2_session *session,
                               const nghttp2_frame *frame, void *user_data) {
@@ -1048,13 +1122,17 @@ int on_begin_headers_callback(nghttp2_session *session,
                                       NGHTTP2_INTERNAL_ERROR);
       return 0;
     }
+    if (frame->headers.cat == NGHTTP2_HCAT_RESPONSE) {
+      resolve_hedge(sd->dconn);
+    }
     return 0;
   }
   case NGHTTP2_PUSH_PROMISE: {
     auto promised_stream_id = frame->push_promise.promised_stream_id;
     auto sd = static_cast<StreamData *>(
         nghttp2_session_get_stream_user_data(session, frame->hd.stream_id));
-    if (!sd || !sd->dconn) {
+    // The hedged request may lose.  Refuse push until it wins.
+    if (!sd || !sd->dconn || sd->dconn->get_hedge()) {
       http2session->submit_rst_stream(promised_stream_id, NGHTTP2_CANCEL);
       return NGHTTP2_ERR_TEMPORAL_CALLBACK_FAILURE;
     }
@@ -1108,6 +1186,11 @@ int on_response_headers(Http2Session *http2session, Downstream *downstream,
       http2session->get_downstream_addr_group());
   downstream->set_addr(http2session->get_addr());
 
+  auto dconn = downstream->get_downstream_connection();
+  if (dconn) {
+    dconn->on_response_header();
+  }
+
   if (LOG_ENABLED(INFO)) {
     std::stringstream ss;
     for (auto &nv : nva) {
@@ -1300,6 +1383,11 @@ int on_frame_recv_callback(nghttp2_session *session, const nghttp2_frame *frame,
         nghttp2_session_get_stream_user_data(session, frame->hd.stream_id));
     if (sd && sd->dconn) {
       auto downstream = sd->dconn->get_downstream();
+      if (downstream->get_hedge_downstream_connection()) {
+        // on_stream_close_callback() decides which request of hedging
+        // is kept.
+        return 0;
+      }
       downstream->set_response_rst_stream_error_code(
           frame->rst_stream.error_code);
       call_downstream_readcb(http2session, downstream);
@@ -1524,6 +1612,14 @@ int on_frame_not_send_callback(nghttp2_session *session,
   }
   auto downstream = sd->dconn->get_downstream();
 
+  if (sd->dconn->get_hedge()) {
+    // The stream has not been opened.  Do not reset it.
+    sd->dconn->detach_stream_data();
+    downstream->cancel_hedge();
+
+    return 0;
+  }
+
   if (lib_error_code == NGHTTP2_ERR_START_STREAM_NOT_ALLOWED) {
     // Migrate to another downstream connection.
     auto upstream = downstream->get_upstream();
@@ -1913,9 +2009,21 @@ void Http2Session::connection_alive() {
 }
 
 void Http2Session::submit_pending_requests() {
-  for (auto dconn = dconns_.head; dconn; dconn = dconn->dlnext) {
+  for (auto next = dconns_.head; next;) {
+    auto dconn = next;
+    next = dconn->dlnext;
+
     auto downstream = dconn->get_downstream();
 
+    if (dconn->get_hedge()) {
+      if (dconn->get_request_pending() && dconn->push_request_headers() != 0) {
+        // This deletes dconn.
+        downstream->cancel_hedge();
+      }
+
+      continue;
+    }
+
     if (!downstream->get_request_pending() ||
         !downstream->request_submission_ready()) {
       continue;
@@ -2379,6 +2487,10 @@ void Http2Session::check_retire() {
 
   ev_prepare_stop(conn_.loop, &prep_);
 
+  // The address may still be used by the other groups.  Do not let
+  // them pick this session.
+  exclude_from_scheduling();
+
   if (!session_) {
     return;
   }
@@ -27,6 +27,7 @@
 #include <netinet/tcp.h>
 #include <assert.h>
 #include <cerrno>
+#include <cmath>
 #include <sstream>
 
 #include "shrpx_client_handler.h"
@@ -55,6 +56,14 @@ namespace {
 constexpr size_t MAX_BUFFER_SIZE = 32_k;
 } // namespace
 
+namespace {
+// DATA payload which is at least this size is handed to the write
+// buffer without copying if the frontend connection is cleartext.
+// Smaller payload is just copied because sharing a region costs an
+// extra chunk.
+constexpr size_t MIN_SHARE_DATA_LENGTH = 4_k;
+} // namespace
+
 namespace {
 int on_stream_close_callback(nghttp2_session *session, int32_t stream_id,
                              uint32_t error_code, void *user_data) {
@@ -467,6 +476,8 @@ void Http2Upstream::initiate_downstream(Downstream *downstream) {
     if (!dconn) {
       if (rv == SHRPX_ERR_TLS_REQUIRED) {
         rv = redirect_to_https(downstream);
+      } else if (rv == SHRPX_ERR_OVERLOADED) {
+        rv = reject_overloaded(downstream);
       } else {
         rv = error_reply(downstream, 502);
       }
@@ -844,7 +855,15 @@ int send_data_callback(nghttp2_session *session, nghttp2_frame *frame,
     wb->append(static_cast<uint8_t>(padlen));
   }
 
-  body->remove(*wb, length);
+  // With TLS, SSL_write is called per chunk, and sharing would
+  // split a DATA frame into small TLS records.  Encryption copies the
+  // data anyway.
+  if (length >= MIN_SHARE_DATA_LENGTH &&
+      !upstream->get_client_handler()->get_ssl()) {
+    body->share(*wb, length);
+  } else {
+    body->remove(*wb, length);
+  }
 
   wb->append(PADDING.data(), padlen);
 
@@ -1347,6 +1366,8 @@ int Http2Upstream::downstream_eof(DownstreamConnection *dconn) {
 int Http2Upstream::downstream_error(DownstreamConnection *dconn, int events) {
   auto downstream = dconn->get_downstream();
 
+  dconn->on_request_error();
+
   if (LOG_ENABLED(INFO)) {
     if (events & Downstream::EVENT_ERROR) {
       DCLOG(INFO, dconn) << "Downstream network/general error";
@@ -1653,6 +1674,10 @@ int Http2Upstream::on_downstream_header_complete(Downstream *downstream) {
     }
   }
 
+  if (!downstream->get_non_final_response()) {
+    downstream->collapse_response_header();
+  }
+
   auto config = get_config();
   auto &httpconf = config->http;
 
@@ -1872,6 +1897,8 @@ int Http2Upstream::on_downstream_header_complete(Downstream *downstream) {
 int Http2Upstream::on_downstream_body(Downstream *downstream,
                                       const uint8_t *data, size_t len,
                                       bool flush) {
+  downstream->collapse_response_body(data, len);
+
   auto body = downstream->get_response_buf();
   body->append(data, len);
 
@@ -1891,6 +1918,8 @@ int Http2Upstream::on_downstream_body_complete(Downstream *downstream) {
     DLOG(INFO, downstream) << "HTTP response completed";
   }
 
+  downstream->collapse_response_complete();
+
   auto &resp = downstream->response();
 
   if (!downstream->validate_response_recv_body_length()) {
@@ -1985,6 +2014,37 @@ int Http2Upstream::redirect_to_https(Downstream *downstream) {
   return send_reply(downstream, nullptr, 0);
 }
 
+int Http2Upstream::reject_overloaded(Downstream *downstream) {
+  auto &resp = downstream->response();
+  auto &balloc = downstream->get_block_allocator();
+  auto &concurrencyconf =
+      handler_->get_worker()->get_downstream_config()->concurrency;
+
+  auto html = http::create_error_html(balloc, 503);
+
+  resp.http_status = 503;
+  resp.fs.add_header_token(StringRef::from_lit("content-type"),
+                           StringRef::from_lit("text/html; charset=UTF-8"),
+                           false, http2::HD_CONTENT_TYPE);
+  resp.fs.add_header_token(StringRef::from_lit("content-length"),
+                           util::make_string_ref_uint(balloc, html.size()),
+                           false, http2::HD_CONTENT_LENGTH);
+  if (concurrencyconf.retry_after > 0.) {
+    resp.fs.add_header_token(
+        StringRef::from_lit("retry-after"),
+        util::make_string_ref_uint(
+            balloc,
+            static_cast<uint64_t>(std::ceil(concurrencyconf.retry_after))),
+        false, -1);
+  }
+
+  if (!downstream->expect_response_body()) {
+    return send_reply(downstream, nullptr, 0);
+  }
+
+  return send_reply(downstream, html.byte(), html.size());
+}
+
 int Http2Upstream::consume(int32_t stream_id, size_t len) {
   int rv;
 
@@ -2041,6 +2101,10 @@ void Http2Upstream::on_handler_delete() {
 int Http2Upstream::on_downstream_reset(Downstream *downstream, bool no_retry) {
   int rv;
 
+  if (downstream->get_downstream_connection()) {
+    downstream->get_downstream_connection()->on_request_error();
+  }
+
   if (downstream->get_dispatch_state() != DispatchState::ACTIVE) {
     // This is error condition when we failed push_request_headers()
     // in initiate_downstream().  Otherwise, we have
@@ -2299,6 +2363,10 @@ void Http2Upstream::response_drain(size_t n) { wb_.drain(n); }
 
 bool Http2Upstream::response_empty() const { return wb_.rleft() == 0; }
 
+SplicePipe *Http2Upstream::get_response_pipe() const { return nullptr; }
+
+bool Http2Upstream::response_pipe_supported() const { return false; }
+
 DefaultMemchunks *Http2Upstream::get_response_buf() { return &wb_; }
 
 Downstream *
@@ -2365,4 +2433,13 @@ void Http2Upstream::cancel_premature_downstream(
 
 size_t Http2Upstream::get_max_buffer_size() const { return max_buffer_size_; }
 
+void Http2Upstream::release_buffers() {
+  if (wb_.rleft() != 0 || nghttp2_session_want_write(session_)) {
+    return;
+  }
+
+  // This fails if a frame is being sent, and it is fine.
+  nghttp2_session_release_buffers(session_);
+}
+
 } // namespace shrpx
@@ -87,6 +87,8 @@ public:
   virtual int response_riovec(struct iovec *iov, int iovcnt) const;
   virtual void response_drain(size_t n);
   virtual bool response_empty() const;
+  virtual SplicePipe *get_response_pipe() const;
+  virtual bool response_pipe_supported() const;
 
   virtual Downstream *on_downstream_push_promise(Downstream *downstream,
                                                  int32_t promised_stream_id);
@@ -95,6 +97,7 @@ public:
                                       Downstream *promised_downstream);
   virtual bool push_enabled() const;
   virtual void cancel_premature_downstream(Downstream *promised_downstream);
+  virtual void release_buffers();
 
   bool get_flow_control() const;
   // Perform HTTP/2 upgrade from |upstream|. On success, this object
@@ -122,11 +125,14 @@ public:
   void on_start_request(const nghttp2_frame *frame);
   int on_request_headers(Downstream *downstream, const nghttp2_frame *frame);
 
-  DefaultMemchunks *get_response_buf();
+  virtual DefaultMemchunks *get_response_buf();
 
   size_t get_max_buffer_size() const;
 
   int redirect_to_https(Downstream *downstream);
+  // Responds to the request with 503 because the backend group
+  // reached its concurrency limit.
+  int reject_overloaded(Downstream *downstream);
 
 private:
   DefaultMemchunks wb_;
@@ -24,6 +24,12 @@
  */
 #include "shrpx_http_downstream_connection.h"
 
+#ifdef HAVE_SYS_SOCKET_H
+#  include <sys/socket.h>
+#endif // HAVE_SYS_SOCKET_H
+
+#include <openssl/err.h>
+
 #include "shrpx_client_handler.h"
 #include "shrpx_upstream.h"
 #include "shrpx_downstream.h"
@@ -45,6 +51,14 @@ using namespace nghttp2;
 
 namespace shrpx {
 
+namespace {
+void remove_from_pool(HttpDownstreamConnection *dconn) {
+  auto addr = dconn->get_addr();
+  auto &dconn_pool = addr->dconn_pool;
+  dconn_pool->remove_downstream_connection(dconn);
+}
+} // namespace
+
 namespace {
 void timeoutcb(struct ev_loop *loop, ev_timer *w, int revents) {
   auto conn = static_cast<Connection *>(w->data);
@@ -59,6 +73,19 @@ void timeoutcb(struct ev_loop *loop, ev_timer *w, int revents) {
   }
 
   auto downstream = dconn->get_downstream();
+
+  if (downstream->get_hedge_downstream_connection() == dconn) {
+    downstream->cancel_hedge();
+    return;
+  }
+
+  if (downstream->get_hedge_downstream_connection()) {
+    // The hedged request is still in flight.  Let it take over.
+    dconn->on_request_error();
+    downstream->promote_hedge_downstream_connection();
+    return;
+  }
+
   auto upstream = downstream->get_upstream();
   auto handler = upstream->get_client_handler();
   auto &resp = downstream->response();
@@ -134,6 +161,11 @@ void connect_timeoutcb(struct ev_loop *loop, ev_timer *w, int revents) {
 
   auto downstream = dconn->get_downstream();
 
+  if (downstream->get_hedge_downstream_connection() == dconn) {
+    downstream->cancel_hedge();
+    return;
+  }
+
   retry_downstream_connection(downstream, 504);
 }
 } // namespace
@@ -152,6 +184,36 @@ void readcb(struct ev_loop *loop, ev_io *w, int revents) {
   auto downstream = dconn->get_downstream();
   auto upstream = downstream->get_upstream();
   auto handler = upstream->get_client_handler();
+  auto hedge_dconn = downstream->get_hedge_downstream_connection();
+
+  if (hedge_dconn) {
+    // Either the original or hedged request is going to receive
+    // response.  Keep the one which answers first.
+    rv = dconn->peek_response();
+    if (rv == 0) {
+      return;
+    }
+
+    if (hedge_dconn == dconn) {
+      if (rv < 0) {
+        downstream->cancel_hedge();
+        return;
+      }
+
+      downstream->promote_hedge_downstream_connection();
+
+      handler->get_worker()->get_worker_stat()->num_hedge_wins.fetch_add(
+          1, std::memory_order_relaxed);
+    } else if (rv < 0) {
+      dconn->on_request_error();
+      downstream->promote_hedge_downstream_connection();
+      return;
+    } else {
+      downstream->cancel_hedge();
+    }
+  } else {
+    downstream->cancel_hedge();
+  }
 
   rv = upstream->downstream_read(dconn);
   if (rv != 0) {
@@ -171,6 +233,14 @@ void writecb(struct ev_loop *loop, ev_io *w, int revents) {
   auto conn = static_cast<Connection *>(w->data);
   auto dconn = static_cast<HttpDownstreamConnection *>(conn->data);
   auto downstream = dconn->get_downstream();
+
+  if (downstream->get_hedge_downstream_connection() == dconn) {
+    if (dconn->on_write() != 0) {
+      downstream->cancel_hedge();
+    }
+    return;
+  }
+
   auto upstream = downstream->get_upstream();
   auto handler = upstream->get_client_handler();
 
@@ -192,6 +262,10 @@ void connectcb(struct ev_loop *loop, ev_io *w, int revents) {
   auto dconn = static_cast<HttpDownstreamConnection *>(conn->data);
   auto downstream = dconn->get_downstream();
   if (dconn->connected() != 0) {
+    if (downstream->get_hedge_downstream_connection() == dconn) {
+      downstream->cancel_hedge();
+      return;
+    }
     backend_retry(downstream);
     return;
   }
@@ -219,17 +293,22 @@ HttpDownstreamConnection::HttpDownstreamConnection(
       response_htp_{0},
       first_write_done_(false),
       reusable_(true),
-      request_header_written_(false) {}
+      request_header_written_(false),
+      prewarming_(false) {}
 
 HttpDownstreamConnection::~HttpDownstreamConnection() {
   if (LOG_ENABLED(INFO)) {
     DCLOG(INFO, this) << "Deleted";
   }
 
+  end_request();
+
   if (dns_query_) {
     auto dns_tracker = worker_->get_dns_tracker();
     dns_tracker->cancel(dns_query_.get());
   }
+
+  downstream_connection_release(addr_);
 }
 
 int HttpDownstreamConnection::attach_downstream(Downstream *downstream) {
@@ -247,6 +326,8 @@ int HttpDownstreamConnection::attach_downstream(Downstream *downstream) {
     return rv;
   }
 
+  begin_request(addr_);
+
   return 0;
 }
 
@@ -321,6 +402,12 @@ int HttpDownstreamConnection::initiate_connection() {
 
               rv = this->initiate_connection();
               if (rv != 0) {
+                if (this->prewarming_) {
+                  // This deletes |this|.
+                  remove_from_pool(this);
+                  return;
+                }
+
                 // This callback destroys |this|.
                 auto downstream = this->downstream_;
                 backend_retry(downstream);
@@ -804,18 +891,18 @@ void HttpDownstreamConnection::end_upload_data_chunk() {
   }
 }
 
-namespace {
-void remove_from_pool(HttpDownstreamConnection *dconn) {
-  auto addr = dconn->get_addr();
-  auto &dconn_pool = addr->dconn_pool;
-  dconn_pool->remove_downstream_connection(dconn);
-}
-} // namespace
-
 namespace {
 void idle_readcb(struct ev_loop *loop, ev_io *w, int revents) {
   auto conn = static_cast<Connection *>(w->data);
   auto dconn = static_cast<HttpDownstreamConnection *>(conn->data);
+
+  // TLS post-handshake messages, such as NewSessionTicket, may arrive
+  // after a pre-warmed connection became idle.  SSL_peek consumes
+  // them.
+  if (dconn->peek_response() == 0) {
+    return;
+  }
+
   if (LOG_ENABLED(INFO)) {
     DCLOG(INFO, dconn) << "Idle connection EOF";
   }
@@ -834,6 +921,10 @@ void idle_timeoutcb(struct ev_loop *loop, ev_timer *w, int revents) {
     return;
   }
 
+  if (dconn->keep_idle()) {
+    return;
+  }
+
   if (LOG_ENABLED(INFO)) {
     DCLOG(INFO, dconn) << "Idle connection timeout";
   }
@@ -843,12 +934,117 @@ void idle_timeoutcb(struct ev_loop *loop, ev_timer *w, int revents) {
 }
 } // namespace
 
+namespace {
+void prewarm_timeoutcb(struct ev_loop *loop, ev_timer *w, int revents) {
+  auto conn = static_cast<Connection *>(w->data);
+  auto dconn = static_cast<HttpDownstreamConnection *>(conn->data);
+
+  if (w == &conn->rt && !conn->expired_rt()) {
+    return;
+  }
+
+  DCLOG(WARN, dconn) << "Pre-warm connection time out; addr="
+                     << util::to_numeric_addr(dconn->get_raddr());
+
+  downstream_failure(dconn->get_addr(), dconn->get_raddr());
+
+  remove_from_pool(dconn);
+  // dconn was deleted
+}
+} // namespace
+
+namespace {
+void prewarm_handshakecb(struct ev_loop *loop, ev_io *w, int revents) {
+  auto conn = static_cast<Connection *>(w->data);
+  auto dconn = static_cast<HttpDownstreamConnection *>(conn->data);
+
+  auto rv = w == &conn->rev ? dconn->on_read() : dconn->on_write();
+  if (rv != 0) {
+    remove_from_pool(dconn);
+    // dconn was deleted
+  }
+}
+} // namespace
+
+namespace {
+void prewarm_connectcb(struct ev_loop *loop, ev_io *w, int revents) {
+  auto conn = static_cast<Connection *>(w->data);
+  auto dconn = static_cast<HttpDownstreamConnection *>(conn->data);
+
+  if (dconn->connected() != 0) {
+    remove_from_pool(dconn);
+    // dconn was deleted
+    return;
+  }
+
+  if (conn->tls.ssl) {
+    // Send ClientHello.  The rest of TLS handshake is driven by
+    // prewarm_handshakecb.
+    prewarm_handshakecb(loop, w, revents);
+    return;
+  }
+
+  dconn->finish_prewarm();
+}
+} // namespace
+
+int HttpDownstreamConnection::prewarm() {
+  if (LOG_ENABLED(INFO)) {
+    DCLOG(INFO, this) << "Pre-warming connection to " << addr_->host << ":"
+                      << addr_->port;
+  }
+
+  prewarming_ = true;
+
+  ev_set_cb(&conn_.wev, prewarm_connectcb);
+  ev_set_cb(&conn_.rt, prewarm_timeoutcb);
+  ev_set_cb(&conn_.wt, prewarm_timeoutcb);
+
+  return initiate_connection();
+}
+
+int HttpDownstreamConnection::finish_prewarm() {
+  if (LOG_ENABLED(INFO)) {
+    DCLOG(INFO, this) << "Pre-warmed connection is ready";
+  }
+
+  prewarming_ = false;
+
+  ev_set_cb(&conn_.wev, writecb);
+
+  start_idle();
+
+  addr_->dconn_pool->promote_downstream_connection(this);
+
+  return 0;
+}
+
+void HttpDownstreamConnection::set_downstream_addr(
+    const std::shared_ptr<DownstreamAddrGroup> &group, DownstreamAddr *addr) {
+  if (raddr_ == &addr_->addr) {
+    raddr_ = &addr->addr;
+  }
+
+  if (conn_.tls.client_session_cache) {
+    conn_.tls.client_session_cache = &addr->tls_session_cache;
+  }
+
+  group_ = group;
+  addr_ = addr;
+}
+
 void HttpDownstreamConnection::detach_downstream(Downstream *downstream) {
   if (LOG_ENABLED(INFO)) {
     DCLOG(INFO, this) << "Detaching from DOWNSTREAM:" << downstream;
   }
   downstream_ = nullptr;
 
+  end_request();
+
+  start_idle();
+}
+
+void HttpDownstreamConnection::start_idle() {
   ev_set_cb(&conn_.rev, idle_readcb);
   ioctrl_.force_resume_read();
 
@@ -866,6 +1062,21 @@ void HttpDownstreamConnection::detach_downstream(Downstream *downstream) {
   ev_timer_stop(conn_.loop, &conn_.wt);
 }
 
+bool HttpDownstreamConnection::keep_idle() {
+  if (worker_->get_graceful_shutdown() ||
+      !downstream_connection_keep_idle(addr_, addr_->dconn_pool->size())) {
+    return false;
+  }
+
+  if (LOG_ENABLED(INFO)) {
+    DCLOG(INFO, this) << "Keep pre-warmed idle connection";
+  }
+
+  conn_.again_rt();
+
+  return true;
+}
+
 void HttpDownstreamConnection::pause_read(IOCtrlReason reason) {
   ioctrl_.pause_read(reason);
 }
@@ -873,9 +1084,11 @@ void HttpDownstreamConnection::pause_read(IOCtrlReason reason) {
 int HttpDownstreamConnection::resume_read(IOCtrlReason reason,
                                           size_t consumed) {
   auto &downstreamconf = *worker_->get_downstream_config();
+  auto pipe = downstream_->get_response_pipe();
 
   if (downstream_->get_response_buf()->rleft() <=
-      downstreamconf.request_buffer_size / 2) {
+          downstreamconf.request_buffer_size / 2 &&
+      (!pipe || pipe->len == 0)) {
     ioctrl_.resume_read(reason);
   }
 
@@ -926,6 +1139,8 @@ int htp_hdrs_completecb(llhttp_t *htp) {
   downstream->set_downstream_addr_group(dconn->get_downstream_addr_group());
   downstream->set_addr(dconn->get_addr());
 
+  dconn->on_response_header();
+
   // Server MUST NOT send Transfer-Encoding with a status code 1xx or
   // 204.  Also server MUST NOT send Transfer-Encoding with a status
   // code 2xx to a CONNECT request.  Same holds true with
@@ -1222,12 +1437,85 @@ int HttpDownstreamConnection::read_clear() {
       return rv;
     }
 
+    if (can_splice_response() && downstream_->start_response_splice() == 0) {
+      if (LOG_ENABLED(INFO)) {
+        DCLOG(INFO, this) << "Relay response body with splice";
+      }
+
+      on_read_ = &HttpDownstreamConnection::read_splice;
+
+      return read_splice();
+    }
+
     if (!ev_is_active(&conn_.rev)) {
       return 0;
     }
   }
 }
 
+bool HttpDownstreamConnection::can_splice_response() const {
+  auto &spliceconf = get_config()->splice_relay;
+
+  if (!spliceconf.enabled || conn_.tls.ssl ||
+      !downstream_->response_body_spliceable(spliceconf.min_length)) {
+    return false;
+  }
+
+  auto upstream = downstream_->get_upstream();
+  auto handler = upstream->get_client_handler();
+
+  // The frontend TLS connection can receive data from pipe if the
+  // kernel encrypts it.
+  return upstream->response_pipe_supported() &&
+         (!handler->get_ssl() || handler->get_connection()->tls.ktls_tx);
+}
+
+int HttpDownstreamConnection::read_splice() {
+  conn_.last_read = ev_now(conn_.loop);
+
+  auto pipe = downstream_->get_response_pipe();
+  auto &resp = downstream_->response();
+
+  for (;;) {
+    auto left = static_cast<size_t>(resp.fs.content_length -
+                                    resp.recv_body_length);
+    if (left == 0) {
+      on_read_ = &HttpDownstreamConnection::read_clear;
+
+      downstream_->set_response_state(DownstreamState::MSG_COMPLETE);
+      downstream_->pause_read(SHRPX_MSG_BLOCK);
+
+      return downstream_->get_upstream()->on_downstream_body_complete(
+          downstream_);
+    }
+
+    if (pipe->len == pipe->capacity) {
+      downstream_->pause_read(SHRPX_NO_BUFFER);
+      return 0;
+    }
+
+    auto nread = conn_.splice_read_clear(
+        pipe->wfd, std::min(left, pipe->capacity - pipe->len));
+    if (nread == 0) {
+      // If pipe is not empty, splice(2) may fail because pipe has no
+      // slot left even if there is room in terms of bytes.  Wait for
+      // frontend to drain pipe.
+      if (pipe->len) {
+        downstream_->pause_read(SHRPX_NO_BUFFER);
+      }
+      return 0;
+    }
+
+    if (nread < 0) {
+      return nread;
+    }
+
+    pipe->len += nread;
+    resp.recv_body_length += nread;
+    downstream_->response_sent_body_length += nread;
+  }
+}
+
 int HttpDownstreamConnection::write_clear() {
   conn_.last_read = ev_now(conn_.loop);
 
@@ -1315,6 +1603,10 @@ int HttpDownstreamConnection::tls_handshake() {
 
   // TODO Check negotiated ALPN
 
+  if (prewarming_) {
+    return finish_prewarm();
+  }
+
   return on_write();
 }
 
@@ -1502,6 +1794,11 @@ int HttpDownstreamConnection::connected() {
     on_read_ = &HttpDownstreamConnection::tls_handshake;
     on_write_ = &HttpDownstreamConnection::tls_handshake;
 
+    if (prewarming_) {
+      ev_set_cb(&conn_.rev, prewarm_handshakecb);
+      ev_set_cb(&conn_.wev, prewarm_handshakecb);
+    }
+
     return 0;
   }
 
@@ -1518,6 +1815,46 @@ int HttpDownstreamConnection::connected() {
   return 0;
 }
 
+int HttpDownstreamConnection::peek_response() {
+  if (conn_.tls.ssl) {
+    if (!SSL_is_init_finished(conn_.tls.ssl)) {
+      return on_read() == 0 ? 0 : -1;
+    }
+
+    ERR_clear_error();
+
+    uint8_t b;
+    auto rv = SSL_peek(conn_.tls.ssl, &b, 1);
+    if (rv > 0) {
+      return 1;
+    }
+
+    switch (SSL_get_error(conn_.tls.ssl, rv)) {
+    case SSL_ERROR_WANT_READ:
+    case SSL_ERROR_WANT_WRITE:
+      return 0;
+    default:
+      return -1;
+    }
+  }
+
+  uint8_t b;
+  ssize_t nread;
+
+  while ((nread = recv(conn_.fd, &b, 1, MSG_PEEK)) == -1 && errno == EINTR)
+    ;
+
+  if (nread > 0) {
+    return 1;
+  }
+
+  if (nread == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+    return 0;
+  }
+
+  return -1;
+}
+
 int HttpDownstreamConnection::on_read() { return on_read_(*this); }
 
 int HttpDownstreamConnection::on_write() { return on_write_(*this); }
@@ -74,6 +74,9 @@ public:
 
   int write_first();
   int read_clear();
+  // Relays the rest of response body to the pipe of downstream with
+  // splice(2).
+  int read_splice();
   int write_clear();
   int read_tls();
   int write_tls();
@@ -92,7 +95,43 @@ public:
 
   int process_blocked_request_buf();
 
+  // Returns true if the rest of response body can be relayed with
+  // splice(2).
+  bool can_splice_response() const;
+
+  // Checks whether response data is available without consuming it.
+  // This is used to decide which of the original and hedged requests
+  // answered first.  It drives TLS handshake if it is in progress.
+  // This function returns 1 if response data is available, 0 if not,
+  // or -1 if the connection failed.
+  int peek_response();
+
+  // Establishes a connection to backend without request so that it
+  // is pooled as an idle connection.  The caller must add this
+  // object to the connection pool with
+  // DownstreamConnectionPool::add_warming_downstream_connection()
+  // before calling this function.
+  int prewarm();
+  // Called when a connection established by prewarm() gets ready.
+  // This object is made available for reuse.
+  int finish_prewarm();
+
+  // Called when the keep-alive timeout of this idle connection
+  // expires.  This function returns true if the connection is kept
+  // open as one of the pre-warmed connections of its address, and
+  // restarts the timer.
+  bool keep_idle();
+
+  // Makes this idle connection belong to |addr| in |group|.  This is
+  // used when the backend configuration is replaced, and |addr|
+  // connects to the same endpoint as the current one.
+  void set_downstream_addr(const std::shared_ptr<DownstreamAddrGroup> &group,
+                           DownstreamAddr *addr);
+
 private:
+  // Sets up idle connection callbacks and timeouts.
+  void start_idle();
+
   Connection conn_;
   std::function<int(HttpDownstreamConnection &)> on_read_, on_write_,
       signal_write_;
@@ -117,6 +156,8 @@ private:
   bool reusable_;
   // true if request header is written to request buffer.
   bool request_header_written_;
+  // true if this connection is being established by prewarm().
+  bool prewarming_;
 };
 
 } // namespace shrpx
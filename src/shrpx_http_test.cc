@@ -118,4 +118,76 @@ void test_shrpx_http_create_affinity_cookie(void) {
   CU_ASSERT("charlie=01111111; Path=bar; Secure" == c);
 }
 
+void test_shrpx_http_create_collapse_key(void) {
+  BlockAllocator balloc(1024, 1024);
+  auto vary = std::vector<StringRef>{StringRef::from_lit("accept-encoding"),
+                                     StringRef::from_lit("accept-language")};
+  auto headers = HeaderRefs{
+      {StringRef::from_lit("accept-encoding"), StringRef::from_lit("gzip")},
+      {StringRef::from_lit("user-agent"), StringRef::from_lit("foo")},
+      {StringRef::from_lit("accept-encoding"), StringRef::from_lit("br")},
+  };
+
+  CU_ASSERT("https example.com /alpha\ngzip,br,\n" ==
+            http::create_collapse_key(
+                balloc, StringRef::from_lit("https"),
+                StringRef::from_lit("example.com"),
+                StringRef::from_lit("/alpha"), headers, vary));
+  CU_ASSERT("http example.com /alpha" ==
+            http::create_collapse_key(
+                balloc, StringRef::from_lit("http"),
+                StringRef::from_lit("example.com"),
+                StringRef::from_lit("/alpha"), headers,
+                std::vector<StringRef>{}));
+}
+
+void test_shrpx_http_collapsible_response(void) {
+  auto vary = std::vector<StringRef>{StringRef::from_lit("accept-encoding")};
+
+  CU_ASSERT(http::collapsible_response(200, HeaderRefs{}, vary));
+  CU_ASSERT(http::collapsible_response(404, HeaderRefs{}, vary));
+  CU_ASSERT(!http::collapsible_response(206, HeaderRefs{}, vary));
+  CU_ASSERT(!http::collapsible_response(302, HeaderRefs{}, vary));
+  CU_ASSERT(!http::collapsible_response(500, HeaderRefs{}, vary));
+
+  CU_ASSERT(http::collapsible_response(
+      200,
+      HeaderRefs{{StringRef::from_lit("cache-control"),
+                  StringRef::from_lit("public, max-age=60"), false,
+                  http2::HD_CACHE_CONTROL}},
+      vary));
+  CU_ASSERT(!http::collapsible_response(
+      200,
+      HeaderRefs{{StringRef::from_lit("cache-control"),
+                  StringRef::from_lit("max-age=60 , private"), false,
+                  http2::HD_CACHE_CONTROL}},
+      vary));
+  CU_ASSERT(!http::collapsible_response(
+      200,
+      HeaderRefs{{StringRef::from_lit("cache-control"),
+                  StringRef::from_lit("no-cache=\"foo\""), false,
+                  http2::HD_CACHE_CONTROL}},
+      vary));
+  CU_ASSERT(!http::collapsible_response(
+      200,
+      HeaderRefs{
+          {StringRef::from_lit("set-cookie"), StringRef::from_lit("a=b")}},
+      vary));
+
+  CU_ASSERT(http::collapsible_response(
+      200,
+      HeaderRefs{{StringRef::from_lit("vary"),
+                  StringRef::from_lit("Accept-Encoding")}},
+      vary));
+  CU_ASSERT(!http::collapsible_response(
+      200,
+      HeaderRefs{{StringRef::from_lit("vary"),
+                  StringRef::from_lit("accept-encoding, cookie")}},
+      vary));
+  CU_ASSERT(!http::collapsible_response(
+      200,
+      HeaderRefs{{StringRef::from_lit("vary"), StringRef::from_lit("*")}},
+      vary));
+}
+
 } // namespace shrpx
@@ -34,6 +34,8 @@ namespace shrpx {
 void test_shrpx_http_create_forwarded(void);
 void test_shrpx_http_create_via_header_value(void);
 void test_shrpx_http_create_affinity_cookie(void);
+void test_shrpx_http_create_collapse_key(void);
+void test_shrpx_http_collapsible_response(void);
 
 } // namespace shrpx
 
@@ -25,6 +25,7 @@
 #include "shrpx_https_upstream.h"
 
 #include <cassert>
+#include <cmath>
 #include <set>
 #include <sstream>
 
@@ -105,9 +106,7 @@ void HttpsUpstream::on_start_request() {
   auto conn = handler_->get_connection();
   auto &upstreamconf = get_config()->conn.upstream;
 
-  conn->rt.repeat = upstreamconf.timeout.read;
-
-  handler_->repeat_read_timer();
+  conn->again_rt(upstreamconf.timeout.read);
 
   ++num_requests_;
 }
@@ -465,6 +464,8 @@ int htp_hdrs_completecb(llhttp_t *htp) {
     if (!dconn) {
       if (rv == SHRPX_ERR_TLS_REQUIRED) {
         upstream->redirect_to_https(downstream);
+      } else if (rv == SHRPX_ERR_OVERLOADED) {
+        upstream->reject_overloaded(downstream);
       }
       downstream->set_request_state(DownstreamState::CONNECT_FAIL);
       return -1;
@@ -715,9 +716,10 @@ int HttpsUpstream::on_write() {
   }
 
   auto output = downstream->get_response_buf();
+  auto pipe = downstream->get_response_pipe();
   const auto &resp = downstream->response();
 
-  if (output->rleft() > 0) {
+  if (output->rleft() > 0 || (pipe && pipe->len > 0)) {
     return 0;
   }
 
@@ -743,9 +745,7 @@ int HttpsUpstream::on_write() {
       auto conn = handler_->get_connection();
       auto &upstreamconf = get_config()->conn.upstream;
 
-      conn->rt.repeat = upstreamconf.timeout.idle_read;
-
-      handler_->repeat_read_timer();
+      conn->again_rt(upstreamconf.timeout.idle_read);
 
       return resume_read(SHRPX_NO_BUFFER, nullptr, 0);
     }
@@ -883,6 +883,9 @@ end:
 
 int HttpsUpstream::downstream_error(DownstreamConnection *dconn, int events) {
   auto downstream = dconn->get_downstream();
+
+  dconn->on_request_error();
+
   if (LOG_ENABLED(INFO)) {
     if (events & Downstream::EVENT_ERROR) {
       DCLOG(INFO, dconn) << "Network error/general error";
@@ -1082,6 +1085,10 @@ int HttpsUpstream::on_downstream_header_complete(Downstream *downstream) {
     return 0;
   }
 
+  if (!downstream->get_non_final_response()) {
+    downstream->collapse_response_header();
+  }
+
 #ifdef HAVE_MRUBY
   if (!downstream->get_non_final_response()) {
     assert(dconn);
@@ -1301,6 +1308,9 @@ int HttpsUpstream::on_downstream_body(Downstream *downstream,
   if (len == 0) {
     return 0;
   }
+
+  downstream->collapse_response_body(data, len);
+
   auto output = downstream->get_response_buf();
   if (downstream->get_chunked_response()) {
     output->append(util::utox(len));
@@ -1320,6 +1330,8 @@ int HttpsUpstream::on_downstream_body_complete(Downstream *downstream) {
   const auto &req = downstream->request();
   auto &resp = downstream->response();
 
+  downstream->collapse_response_complete();
+
   if (downstream->get_chunked_response()) {
     auto output = downstream->get_response_buf();
     const auto &trailers = resp.fs.trailers();
@@ -1402,6 +1414,40 @@ int HttpsUpstream::redirect_to_https(Downstream *downstream) {
   return send_reply(downstream, nullptr, 0);
 }
 
+int HttpsUpstream::reject_overloaded(Downstream *downstream) {
+  auto &resp = downstream->response();
+  auto &balloc = downstream->get_block_allocator();
+  auto &concurrencyconf =
+      handler_->get_worker()->get_downstream_config()->concurrency;
+
+  auto html = http::create_error_html(balloc, 503);
+
+  resp.http_status = 503;
+  resp.fs.add_header_token(StringRef::from_lit("content-type"),
+                           StringRef::from_lit("text/html; charset=UTF-8"),
+                           false, http2::HD_CONTENT_TYPE);
+  resp.fs.add_header_token(StringRef::from_lit("content-length"),
+                           util::make_string_ref_uint(balloc, html.size()),
+                           false, http2::HD_CONTENT_LENGTH);
+  if (concurrencyconf.retry_after > 0.) {
+    resp.fs.add_header_token(
+        StringRef::from_lit("retry-after"),
+        util::make_string_ref_uint(
+            balloc,
+            static_cast<uint64_t>(std::ceil(concurrencyconf.retry_after))),
+        false, -1);
+  }
+  resp.fs.add_header_token(StringRef::from_lit("connection"),
+                           StringRef::from_lit("close"), false,
+                           http2::HD_CONNECTION);
+
+  if (!downstream->expect_response_body()) {
+    return send_reply(downstream, nullptr, 0);
+  }
+
+  return send_reply(downstream, html.byte(), html.size());
+}
+
 void HttpsUpstream::log_response_headers(DefaultMemchunks *buf) const {
   std::string nhdrs;
   for (auto chunk = buf->head; chunk; chunk = chunk->next) {
@@ -1425,6 +1471,10 @@ int HttpsUpstream::on_downstream_reset(Downstream *downstream, bool no_retry) {
 
   assert(downstream == downstream_.get());
 
+  if (downstream_->get_downstream_connection()) {
+    downstream_->get_downstream_connection()->on_request_error();
+  }
+
   downstream_->pop_downstream_connection();
 
   if (!downstream_->request_submission_ready()) {
@@ -1515,8 +1565,27 @@ bool HttpsUpstream::response_empty() const {
   }
 
   auto buf = downstream_->get_response_buf();
+  auto pipe = downstream_->get_response_pipe();
 
-  return buf->rleft() == 0;
+  return buf->rleft() == 0 && (!pipe || pipe->len == 0);
+}
+
+SplicePipe *HttpsUpstream::get_response_pipe() const {
+  if (!downstream_) {
+    return nullptr;
+  }
+
+  return downstream_->get_response_pipe();
+}
+
+bool HttpsUpstream::response_pipe_supported() const { return true; }
+
+DefaultMemchunks *HttpsUpstream::get_response_buf() {
+  if (!downstream_) {
+    return nullptr;
+  }
+
+  return downstream_->get_response_buf();
 }
 
 Downstream *
@@ -1535,4 +1604,6 @@ bool HttpsUpstream::push_enabled() const { return false; }
 void HttpsUpstream::cancel_premature_downstream(
     Downstream *promised_downstream) {}
 
+void HttpsUpstream::release_buffers() {}
+
 } // namespace shrpx
@@ -82,6 +82,9 @@ public:
   virtual int response_riovec(struct iovec *iov, int iovcnt) const;
   virtual void response_drain(size_t n);
   virtual bool response_empty() const;
+  virtual SplicePipe *get_response_pipe() const;
+  virtual bool response_pipe_supported() const;
+  virtual DefaultMemchunks *get_response_buf();
 
   virtual Downstream *on_downstream_push_promise(Downstream *downstream,
                                                  int32_t promised_stream_id);
@@ -90,10 +93,14 @@ public:
                                       Downstream *promised_downstream);
   virtual bool push_enabled() const;
   virtual void cancel_premature_downstream(Downstream *promised_downstream);
+  virtual void release_buffers();
 
   void reset_current_header_length();
   void log_response_headers(DefaultMemchunks *buf) const;
   int redirect_to_https(Downstream *downstream);
+  // Responds to the request with 503 because the backend group
+  // reached its concurrency limit.
+  int reject_overloaded(Downstream *downstream);
 
   // Called when new request has started.
   void on_start_request();
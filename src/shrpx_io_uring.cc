@@ -0,0 +1,520 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_io_uring.h"
+
+#ifdef HAVE_IO_URING
+
+#  ifdef HAVE_UNISTD_H
+#    include <unistd.h>
+#  endif // HAVE_UNISTD_H
+#  include <sys/mman.h>
+#  include <sys/socket.h>
+#  include <sys/syscall.h>
+
+#  include <cassert>
+#  include <cerrno>
+#  include <cstdlib>
+#  include <cstring>
+#  include <algorithm>
+
+#  include "shrpx_log.h"
+
+using namespace nghttp2;
+
+namespace shrpx {
+
+namespace {
+// The buffer group ID of the provided buffer ring.
+constexpr uint16_t BUFFER_GROUP_ID = 0;
+} // namespace
+
+namespace {
+// The user data of SQE has the operation type in the most significant
+// 8 bits, the generation of the slot in the next 24 bits, and the
+// slot index in the least significant 32 bits.  The generation
+// detects the completion for the operation which has been
+// unregistered.  The user data 0 is used for the SQE whose completion
+// is ignored.
+uint64_t make_user_data(IOUringOpType type, uint32_t gen, uint32_t slot) {
+  return (static_cast<uint64_t>(type) << 56) |
+         (static_cast<uint64_t>(gen & 0xffffffu) << 32) | slot;
+}
+} // namespace
+
+namespace {
+int sys_io_uring_setup(uint32_t entries, io_uring_params *params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+} // namespace
+
+namespace {
+int sys_io_uring_enter(int fd, uint32_t to_submit, uint32_t min_complete,
+                       uint32_t flags) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit,
+                                  min_complete, flags, nullptr, 0));
+}
+} // namespace
+
+namespace {
+int sys_io_uring_register(int fd, uint32_t opcode, void *arg,
+                          uint32_t nr_args) {
+  return static_cast<int>(
+      syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+} // namespace
+
+namespace {
+void readcb(struct ev_loop *loop, ev_io *w, int revents) {
+  auto ring = static_cast<IOUring *>(w->data);
+  ring->process_completions();
+}
+} // namespace
+
+namespace {
+void preparecb(struct ev_loop *loop, ev_prepare *w, int revents) {
+  auto ring = static_cast<IOUring *>(w->data);
+  ring->submit();
+}
+} // namespace
+
+void io_uring_op_init(IOUringOp *op, IOUringCb cb, void *data, int fd,
+                      IOUringOpType type) {
+  op->cb = cb;
+  op->data = data;
+  op->fd = fd;
+  op->slot = -1;
+  op->type = type;
+  op->armed = false;
+}
+
+IOUring::IOUring(struct ev_loop *loop, MemchunkPool *mcpool)
+    : loop_(loop),
+      mcpool_(mcpool),
+      sq_ring_(nullptr),
+      sq_ring_size_(0),
+      sq_head_(nullptr),
+      sq_tail_(nullptr),
+      sq_flags_(nullptr),
+      sq_array_(nullptr),
+      sq_mask_(0),
+      sqe_tail_(0),
+      sqes_(nullptr),
+      sqes_size_(0),
+      cq_ring_(nullptr),
+      cq_ring_size_(0),
+      cq_head_(nullptr),
+      cq_tail_(nullptr),
+      cq_mask_(0),
+      cqes_(nullptr),
+      buf_ring_(nullptr),
+      buf_ring_size_(0),
+      buf_tail_(0),
+      buf_mask_(0),
+      fd_(-1) {
+  ev_io_init(&rev_, readcb, -1, EV_READ);
+  rev_.data = this;
+  ev_prepare_init(&prep_, preparecb);
+  prep_.data = this;
+}
+
+IOUring::~IOUring() {
+  ev_io_stop(loop_, &rev_);
+  ev_prepare_stop(loop_, &prep_);
+
+  if (fd_ != -1) {
+    if (buf_ring_) {
+      io_uring_buf_reg reg{};
+      reg.bgid = BUFFER_GROUP_ID;
+      (void)sys_io_uring_register(fd_, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+    }
+
+    close(fd_);
+  }
+
+  for (auto m : bufs_) {
+    mcpool_->recycle(m);
+  }
+
+  if (buf_ring_) {
+    munmap(buf_ring_, buf_ring_size_);
+  }
+  if (sqes_) {
+    munmap(sqes_, sqes_size_);
+  }
+  if (cq_ring_ && cq_ring_ != sq_ring_) {
+    munmap(cq_ring_, cq_ring_size_);
+  }
+  if (sq_ring_) {
+    munmap(sq_ring_, sq_ring_size_);
+  }
+}
+
+namespace {
+void *map_ring(int fd, size_t size, off_t offset) {
+  auto p = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, fd, offset);
+  if (p == MAP_FAILED) {
+    return nullptr;
+  }
+  return p;
+}
+} // namespace
+
+int IOUring::init(uint32_t entries, uint32_t nbufs) {
+  io_uring_params params{};
+  params.flags = IORING_SETUP_CLAMP;
+
+  auto fd = sys_io_uring_setup(entries, &params);
+  if (fd == -1) {
+    auto error = errno;
+    LOG(WARN) << "io_uring_setup() failed: errno=" << error;
+    return -1;
+  }
+
+  fd_ = fd;
+
+  // IORING_FEAT_LINKED_FILE was added in Linux 6.0, which also
+  // introduced multishot recv.
+  if (!(params.features & IORING_FEAT_NODROP) ||
+      !(params.features & IORING_FEAT_LINKED_FILE)) {
+    LOG(WARN) << "io_uring: kernel is too old";
+    return -1;
+  }
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+  cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+  }
+
+  sq_ring_ =
+      static_cast<uint8_t *>(map_ring(fd_, sq_ring_size_, IORING_OFF_SQ_RING));
+  if (!sq_ring_) {
+    auto error = errno;
+    LOG(WARN) << "io_uring: mmap() for SQ ring failed: errno=" << error;
+    return -1;
+  }
+
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    cq_ring_ = sq_ring_;
+  } else {
+    cq_ring_ = static_cast<uint8_t *>(
+        map_ring(fd_, cq_ring_size_, IORING_OFF_CQ_RING));
+    if (!cq_ring_) {
+      auto error = errno;
+      LOG(WARN) << "io_uring: mmap() for CQ ring failed: errno=" << error;
+      return -1;
+    }
+  }
+
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  sqes_ = static_cast<io_uring_sqe *>(
+      map_ring(fd_, sqes_size_, IORING_OFF_SQES));
+  if (!sqes_) {
+    auto error = errno;
+    LOG(WARN) << "io_uring: mmap() for SQEs failed: errno=" << error;
+    return -1;
+  }
+
+  sq_head_ = reinterpret_cast<uint32_t *>(sq_ring_ + params.sq_off.head);
+  sq_tail_ = reinterpret_cast<uint32_t *>(sq_ring_ + params.sq_off.tail);
+  sq_flags_ = reinterpret_cast<uint32_t *>(sq_ring_ + params.sq_off.flags);
+  sq_array_ = reinterpret_cast<uint32_t *>(sq_ring_ + params.sq_off.array);
+  sq_mask_ = *reinterpret_cast<uint32_t *>(sq_ring_ + params.sq_off.ring_mask);
+  sqe_tail_ = *sq_tail_;
+
+  cq_head_ = reinterpret_cast<uint32_t *>(cq_ring_ + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<uint32_t *>(cq_ring_ + params.cq_off.tail);
+  cq_mask_ = *reinterpret_cast<uint32_t *>(cq_ring_ + params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<io_uring_cqe *>(cq_ring_ + params.cq_off.cqes);
+
+  buf_ring_size_ = nbufs * sizeof(io_uring_buf);
+  auto p = mmap(nullptr, buf_ring_size_, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED) {
+    auto error = errno;
+    LOG(WARN) << "io_uring: mmap() for buffer ring failed: errno=" << error;
+    return -1;
+  }
+
+  buf_ring_ = static_cast<io_uring_buf *>(p);
+  buf_mask_ = nbufs - 1;
+
+  io_uring_buf_reg reg{};
+  reg.ring_addr = reinterpret_cast<uint64_t>(buf_ring_);
+  reg.ring_entries = nbufs;
+  reg.bgid = BUFFER_GROUP_ID;
+
+  if (sys_io_uring_register(fd_, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+    auto error = errno;
+    LOG(WARN) << "io_uring: registering buffer ring failed: errno=" << error;
+    munmap(buf_ring_, buf_ring_size_);
+    buf_ring_ = nullptr;
+    return -1;
+  }
+
+  bufs_.resize(nbufs);
+  for (uint32_t i = 0; i < nbufs; ++i) {
+    bufs_[i] = mcpool_->get();
+    provide_buffer(i);
+  }
+
+  ev_io_set(&rev_, fd_, EV_READ);
+  ev_io_start(loop_, &rev_);
+  ev_prepare_start(loop_, &prep_);
+
+  return 0;
+}
+
+void IOUring::provide_buffer(uint16_t bid) {
+  auto m = bufs_[bid];
+
+  m->reset();
+
+  // Do not overwrite resv field which is shared with the ring tail.
+  auto &buf = buf_ring_[buf_tail_ & buf_mask_];
+  buf.addr = reinterpret_cast<uint64_t>(m->pos);
+  buf.len = m->left();
+  buf.bid = bid;
+
+  ++buf_tail_;
+
+  __atomic_store_n(&buf_ring_[0].resv, buf_tail_, __ATOMIC_RELEASE);
+}
+
+io_uring_sqe *IOUring::get_sqe() {
+  if (sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) > sq_mask_) {
+    submit();
+
+    if (sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) > sq_mask_) {
+      return nullptr;
+    }
+  }
+
+  auto idx = sqe_tail_ & sq_mask_;
+  auto sqe = &sqes_[idx];
+
+  sq_array_[idx] = idx;
+  ++sqe_tail_;
+
+  memset(sqe, 0, sizeof(*sqe));
+
+  return sqe;
+}
+
+void IOUring::submit() {
+  auto to_submit = sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+  if (to_submit == 0) {
+    return;
+  }
+
+  __atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+
+  int rv;
+  while ((rv = sys_io_uring_enter(fd_, to_submit, 0, 0)) == -1 &&
+         errno == EINTR)
+    ;
+  if (rv == -1) {
+    // EAGAIN or EBUSY.  The remaining SQEs are submitted next time.
+    auto error = errno;
+    if (LOG_ENABLED(INFO)) {
+      LOG(INFO) << "io_uring_enter() failed: errno=" << error;
+    }
+  }
+}
+
+void IOUring::start(IOUringOp *op) {
+  if (op->armed) {
+    return;
+  }
+
+  if (op->slot == -1) {
+    if (free_slots_.empty()) {
+      op->slot = static_cast<int>(slots_.size());
+      slots_.push_back(Slot{op, 0});
+    } else {
+      op->slot = free_slots_.back();
+      free_slots_.pop_back();
+      slots_[op->slot].op = op;
+    }
+  }
+
+  auto sqe = get_sqe();
+  if (!sqe) {
+    LOG(WARN) << "io_uring: SQ ring is full";
+    return;
+  }
+
+  sqe->fd = op->fd;
+
+  switch (op->type) {
+  case IOUringOpType::ACCEPT:
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    break;
+  case IOUringOpType::RECV:
+    sqe->opcode = IORING_OP_RECV;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BUFFER_GROUP_ID;
+    break;
+  default:
+    assert(0);
+    abort();
+  }
+
+  sqe->user_data = make_user_data(op->type, slots_[op->slot].gen,
+                                  static_cast<uint32_t>(op->slot));
+
+  op->armed = true;
+}
+
+void IOUring::cancel(IOUringOp *op) {
+  if (!op->armed) {
+    return;
+  }
+
+  auto sqe = get_sqe();
+  if (!sqe) {
+    LOG(WARN) << "io_uring: SQ ring is full";
+    return;
+  }
+
+  sqe->opcode = IORING_OP_ASYNC_CANCEL;
+  sqe->fd = -1;
+  sqe->addr = make_user_data(op->type, slots_[op->slot].gen,
+                             static_cast<uint32_t>(op->slot));
+  sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+}
+
+void IOUring::stop(IOUringOp *op) {
+  if (op->slot == -1) {
+    return;
+  }
+
+  cancel(op);
+
+  auto &slot = slots_[op->slot];
+  slot.op = nullptr;
+  ++slot.gen;
+
+  free_slots_.push_back(op->slot);
+
+  op->slot = -1;
+  op->armed = false;
+}
+
+MemchunkPool *IOUring::get_mcpool() const { return mcpool_; }
+
+void IOUring::process_completions() {
+  for (;;) {
+    auto head = *cq_head_;
+    auto tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+
+    if (head == tail) {
+      // The completions which did not fit in CQ ring are flushed to
+      // the ring by io_uring_enter(2).
+      if (!(__atomic_load_n(sq_flags_, __ATOMIC_RELAXED) &
+            IORING_SQ_CQ_OVERFLOW)) {
+        return;
+      }
+
+      (void)sys_io_uring_enter(fd_, 0, 0, IORING_ENTER_GETEVENTS);
+
+      if (*cq_head_ == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+        return;
+      }
+
+      continue;
+    }
+
+    for (; head != tail; ++head) {
+      // Copy CQE so that its slot is released before calling the
+      // callback.
+      auto cqe = cqes_[head & cq_mask_];
+
+      __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+
+      handle_cqe(&cqe);
+    }
+  }
+}
+
+void IOUring::handle_cqe(const io_uring_cqe *cqe) {
+  auto type = static_cast<IOUringOpType>(cqe->user_data >> 56);
+  if (type == IOUringOpType::NONE) {
+    return;
+  }
+
+  auto gen = static_cast<uint32_t>(cqe->user_data >> 32) & 0xffffffu;
+  auto idx = static_cast<uint32_t>(cqe->user_data);
+
+  Memchunk16K *m = nullptr;
+
+  if (cqe->flags & IORING_CQE_F_BUFFER) {
+    auto bid = static_cast<uint16_t>(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+
+    // Hand the buffer over to the callee, and refill the ring with a
+    // new one.
+    m = bufs_[bid];
+    bufs_[bid] = mcpool_->get();
+    provide_buffer(bid);
+
+    if (cqe->res > 0) {
+      m->last = m->pos + cqe->res;
+    } else {
+      mcpool_->recycle(m);
+      m = nullptr;
+    }
+  }
+
+  IOUringOp *op = nullptr;
+  if (idx < slots_.size() && slots_[idx].gen == gen) {
+    op = slots_[idx].op;
+  }
+
+  if (!op) {
+    if (m) {
+      mcpool_->recycle(m);
+    }
+    if (type == IOUringOpType::ACCEPT && cqe->res >= 0) {
+      close(cqe->res);
+    }
+    return;
+  }
+
+  auto more = (cqe->flags & IORING_CQE_F_MORE) != 0;
+  if (!more) {
+    op->armed = false;
+  }
+
+  op->cb(this, op, cqe->res, m, more);
+}
+
+} // namespace shrpx
+
+#endif // HAVE_IO_URING
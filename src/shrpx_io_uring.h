@@ -0,0 +1,179 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef SHRPX_IO_URING_H
+#define SHRPX_IO_URING_H
+
+#include "shrpx.h"
+
+#ifdef HAVE_IO_URING
+
+#  include <vector>
+
+#  include <linux/io_uring.h>
+
+#  include <ev.h>
+
+#  include "memchunk.h"
+
+using namespace nghttp2;
+
+namespace shrpx {
+
+class IOUring;
+struct IOUringOp;
+
+// Called when |op| completes.  |res| is the result of the operation
+// as the system call returns, but the negative error code instead of
+// -1 and errno.  For IOUringOpType::RECV, |chunk| holds the received
+// data if res > 0, and the callee owns it.  Otherwise |chunk| is
+// nullptr.  |more| is false if the multishot operation has been
+// terminated, and it must be started again to get further
+// completions.
+using IOUringCb = void (*)(IOUring *ring, IOUringOp *op, int res,
+                           Memchunk16K *chunk, bool more);
+
+enum class IOUringOpType : uint8_t {
+  NONE,
+  // Multishot accept(2).
+  ACCEPT,
+  // Multishot recv(2) to the buffer provided by IOUring.
+  RECV,
+};
+
+// IOUringOp is the multishot operation on fd, which is registered to
+// IOUring.  It is similar to ev_io.
+struct IOUringOp {
+  IOUringCb cb;
+  void *data;
+  int fd;
+  // The index to the slot in IOUring.  -1 if this object is not
+  // registered.
+  int slot;
+  IOUringOpType type;
+  // true if the operation is in flight in kernel.
+  bool armed;
+};
+
+void io_uring_op_init(IOUringOp *op, IOUringCb cb, void *data, int fd,
+                      IOUringOpType type);
+
+// IOUring is the io_uring instance per Worker.  SQEs are not
+// submitted immediately.  They are submitted at once just before the
+// event loop polls for I/O events, so that a single io_uring_enter(2)
+// serves all connections handled in the loop iteration.  Completions
+// are reaped when the ring file descriptor becomes readable.  The
+// data received by multishot recv goes to the buffers in the ring
+// which are borrowed from MemchunkPool, and they are handed over to
+// the owner of the operation without copying.
+//
+// Only multishot accept and recv are supported.  Writes stay on
+// libev: Connection::writev_clear() is expected to tell how many
+// bytes have been written synchronously, and an asynchronous send
+// would have to keep the chunks alive until its completion arrives.
+// TLS connections and backend connections do not use IOUring either.
+class IOUring {
+public:
+  IOUring(struct ev_loop *loop, MemchunkPool *mcpool);
+  ~IOUring();
+  IOUring(const IOUring &) = delete;
+  IOUring &operator=(const IOUring &) = delete;
+
+  // Creates the ring with |entries| SQEs and |nbufs| provided
+  // buffers.  |nbufs| must be a power of 2.  This function returns 0
+  // if it succeeds, or -1 if io_uring is not available in this
+  // system.
+  int init(uint32_t entries, uint32_t nbufs);
+
+  // Arms |op|, and registers it if it has not been registered yet.
+  // This function does nothing if |op| is in flight.
+  void start(IOUringOp *op);
+  // Asks kernel to terminate |op|.  |op| stays registered, and the
+  // callback is still invoked for the completions which have already
+  // been made, followed by the one without more flag.
+  void cancel(IOUringOp *op);
+  // Unregisters |op|.  The callback is never invoked for |op| after
+  // this call.  The data received for |op| in flight is discarded.
+  void stop(IOUringOp *op);
+
+  // Returns the pool which the buffers given to the callback belong
+  // to.
+  MemchunkPool *get_mcpool() const;
+
+  // Submits the queued SQEs to kernel.
+  void submit();
+  // Processes the completions.
+  void process_completions();
+
+private:
+  io_uring_sqe *get_sqe();
+  void provide_buffer(uint16_t bid);
+  void handle_cqe(const io_uring_cqe *cqe);
+
+  struct Slot {
+    IOUringOp *op;
+    uint32_t gen;
+  };
+
+  ev_io rev_;
+  ev_prepare prep_;
+  std::vector<Slot> slots_;
+  std::vector<int> free_slots_;
+  // Buffers in the provided buffer ring indexed by buffer ID.
+  std::vector<Memchunk16K *> bufs_;
+  struct ev_loop *loop_;
+  MemchunkPool *mcpool_;
+  // SQ ring
+  uint8_t *sq_ring_;
+  size_t sq_ring_size_;
+  uint32_t *sq_head_;
+  uint32_t *sq_tail_;
+  uint32_t *sq_flags_;
+  uint32_t *sq_array_;
+  uint32_t sq_mask_;
+  // The local copy of SQ tail which includes the SQEs not submitted
+  // yet.
+  uint32_t sqe_tail_;
+  io_uring_sqe *sqes_;
+  size_t sqes_size_;
+  // CQ ring
+  uint8_t *cq_ring_;
+  size_t cq_ring_size_;
+  uint32_t *cq_head_;
+  uint32_t *cq_tail_;
+  uint32_t cq_mask_;
+  io_uring_cqe *cqes_;
+  // Provided buffer ring
+  io_uring_buf *buf_ring_;
+  size_t buf_ring_size_;
+  uint16_t buf_tail_;
+  uint16_t buf_mask_;
+  int fd_;
+};
+
+} // namespace shrpx
+
+#endif // HAVE_IO_URING
+
+#endif // SHRPX_IO_URING_H
@@ -0,0 +1,253 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_io_uring_test.h"
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>
+#endif // HAVE_UNISTD_H
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <string>
+
+#include <CUnit/CUnit.h>
+
+#include "shrpx_io_uring.h"
+
+namespace shrpx {
+
+#ifdef HAVE_IO_URING
+namespace {
+struct Result {
+  std::string data;
+  std::vector<int> fds;
+  size_t ncall;
+  int last_res;
+  bool more;
+};
+} // namespace
+
+namespace {
+void resultcb(IOUring *ring, IOUringOp *op, int res, Memchunk16K *chunk,
+              bool more) {
+  auto r = static_cast<Result *>(op->data);
+
+  ++r->ncall;
+  r->last_res = res;
+  r->more = more;
+
+  if (chunk) {
+    r->data.append(chunk->pos, chunk->last);
+    ring->get_mcpool()->recycle(chunk);
+  }
+
+  if (op->type == IOUringOpType::ACCEPT && res >= 0) {
+    r->fds.push_back(res);
+  }
+}
+} // namespace
+
+namespace {
+// Runs |loop| until |r| gets |ncall| callbacks, or gives up after a
+// while.
+void run_until(struct ev_loop *loop, const Result &r, size_t ncall) {
+  for (size_t i = 0; i < 100 && r.ncall < ncall; ++i) {
+    ev_run(loop, EVRUN_ONCE);
+  }
+}
+} // namespace
+#endif // HAVE_IO_URING
+
+void test_shrpx_io_uring_recv(void) {
+#ifdef HAVE_IO_URING
+  auto loop = ev_loop_new(EVFLAG_AUTO);
+  MemchunkPool mcpool;
+
+  {
+    IOUring ring(loop, &mcpool);
+
+    if (ring.init(8, 4) != 0) {
+      // io_uring is not available in this system.
+      ev_loop_destroy(loop);
+      return;
+    }
+
+    int sv[2];
+
+    CU_ASSERT_FATAL(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+
+    Result r{};
+    IOUringOp op;
+    io_uring_op_init(&op, resultcb, &r, sv[0], IOUringOpType::RECV);
+
+    ring.start(&op);
+
+    CU_ASSERT(op.armed);
+    CU_ASSERT(-1 != op.slot);
+
+    CU_ASSERT(5 == write(sv[1], "hello", 5));
+
+    run_until(loop, r, 1);
+
+    CU_ASSERT(1 == r.ncall);
+    CU_ASSERT(5 == r.last_res);
+    CU_ASSERT(r.more);
+    CU_ASSERT("hello" == r.data);
+
+    // Multishot recv keeps receiving without being started again.
+    CU_ASSERT(5 == write(sv[1], "world", 5));
+
+    run_until(loop, r, 2);
+
+    CU_ASSERT(2 == r.ncall);
+    CU_ASSERT("helloworld" == r.data);
+
+    // The provided buffers are refilled; more completions than the
+    // number of buffers are received.
+    for (size_t i = 0; i < 8; ++i) {
+      CU_ASSERT(1 == write(sv[1], "x", 1));
+      run_until(loop, r, 3 + i);
+    }
+
+    CU_ASSERT(10 == r.ncall);
+    CU_ASSERT("helloworldxxxxxxxx" == r.data);
+
+    // EOF terminates multishot recv.
+    shutdown(sv[1], SHUT_WR);
+
+    run_until(loop, r, 11);
+
+    CU_ASSERT(11 == r.ncall);
+    CU_ASSERT(0 == r.last_res);
+    CU_ASSERT(!r.more);
+    CU_ASSERT(!op.armed);
+
+    ring.stop(&op);
+
+    CU_ASSERT(-1 == op.slot);
+
+    close(sv[1]);
+    close(sv[0]);
+
+    CU_ASSERT_FATAL(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+
+    // The callback is not invoked after the operation is stopped.
+    r = Result{};
+    io_uring_op_init(&op, resultcb, &r, sv[0], IOUringOpType::RECV);
+
+    ring.start(&op);
+    ring.submit();
+    ring.stop(&op);
+
+    CU_ASSERT(5 == write(sv[1], "hello", 5));
+
+    for (size_t i = 0; i < 10; ++i) {
+      ev_run(loop, EVRUN_NOWAIT);
+    }
+
+    CU_ASSERT(0 == r.ncall);
+
+    close(sv[1]);
+    close(sv[0]);
+  }
+
+  ev_loop_destroy(loop);
+#endif // HAVE_IO_URING
+}
+
+void test_shrpx_io_uring_accept(void) {
+#ifdef HAVE_IO_URING
+  auto loop = ev_loop_new(EVFLAG_AUTO);
+  MemchunkPool mcpool;
+
+  {
+    IOUring ring(loop, &mcpool);
+
+    if (ring.init(8, 4) != 0) {
+      // io_uring is not available in this system.
+      ev_loop_destroy(loop);
+      return;
+    }
+
+    auto lfd = socket(AF_INET, SOCK_STREAM, 0);
+
+    CU_ASSERT_FATAL(-1 != lfd);
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addrlen = sizeof(addr);
+
+    CU_ASSERT_FATAL(0 == bind(lfd, reinterpret_cast<sockaddr *>(&addr),
+                              sizeof(addr)));
+    CU_ASSERT_FATAL(0 == listen(lfd, 16));
+    CU_ASSERT_FATAL(0 == getsockname(lfd, reinterpret_cast<sockaddr *>(&addr),
+                                     &addrlen));
+
+    Result r{};
+    IOUringOp op;
+    io_uring_op_init(&op, resultcb, &r, lfd, IOUringOpType::ACCEPT);
+
+    ring.start(&op);
+
+    std::vector<int> cfds;
+
+    for (size_t i = 0; i < 3; ++i) {
+      auto cfd = socket(AF_INET, SOCK_STREAM, 0);
+
+      CU_ASSERT_FATAL(-1 != cfd);
+      CU_ASSERT(0 == connect(cfd, reinterpret_cast<sockaddr *>(&addr),
+                             sizeof(addr)));
+
+      cfds.push_back(cfd);
+    }
+
+    run_until(loop, r, 3);
+
+    CU_ASSERT(3 == r.ncall);
+    CU_ASSERT(3 == r.fds.size());
+    CU_ASSERT(r.more);
+    CU_ASSERT(op.armed);
+
+    for (auto fd : r.fds) {
+      CU_ASSERT(fd >= 0);
+      close(fd);
+    }
+
+    ring.stop(&op);
+
+    for (auto fd : cfds) {
+      close(fd);
+    }
+
+    close(lfd);
+  }
+
+  ev_loop_destroy(loop);
+#endif // HAVE_IO_URING
+}
+
+} // namespace shrpx
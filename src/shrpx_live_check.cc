@@ -24,6 +24,7 @@
  */
 #include "shrpx_live_check.h"
 #include "shrpx_worker.h"
+#include "shrpx_connection_handler.h"
 #include "shrpx_connect_blocker.h"
 #include "shrpx_tls.h"
 #include "shrpx_log.h"
@@ -187,6 +188,15 @@ void LiveCheck::schedule() {
   ev_timer_start(conn_.loop, &backoff_timer_);
 }
 
+void LiveCheck::cancel() {
+  disconnect();
+
+  ev_timer_stop(conn_.loop, &backoff_timer_);
+
+  success_count_ = 0;
+  fail_count_ = 0;
+}
+
 int LiveCheck::do_read() { return read_(*this); }
 
 int LiveCheck::do_write() { return write_(*this); }
@@ -697,6 +707,14 @@ void LiveCheck::on_success() {
   fail_count_ = 0;
 
   disconnect();
+
+  auto &endpoint = addr_->endpoint;
+
+  // Tell the other workers that the backend is back online.
+  if (endpoint->share_health &&
+      endpoint->offline.exchange(false, std::memory_order_acq_rel)) {
+    endpoint->conn_handler->worker_update_downstream_health();
+  }
 }
 
 int LiveCheck::noop() { return 0; }
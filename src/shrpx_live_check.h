@@ -59,6 +59,8 @@ public:
 
   // Schedules next connection attempt
   void schedule();
+  // Stops the ongoing and scheduled connection attempts.
+  void cancel();
 
   // Low level I/O operation callback; they are called from do_read()
   // or do_write().
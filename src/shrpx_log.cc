@@ -50,6 +50,9 @@
 #include "shrpx_config.h"
 #include "shrpx_downstream.h"
 #include "shrpx_worker.h"
+#include "shrpx_upstream.h"
+#include "shrpx_client_handler.h"
+#include "shrpx_accesslog_writer.h"
 #include "util.h"
 #include "template.h"
 
@@ -578,8 +581,9 @@ void upstream_accesslog(const std::vector<LogFragment> &lfv,
   auto config = get_config();
   auto lgconf = log_config();
   auto &accessconf = get_config()->logging.access;
+  auto writer = get_accesslog_writer();
 
-  if (lgconf->accesslog_fd == -1 && !accessconf.syslog) {
+  if (!writer && lgconf->accesslog_fd == -1 && !accessconf.syslog) {
     return;
   }
 
@@ -841,6 +845,34 @@ void upstream_accesslog(const std::vector<LogFragment> &lfv,
 
   *p = '\0';
 
+  if (writer) {
+    *p++ = '\n';
+
+    if (!lgconf->accesslog_buf) {
+      lgconf->accesslog_buf = writer->create_buffer();
+    }
+
+    auto logbuf = lgconf->accesslog_buf.get();
+
+    // The lines which the writer thread failed to write are counted
+    // as dropped as well.
+    auto ndropped = logbuf->take_num_discarded();
+
+    if (!writer->write(logbuf, reinterpret_cast<const uint8_t *>(buf.data()),
+                       std::distance(std::begin(buf), p))) {
+      ++ndropped;
+    }
+
+    if (ndropped) {
+      auto handler = downstream->get_upstream()->get_client_handler();
+      auto worker_stat = handler->get_worker()->get_worker_stat();
+      worker_stat->num_accesslog_dropped.fetch_add(ndropped,
+                                                   std::memory_order_relaxed);
+    }
+
+    return;
+  }
+
   if (accessconf.syslog) {
     syslog(LOG_INFO, "%s", buf.data());
 
@@ -864,7 +896,9 @@ int reopen_log_files(const LoggingConfig &loggingconf) {
   auto &accessconf = loggingconf.access;
   auto &errorconf = loggingconf.error;
 
-  if (!accessconf.syslog && !accessconf.file.empty()) {
+  // AccessLogWriter owns the access log file if it is enabled.
+  if (!accessconf.syslog && !accessconf.file.empty() &&
+      !get_accesslog_writer()) {
     new_accesslog_fd = open_log_file(accessconf.file.c_str());
 
     if (new_accesslog_fd == -1) {
@@ -30,6 +30,7 @@
 #include <sys/types.h>
 
 #include <chrono>
+#include <memory>
 
 #include "template.h"
 
@@ -37,6 +38,8 @@ using namespace nghttp2;
 
 namespace shrpx {
 
+class AccessLogBuffer;
+
 struct Timestamp {
   Timestamp(const std::chrono::system_clock::time_point &tp);
 
@@ -57,6 +60,9 @@ struct LogConfig {
   int errorlog_fd;
   // true if errorlog_fd is referring to a terminal.
   bool errorlog_tty;
+  // Buffer which this thread appends access log lines to if
+  // asynchronous access logging is enabled.  It is created lazily.
+  std::shared_ptr<AccessLogBuffer> accesslog_buf;
 
   LogConfig();
   // Updates time stamp if difference between time_str_updated and now
@@ -0,0 +1,112 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_pipe_pool.h"
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>
+#endif // HAVE_UNISTD_H
+#include <fcntl.h>
+
+#include <array>
+
+#include "shrpx_log.h"
+
+namespace shrpx {
+
+namespace {
+// The pipe size we ask for.  The default size of 64KiB requires too
+// many splice(2) calls for a large response body.
+constexpr size_t PIPE_SIZE = 256_k;
+} // namespace
+
+PipePool::PipePool(size_t max_size) : max_size_(max_size) {}
+
+PipePool::~PipePool() {
+  for (auto &p : pipes_) {
+    close(p.rfd);
+    close(p.wfd);
+  }
+}
+
+int PipePool::get(SplicePipe &p) {
+  if (!pipes_.empty()) {
+    p = pipes_.back();
+    pipes_.pop_back();
+
+    return 0;
+  }
+
+#ifdef HAVE_SPLICE
+  std::array<int, 2> fds;
+
+  if (pipe2(fds.data(), O_NONBLOCK | O_CLOEXEC) != 0) {
+    auto error = errno;
+    if (LOG_ENABLED(INFO)) {
+      LOG(INFO) << "pipe2() failed: errno=" << error;
+    }
+    return -1;
+  }
+
+#  ifdef F_SETPIPE_SZ
+  // This may fail if PIPE_SIZE exceeds the system limit.  The default
+  // size is fine in that case.
+  (void)fcntl(fds[1], F_SETPIPE_SZ, PIPE_SIZE);
+#  endif // F_SETPIPE_SZ
+
+  p.rfd = fds[0];
+  p.wfd = fds[1];
+  p.len = 0;
+  p.capacity = 64_k;
+
+#  ifdef F_GETPIPE_SZ
+  auto rv = fcntl(fds[1], F_GETPIPE_SZ);
+  if (rv > 0) {
+    p.capacity = rv;
+  }
+#  endif // F_GETPIPE_SZ
+
+  return 0;
+#else  // !HAVE_SPLICE
+  return -1;
+#endif // !HAVE_SPLICE
+}
+
+void PipePool::put(SplicePipe &p) {
+  if (p.rfd == -1) {
+    return;
+  }
+
+  if (p.len == 0 && pipes_.size() < max_size_) {
+    pipes_.push_back(p);
+  } else {
+    close(p.rfd);
+    close(p.wfd);
+  }
+
+  p.rfd = p.wfd = -1;
+  p.len = 0;
+}
+
+} // namespace shrpx
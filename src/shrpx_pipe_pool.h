@@ -0,0 +1,70 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef SHRPX_PIPE_POOL_H
+#define SHRPX_PIPE_POOL_H
+
+#include "shrpx.h"
+
+#include <vector>
+
+namespace shrpx {
+
+// SplicePipe is a pipe which relays data between 2 sockets with
+// splice(2).
+struct SplicePipe {
+  int rfd;
+  int wfd;
+  // The number of bytes in the pipe.
+  size_t len;
+  // The capacity of the pipe.
+  size_t capacity;
+};
+
+// PipePool keeps empty pipes for reuse so that relaying a response
+// body does not need pipe(2) and close(2) each time.
+class PipePool {
+public:
+  // |max_size| is the maximum number of pipes kept in the pool.
+  PipePool(size_t max_size);
+  ~PipePool();
+  PipePool(const PipePool &) = delete;
+  PipePool &operator=(const PipePool &) = delete;
+
+  // Stores a pipe to |p|.  This function returns 0 if it succeeds, or
+  // -1.
+  int get(SplicePipe &p);
+  // Returns |p| to the pool.  If |p| still has data, or the pool is
+  // full, |p| is closed instead.  After this call, p.rfd and p.wfd
+  // are -1.
+  void put(SplicePipe &p);
+
+private:
+  std::vector<SplicePipe> pipes_;
+  size_t max_size_;
+};
+
+} // namespace shrpx
+
+#endif // SHRPX_PIPE_POOL_H
@@ -0,0 +1,104 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_pipe_pool_test.h"
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>
+#endif // HAVE_UNISTD_H
+#include <fcntl.h>
+
+#include <CUnit/CUnit.h>
+
+#include "shrpx_pipe_pool.h"
+
+namespace shrpx {
+
+void test_shrpx_pipe_pool_reuse(void) {
+#ifdef HAVE_SPLICE
+  SplicePipe p1, p2, p3;
+  int rfd;
+
+  {
+    PipePool pool(1);
+
+    CU_ASSERT(0 == pool.get(p1));
+    CU_ASSERT(-1 != p1.rfd);
+    CU_ASSERT(-1 != p1.wfd);
+    CU_ASSERT(0 == p1.len);
+    CU_ASSERT(p1.capacity > 0);
+    CU_ASSERT(fcntl(p1.wfd, F_GETFL) & O_NONBLOCK);
+
+    CU_ASSERT(0 == pool.get(p2));
+    CU_ASSERT(p1.rfd != p2.rfd);
+
+    auto rfd1 = p1.rfd;
+    auto wfd1 = p1.wfd;
+    auto rfd2 = p2.rfd;
+
+    // An empty pipe is kept for reuse.
+    pool.put(p1);
+
+    CU_ASSERT(-1 == p1.rfd);
+    CU_ASSERT(-1 == p1.wfd);
+    CU_ASSERT(-1 != fcntl(rfd1, F_GETFD));
+
+    // The pool is full.  The pipe is closed.
+    pool.put(p2);
+
+    CU_ASSERT(-1 == p2.rfd);
+    CU_ASSERT(-1 == fcntl(rfd2, F_GETFD));
+
+    CU_ASSERT(0 == pool.get(p3));
+    CU_ASSERT(rfd1 == p3.rfd);
+    CU_ASSERT(wfd1 == p3.wfd);
+
+    // The pipe which still has data is closed.
+    CU_ASSERT(1 == write(p3.wfd, "a", 1));
+    p3.len = 1;
+
+    pool.put(p3);
+
+    CU_ASSERT(-1 == p3.rfd);
+    CU_ASSERT(0 == p3.len);
+    CU_ASSERT(-1 == fcntl(rfd1, F_GETFD));
+
+    // Putting the pipe which has been returned is no-op.
+    pool.put(p3);
+
+    CU_ASSERT(0 == pool.get(p1));
+
+    rfd = p1.rfd;
+
+    pool.put(p1);
+
+    CU_ASSERT(-1 != fcntl(rfd, F_GETFD));
+  }
+
+  // The pooled pipes are closed with the pool.
+  CU_ASSERT(-1 == fcntl(rfd, F_GETFD));
+#endif // HAVE_SPLICE
+}
+
+} // namespace shrpx
@@ -0,0 +1,188 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_timer_wheel.h"
+
+#include <cmath>
+#include <algorithm>
+
+namespace shrpx {
+
+namespace {
+void timercb(struct ev_loop *loop, ev_timer *w, int revents) {
+  auto wheel = static_cast<TimerWheel *>(w->data);
+
+  wheel->expire(wheel->now_tick());
+
+  if (wheel->size() == 0) {
+    ev_timer_stop(loop, w);
+  }
+}
+} // namespace
+
+WheelTimer::WheelTimer(WheelTimerCb cb, void *data)
+    : dlnext(nullptr),
+      dlprev(nullptr),
+      slot(nullptr),
+      cb(cb),
+      data(data),
+      expiry(0) {}
+
+TimerWheel::TimerWheel(struct ev_loop *loop, ev_tstamp tick)
+    : loop_(loop), origin_(ev_now(loop)), tick_(tick), base_(0), num_timers_(0) {
+  ev_timer_init(&timer_, timercb, 0., tick);
+  timer_.data = this;
+}
+
+TimerWheel::~TimerWheel() { ev_timer_stop(loop_, &timer_); }
+
+void TimerWheel::start(WheelTimer *w, ev_tstamp t) {
+  stop(w);
+
+  if (num_timers_ == 0) {
+    // Skip the ticks elapsed while the wheel was empty.
+    base_ = std::max(base_, now_tick());
+  }
+
+  // Round up so that the timer never expires early.  The small bias
+  // absorbs the rounding error of floating point division.
+  auto ticks = (ev_now(loop_) - origin_ + t) / tick_ - 1e-6;
+  w->expiry = static_cast<uint64_t>(std::ceil(std::max(ticks, 0.)));
+
+  add(w);
+  ++num_timers_;
+
+  if (!ev_is_active(&timer_)) {
+    ev_timer_again(loop_, &timer_);
+  }
+}
+
+void TimerWheel::stop(WheelTimer *w) {
+  if (!w->slot) {
+    return;
+  }
+
+  w->slot->remove(w);
+  w->slot = nullptr;
+  --num_timers_;
+}
+
+void TimerWheel::add(WheelTimer *w) {
+  auto expiry = w->expiry;
+  DList<WheelTimer> *slot;
+
+  if (expiry < base_) {
+    slot = &root_[base_ & (ROOT_SIZE - 1)];
+  } else {
+    auto idx = expiry - base_;
+    if (idx > MAX_TICKS) {
+      idx = MAX_TICKS;
+      expiry = base_ + MAX_TICKS;
+    }
+
+    if (idx < ROOT_SIZE) {
+      slot = &root_[expiry & (ROOT_SIZE - 1)];
+    } else {
+      size_t level = 0;
+      for (; level < NUM_LEVELS - 1 &&
+             idx >= static_cast<uint64_t>(1)
+                        << (ROOT_BITS + (level + 1) * LEVEL_BITS);
+           ++level)
+        ;
+
+      slot = &levels_[level][(expiry >> (ROOT_BITS + level * LEVEL_BITS)) &
+                             (LEVEL_SIZE - 1)];
+    }
+  }
+
+  slot->append(w);
+  w->slot = slot;
+}
+
+size_t TimerWheel::cascade(size_t level, size_t index) {
+  auto list = std::move(levels_[level][index]);
+
+  for (auto w = list.head; w;) {
+    auto next = w->dlnext;
+    w->dlnext = w->dlprev = nullptr;
+    add(w);
+    w = next;
+  }
+
+  return index;
+}
+
+void TimerWheel::expire(uint64_t tick) {
+  while (base_ <= tick) {
+    if (num_timers_ == 0) {
+      base_ = tick + 1;
+      return;
+    }
+
+    auto index = base_ & (ROOT_SIZE - 1);
+    if (index == 0) {
+      for (size_t i = 0;
+           i < NUM_LEVELS &&
+           cascade(i, (base_ >> (ROOT_BITS + i * LEVEL_BITS)) &
+                          (LEVEL_SIZE - 1)) == 0;
+           ++i)
+        ;
+    }
+
+    ++base_;
+
+    // The callbacks may stop the timers in this slot, or start new
+    // ones which may land in this slot again.  Detach the slot first.
+    auto work = std::move(root_[index]);
+    for (auto w = work.head; w; w = w->dlnext) {
+      w->slot = &work;
+    }
+
+    while (!work.empty()) {
+      auto w = work.head;
+      work.remove(w);
+      w->slot = nullptr;
+
+      if (w->expiry >= base_) {
+        // This timer was parked because it was scheduled beyond
+        // MAX_TICKS.
+        add(w);
+        continue;
+      }
+
+      --num_timers_;
+
+      w->cb(w);
+    }
+  }
+}
+
+uint64_t TimerWheel::now_tick() const {
+  return static_cast<uint64_t>(
+      std::max((ev_now(loop_) - origin_) / tick_, 0.));
+}
+
+size_t TimerWheel::size() const { return num_timers_; }
+
+} // namespace shrpx
@@ -0,0 +1,126 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef SHRPX_TIMER_WHEEL_H
+#define SHRPX_TIMER_WHEEL_H
+
+#include "shrpx.h"
+
+#include <cstdint>
+#include <array>
+
+#include <ev.h>
+
+#include "template.h"
+
+using namespace nghttp2;
+
+namespace shrpx {
+
+struct WheelTimer;
+
+using WheelTimerCb = void (*)(WheelTimer *w);
+
+// WheelTimer is a timer scheduled in TimerWheel.  Unlike ev_timer,
+// it is linked into a slot list, and scheduling and cancelling it is
+// O(1).
+struct WheelTimer {
+  WheelTimer(WheelTimerCb cb, void *data);
+
+  WheelTimer *dlnext, *dlprev;
+  // The list which this timer is linked into, or nullptr if it is not
+  // active.
+  DList<WheelTimer> *slot;
+  WheelTimerCb cb;
+  void *data;
+  // The tick when this timer expires.
+  uint64_t expiry;
+};
+
+// TimerWheel is a hierarchical timing wheel with the granularity of
+// |tick| seconds.  It is intended for the coarse read and idle
+// timeouts of a large number of connections, which are rearmed on
+// every activity and rarely expire.  libev keeps its timers in a
+// binary heap, so rearming one costs O(log n).  The timers in this
+// wheel never expire earlier than requested, but may expire up to
+// |tick| seconds later.  A single ev_timer drives the wheel while it
+// has any timer.
+class TimerWheel {
+public:
+  TimerWheel(struct ev_loop *loop, ev_tstamp tick);
+  ~TimerWheel();
+  TimerWheel(const TimerWheel &) = delete;
+  TimerWheel &operator=(const TimerWheel &) = delete;
+
+  // Schedules |w| to expire |t| seconds after now.  If |w| is
+  // already active, it is rescheduled.
+  void start(WheelTimer *w, ev_tstamp t);
+  // Cancels |w|.  It is safe to call this function for an inactive
+  // timer.
+  void stop(WheelTimer *w);
+  // Calls the callback of the timers which expire at |tick| or
+  // earlier.  The callback may start or stop any timer, including the
+  // one being called.
+  void expire(uint64_t tick);
+  // Returns the current tick.
+  uint64_t now_tick() const;
+  // Returns the number of active timers.
+  size_t size() const;
+
+private:
+  void add(WheelTimer *w);
+  size_t cascade(size_t level, size_t index);
+
+  static constexpr size_t ROOT_BITS = 8;
+  static constexpr size_t ROOT_SIZE = 1 << ROOT_BITS;
+  static constexpr size_t LEVEL_BITS = 6;
+  static constexpr size_t LEVEL_SIZE = 1 << LEVEL_BITS;
+  static constexpr size_t NUM_LEVELS = 3;
+  // The maximum number of ticks from |base_| a timer can be
+  // scheduled.  A timer which expires later is parked in the last
+  // slot of the outermost level, and moved back when it is reached.
+  static constexpr uint64_t MAX_TICKS =
+      (static_cast<uint64_t>(1) << (ROOT_BITS + NUM_LEVELS * LEVEL_BITS)) -
+      1;
+
+  // The slots for the timers which expire in the next ROOT_SIZE
+  // ticks.
+  std::array<DList<WheelTimer>, ROOT_SIZE> root_;
+  // levels_[i] covers ROOT_SIZE * LEVEL_SIZE^(i+1) ticks.  When
+  // |base_| reaches a slot, its timers are redistributed to the inner
+  // level.
+  std::array<std::array<DList<WheelTimer>, LEVEL_SIZE>, NUM_LEVELS> levels_;
+  ev_timer timer_;
+  struct ev_loop *loop_;
+  // The time when tick 0 began.
+  ev_tstamp origin_;
+  ev_tstamp tick_;
+  // The next tick which has not been processed yet.
+  uint64_t base_;
+  size_t num_timers_;
+};
+
+} // namespace shrpx
+
+#endif // SHRPX_TIMER_WHEEL_H
@@ -0,0 +1,222 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+// This program measures the cost of rearming the read timers of a
+// large number of connections with libev timers and with TimerWheel,
+// which nghttpx uses for frontend connections.
+//
+// Usage: timer-wheel-bench [N...]
+//
+// For each N (default: 100000 1000000), N timers of 60 seconds are
+// started, and then they are rearmed 4N times in random order, as if
+// the connections had activity.  The event loop is run once every 64
+// rearms, as it is when a worker handles a batch of events.  The
+// timers never expire during the measurement.
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif // HAVE_CONFIG_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <functional>
+
+#include <ev.h>
+
+#include "shrpx_timer_wheel.h"
+
+using namespace shrpx;
+
+namespace {
+constexpr ev_tstamp TIMEOUT = 60.;
+constexpr size_t LOOP_BATCH = 64;
+} // namespace
+
+namespace {
+void timeoutcb(struct ev_loop *loop, ev_timer *w, int revents) {
+  std::fprintf(stderr, "unexpected timeout\n");
+  std::abort();
+}
+} // namespace
+
+namespace {
+void wheeltimeoutcb(WheelTimer *w) {
+  std::fprintf(stderr, "unexpected timeout\n");
+  std::abort();
+}
+} // namespace
+
+namespace {
+struct Result {
+  double start_ns;
+  double rearm_ns;
+  double stop_ns;
+};
+} // namespace
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+double elapsed_ns(Clock::time_point t, size_t n) {
+  return std::chrono::duration<double, std::nano>(Clock::now() - t).count() /
+         n;
+}
+} // namespace
+
+namespace {
+// Measures the functions which start, rearm and stop timer i.  The
+// order of rearms is given by |order|.
+Result run(struct ev_loop *loop, size_t n, const std::vector<size_t> &order,
+           const std::function<void(size_t)> &start,
+           const std::function<void(size_t)> &rearm,
+           const std::function<void(size_t)> &stop) {
+  Result res;
+
+  ev_now_update(loop);
+
+  auto t = Clock::now();
+  for (size_t i = 0; i < n; ++i) {
+    start(i);
+  }
+  res.start_ns = elapsed_ns(t, n);
+
+  t = Clock::now();
+  for (size_t i = 0; i < order.size(); ++i) {
+    rearm(order[i]);
+    if ((i + 1) % LOOP_BATCH == 0) {
+      ev_run(loop, EVRUN_NOWAIT);
+    }
+  }
+  res.rearm_ns = elapsed_ns(t, order.size());
+
+  t = Clock::now();
+  for (size_t i = 0; i < n; ++i) {
+    stop(i);
+  }
+  res.stop_ns = elapsed_ns(t, n);
+
+  return res;
+}
+} // namespace
+
+namespace {
+void print_result(const char *name, const Result &res) {
+  std::printf("  %-14s start %8.1f ns  rearm %8.1f ns  stop %8.1f ns\n", name,
+              res.start_ns, res.rearm_ns, res.stop_ns);
+}
+} // namespace
+
+namespace {
+void bench(size_t n) {
+  auto loop = ev_loop_new(EVFLAG_AUTO);
+  std::mt19937 gen(n);
+  std::uniform_int_distribution<size_t> dis(0, n - 1);
+
+  std::vector<size_t> order(n * 4);
+  for (auto &i : order) {
+    i = dis(gen);
+  }
+
+  std::printf("%zu timers, %zu rearms\n", n, order.size());
+
+  {
+    std::vector<ev_timer> timers(n);
+    for (auto &w : timers) {
+      ev_timer_init(&w, timeoutcb, 0., TIMEOUT);
+    }
+
+    // This is what Connection::again_rt() does without a timer wheel.
+    auto res = run(
+        loop, n, order, [&](size_t i) { ev_timer_again(loop, &timers[i]); },
+        [&](size_t i) { ev_timer_again(loop, &timers[i]); },
+        [&](size_t i) { ev_timer_stop(loop, &timers[i]); });
+
+    print_result("libev", res);
+  }
+
+  {
+    TimerWheel wheel(loop, 0.1);
+    std::vector<WheelTimer> timers(n, WheelTimer(wheeltimeoutcb, nullptr));
+
+    auto res = run(
+        loop, n, order, [&](size_t i) { wheel.start(&timers[i], TIMEOUT); },
+        [&](size_t i) { wheel.start(&timers[i], TIMEOUT); },
+        [&](size_t i) { wheel.stop(&timers[i]); });
+
+    print_result("wheel", res);
+  }
+
+  {
+    TimerWheel wheel(loop, 0.1);
+    std::vector<WheelTimer> timers(n, WheelTimer(wheeltimeoutcb, nullptr));
+    std::vector<ev_tstamp> last_read(n);
+
+    // This is what Connection::again_rt() does with a timer wheel.  It
+    // only records the time of activity, and the deadline is checked
+    // when the timer expires.
+    auto res = run(
+        loop, n, order,
+        [&](size_t i) {
+          last_read[i] = ev_now(loop);
+          wheel.start(&timers[i], TIMEOUT);
+        },
+        [&](size_t i) {
+          last_read[i] = ev_now(loop);
+          if (!timers[i].slot) {
+            wheel.start(&timers[i], TIMEOUT);
+          }
+        },
+        [&](size_t i) { wheel.stop(&timers[i]); });
+
+    print_result("wheel (lazy)", res);
+  }
+
+  ev_loop_destroy(loop);
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  std::vector<size_t> ns;
+
+  for (int i = 1; i < argc; ++i) {
+    auto n = std::strtoul(argv[i], nullptr, 10);
+    if (n == 0) {
+      std::fprintf(stderr, "usage: %s [N...]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+    ns.push_back(n);
+  }
+
+  if (ns.empty()) {
+    ns = {100000, 1000000};
+  }
+
+  for (auto n : ns) {
+    bench(n);
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,168 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_timer_wheel_test.h"
+
+#include <vector>
+
+#include <CUnit/CUnit.h>
+
+#include "shrpx_timer_wheel.h"
+
+namespace shrpx {
+
+namespace {
+struct Fired {
+  std::vector<WheelTimer *> timers;
+  TimerWheel *wheel;
+  // If not nullptr, the callback stops this timer.
+  WheelTimer *stop;
+  // If not nullptr, the callback starts this timer again with 0.
+  WheelTimer *restart;
+};
+} // namespace
+
+namespace {
+void firedcb(WheelTimer *w) {
+  auto f = static_cast<Fired *>(w->data);
+
+  f->timers.push_back(w);
+
+  if (f->stop) {
+    f->wheel->stop(f->stop);
+    f->stop = nullptr;
+  }
+
+  if (f->restart) {
+    f->wheel->start(f->restart, 0.);
+    f->restart = nullptr;
+  }
+}
+} // namespace
+
+void test_shrpx_timer_wheel_expire(void) {
+  auto loop = ev_loop_new(EVFLAG_AUTO);
+  TimerWheel wheel(loop, 0.1);
+  Fired f{{}, &wheel, nullptr, nullptr};
+  WheelTimer a(firedcb, &f), b(firedcb, &f), c(firedcb, &f), d(firedcb, &f);
+
+  // ev_now() does not advance, so that the tick is always 0.
+  wheel.start(&a, 1.);
+  // Goes to the outer levels.
+  wheel.start(&b, 30.);
+  wheel.start(&c, 3600.);
+  wheel.start(&d, 2.);
+
+  CU_ASSERT(4 == wheel.size());
+
+  wheel.expire(9);
+
+  CU_ASSERT(f.timers.empty());
+
+  wheel.expire(10);
+
+  CU_ASSERT(1 == f.timers.size());
+  CU_ASSERT(&a == f.timers[0]);
+  CU_ASSERT(nullptr == a.slot);
+
+  wheel.stop(&d);
+  // Stopping inactive timer is no-op.
+  wheel.stop(&d);
+
+  CU_ASSERT(2 == wheel.size());
+
+  wheel.expire(299);
+
+  CU_ASSERT(1 == f.timers.size());
+
+  wheel.expire(300);
+
+  CU_ASSERT(2 == f.timers.size());
+  CU_ASSERT(&b == f.timers[1]);
+
+  wheel.expire(35999);
+
+  CU_ASSERT(2 == f.timers.size());
+
+  wheel.expire(36000);
+
+  CU_ASSERT(3 == f.timers.size());
+  CU_ASSERT(&c == f.timers[2]);
+  CU_ASSERT(0 == wheel.size());
+
+  ev_loop_destroy(loop);
+}
+
+void test_shrpx_timer_wheel_reentrant(void) {
+  auto loop = ev_loop_new(EVFLAG_AUTO);
+  TimerWheel wheel(loop, 0.1);
+  Fired f{{}, &wheel, nullptr, nullptr};
+  WheelTimer a(firedcb, &f), b(firedcb, &f), c(firedcb, &f);
+
+  // a, b and c expire in the same tick.
+  wheel.start(&a, 1.);
+  wheel.start(&b, 1.);
+  wheel.start(&c, 1.);
+
+  // a stops b, and starts a again.
+  f.stop = &b;
+  f.restart = &a;
+
+  wheel.expire(10);
+
+  CU_ASSERT(2 == f.timers.size());
+  CU_ASSERT(&a == f.timers[0]);
+  CU_ASSERT(&c == f.timers[1]);
+  CU_ASSERT(nullptr == b.slot);
+  // a expires in the next tick.
+  CU_ASSERT(nullptr != a.slot);
+  CU_ASSERT(1 == wheel.size());
+
+  wheel.expire(11);
+
+  CU_ASSERT(3 == f.timers.size());
+  CU_ASSERT(&a == f.timers[2]);
+  CU_ASSERT(0 == wheel.size());
+
+  // Restarting active timer reschedules it.  The tick does not
+  // advance, so the deadline of 1 second has already passed, and the
+  // deadline of 2 seconds is tick 20.
+  wheel.start(&a, 1.);
+  wheel.start(&a, 2.);
+
+  CU_ASSERT(1 == wheel.size());
+
+  wheel.expire(19);
+
+  CU_ASSERT(3 == f.timers.size());
+
+  wheel.expire(20);
+
+  CU_ASSERT(4 == f.timers.size());
+  CU_ASSERT(0 == wheel.size());
+
+  ev_loop_destroy(loop);
+}
+
+} // namespace shrpx
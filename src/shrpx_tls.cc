@@ -60,6 +60,7 @@
 #include "shrpx_memcached_request.h"
 #include "shrpx_memcached_dispatcher.h"
 #include "shrpx_connection_handler.h"
+#include "shrpx_connection.h"
 #include "util.h"
 #include "tls.h"
 #include "template.h"
@@ -437,7 +438,7 @@ SSL_SESSION *tls_session_get_cb(SSL *ssl,
 
     // We might stop reading, so start it again
     conn->rlimit.startw();
-    ev_timer_again(conn->loop, &conn->rt);
+    conn->again_rt();
 
     conn->wlimit.startw();
     ev_timer_again(conn->loop, &conn->wt);
@@ -815,6 +816,12 @@ SSL_CTX *create_ssl_context(const char *private_key_file, const char *cert_file,
 
   SSL_CTX_set_options(ssl_ctx, ssl_opts | tlsconf.tls_proto_mask);
 
+#ifdef SHRPX_KTLS
+  if (tlsconf.ktls) {
+    SSL_CTX_set_options(ssl_ctx, SSL_OP_ENABLE_KTLS);
+  }
+#endif // SHRPX_KTLS
+
   if (nghttp2::tls::ssl_ctx_set_proto_versions(
           ssl_ctx, tlsconf.min_proto_version, tlsconf.max_proto_version) != 0) {
     LOG(FATAL) << "Could not set TLS protocol version";
@@ -1113,6 +1120,12 @@ SSL_CTX *create_ssl_client_context(
 
   SSL_CTX_set_options(ssl_ctx, ssl_opts | tlsconf.tls_proto_mask);
 
+#ifdef SHRPX_KTLS
+  if (tlsconf.ktls) {
+    SSL_CTX_set_options(ssl_ctx, SSL_OP_ENABLE_KTLS);
+  }
+#endif // SHRPX_KTLS
+
   SSL_CTX_set_session_cache_mode(ssl_ctx, SSL_SESS_CACHE_CLIENT |
                                               SSL_SESS_CACHE_NO_INTERNAL_STORE);
   SSL_CTX_sess_set_new_cb(ssl_ctx, tls_session_client_new_cb);
@@ -36,6 +36,7 @@ namespace shrpx {
 class ClientHandler;
 class Downstream;
 class DownstreamConnection;
+struct SplicePipe;
 
 class Upstream {
 public:
@@ -83,6 +84,15 @@ public:
   virtual int response_riovec(struct iovec *iov, int iovcnt) const = 0;
   virtual void response_drain(size_t n) = 0;
   virtual bool response_empty() const = 0;
+  // Returns the pipe which holds response body following the data
+  // returned by response_riovec(), or nullptr.
+  virtual SplicePipe *get_response_pipe() const = 0;
+  // Returns true if this upstream can write response body from the
+  // pipe returned by get_response_pipe().
+  virtual bool response_pipe_supported() const = 0;
+  // Returns the buffer which holds the data returned by
+  // response_riovec(), or nullptr.
+  virtual DefaultMemchunks *get_response_buf() = 0;
 
   // Called when PUSH_PROMISE was started in downstream.  The
   // associated downstream is given as |downstream|.  The promised
@@ -105,6 +115,9 @@ public:
   // PUSH_PROMISE for |promised_downstream| is not submitted to
   // upstream session.
   virtual void cancel_premature_downstream(Downstream *promised_downstream) = 0;
+  // Releases the buffers which are not needed while the connection
+  // is idle.  They are allocated again when needed.
+  virtual void release_buffers() = 0;
 };
 
 } // namespace shrpx
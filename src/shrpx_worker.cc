@@ -28,12 +28,19 @@
 #  include <unistd.h>
 #endif // HAVE_UNISTD_H
 
+#include <algorithm>
 #include <memory>
+#include <unordered_set>
+#include <cassert>
+#include <cmath>
 
 #include "shrpx_tls.h"
 #include "shrpx_log.h"
+#include "shrpx_accept_handler.h"
+#include "shrpx_connection_handler.h"
 #include "shrpx_client_handler.h"
 #include "shrpx_http2_session.h"
+#include "shrpx_http_downstream_connection.h"
 #include "shrpx_log_config.h"
 #include "shrpx_memcached_dispatcher.h"
 #ifdef HAVE_MRUBY
@@ -44,6 +51,22 @@
 
 namespace shrpx {
 
+namespace {
+// The maximum number of idle pipes which a worker keeps for splice
+// relay.
+constexpr size_t MAX_PIPE_POOL_SIZE = 64;
+} // namespace
+
+#ifdef HAVE_IO_URING
+namespace {
+// The number of SQEs in io_uring.
+constexpr uint32_t IO_URING_ENTRIES = 1024;
+// The number of buffers provided to io_uring for multishot recv.
+// They are taken from MemchunkPool, and stay in the ring.
+constexpr uint32_t IO_URING_BUFFERS = 128;
+} // namespace
+#endif // HAVE_IO_URING
+
 namespace {
 void eventcb(struct ev_loop *loop, ev_async *w, int revents) {
   auto worker = static_cast<Worker *>(w->data);
@@ -51,6 +74,52 @@ void eventcb(struct ev_loop *loop, ev_async *w, int revents) {
 }
 } // namespace
 
+namespace {
+void stat_timer_cb(struct ev_loop *loop, ev_timer *w, int revents) {
+  auto worker = static_cast<Worker *>(w->data);
+  auto stat = worker->get_worker_stat();
+  auto mcpool = worker->get_mcpool();
+
+  stat->num_connections_snapshot.store(stat->num_connections,
+                                       std::memory_order_relaxed);
+  stat->buffer_bytes_snapshot.store(mcpool->poolsize - mcpool->freelistsize,
+                                    std::memory_order_relaxed);
+
+  size_t limit = 0;
+  size_t inflight = 0;
+
+  for_each_shared_downstream_addr(
+      worker->get_downstream_addr_groups(),
+      [&limit, &inflight](const std::shared_ptr<DownstreamAddrGroup> &g) {
+        auto &concurrency = g->shared_addr->concurrency;
+        if (!concurrency.max_limit) {
+          return;
+        }
+
+        limit += static_cast<size_t>(concurrency.limit);
+        inflight += concurrency.inflight;
+      });
+
+  stat->concurrency_limit_snapshot.store(limit, std::memory_order_relaxed);
+  stat->concurrency_inflight_snapshot.store(inflight,
+                                            std::memory_order_relaxed);
+}
+} // namespace
+
+namespace {
+void outlier_detection_cb(struct ev_loop *loop, ev_timer *w, int revents) {
+  auto worker = static_cast<Worker *>(w->data);
+  worker->detect_outliers();
+}
+} // namespace
+
+namespace {
+void prewarm_cb(struct ev_loop *loop, ev_timer *w, int revents) {
+  auto worker = static_cast<Worker *>(w->data);
+  worker->prewarm_downstream_connections();
+}
+} // namespace
+
 namespace {
 void mcpool_clear_cb(struct ev_loop *loop, ev_timer *w, int revents) {
   auto worker = static_cast<Worker *>(w->data);
@@ -71,6 +140,20 @@ void proc_wev_cb(struct ev_loop *loop, ev_timer *w, int revents) {
 }
 } // namespace
 
+namespace {
+void acceptor_disable_cb(struct ev_loop *loop, ev_timer *w, int revent) {
+  auto worker = static_cast<Worker *>(w->data);
+
+  // If we are in graceful shutdown period, we must not enable
+  // acceptors again.
+  if (worker->get_graceful_shutdown()) {
+    return;
+  }
+
+  worker->enable_acceptor();
+}
+} // namespace
+
 DownstreamAddrGroup::DownstreamAddrGroup() : retired{false} {}
 
 DownstreamAddrGroup::~DownstreamAddrGroup() {}
@@ -80,20 +163,21 @@ DownstreamAddrGroup::~DownstreamAddrGroup() {}
 using DownstreamKey =
     std::tuple<std::vector<std::tuple<StringRef, StringRef, StringRef, size_t,
                                       size_t, Proto, uint32_t, uint32_t,
-                                      uint32_t, bool, bool, bool, bool>>,
+                                      uint32_t, bool, bool, bool, bool,
+                                      size_t, size_t>>,
                bool, SessionAffinity, StringRef, StringRef,
-               SessionAffinityCookieSecure, int64_t, int64_t, StringRef>;
+               SessionAffinityCookieSecure, int64_t, int64_t, StringRef,
+               LoadBalancing, SessionAffinityHashKey, StringRef, size_t,
+               uint32_t, uint32_t, uint32_t, bool>;
 
 namespace {
-DownstreamKey
-create_downstream_key(const std::shared_ptr<SharedDownstreamAddr> &shared_addr,
-                      const StringRef &mruby_file) {
+DownstreamKey create_downstream_key(const DownstreamAddrGroupConfig &g) {
   DownstreamKey dkey;
 
   auto &addrs = std::get<0>(dkey);
-  addrs.resize(shared_addr->addrs.size());
+  addrs.resize(g.addrs.size());
   auto p = std::begin(addrs);
-  for (auto &a : shared_addr->addrs) {
+  for (auto &a : g.addrs) {
     std::get<0>(*p) = a.host;
     std::get<1>(*p) = a.sni;
     std::get<2>(*p) = a.group;
@@ -107,33 +191,96 @@ create_downstream_key(const std::shared_ptr<SharedDownstreamAddr> &shared_addr,
     std::get<10>(*p) = a.tls;
     std::get<11>(*p) = a.dns;
     std::get<12>(*p) = a.upgrade_scheme;
+    std::get<13>(*p) = a.min_idle;
+    std::get<14>(*p) = a.max_connections;
     ++p;
   }
   std::sort(std::begin(addrs), std::end(addrs));
 
-  std::get<1>(dkey) = shared_addr->redirect_if_not_tls;
+  std::get<1>(dkey) = g.redirect_if_not_tls;
 
-  auto &affinity = shared_addr->affinity;
+  auto &affinity = g.affinity;
   std::get<2>(dkey) = affinity.type;
-  std::get<3>(dkey) = affinity.cookie.name;
-  std::get<4>(dkey) = affinity.cookie.path;
-  std::get<5>(dkey) = affinity.cookie.secure;
-  auto &timeout = shared_addr->timeout;
-  std::get<6>(dkey) = timeout.read;
-  std::get<7>(dkey) = timeout.write;
-  std::get<8>(dkey) = mruby_file;
+  if (affinity.type == SessionAffinity::COOKIE) {
+    std::get<3>(dkey) = affinity.cookie.name;
+    std::get<4>(dkey) = affinity.cookie.path;
+    std::get<5>(dkey) = affinity.cookie.secure;
+  } else if (affinity.type == SessionAffinity::HASH) {
+    std::get<10>(dkey) = affinity.hash.key;
+    std::get<11>(dkey) = affinity.hash.header;
+    std::get<12>(dkey) = affinity.hash.path_segments;
+    std::get<13>(dkey) = affinity.hash.max_load;
+  }
+  std::get<6>(dkey) = g.timeout.read;
+  std::get<7>(dkey) = g.timeout.write;
+  std::get<8>(dkey) = g.mruby_file;
+  std::get<9>(dkey) = g.balance;
+  std::get<14>(dkey) = g.hedge;
+  std::get<15>(dkey) = g.max_concurrency;
+  std::get<16>(dkey) = g.collapse;
 
   return dkey;
 }
 } // namespace
 
+// DownstreamAddrKey identifies the backend endpoint which a
+// DownstreamAddr connects to.  The addresses which have the same key
+// can take over the connections and the health state of each other.
+using DownstreamAddrKey =
+    std::tuple<StringRef, StringRef, Proto, uint32_t, bool, bool, bool, bool>;
+
+namespace {
+template <typename T> DownstreamAddrKey create_downstream_addr_key(const T &a) {
+  return DownstreamAddrKey{a.host,      a.sni, a.proto, a.port,
+                           a.host_unix, a.tls, a.dns,   a.upgrade_scheme};
+}
+} // namespace
+
+bool match_downstream_addrs(std::vector<size_t> &res,
+                            const std::vector<DownstreamAddr> &addrs,
+                            const std::vector<DownstreamAddrConfig> &src) {
+  if (addrs.size() != src.size()) {
+    return false;
+  }
+
+  std::vector<std::pair<DownstreamAddrKey, size_t>> lhs, rhs;
+  lhs.reserve(addrs.size());
+  rhs.reserve(src.size());
+
+  for (size_t i = 0; i < addrs.size(); ++i) {
+    lhs.emplace_back(create_downstream_addr_key(addrs[i]), i);
+  }
+
+  for (size_t i = 0; i < src.size(); ++i) {
+    rhs.emplace_back(create_downstream_addr_key(src[i]), i);
+  }
+
+  std::sort(std::begin(lhs), std::end(lhs));
+  std::sort(std::begin(rhs), std::end(rhs));
+
+  res.resize(src.size());
+
+  for (size_t i = 0; i < lhs.size(); ++i) {
+    if (lhs[i].first != rhs[i].first) {
+      return false;
+    }
+
+    res[rhs[i].second] = lhs[i].second;
+  }
+
+  return true;
+}
+
 Worker::Worker(struct ev_loop *loop, SSL_CTX *sv_ssl_ctx, SSL_CTX *cl_ssl_ctx,
                SSL_CTX *tls_session_cache_memcached_ssl_ctx,
                tls::CertLookupTree *cert_tree,
                const std::shared_ptr<TicketKeys> &ticket_keys,
                ConnectionHandler *conn_handler,
                std::shared_ptr<DownstreamConfig> downstreamconf)
-    : randgen_(util::make_mt19937()),
+    : conn_q_(get_config()->worker_event.queue_size),
+      wakeup_pending_(false),
+      randgen_(util::make_mt19937()),
+      pipe_pool_(MAX_PIPE_POOL_SIZE),
       worker_stat_{},
       dns_tracker_(loop),
       loop_(loop),
@@ -144,7 +291,8 @@ Worker::Worker(struct ev_loop *loop, SSL_CTX *sv_ssl_ctx, SSL_CTX *cl_ssl_ctx,
       ticket_keys_(ticket_keys),
       connect_blocker_(
           std::make_unique<ConnectBlocker>(randgen_, loop_, nullptr, nullptr)),
-      graceful_shutdown_(false) {
+      graceful_shutdown_(false),
+      health_check_worker_(false) {
   ev_async_init(&w_, eventcb);
   w_.data = this;
   ev_async_start(loop_, &w_);
@@ -155,6 +303,49 @@ Worker::Worker(struct ev_loop *loop, SSL_CTX *sv_ssl_ctx, SSL_CTX *cl_ssl_ctx,
   ev_timer_init(&proc_wev_timer_, proc_wev_cb, 0., 0.);
   proc_wev_timer_.data = this;
 
+  ev_timer_init(&disable_acceptor_timer_, acceptor_disable_cb, 0., 0.);
+  disable_acceptor_timer_.data = this;
+
+  ev_timer_init(&stat_timer_, stat_timer_cb, 0., 1.);
+  stat_timer_.data = this;
+
+  if (get_config()->api.enabled) {
+    ev_timer_again(loop_, &stat_timer_);
+  }
+
+  ev_timer_init(&outlier_timer_, outlier_detection_cb, 0., 0.);
+  outlier_timer_.data = this;
+
+  ev_timer_init(&prewarm_timer_, prewarm_cb, 0., 0.);
+  prewarm_timer_.data = this;
+
+#ifdef HAVE_IO_URING
+  if (get_config()->io_engine == IOEngine::IO_URING) {
+    auto ring = std::make_unique<IOUring>(loop_, &mcpool_);
+    if (ring->init(IO_URING_ENTRIES, IO_URING_BUFFERS) == 0) {
+      io_uring_ = std::move(ring);
+    } else {
+      LOG(WARN) << "io_uring is not available; fall back to libev";
+    }
+  }
+#endif // HAVE_IO_URING
+
+#ifdef HAVE_MSG_ZEROCOPY
+  auto &zerocopyconf = get_config()->zerocopy_send;
+
+  if (zerocopyconf.enabled) {
+    zerocopy_ = std::make_unique<Zerocopy>(
+        loop_, &mcpool_, zerocopyconf.min_length, zerocopyconf.max_pinned,
+        get_config()->conn.upstream.timeout.write);
+  }
+#endif // HAVE_MSG_ZEROCOPY
+
+  auto timer_wheel_tick = get_config()->conn.upstream.timer_wheel_tick;
+
+  if (timer_wheel_tick > 0.) {
+    timer_wheel_ = std::make_unique<TimerWheel>(loop_, timer_wheel_tick);
+  }
+
   auto &session_cacheconf = get_config()->tls.session_cache;
 
   if (!session_cacheconf.memcached.host.empty()) {
@@ -201,15 +392,189 @@ void ensure_enqueue_addr(
 }
 } // namespace
 
+namespace {
+// Assigns |src| to |dst|.  |src| is copied to |balloc| only if it
+// differs from |dst| so that repeated updates do not grow |balloc|.
+void assign_string_ref(StringRef &dst, BlockAllocator &balloc,
+                       const StringRef &src) {
+  if (dst == src) {
+    return;
+  }
+
+  dst = make_string_ref(balloc, src);
+}
+} // namespace
+
+namespace {
+// Applies the parameters of |src| which can be changed without
+// reconnecting to |addr|.
+void update_downstream_addr(DownstreamAddr &addr, BlockAllocator &balloc,
+                            const DownstreamAddrConfig &src) {
+  addr.weight = src.weight;
+  assign_string_ref(addr.group, balloc, src.group);
+  addr.group_weight = src.group_weight;
+  addr.fall = src.fall;
+  addr.rise = src.rise;
+  addr.min_idle = src.min_idle;
+  addr.max_connections = src.max_connections;
+}
+} // namespace
+
+namespace {
+// Applies the group wide parameters of |src| to |shared_addr|.  If
+// |idx| is not nullptr, src.addrs[i] is shared_addr.addrs[idx[i]].
+// Otherwise, they are in the same order.
+void update_shared_downstream_addr(SharedDownstreamAddr &shared_addr,
+                                   const DownstreamAddrGroupConfig &src,
+                                   const std::vector<size_t> *idx) {
+  auto &balloc = shared_addr.balloc;
+  auto &affinity = shared_addr.affinity;
+
+  affinity.type = src.affinity.type;
+  if (src.affinity.type == SessionAffinity::COOKIE) {
+    assign_string_ref(affinity.cookie.name, balloc, src.affinity.cookie.name);
+    assign_string_ref(affinity.cookie.path, balloc, src.affinity.cookie.path);
+    affinity.cookie.secure = src.affinity.cookie.secure;
+  } else if (src.affinity.type == SessionAffinity::HASH) {
+    auto header = affinity.hash.header;
+    affinity.hash = src.affinity.hash;
+    affinity.hash.header = header;
+    assign_string_ref(affinity.hash.header, balloc, src.affinity.hash.header);
+  }
+  shared_addr.affinity_hash = src.affinity_hash;
+  if (idx) {
+    // The hash ring refers to the addresses in the configuration
+    // order.  All workers must map a key to the same backend.
+    for (auto &ent : shared_addr.affinity_hash) {
+      ent.idx = (*idx)[ent.idx];
+    }
+  }
+  shared_addr.balance = src.balance;
+  shared_addr.hedge.percentile = src.hedge;
+  if (shared_addr.concurrency.max_limit != src.max_concurrency) {
+    shared_addr.concurrency.max_limit = src.max_concurrency;
+    shared_addr.concurrency.limit = src.max_concurrency;
+  }
+  shared_addr.redirect_if_not_tls = src.redirect_if_not_tls;
+  shared_addr.collapse.enabled = src.collapse;
+  shared_addr.timeout.read = src.timeout.read;
+  shared_addr.timeout.write = src.timeout.write;
+}
+} // namespace
+
+namespace {
+// Builds the weight groups of |shared_addr| from scratch.
+void init_weight_groups(SharedDownstreamAddr &shared_addr) {
+  shared_addr.pq = decltype(shared_addr.pq)();
+  shared_addr.wgs.clear();
+
+  for (auto &addr : shared_addr.addrs) {
+    addr.wg = nullptr;
+    addr.queued = false;
+  }
+
+  if (shared_addr.affinity.type != SessionAffinity::NONE) {
+    return;
+  }
+
+  std::map<StringRef, WeightGroup *> wgs;
+  size_t num_wgs = 0;
+  for (auto &addr : shared_addr.addrs) {
+    if (wgs.find(addr.group) == std::end(wgs)) {
+      ++num_wgs;
+      wgs.emplace(addr.group, nullptr);
+    }
+  }
+
+  shared_addr.wgs = std::vector<WeightGroup>(num_wgs);
+
+  for (auto &addr : shared_addr.addrs) {
+    auto &wg = wgs[addr.group];
+    if (wg == nullptr) {
+      wg = &shared_addr.wgs[--num_wgs];
+      wg->seq = num_wgs;
+    }
+
+    wg->weight = addr.group_weight;
+    wg->pq.push(DownstreamAddrEntry{&addr, addr.seq, addr.cycle});
+    addr.queued = true;
+    addr.wg = wg;
+  }
+
+  assert(num_wgs == 0);
+
+  for (auto &kv : wgs) {
+    shared_addr.pq.push(
+        WeightGroupEntry{kv.second, kv.second->seq, kv.second->cycle});
+    kv.second->queued = true;
+  }
+}
+} // namespace
+
+namespace {
+// Moves idle connections, TLS session cache, and health state of
+// |src| which is no longer used to |dst| which connects to the same
+// endpoint.  |group| is the group which |dst| belongs to.
+void take_over_downstream_addr(
+    DownstreamAddr &dst, DownstreamAddr &src,
+    const std::shared_ptr<DownstreamAddrGroup> &group, ev_tstamp now) {
+  std::swap(dst.dconn_pool, src.dconn_pool);
+  dst.dconn_pool->for_each([&group, &dst](DownstreamConnection *dconn) {
+    // Only HttpDownstreamConnection is pooled.
+    static_cast<HttpDownstreamConnection *>(dconn)->set_downstream_addr(
+        group, &dst);
+  });
+
+  dst.tls_session_cache = std::move(src.tls_session_cache);
+  dst.latency = src.latency;
+  dst.outlier_stats = src.outlier_stats;
+  dst.num_ejections = src.num_ejections;
+  dst.ejected_until = src.ejected_until;
+
+  // If the health of the endpoint is shared, the offline state is
+  // restored by update_downstream_health().
+  if (!dst.endpoint->share_health && src.connect_blocker->in_offline()) {
+    dst.connect_blocker->offline();
+
+    if (dst.rise) {
+      dst.live_check->schedule();
+    }
+  } else if (dst.ejected_until > now) {
+    dst.connect_blocker->block(dst.ejected_until - now);
+  }
+}
+} // namespace
+
 void Worker::replace_downstream_config(
     std::shared_ptr<DownstreamConfig> downstreamconf) {
-  for (auto &g : downstream_addr_groups_) {
-    g->retired = true;
+  // The current configuration is kept until the end of this function
+  // in order to find the groups which have not changed.
+  auto old_downstreamconf = std::move(downstreamconf_);
+  auto old_groups = std::move(downstream_addr_groups_);
+
+  std::map<StringRef, size_t> old_groups_indexer;
+  // SharedDownstreamAddr of the current groups which are reused as
+  // they are, or updated in place.
+  std::unordered_set<SharedDownstreamAddr *> reused_shared_addrs;
+  // The current groups which are reused.
+  std::unordered_set<DownstreamAddrGroup *> reused_groups;
 
-    auto &shared_addr = g->shared_addr;
-    for (auto &addr : shared_addr->addrs) {
-      addr.dconn_pool->remove_all();
-    }
+#ifdef HAVE_MRUBY
+  // TODO It is a bit less efficient because
+  // mruby::create_mruby_context returns std::unique_ptr and we cannot
+  // use std::make_shared.
+  std::map<StringRef, std::shared_ptr<mruby::MRubyContext>> shared_mruby_ctxs;
+#endif // HAVE_MRUBY
+
+  for (size_t i = 0; i < old_groups.size(); ++i) {
+    auto &src = old_downstreamconf->addr_groups[i];
+
+    old_groups_indexer.emplace(src.pattern, i);
+
+#ifdef HAVE_MRUBY
+    shared_mruby_ctxs.emplace(src.mruby_file,
+                              old_groups[i]->shared_addr->mruby_ctx);
+#endif // HAVE_MRUBY
   }
 
   downstreamconf_ = downstreamconf;
@@ -222,155 +587,430 @@ void Worker::replace_downstream_config(
       std::vector<std::shared_ptr<DownstreamAddrGroup>>(groups.size());
 
   std::map<DownstreamKey, size_t> addr_groups_indexer;
-#ifdef HAVE_MRUBY
-  // TODO It is a bit less efficient because
-  // mruby::create_mruby_context returns std::unique_ptr and we cannot
-  // use std::make_shared.
-  std::map<StringRef, std::shared_ptr<mruby::MRubyContext>> shared_mruby_ctxs;
-#endif // HAVE_MRUBY
+  // The indices of the groups which have newly created
+  // SharedDownstreamAddr.
+  std::vector<size_t> new_groups;
+  std::vector<size_t> idx;
 
   for (size_t i = 0; i < groups.size(); ++i) {
     auto &src = groups[i];
     auto &dst = downstream_addr_groups_[i];
 
+    std::shared_ptr<DownstreamAddrGroup> old_group;
+    const DownstreamAddrGroupConfig *old_src = nullptr;
+
+    auto old_it = old_groups_indexer.find(src.pattern);
+    if (old_it != std::end(old_groups_indexer)) {
+      old_group = old_groups[(*old_it).second];
+      old_src = &old_downstreamconf->addr_groups[(*old_it).second];
+    }
+
+    std::shared_ptr<SharedDownstreamAddr> shared_addr;
+
+    // share the connection if patterns have the same set of backend
+    // addresses.
+
+    auto dkey = create_downstream_key(src);
+    auto it = addr_groups_indexer.find(dkey);
+
+    if (it != std::end(addr_groups_indexer)) {
+      auto &g = *(std::begin(downstream_addr_groups_) + (*it).second);
+      if (LOG_ENABLED(INFO)) {
+        LOG(INFO) << src.pattern << " shares the same backend group with "
+                  << g->pattern;
+      }
+      shared_addr = g->shared_addr;
+    } else {
+      if (old_group &&
+          reused_shared_addrs.find(old_group->shared_addr.get()) ==
+              std::end(reused_shared_addrs)) {
+        auto &old_shared_addr = old_group->shared_addr;
+
+        if (create_downstream_key(*old_src) == dkey) {
+          if (LOG_ENABLED(INFO)) {
+            LOG(INFO) << src.pattern << " is unchanged";
+          }
+
+          shared_addr = old_shared_addr;
+        } else if (old_src->mruby_file == src.mruby_file &&
+                   match_downstream_addrs(idx, old_shared_addr->addrs,
+                                          src.addrs)) {
+          if (LOG_ENABLED(INFO)) {
+            LOG(INFO) << src.pattern << " is updated in place";
+          }
+
+          for (size_t j = 0; j < src.addrs.size(); ++j) {
+            update_downstream_addr(old_shared_addr->addrs[idx[j]],
+                                   old_shared_addr->balloc, src.addrs[j]);
+          }
+
+          update_shared_downstream_addr(*old_shared_addr, src, &idx);
+          init_weight_groups(*old_shared_addr);
+
+          shared_addr = old_shared_addr;
+        }
+
+        if (shared_addr) {
+          reused_shared_addrs.emplace(shared_addr.get());
+        }
+      }
+
+      if (!shared_addr) {
+        shared_addr = std::make_shared<SharedDownstreamAddr>();
+
+        shared_addr->addrs.resize(src.addrs.size());
+        update_shared_downstream_addr(*shared_addr, src, nullptr);
+
+        for (size_t j = 0; j < src.addrs.size(); ++j) {
+          auto &src_addr = src.addrs[j];
+          auto &dst_addr = shared_addr->addrs[j];
+
+          dst_addr.addr = src_addr.addr;
+          dst_addr.host = make_string_ref(shared_addr->balloc, src_addr.host);
+          dst_addr.hostport =
+              make_string_ref(shared_addr->balloc, src_addr.hostport);
+          dst_addr.port = src_addr.port;
+          dst_addr.host_unix = src_addr.host_unix;
+          dst_addr.proto = src_addr.proto;
+          dst_addr.tls = src_addr.tls;
+          dst_addr.sni = make_string_ref(shared_addr->balloc, src_addr.sni);
+          dst_addr.dns = src_addr.dns;
+          dst_addr.upgrade_scheme = src_addr.upgrade_scheme;
+
+          update_downstream_addr(dst_addr, shared_addr->balloc, src_addr);
+
+          auto shared_addr_ptr = shared_addr.get();
+
+          dst_addr.connect_blocker = std::make_unique<ConnectBlocker>(
+              randgen_, loop_, nullptr, [shared_addr_ptr, &dst_addr]() {
+                if (!dst_addr.queued) {
+                  if (!dst_addr.wg) {
+                    return;
+                  }
+                  ensure_enqueue_addr(shared_addr_ptr->pq, dst_addr.wg,
+                                      &dst_addr);
+                }
+              });
+
+          dst_addr.live_check = std::make_unique<LiveCheck>(
+              loop_, cl_ssl_ctx_, this, &dst_addr, randgen_);
+          dst_addr.endpoint =
+              conn_handler_->get_downstream_endpoint(dst_addr);
+        }
+
+#ifdef HAVE_MRUBY
+        auto mruby_ctx_it = shared_mruby_ctxs.find(src.mruby_file);
+        if (mruby_ctx_it == std::end(shared_mruby_ctxs)) {
+          shared_addr->mruby_ctx = mruby::create_mruby_context(src.mruby_file);
+          assert(shared_addr->mruby_ctx);
+          shared_mruby_ctxs.emplace(src.mruby_file, shared_addr->mruby_ctx);
+        } else {
+          shared_addr->mruby_ctx = (*mruby_ctx_it).second;
+        }
+#endif // HAVE_MRUBY
+
+        // The order of the addresses only matters to the weighted
+        // scheduling.  With affinity, the hash ring refers to the
+        // addresses in the configuration order, and shuffling them
+        // would make each worker map a key to a different backend.
+        if (shared_addr->affinity.type == SessionAffinity::NONE) {
+          std::shuffle(std::begin(shared_addr->addrs),
+                       std::end(shared_addr->addrs), randgen_);
+        }
+
+        size_t seq = 0;
+        for (auto &addr : shared_addr->addrs) {
+          addr.dconn_pool = std::make_unique<DownstreamConnectionPool>();
+          addr.seq = seq++;
+        }
+
+        init_weight_groups(*shared_addr);
+
+        new_groups.push_back(i);
+      }
+
+      addr_groups_indexer.emplace(std::move(dkey), i);
+    }
+
+    if (old_group && old_group->shared_addr == shared_addr) {
+      // Keep the same object so that the connections made for this
+      // group are not retired.
+      dst = old_group;
+      reused_groups.emplace(dst.get());
+
+      continue;
+    }
+
     dst = std::make_shared<DownstreamAddrGroup>();
     dst->pattern =
         ImmutableString{std::begin(src.pattern), std::end(src.pattern)};
+    dst->shared_addr = shared_addr;
+  }
+
+  // The addresses which are no longer used, indexed by the endpoint.
+  std::map<DownstreamAddrKey, std::vector<DownstreamAddr *>> old_addrs;
+
+  for (auto &g : old_groups) {
+    if (reused_groups.find(g.get()) == std::end(reused_groups)) {
+      g->retired = true;
+    }
+
+    // Skip SharedDownstreamAddr which is still used, or has already
+    // been visited through the other group.
+    auto &shared_addr = g->shared_addr;
+    if (!reused_shared_addrs.emplace(shared_addr.get()).second) {
+      continue;
+    }
+
+    for (auto &addr : shared_addr->addrs) {
+      old_addrs[create_downstream_addr_key(addr)].push_back(&addr);
+    }
+  }
+
+  auto now = ev_now(loop_);
 
-    auto shared_addr = std::make_shared<SharedDownstreamAddr>();
+  for (auto i : new_groups) {
+    auto &g = downstream_addr_groups_[i];
 
-    shared_addr->addrs.resize(src.addrs.size());
-    shared_addr->affinity.type = src.affinity.type;
-    if (src.affinity.type == SessionAffinity::COOKIE) {
-      shared_addr->affinity.cookie.name =
-          make_string_ref(shared_addr->balloc, src.affinity.cookie.name);
-      if (!src.affinity.cookie.path.empty()) {
-        shared_addr->affinity.cookie.path =
-            make_string_ref(shared_addr->balloc, src.affinity.cookie.path);
+    for (auto &addr : g->shared_addr->addrs) {
+      auto it = old_addrs.find(create_downstream_addr_key(addr));
+      if (it == std::end(old_addrs) || (*it).second.empty()) {
+        continue;
       }
-      shared_addr->affinity.cookie.secure = src.affinity.cookie.secure;
-    }
-    shared_addr->affinity_hash = src.affinity_hash;
-    shared_addr->redirect_if_not_tls = src.redirect_if_not_tls;
-    shared_addr->timeout.read = src.timeout.read;
-    shared_addr->timeout.write = src.timeout.write;
-
-    for (size_t j = 0; j < src.addrs.size(); ++j) {
-      auto &src_addr = src.addrs[j];
-      auto &dst_addr = shared_addr->addrs[j];
-
-      dst_addr.addr = src_addr.addr;
-      dst_addr.host = make_string_ref(shared_addr->balloc, src_addr.host);
-      dst_addr.hostport =
-          make_string_ref(shared_addr->balloc, src_addr.hostport);
-      dst_addr.port = src_addr.port;
-      dst_addr.host_unix = src_addr.host_unix;
-      dst_addr.weight = src_addr.weight;
-      dst_addr.group = make_string_ref(shared_addr->balloc, src_addr.group);
-      dst_addr.group_weight = src_addr.group_weight;
-      dst_addr.proto = src_addr.proto;
-      dst_addr.tls = src_addr.tls;
-      dst_addr.sni = make_string_ref(shared_addr->balloc, src_addr.sni);
-      dst_addr.fall = src_addr.fall;
-      dst_addr.rise = src_addr.rise;
-      dst_addr.dns = src_addr.dns;
-      dst_addr.upgrade_scheme = src_addr.upgrade_scheme;
-
-      auto shared_addr_ptr = shared_addr.get();
-
-      dst_addr.connect_blocker = std::make_unique<ConnectBlocker>(
-          randgen_, loop_, nullptr, [shared_addr_ptr, &dst_addr]() {
-            if (!dst_addr.queued) {
-              if (!dst_addr.wg) {
-                return;
-              }
-              ensure_enqueue_addr(shared_addr_ptr->pq, dst_addr.wg, &dst_addr);
-            }
-          });
 
-      dst_addr.live_check = std::make_unique<LiveCheck>(
-          loop_, cl_ssl_ctx_, this, &dst_addr, randgen_);
+      take_over_downstream_addr(addr, *(*it).second.back(), g, now);
+      (*it).second.pop_back();
     }
+  }
 
-#ifdef HAVE_MRUBY
-    auto mruby_ctx_it = shared_mruby_ctxs.find(src.mruby_file);
-    if (mruby_ctx_it == std::end(shared_mruby_ctxs)) {
-      shared_addr->mruby_ctx = mruby::create_mruby_context(src.mruby_file);
-      assert(shared_addr->mruby_ctx);
-      shared_mruby_ctxs.emplace(src.mruby_file, shared_addr->mruby_ctx);
-    } else {
-      shared_addr->mruby_ctx = (*mruby_ctx_it).second;
+  for (auto &kv : old_addrs) {
+    for (auto addr : kv.second) {
+      addr->dconn_pool->remove_all();
     }
-#endif // HAVE_MRUBY
+  }
 
-    // share the connection if patterns have the same set of backend
-    // addresses.
+  update_downstream_health();
 
-    auto dkey = create_downstream_key(shared_addr, src.mruby_file);
-    auto it = addr_groups_indexer.find(dkey);
+  auto interval = downstreamconf->outlier.interval;
 
-    if (it == std::end(addr_groups_indexer)) {
-      std::shuffle(std::begin(shared_addr->addrs), std::end(shared_addr->addrs),
-                   randgen_);
+  ev_timer_stop(loop_, &outlier_timer_);
 
-      size_t seq = 0;
-      for (auto &addr : shared_addr->addrs) {
-        addr.dconn_pool = std::make_unique<DownstreamConnectionPool>();
-        addr.seq = seq++;
-      }
+  if (interval > 0.) {
+    ev_timer_set(&outlier_timer_, interval, interval);
+    ev_timer_start(loop_, &outlier_timer_);
+  } else {
+    worker_stat_.num_ejected_addrs.store(0, std::memory_order_relaxed);
 
-      if (shared_addr->affinity.type == SessionAffinity::NONE) {
-        std::map<StringRef, WeightGroup *> wgs;
-        size_t num_wgs = 0;
-        for (auto &addr : shared_addr->addrs) {
-          if (wgs.find(addr.group) == std::end(wgs)) {
-            ++num_wgs;
-            wgs.emplace(addr.group, nullptr);
+    std::lock_guard<std::mutex> g(worker_stat_.ejected_addrs_mu);
+    worker_stat_.ejected_addrs.clear();
+  }
+
+  ev_timer_stop(loop_, &prewarm_timer_);
+
+  for (auto &g : downstream_addr_groups_) {
+    auto &addrs = g->shared_addr->addrs;
+    if (std::any_of(std::begin(addrs), std::end(addrs),
+                    [](const DownstreamAddr &addr) {
+                      return addr.min_idle > 0;
+                    })) {
+      // Start within 1 second so that workers do not connect to
+      // backends at the same time after reload.
+      schedule_prewarm(0.);
+      break;
+    }
+  }
+}
+
+namespace {
+// The interval between the runs of pre-warming backend connections.
+constexpr ev_tstamp PREWARM_INTERVAL = 1.;
+} // namespace
+
+void Worker::schedule_prewarm(ev_tstamp base) {
+  std::uniform_real_distribution<> jitter(0., PREWARM_INTERVAL);
+
+  ev_timer_set(&prewarm_timer_, base + jitter(randgen_), 0.);
+  ev_timer_start(loop_, &prewarm_timer_);
+}
+
+void Worker::update_downstream_health() {
+  for_each_shared_downstream_addr(
+      downstream_addr_groups_,
+      [this](const std::shared_ptr<DownstreamAddrGroup> &g) {
+        for (auto &addr : g->shared_addr->addrs) {
+          // Without rise, the address stays offline once it is
+          // considered so.
+          auto &endpoint = addr.endpoint;
+          if (!endpoint->share_health || addr.rise == 0) {
+            continue;
+          }
+
+          auto &connect_blocker = addr.connect_blocker;
+
+          if (!endpoint->offline.load(std::memory_order_acquire)) {
+            if (connect_blocker->in_offline()) {
+              if (health_check_worker_) {
+                addr.live_check->cancel();
+              }
+
+              connect_blocker->online();
+            }
+
+            continue;
+          }
+
+          if (connect_blocker->in_offline()) {
+            continue;
+          }
+
+          connect_blocker->offline();
+
+          if (health_check_worker_) {
+            addr.live_check->schedule();
           }
         }
+      });
+}
 
-        shared_addr->wgs = std::vector<WeightGroup>(num_wgs);
+void Worker::set_health_check_worker(bool f) { health_check_worker_ = f; }
 
-        for (auto &addr : shared_addr->addrs) {
-          auto &wg = wgs[addr.group];
-          if (wg == nullptr) {
-            wg = &shared_addr->wgs[--num_wgs];
-            wg->seq = num_wgs;
+void Worker::reclaim_downstream_connections() {
+  for_each_shared_downstream_addr(
+      downstream_addr_groups_,
+      [](const std::shared_ptr<DownstreamAddrGroup> &g) {
+        for (auto &addr : g->shared_addr->addrs) {
+          auto &dconn_pool = addr.dconn_pool;
+
+          if (dconn_pool->size() == 0 ||
+              !downstream_connection_reclaim(&addr)) {
+            continue;
           }
 
-          wg->weight = addr.group_weight;
-          wg->pq.push(DownstreamAddrEntry{&addr, addr.seq, addr.cycle});
-          addr.queued = true;
-          addr.wg = wg;
+          auto dconn = dconn_pool->pop_downstream_connection();
+          if (dconn) {
+            continue;
+          }
+
+          // Only the connections which are being pre-warmed are left.
+          DownstreamConnection *warming = nullptr;
+          dconn_pool->for_each([&warming](DownstreamConnection *dconn) {
+            warming = dconn;
+          });
+
+          dconn_pool->remove_downstream_connection(warming);
         }
+      });
+}
+
+void Worker::prewarm_downstream_connections() {
+  if (graceful_shutdown_ || health_check_worker_) {
+    return;
+  }
+
+  if (connect_blocker_->blocked()) {
+    schedule_prewarm(PREWARM_INTERVAL / 2);
+    return;
+  }
 
-        assert(num_wgs == 0);
+  for_each_shared_downstream_addr(
+      downstream_addr_groups_,
+      [this](const std::shared_ptr<DownstreamAddrGroup> &g) {
+        prewarm_downstream_addrs(g);
+      });
 
-        for (auto &kv : wgs) {
-          shared_addr->pq.push(
-              WeightGroupEntry{kv.second, kv.second->seq, kv.second->cycle});
-          kv.second->queued = true;
+  schedule_prewarm(PREWARM_INTERVAL / 2);
+}
+
+void Worker::prewarm_downstream_addrs(
+    const std::shared_ptr<DownstreamAddrGroup> &group) {
+  for (auto &addr : group->shared_addr->addrs) {
+    if (addr.min_idle == 0 || addr.connect_blocker->blocked()) {
+      continue;
+    }
+
+    if (addr.proto == Proto::HTTP2) {
+      for (auto n = addr.http2_extra_freelist.size(); n < addr.min_idle; ++n) {
+        if (!downstream_connection_acquire_prewarm(&addr)) {
+          break;
         }
+
+        auto session = new Http2Session(loop_, cl_ssl_ctx_, this, group, &addr);
+        session->add_to_extra_freelist();
+        // This starts connecting to backend.  |session| is deleted if
+        // it fails.
+        session->signal_write();
       }
 
-      dst->shared_addr = shared_addr;
+      continue;
+    }
 
-      addr_groups_indexer.emplace(std::move(dkey), i);
-    } else {
-      auto &g = *(std::begin(downstream_addr_groups_) + (*it).second);
-      if (LOG_ENABLED(INFO)) {
-        LOG(INFO) << dst->pattern << " shares the same backend group with "
-                  << g->pattern;
+    for (auto n = addr.dconn_pool->size(); n < addr.min_idle; ++n) {
+      if (!downstream_connection_acquire_prewarm(&addr)) {
+        break;
+      }
+
+      auto dconn =
+          std::make_unique<HttpDownstreamConnection>(group, &addr, loop_, this);
+      auto p = dconn.get();
+
+      addr.dconn_pool->add_warming_downstream_connection(std::move(dconn));
+
+      if (p->prewarm() != 0) {
+        addr.dconn_pool->remove_downstream_connection(p);
+        break;
       }
-      dst->shared_addr = g->shared_addr;
     }
   }
 }
 
+void Worker::detect_outliers() {
+  auto now = ev_now(loop_);
+  size_t nejected = 0;
+  size_t nejected_now = 0;
+  std::vector<EjectedAddr> ejected_addrs;
+
+  for_each_shared_downstream_addr(
+      downstream_addr_groups_,
+      [this, now, &nejected, &nejected_now,
+       &ejected_addrs](const std::shared_ptr<DownstreamAddrGroup> &g) {
+        auto &addrs = g->shared_addr->addrs;
+
+        nejected += detect_downstream_outliers(addrs, *downstreamconf_, now);
+
+        for (auto &addr : addrs) {
+          if (addr.ejected_until != 0.) {
+            ++nejected_now;
+          } else if (addr.num_ejections == 0) {
+            continue;
+          }
+
+          auto &hostport = addr.host_unix ? addr.host : addr.hostport;
+
+          ejected_addrs.push_back(
+              EjectedAddr{std::string{std::begin(hostport), std::end(hostport)},
+                          addr.ejected_until, addr.num_ejections});
+        }
+      });
+
+  worker_stat_.num_outlier_ejections.fetch_add(nejected,
+                                               std::memory_order_relaxed);
+  worker_stat_.num_ejected_addrs.store(nejected_now,
+                                       std::memory_order_relaxed);
+
+  std::lock_guard<std::mutex> g(worker_stat_.ejected_addrs_mu);
+  worker_stat_.ejected_addrs = std::move(ejected_addrs);
+}
+
 Worker::~Worker() {
+  acceptors_.clear();
+
   ev_async_stop(loop_, &w_);
   ev_timer_stop(loop_, &mcpool_clear_timer_);
   ev_timer_stop(loop_, &proc_wev_timer_);
+  ev_timer_stop(loop_, &disable_acceptor_timer_);
+  ev_timer_stop(loop_, &stat_timer_);
+  ev_timer_stop(loop_, &outlier_timer_);
+  ev_timer_stop(loop_, &prewarm_timer_);
 }
 
 void Worker::schedule_clear_mcpool() {
@@ -403,69 +1043,154 @@ void Worker::send(const WorkerEvent &event) {
     q_.push_back(event);
   }
 
-  ev_async_send(loop_, &w_);
+  wakeup();
 }
 
-void Worker::process_events() {
-  WorkerEvent wev;
-  {
-    std::lock_guard<std::mutex> g(m_);
+void Worker::send_connection(int fd, const sockaddr *addr, int addrlen,
+                             const UpstreamAddr *faddr) {
+  ConnectionEvent cev;
 
-    // Process event one at a time.  This is important for
-    // WorkerEventType::NEW_CONNECTION event since accepting large
-    // number of new connections at once may delay time to 1st byte
-    // for existing connections.
+  if (addr->sa_family == AF_UNIX) {
+    cev.client_addr.sa.sa_family = AF_UNIX;
+    cev.client_addrlen = sizeof(sa_family_t);
+  } else {
+    assert(static_cast<size_t>(addrlen) <= sizeof(cev.client_addr));
+    memcpy(&cev.client_addr, addr, addrlen);
+    cev.client_addrlen = addrlen;
+  }
 
-    if (q_.empty()) {
-      ev_timer_stop(loop_, &proc_wev_timer_);
-      return;
-    }
+  cev.faddr = faddr;
+  cev.client_fd = fd;
+  cev.enqueued = std::chrono::steady_clock::now();
 
-    wev = q_.front();
-    q_.pop_front();
+  if (conn_q_.push(cev)) {
+    wakeup();
+    return;
   }
 
-  ev_timer_start(loop_, &proc_wev_timer_);
+  // The worker is far behind.  Fall back to the mutex protected
+  // queue rather than dropping the connection.
+  worker_stat_.num_conn_event_overflows.fetch_add(1,
+                                                  std::memory_order_relaxed);
 
-  auto config = get_config();
+  WorkerEvent wev{};
+  wev.type = WorkerEventType::NEW_CONNECTION;
+  wev.client_fd = fd;
+  memcpy(&wev.client_addr, addr, addrlen);
+  wev.client_addrlen = addrlen;
+  wev.faddr = faddr;
 
-  auto worker_connections = config->conn.upstream.worker_connections;
+  send(wev);
+}
 
-  switch (wev.type) {
-  case WorkerEventType::NEW_CONNECTION: {
-    if (LOG_ENABLED(INFO)) {
-      WLOG(INFO, this) << "WorkerEvent: client_fd=" << wev.client_fd
-                       << ", addrlen=" << wev.client_addrlen;
+size_t Worker::get_conn_event_queue_depth() const { return conn_q_.size(); }
+
+void Worker::wakeup() {
+  // ev_async_send issues a system call unless the previous one is
+  // still pending.  Batch wakeups until the worker starts processing
+  // events.
+  if (!wakeup_pending_.exchange(true, std::memory_order_acq_rel)) {
+    ev_async_send(loop_, &w_);
+  }
+}
+
+void Worker::handle_connection_event(ConnectionEvent &cev) {
+  auto latency = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     std::chrono::steady_clock::now() - cev.enqueued)
+                     .count();
+  if (latency < 0) {
+    latency = 0;
+  }
+
+  worker_stat_.num_conn_events.fetch_add(1, std::memory_order_relaxed);
+  worker_stat_.conn_event_latency_total.fetch_add(latency,
+                                                  std::memory_order_relaxed);
+  if (static_cast<uint64_t>(latency) >
+      worker_stat_.conn_event_latency_max.load(std::memory_order_relaxed)) {
+    worker_stat_.conn_event_latency_max.store(latency,
+                                              std::memory_order_relaxed);
+  }
+
+  if (LOG_ENABLED(INFO)) {
+    WLOG(INFO, this) << "ConnectionEvent: client_fd=" << cev.client_fd
+                     << ", addrlen=" << cev.client_addrlen
+                     << ", latency=" << latency << "ns";
+  }
+
+  handle_connection(cev.client_fd, &cev.client_addr.sa, cev.client_addrlen,
+                    cev.faddr);
+}
+
+void Worker::process_events() {
+  wakeup_pending_.exchange(false, std::memory_order_acq_rel);
+
+  // Process at most |budget| events in one event loop iteration.
+  // Accepting large number of new connections at once may delay time
+  // to 1st byte for existing connections.
+  auto budget = get_config()->worker_event.budget;
+
+  auto depth = conn_q_.size();
+  if (depth > worker_stat_.conn_event_queue_depth_max.load(
+                  std::memory_order_relaxed)) {
+    worker_stat_.conn_event_queue_depth_max.store(depth,
+                                                  std::memory_order_relaxed);
+  }
+
+  ConnectionEvent cev;
+  size_t n = 0;
+
+  for (; n < budget; ++n) {
+    if (conn_q_.pop(cev)) {
+      handle_connection_event(cev);
+      continue;
     }
 
-    if (worker_stat_.num_connections >= worker_connections) {
+    WorkerEvent wev;
+    {
+      std::lock_guard<std::mutex> g(m_);
 
-      if (LOG_ENABLED(INFO)) {
-        WLOG(INFO, this) << "Too many connections >= " << worker_connections;
+      if (q_.empty()) {
+        break;
       }
 
-      close(wev.client_fd);
+      wev = std::move(q_.front());
+      q_.pop_front();
+    }
 
-      break;
+    // The connections which were enqueued before |wev| must be
+    // handled before it, especially before GRACEFUL_SHUTDOWN.
+    while (conn_q_.pop(cev)) {
+      handle_connection_event(cev);
     }
 
-    auto client_handler =
-        tls::accept_connection(this, wev.client_fd, &wev.client_addr.sa,
-                               wev.client_addrlen, wev.faddr);
-    if (!client_handler) {
-      if (LOG_ENABLED(INFO)) {
-        WLOG(ERROR, this) << "ClientHandler creation failed";
-      }
-      close(wev.client_fd);
-      break;
+    if (process_event(wev) != 0) {
+      return;
     }
+  }
+
+  if (n == budget) {
+    // There may be more events.  Resume after the other watchers get
+    // a chance to run.
+    ev_timer_start(loop_, &proc_wev_timer_);
+  } else {
+    ev_timer_stop(loop_, &proc_wev_timer_);
+  }
+}
+
+int Worker::process_event(WorkerEvent &wev) {
+  auto config = get_config();
 
+  switch (wev.type) {
+  case WorkerEventType::NEW_CONNECTION:
     if (LOG_ENABLED(INFO)) {
-      WLOG(INFO, this) << "CLIENT_HANDLER:" << client_handler << " created ";
+      WLOG(INFO, this) << "WorkerEvent: client_fd=" << wev.client_fd
+                       << ", addrlen=" << wev.client_addrlen;
     }
 
+    handle_connection(wev.client_fd, &wev.client_addr.sa,
+                      wev.client_addrlen, wev.faddr);
+
     break;
-  }
   case WorkerEventType::REOPEN_LOG:
     WLOG(NOTICE, this) << "Reopening log files: worker process (thread " << this
                        << ")";
@@ -478,10 +1203,19 @@ void Worker::process_events() {
 
     graceful_shutdown_ = true;
 
+    ev_timer_stop(loop_, &prewarm_timer_);
+
+    // The main process keeps the SO_REUSEPORT listener sockets open,
+    // and the new worker process accepts the connections queued on
+    // them after we close our copies.
+    accept_pending_connection();
+    delete_acceptor();
+
     if (worker_stat_.num_connections == 0) {
+      ev_timer_stop(loop_, &proc_wev_timer_);
       ev_break(loop_);
 
-      return;
+      return -1;
     }
 
     break;
@@ -490,12 +1224,97 @@ void Worker::process_events() {
 
     replace_downstream_config(wev.downstreamconf);
 
+    break;
+  case WorkerEventType::UPDATE_DOWNSTREAM_HEALTH:
+    update_downstream_health();
+
+    break;
+  case WorkerEventType::RECLAIM_DOWNSTREAM_CONNECTION:
+    reclaim_downstream_connections();
+
+    break;
+  case WorkerEventType::ENABLE_ACCEPTOR:
+    if (!graceful_shutdown_) {
+      enable_acceptor();
+    }
+
     break;
   default:
     if (LOG_ENABLED(INFO)) {
       WLOG(INFO, this) << "unknown event type " << static_cast<int>(wev.type);
     }
   }
+
+  return 0;
+}
+
+int Worker::handle_connection(int fd, sockaddr *addr, int addrlen,
+                              const UpstreamAddr *faddr) {
+  auto worker_connections = get_config()->conn.upstream.worker_connections;
+
+  if (worker_stat_.num_connections >= worker_connections) {
+
+    if (LOG_ENABLED(INFO)) {
+      WLOG(INFO, this) << "Too many connections >= " << worker_connections;
+    }
+
+    close(fd);
+
+    return -1;
+  }
+
+  auto client_handler = tls::accept_connection(this, fd, addr, addrlen, faddr);
+  if (!client_handler) {
+    if (LOG_ENABLED(INFO)) {
+      WLOG(ERROR, this) << "ClientHandler creation failed";
+    }
+    close(fd);
+    return -1;
+  }
+
+  if (LOG_ENABLED(INFO)) {
+    WLOG(INFO, this) << "CLIENT_HANDLER:" << client_handler << " created ";
+  }
+
+  return 0;
+}
+
+void Worker::add_acceptor(std::unique_ptr<AcceptHandler> h) {
+  acceptors_.push_back(std::move(h));
+}
+
+void Worker::delete_acceptor() {
+  ev_timer_stop(loop_, &disable_acceptor_timer_);
+  acceptors_.clear();
+}
+
+void Worker::enable_acceptor() {
+  for (auto &a : acceptors_) {
+    a->enable();
+  }
+}
+
+void Worker::disable_acceptor() {
+  for (auto &a : acceptors_) {
+    a->disable();
+  }
+}
+
+void Worker::sleep_acceptor(ev_tstamp t) {
+  if (t == 0. || ev_is_active(&disable_acceptor_timer_)) {
+    return;
+  }
+
+  disable_acceptor();
+
+  ev_timer_set(&disable_acceptor_timer_, t, 0.);
+  ev_timer_start(loop_, &disable_acceptor_timer_);
+}
+
+void Worker::accept_pending_connection() {
+  for (auto &a : acceptors_) {
+    a->accept_connection();
+  }
 }
 
 tls::CertLookupTree *Worker::get_cert_lookup_tree() const { return cert_tree_; }
@@ -536,6 +1355,18 @@ bool Worker::get_graceful_shutdown() const { return graceful_shutdown_; }
 
 MemchunkPool *Worker::get_mcpool() { return &mcpool_; }
 
+PipePool *Worker::get_pipe_pool() { return &pipe_pool_; }
+
+#ifdef HAVE_IO_URING
+IOUring *Worker::get_io_uring() const { return io_uring_.get(); }
+#endif // HAVE_IO_URING
+
+#ifdef HAVE_MSG_ZEROCOPY
+Zerocopy *Worker::get_zerocopy() const { return zerocopy_.get(); }
+#endif // HAVE_MSG_ZEROCOPY
+
+TimerWheel *Worker::get_timer_wheel() const { return timer_wheel_.get(); }
+
 MemcachedDispatcher *Worker::get_session_cache_memcached_dispatcher() {
   return session_cache_memcached_dispatcher_.get();
 }
@@ -741,10 +1572,490 @@ void downstream_failure(DownstreamAddr *addr, const Address *raddr) {
 
     connect_blocker->offline();
 
-    if (addr->rise) {
+    if (addr->rise == 0) {
+      return;
+    }
+
+    auto &endpoint = addr->endpoint;
+
+    if (!endpoint->share_health) {
       addr->live_check->schedule();
+      return;
+    }
+
+    // The health check worker probes the endpoint, and tells all
+    // workers when it is back online.  Only the first worker which
+    // finds it offline notifies the others.
+    if (!endpoint->offline.exchange(true, std::memory_order_acq_rel)) {
+      endpoint->conn_handler->worker_update_downstream_health();
+    }
+  }
+}
+
+void downstream_request_begin(DownstreamAddr *addr) { ++addr->num_inflight; }
+
+void downstream_request_end(DownstreamAddr *addr) {
+  assert(addr->num_inflight);
+  --addr->num_inflight;
+}
+
+namespace {
+// The weight of the new sample in DownstreamAddr.latency.
+constexpr double LATENCY_EWMA_ALPHA = 0.2;
+} // namespace
+
+void downstream_update_latency(DownstreamAddr *addr, ev_tstamp t) {
+  // Follow the increase immediately so that a backend which has
+  // just become slow loses its share quickly, and decay slowly.
+  if (addr->latency == 0. || t > addr->latency) {
+    addr->latency = t;
+    return;
+  }
+
+  addr->latency += (t - addr->latency) * LATENCY_EWMA_ALPHA;
+}
+
+void downstream_record_response(DownstreamAddr *addr, uint32_t status_code,
+                                ev_tstamp t) {
+  downstream_update_latency(addr, t);
+
+  auto &stats = addr->outlier_stats[0];
+
+  ++stats.num_responses;
+  if (status_code >= 500) {
+    ++stats.num_errors;
+  }
+  stats.latency_total += t;
+}
+
+void downstream_record_reset(DownstreamAddr *addr) {
+  ++addr->outlier_stats[0].num_resets;
+}
+
+namespace {
+// The minimum number of samples required to compute the delay of
+// hedged request.
+constexpr size_t HEDGE_MIN_SAMPLES = 32;
+// The delay of hedged request is recomputed every this number of
+// samples.
+constexpr size_t HEDGE_UPDATE_INTERVAL = 16;
+} // namespace
+
+void downstream_record_hedge_latency(SharedDownstreamAddr *shared_addr,
+                                     ev_tstamp t) {
+  auto &hedge = shared_addr->hedge;
+
+  hedge.samples[hedge.nsamples % HEDGE_LATENCY_SAMPLES] = t;
+  ++hedge.nsamples;
+
+  if (hedge.nsamples < HEDGE_MIN_SAMPLES ||
+      hedge.nsamples % HEDGE_UPDATE_INTERVAL) {
+    return;
+  }
+
+  auto samples = hedge.samples;
+  auto n = std::min(hedge.nsamples, HEDGE_LATENCY_SAMPLES);
+  auto nth = std::begin(samples) + (n - 1) * hedge.percentile / 100;
+
+  std::nth_element(std::begin(samples), nth, std::begin(samples) + n);
+
+  hedge.delay = *nth;
+}
+
+namespace {
+// The maximum exponent of the ejection time multiplier.
+constexpr size_t MAX_EJECTION_EXP = 10;
+} // namespace
+
+size_t detect_downstream_outliers(std::vector<DownstreamAddr> &addrs,
+                                  const DownstreamConfig &downstreamconf,
+                                  ev_tstamp now) {
+  auto &outlierconf = downstreamconf.outlier;
+
+  // The average latency of each address in the last 2 intervals, or
+  // -1 if it has not served any response.
+  std::vector<double> latencies(addrs.size(), -1.);
+  size_t num_ejected = 0;
+
+  for (size_t i = 0; i < addrs.size(); ++i) {
+    auto &addr = addrs[i];
+
+    if (addr.ejected_until != 0.) {
+      if (addr.ejected_until > now) {
+        ++num_ejected;
+        continue;
+      }
+
+      // The responses recorded while ejected were for the requests
+      // forwarded before ejection.  Start over.
+      addr.ejected_until = 0.;
+      addr.outlier_stats = {};
+      continue;
+    }
+
+    auto nresponses = addr.outlier_stats[0].num_responses +
+                      addr.outlier_stats[1].num_responses;
+    if (nresponses) {
+      latencies[i] = (addr.outlier_stats[0].latency_total +
+                      addr.outlier_stats[1].latency_total) /
+                     nresponses;
+    }
+  }
+
+  // Always leave at least one address for load balancing.
+  auto max_ejected = std::min(addrs.size() * outlierconf.max_ejection / 100,
+                              addrs.size() - 1);
+  size_t nejected = 0;
+
+  for (size_t i = 0; i < addrs.size(); ++i) {
+    auto &addr = addrs[i];
+
+    if (addr.ejected_until != 0. || addr.connect_blocker->in_offline()) {
+      continue;
+    }
+
+    auto &cur = addr.outlier_stats[0];
+    auto &prev = addr.outlier_stats[1];
+
+    auto nresets = cur.num_resets + prev.num_resets;
+    auto nerrors = cur.num_errors + prev.num_errors + nresets;
+    auto total = cur.num_responses + prev.num_responses + nresets;
+
+    if (total < outlierconf.min_requests) {
+      continue;
+    }
+
+    auto outlier = outlierconf.error_rate &&
+                   nerrors * 100 >= outlierconf.error_rate * total;
+
+    if (!outlier && outlierconf.latency_factor && latencies[i] >= 0.) {
+      double sum = 0.;
+      size_t n = 0;
+
+      for (size_t j = 0; j < addrs.size(); ++j) {
+        if (j == i || latencies[j] < 0.) {
+          continue;
+        }
+
+        sum += latencies[j];
+        ++n;
+      }
+
+      outlier = n && latencies[i] > outlierconf.latency_factor * sum / n;
+    }
+
+    if (!outlier) {
+      if (addr.num_ejections) {
+        --addr.num_ejections;
+      }
+      continue;
+    }
+
+    if (num_ejected >= max_ejected) {
+      continue;
+    }
+
+    ++num_ejected;
+    ++nejected;
+    ++addr.num_ejections;
+
+    auto t = std::min(
+        outlierconf.ejection_time *
+            util::int_pow(2, std::min(MAX_EJECTION_EXP,
+                                      addr.num_ejections - 1)),
+        downstreamconf.timeout.max_backoff);
+
+    LOG(WARN) << "Backend " << addr.host << ":" << addr.port
+              << " is an outlier (" << nerrors << " errors in " << total
+              << " requests, average latency " << latencies[i]
+              << " seconds); ejected for " << t << " seconds";
+
+    addr.ejected_until = now + t;
+    addr.outlier_stats = {};
+    addr.connect_blocker->block(t);
+  }
+
+  for (auto &addr : addrs) {
+    addr.outlier_stats[1] = addr.outlier_stats[0];
+    addr.outlier_stats[0] = {};
+  }
+
+  return nejected;
+}
+
+namespace {
+// Returns true if |a| is less loaded than |b|.
+bool downstream_less_loaded(const DownstreamAddr *a, const DownstreamAddr *b) {
+  auto la = static_cast<double>(a->num_inflight + 1) / a->weight;
+  auto lb = static_cast<double>(b->num_inflight + 1) / b->weight;
+
+  if (a->latency > 0. && b->latency > 0.) {
+    la *= a->latency;
+    lb *= b->latency;
+  }
+
+  return la < lb;
+}
+} // namespace
+
+DownstreamAddr *select_downstream_addr_p2c(std::vector<DownstreamAddr> &addrs,
+                                           std::mt19937 &gen) {
+  auto n = addrs.size();
+
+  if (n == 1) {
+    auto addr = &addrs[0];
+    if (addr->connect_blocker->blocked()) {
+      return nullptr;
+    }
+    return addr;
+  }
+
+  auto i = std::uniform_int_distribution<size_t>(0, n - 1)(gen);
+  auto j = std::uniform_int_distribution<size_t>(0, n - 2)(gen);
+  if (j >= i) {
+    ++j;
+  }
+
+  auto a = &addrs[i];
+  auto b = &addrs[j];
+
+  auto a_blocked = a->connect_blocker->blocked();
+  auto b_blocked = b->connect_blocker->blocked();
+
+  if (!a_blocked && !b_blocked) {
+    return downstream_less_loaded(b, a) ? b : a;
+  }
+
+  if (!a_blocked) {
+    return a;
+  }
+
+  if (!b_blocked) {
+    return b;
+  }
+
+  for (size_t k = 1; k < n; ++k) {
+    auto addr = &addrs[(i + k) % n];
+    if (!addr->connect_blocker->blocked()) {
+      return addr;
+    }
+  }
+
+  return nullptr;
+}
+
+DownstreamAddr *select_downstream_addr_hedge(std::vector<DownstreamAddr> &addrs,
+                                             const DownstreamAddr *primary) {
+  DownstreamAddr *selected = nullptr;
+
+  for (auto &addr : addrs) {
+    if (&addr == primary || addr.proto != primary->proto ||
+        addr.connect_blocker->blocked()) {
+      continue;
+    }
+
+    if (!selected || downstream_less_loaded(&addr, selected)) {
+      selected = &addr;
+    }
+  }
+
+  return selected;
+}
+
+bool downstream_concurrency_acquire(SharedDownstreamAddr *shared_addr) {
+  auto &concurrency = shared_addr->concurrency;
+
+  if (concurrency.inflight >= static_cast<size_t>(concurrency.limit)) {
+    return false;
+  }
+
+  ++concurrency.inflight;
+
+  return true;
+}
+
+void downstream_concurrency_release(SharedDownstreamAddr *shared_addr) {
+  assert(shared_addr->concurrency.inflight);
+  --shared_addr->concurrency.inflight;
+}
+
+namespace {
+bool take_downstream_connection(DownstreamAddr *addr) {
+  auto &num_connections = addr->endpoint->num_connections;
+
+  if (addr->max_connections == 0) {
+    num_connections.fetch_add(1, std::memory_order_relaxed);
+
+    return true;
+  }
+
+  auto n = num_connections.load(std::memory_order_relaxed);
+
+  for (;;) {
+    if (n >= addr->max_connections) {
+      return false;
+    }
+
+    if (num_connections.compare_exchange_weak(n, n + 1,
+                                              std::memory_order_relaxed)) {
+      return true;
+    }
+  }
+}
+} // namespace
+
+bool downstream_connection_acquire(DownstreamAddr *addr) {
+  auto &endpoint = *addr->endpoint;
+  auto &exhausted = endpoint.exhausted;
+
+  if (take_downstream_connection(addr)) {
+    if (exhausted.load(std::memory_order_relaxed)) {
+      exhausted.store(false, std::memory_order_relaxed);
+    }
+
+    return true;
+  }
+
+  // Only the first worker which runs short asks the others.  The
+  // shortage lasts until any worker makes a connection.
+  if (!exhausted.exchange(true, std::memory_order_relaxed)) {
+    endpoint.reclaim.store(true, std::memory_order_relaxed);
+    endpoint.conn_handler->worker_reclaim_downstream_connection();
+  }
+
+  return false;
+}
+
+bool downstream_connection_acquire_prewarm(DownstreamAddr *addr) {
+  if (addr->endpoint->exhausted.load(std::memory_order_relaxed)) {
+    return false;
+  }
+
+  return take_downstream_connection(addr);
+}
+
+void downstream_connection_release(DownstreamAddr *addr) {
+  auto n = addr->endpoint->num_connections.fetch_sub(
+      1, std::memory_order_relaxed);
+
+  assert(n);
+  (void)n;
+}
+
+bool downstream_connection_reclaim(DownstreamAddr *addr) {
+  auto &reclaim = addr->endpoint->reclaim;
+
+  return reclaim.load(std::memory_order_relaxed) &&
+         reclaim.exchange(false, std::memory_order_relaxed);
+}
+
+bool downstream_connection_keep_idle(const DownstreamAddr *addr,
+                                     size_t npooled) {
+  return npooled <= addr->min_idle;
+}
+
+namespace {
+// The number of response header latency samples in a window to
+// update the concurrency limit.
+constexpr size_t CONCURRENCY_WINDOW_SAMPLES = 16;
+// The interval to reset the minimum latency.
+constexpr ev_tstamp CONCURRENCY_MIN_RTT_RESET_INTERVAL = 30.;
+// The weight of the new limit.
+constexpr double CONCURRENCY_LIMIT_ALPHA = 0.2;
+// The minimum ratio by which the limit is multiplied in one update.
+constexpr double CONCURRENCY_MIN_GRADIENT = 0.5;
+} // namespace
+
+void downstream_record_concurrency_latency(SharedDownstreamAddr *shared_addr,
+                                           size_t min_limit, ev_tstamp t,
+                                           ev_tstamp now) {
+  auto &concurrency = shared_addr->concurrency;
+
+  concurrency.rtt_total += t;
+  ++concurrency.nsamples;
+
+  if (concurrency.nsamples < CONCURRENCY_WINDOW_SAMPLES) {
+    return;
+  }
+
+  auto rtt = concurrency.rtt_total / concurrency.nsamples;
+
+  concurrency.rtt_total = 0.;
+  concurrency.nsamples = 0;
+
+  if (now >= concurrency.min_rtt_expiry) {
+    concurrency.min_rtt = rtt;
+    concurrency.min_rtt_expiry = now + CONCURRENCY_MIN_RTT_RESET_INTERVAL;
+  } else if (rtt < concurrency.min_rtt) {
+    concurrency.min_rtt = rtt;
+  }
+
+  auto gradient = 1.;
+  if (rtt > 0.) {
+    gradient = std::max(CONCURRENCY_MIN_GRADIENT,
+                        std::min(1., concurrency.min_rtt / rtt));
+  }
+
+  auto limit = concurrency.limit * gradient + std::sqrt(concurrency.limit);
+
+  // Do not grow the limit which is not used.
+  if (limit > concurrency.limit &&
+      concurrency.inflight * 2 < concurrency.limit) {
+    limit = concurrency.limit;
+  }
+
+  limit = concurrency.limit + (limit - concurrency.limit) *
+                                  CONCURRENCY_LIMIT_ALPHA;
+
+  auto max_limit = static_cast<double>(concurrency.max_limit);
+
+  concurrency.limit = std::max(
+      std::min(static_cast<double>(min_limit), max_limit),
+      std::min(limit, max_limit));
+}
+
+DownstreamAddr *
+select_downstream_addr_bounded(std::vector<DownstreamAddr> &addrs,
+                               const std::vector<AffinityHash> &affinity_hash,
+                               uint32_t hash, uint32_t max_load) {
+  size_t total = 0;
+  for (auto &addr : addrs) {
+    total += addr.num_inflight;
+  }
+
+  // The capacity is ceil(max_load / 100 * (total + 1) / n) so that
+  // there is always an address which has room for this request.
+  auto d = static_cast<uint64_t>(100) * addrs.size();
+  auto capacity = (static_cast<uint64_t>(max_load) * (total + 1) + d - 1) / d;
+
+  auto it = std::lower_bound(
+      std::begin(affinity_hash), std::end(affinity_hash), hash,
+      [](const AffinityHash &lhs, uint32_t rhs) { return lhs.hash < rhs; });
+
+  auto first = static_cast<size_t>(
+      std::distance(std::begin(affinity_hash), it) % affinity_hash.size());
+
+  DownstreamAddr *fallback = nullptr;
+
+  for (size_t i = 0; i < affinity_hash.size(); ++i) {
+    auto addr = &addrs[affinity_hash[(first + i) % affinity_hash.size()].idx];
+
+    if (addr->connect_blocker->blocked()) {
+      continue;
+    }
+
+    if (addr->num_inflight < capacity) {
+      return addr;
+    }
+
+    if (!fallback) {
+      fallback = addr;
     }
   }
+
+  // All available addresses are at capacity.  Use the first one on
+  // the ring.
+  return fallback;
 }
 
 } // namespace shrpx
@@ -34,6 +34,11 @@
 #include <deque>
 #include <thread>
 #include <queue>
+#include <atomic>
+#include <chrono>
+#include <array>
+#include <map>
+#include <unordered_set>
 #ifndef NOTHREADS
 #  include <future>
 #endif // NOTHREADS
@@ -46,10 +51,15 @@
 #include "shrpx_config.h"
 #include "shrpx_downstream_connection_pool.h"
 #include "memchunk.h"
+#include "mpsc_queue.h"
 #include "shrpx_tls.h"
 #include "shrpx_live_check.h"
 #include "shrpx_connect_blocker.h"
 #include "shrpx_dns_tracker.h"
+#include "shrpx_pipe_pool.h"
+#include "shrpx_io_uring.h"
+#include "shrpx_zerocopy.h"
+#include "shrpx_timer_wheel.h"
 #include "allocator.h"
 
 using namespace nghttp2;
@@ -57,10 +67,12 @@ using namespace nghttp2;
 namespace shrpx {
 
 class Http2Session;
+class Downstream;
 class ConnectBlocker;
 class MemcachedDispatcher;
 struct UpstreamAddr;
 class ConnectionHandler;
+class AcceptHandler;
 
 #ifdef HAVE_MRUBY
 namespace mruby {
@@ -76,6 +88,42 @@ class CertLookupTree;
 
 struct WeightGroup;
 
+// The outcome of the responses served by backend address in an
+// interval of passive outlier detection.
+struct DownstreamOutlierStats {
+  // The number of responses received.
+  size_t num_responses;
+  // The number of 5xx responses.
+  size_t num_errors;
+  // The number of requests which failed before response header was
+  // received.
+  size_t num_resets;
+  // The sum of the latency of the responses.
+  ev_tstamp latency_total;
+};
+
+// The state of a backend endpoint which is shared by all workers.
+struct DownstreamEndpoint {
+  ConnectionHandler *conn_handler;
+  // The number of connections to the endpoint which all workers
+  // hold.  HTTP/2 session counts as 1 connection.
+  std::atomic<size_t> num_connections;
+  // true if a worker could not make a new connection because of
+  // max-connections, and no worker has made one since then.  While
+  // it is set, workers do not pre-warm connections to the endpoint.
+  std::atomic<bool> exhausted;
+  // true if a worker should close one of its idle connections to the
+  // endpoint to give room to the worker which could not make one.
+  // The worker which closes the connection clears this flag.
+  std::atomic<bool> reclaim;
+  // true if the endpoint is considered offline.  This is only used
+  // if |share_health| is true.
+  std::atomic<bool> offline;
+  // true if only the dedicated health check worker probes the
+  // endpoint, and the other workers follow |offline|.
+  bool share_health;
+};
+
 struct DownstreamAddr {
   Address addr;
   // backend address.  If |host_unix| is true, this is UNIX domain
@@ -92,11 +140,20 @@ struct DownstreamAddr {
 
   std::unique_ptr<ConnectBlocker> connect_blocker;
   std::unique_ptr<LiveCheck> live_check;
+  // The state of the endpoint shared with the other workers.
+  std::shared_ptr<DownstreamEndpoint> endpoint;
   // Connection pool for this particular address if session affinity
   // is enabled
   std::unique_ptr<DownstreamConnectionPool> dconn_pool;
   size_t fall;
   size_t rise;
+  // The number of idle connections to this address which this worker
+  // keeps open in advance.
+  size_t min_idle;
+  // The maximum number of connections to the endpoint which all
+  // workers can hold in total.  0 means unlimited.  All addresses
+  // which share the same endpoint have the same value.
+  size_t max_connections;
   // Client side TLS session cache
   tls::TLSSessionCache tls_session_cache;
   // List of Http2Session which is not fully utilized (i.e., the
@@ -108,6 +165,23 @@ struct DownstreamAddr {
   // total number of streams created in HTTP/2 connections for this
   // address.
   size_t num_dconn;
+  // The number of requests forwarded to this address which have not
+  // finished yet.
+  size_t num_inflight;
+  // The moving average of the time between a request is forwarded to
+  // this address and its response header is received.  0 if it has
+  // not been measured yet.
+  ev_tstamp latency;
+  // The outcome of the responses used for passive outlier detection.
+  // The first element is for the current interval, and the second one
+  // is for the previous interval.
+  std::array<DownstreamOutlierStats, 2> outlier_stats;
+  // The number of consecutive ejections by outlier detection.  It is
+  // decremented each time this address is evaluated as healthy.
+  size_t num_ejections;
+  // The time until which this address is ejected by outlier
+  // detection.  0 if it is not ejected.
+  ev_tstamp ejected_until;
   // the sequence number of this address to randomize the order access
   // threads.
   size_t seq;
@@ -186,10 +260,18 @@ struct WeightGroupEntryGreater {
   }
 };
 
+// The number of response header latency samples kept per backend
+// group to compute the delay of hedged request.
+constexpr size_t HEDGE_LATENCY_SAMPLES = 128;
+
 struct SharedDownstreamAddr {
   SharedDownstreamAddr()
       : balloc(1024, 1024),
         affinity{SessionAffinity::NONE},
+        balance{LoadBalancing::WRR},
+        hedge{},
+        concurrency{},
+        collapse{},
         redirect_if_not_tls{false},
         timeout{} {}
 
@@ -212,6 +294,54 @@ struct SharedDownstreamAddr {
 #endif // HAVE_MRUBY
   // Configuration for session affinity
   AffinityConfig affinity;
+  // Load balancing algorithm used if session affinity is disabled.
+  LoadBalancing balance;
+  // Request hedging.  It is enabled if percentile is not 0.
+  struct {
+    // The recent response header latency of this group.  This is a
+    // ring buffer, and the latest sample is written at nsamples %
+    // HEDGE_LATENCY_SAMPLES.
+    std::array<ev_tstamp, HEDGE_LATENCY_SAMPLES> samples;
+    // The number of samples recorded so far.
+    size_t nsamples;
+    // The percentile-th latency among samples.  0 if not enough
+    // samples have been recorded yet.
+    ev_tstamp delay;
+    // The number of hedged requests which can be sent now.  It is
+    // replenished by each request eligible for hedging.
+    double tokens;
+    uint32_t percentile;
+  } hedge;
+  // Adaptive concurrency limiting.  It is enabled if max_limit is not
+  // 0.
+  struct {
+    // The smallest average response header latency of a sample
+    // window observed until min_rtt_expiry.
+    ev_tstamp min_rtt;
+    // min_rtt is replaced with the latency of the next sample window
+    // after this time so that the limit follows the permanent change
+    // of backend latency.
+    ev_tstamp min_rtt_expiry;
+    // The sum of response header latency in the current sample
+    // window, and the number of samples in it.
+    ev_tstamp rtt_total;
+    size_t nsamples;
+    // The current limit of the number of requests forwarded to this
+    // group concurrently.
+    double limit;
+    // The number of requests admitted, and not completed yet.
+    size_t inflight;
+    uint32_t max_limit;
+  } concurrency;
+  // Collapsed forwarding.
+  struct {
+    // The requests forwarded to this group which the other requests
+    // with the same key can wait for.  The key is allocated by the
+    // Downstream, which removes itself from here when it receives the
+    // final response header, or is deleted.
+    std::map<StringRef, Downstream *> leaders;
+    bool enabled;
+  } collapse;
   // Session affinity
   // true if this group requires that client connection must be TLS,
   // and the request must be redirected to https URI.
@@ -240,8 +370,71 @@ struct DownstreamAddrGroup {
   bool retired;
 };
 
+// The outlier detection state of a backend address, which is
+// published for API.
+struct EjectedAddr {
+  std::string hostport;
+  // The time until which the address is ejected.  0 if it is not
+  // ejected at the moment.
+  ev_tstamp ejected_until;
+  // The number of consecutive ejections, which determines how long
+  // the next ejection lasts.
+  size_t num_ejections;
+};
+
 struct WorkerStat {
   size_t num_connections;
+  // The following fields are updated by the worker thread, and may be
+  // read by the other threads.
+
+  // The number of connections dequeued from the lock-free event
+  // queue.
+  std::atomic<uint64_t> num_conn_events;
+  // The number of connections which did not fit in the lock-free
+  // event queue, and were passed through the mutex protected queue.
+  std::atomic<uint64_t> num_conn_event_overflows;
+  // The sum and the maximum of the time between the main thread
+  // enqueued a connection and the worker dequeued it, in
+  // nanoseconds.
+  std::atomic<uint64_t> conn_event_latency_total;
+  std::atomic<uint64_t> conn_event_latency_max;
+  // The maximum number of connections observed in the lock-free event
+  // queue.
+  std::atomic<uint64_t> conn_event_queue_depth_max;
+  // The number of access log lines dropped because the asynchronous
+  // access log buffer was full.
+  std::atomic<uint64_t> num_accesslog_dropped;
+  // The number of frontend connections whose buffers have been
+  // released because they are idle.
+  std::atomic<uint64_t> num_idle_connections;
+  // The snapshots of num_connections and the number of bytes of
+  // memchunks in use.  They are updated periodically while API is
+  // enabled.
+  std::atomic<uint64_t> num_connections_snapshot;
+  std::atomic<uint64_t> buffer_bytes_snapshot;
+  // The number of backend addresses ejected by outlier detection so
+  // far, and the number of addresses ejected at the moment.
+  std::atomic<uint64_t> num_outlier_ejections;
+  std::atomic<uint64_t> num_ejected_addrs;
+  // The snapshot of the backend addresses which are ejected, or have
+  // been ejected recently.  It is updated each time outlier detection
+  // runs, and guarded by ejected_addrs_mu.
+  std::mutex ejected_addrs_mu;
+  std::vector<EjectedAddr> ejected_addrs;
+  // The number of hedged requests sent, and the number of them which
+  // received response earlier than the original request.
+  std::atomic<uint64_t> num_hedges;
+  std::atomic<uint64_t> num_hedge_wins;
+  // The number of requests rejected by adaptive concurrency limit.
+  std::atomic<uint64_t> num_shed_requests;
+  // The number of requests which were served by the response of the
+  // other request with collapsed forwarding.
+  std::atomic<uint64_t> num_collapsed_requests;
+  // The snapshots of the sum of the adaptive concurrency limits of
+  // backend groups, and the sum of the number of requests admitted by
+  // them.  They are updated periodically while API is enabled.
+  std::atomic<uint64_t> concurrency_limit_snapshot;
+  std::atomic<uint64_t> concurrency_inflight_snapshot;
 };
 
 enum class WorkerEventType {
@@ -249,6 +442,9 @@ enum class WorkerEventType {
   REOPEN_LOG = 0x02,
   GRACEFUL_SHUTDOWN = 0x03,
   REPLACE_DOWNSTREAM = 0x04,
+  ENABLE_ACCEPTOR = 0x05,
+  UPDATE_DOWNSTREAM_HEALTH = 0x06,
+  RECLAIM_DOWNSTREAM_CONNECTION = 0x07,
 };
 
 struct WorkerEvent {
@@ -263,6 +459,22 @@ struct WorkerEvent {
   std::shared_ptr<DownstreamConfig> downstreamconf;
 };
 
+// ConnectionEvent is a compact event which hands the accepted
+// connection to a worker through its lock-free queue.  For UNIX
+// domain socket, only address family is stored in |client_addr|.
+struct ConnectionEvent {
+  union {
+    sockaddr sa;
+    sockaddr_in in;
+    sockaddr_in6 in6;
+  } client_addr;
+  const UpstreamAddr *faddr;
+  // The time when this event was enqueued.
+  std::chrono::steady_clock::time_point enqueued;
+  int client_fd;
+  int client_addrlen;
+};
+
 class Worker {
 public:
   Worker(struct ev_loop *loop, SSL_CTX *sv_ssl_ctx, SSL_CTX *cl_ssl_ctx,
@@ -275,7 +487,15 @@ public:
   void run_async();
   void wait();
   void process_events();
+  // Sends |event| through the mutex protected queue.
   void send(const WorkerEvent &event);
+  // Hands the accepted connection |fd| to this worker.  It is passed
+  // through the lock-free queue unless it is full.
+  void send_connection(int fd, const sockaddr *addr, int addrlen,
+                       const UpstreamAddr *faddr);
+  // Returns the current number of connections in the lock-free
+  // queue.  This function can be called from any thread.
+  size_t get_conn_event_queue_depth() const;
 
   tls::CertLookupTree *get_cert_lookup_tree() const;
 
@@ -295,6 +515,49 @@ public:
   MemchunkPool *get_mcpool();
   void schedule_clear_mcpool();
 
+  // Evaluates backend addresses with passive outlier detection.  This
+  // is called periodically if outlier detection is enabled.
+  void detect_outliers();
+
+  // Opens backend connections in advance so that each backend address
+  // with min-idle parameter has at least that many idle connections
+  // or HTTP/2 sessions.  This is called periodically if any backend
+  // address has min-idle parameter.
+  void prewarm_downstream_connections();
+
+  // Applies the shared health of backend addresses to their
+  // ConnectBlocker.  If this worker is the health check worker, it
+  // starts probing the addresses which have gone offline.
+  void update_downstream_health();
+
+  // Makes this worker the health check worker.  It must be called
+  // before run_async().
+  void set_health_check_worker(bool f);
+
+  // Closes an idle connection in the pool of the address whose
+  // endpoint has run out of max-connections, so that the other
+  // worker can make a connection to it.  Idle HTTP/2 sessions are
+  // closed by Http2Session itself in the next loop iteration.
+  void reclaim_downstream_connections();
+
+  PipePool *get_pipe_pool();
+
+#ifdef HAVE_IO_URING
+  // Returns io_uring instance of this worker, or nullptr if libev is
+  // used for all I/O.
+  IOUring *get_io_uring() const;
+#endif // HAVE_IO_URING
+
+#ifdef HAVE_MSG_ZEROCOPY
+  // Returns Zerocopy of this worker, or nullptr if MSG_ZEROCOPY is
+  // disabled.
+  Zerocopy *get_zerocopy() const;
+#endif // HAVE_MSG_ZEROCOPY
+
+  // Returns the timer wheel for frontend read timeouts, or nullptr if
+  // libev timers are used.
+  TimerWheel *get_timer_wheel() const;
+
   MemcachedDispatcher *get_session_cache_memcached_dispatcher();
 
   std::mt19937 &get_randgen();
@@ -319,17 +582,68 @@ public:
 
   DNSTracker *get_dns_tracker();
 
+  // Creates ClientHandler for the accepted connection |fd| which
+  // came through |faddr|.  This function returns 0 if it succeeds,
+  // or -1.  On error, |fd| is closed.
+  int handle_connection(int fd, sockaddr *addr, int addrlen,
+                        const UpstreamAddr *faddr);
+
+  // Worker owned acceptors.  They are only used for the frontend
+  // address with "reuseport" parameter.  These functions must be
+  // called from the thread which runs this worker's event loop,
+  // except that add_acceptor() may be called before run_async().
+  void add_acceptor(std::unique_ptr<AcceptHandler> h);
+  void delete_acceptor();
+  void enable_acceptor();
+  void disable_acceptor();
+  void sleep_acceptor(ev_tstamp t);
+  void accept_pending_connection();
+
 private:
+  // Wakes up the event loop of this worker unless it has already been
+  // notified.
+  void wakeup();
+  void handle_connection_event(ConnectionEvent &cev);
+  // Processes |wev|.  This function returns -1 if the event loop has
+  // been stopped, or 0.
+  int process_event(WorkerEvent &wev);
+  // Schedules the next prewarm_downstream_connections() call after
+  // |base| seconds plus random jitter.
+  void schedule_prewarm(ev_tstamp base);
+  // Opens the missing pre-warmed connections to the addresses of
+  // |group|.
+  void prewarm_downstream_addrs(
+      const std::shared_ptr<DownstreamAddrGroup> &group);
+
 #ifndef NOTHREADS
   std::future<void> fut_;
 #endif // NOTHREADS
   std::mutex m_;
   std::deque<WorkerEvent> q_;
+  MPSCQueue<ConnectionEvent> conn_q_;
+  // true if ev_async_send has been called, and the worker has not
+  // started processing events yet.
+  std::atomic<bool> wakeup_pending_;
   std::mt19937 randgen_;
   ev_async w_;
   ev_timer mcpool_clear_timer_;
   ev_timer proc_wev_timer_;
+  ev_timer disable_acceptor_timer_;
+  // The timer to update the snapshots in WorkerStat.
+  ev_timer stat_timer_;
+  // The timer to run passive outlier detection.
+  ev_timer outlier_timer_;
+  // The timer to open backend connections in advance.
+  ev_timer prewarm_timer_;
   MemchunkPool mcpool_;
+  PipePool pipe_pool_;
+#ifdef HAVE_IO_URING
+  std::unique_ptr<IOUring> io_uring_;
+#endif // HAVE_IO_URING
+#ifdef HAVE_MSG_ZEROCOPY
+  std::unique_ptr<Zerocopy> zerocopy_;
+#endif // HAVE_MSG_ZEROCOPY
+  std::unique_ptr<TimerWheel> timer_wheel_;
   WorkerStat worker_stat_;
   DNSTracker dns_tracker_;
 
@@ -355,8 +669,12 @@ private:
   // Worker level blocker for downstream connection.  For example,
   // this is used when file decriptor is exhausted.
   std::unique_ptr<ConnectBlocker> connect_blocker_;
+  std::vector<std::unique_ptr<AcceptHandler>> acceptors_;
 
   bool graceful_shutdown_;
+  // true if this worker probes backends on behalf of all workers.
+  // It does not serve any connection.
+  bool health_check_worker_;
 };
 
 // Selects group based on request's |hostport| and |path|.  |hostport|
@@ -371,11 +689,148 @@ size_t match_downstream_addr_group(
     const std::vector<std::shared_ptr<DownstreamAddrGroup>> &groups,
     size_t catch_all, BlockAllocator &balloc);
 
+// Finds the address in |addrs| which connects to the same endpoint as
+// each address in |src|, and stores its index in |res| at the index
+// of the address in |src|.  The other parameters, such as weight, are
+// not compared.  This function returns true if |addrs| and |src| have
+// the same set of endpoints, or false.
+bool match_downstream_addrs(std::vector<size_t> &res,
+                            const std::vector<DownstreamAddr> &addrs,
+                            const std::vector<DownstreamAddrConfig> &src);
+
 // Calls this function if connecting to backend failed.  |raddr| is
 // the actual address used to connect to backend, and it could be
-// nullptr.  This function may schedule live check.
+// nullptr.  This function may schedule live check, or notify the
+// health check worker.
 void downstream_failure(DownstreamAddr *addr, const Address *raddr);
 
+// Calls this function when a request is forwarded to |addr|.
+void downstream_request_begin(DownstreamAddr *addr);
+// Calls this function when a request forwarded to |addr| finished or
+// was abandoned.  Each call of downstream_request_begin() must be
+// paired with this function.
+void downstream_request_end(DownstreamAddr *addr);
+// Calls this function with the time |t| between a request is
+// forwarded to |addr| and its response header is received.
+void downstream_update_latency(DownstreamAddr *addr, ev_tstamp t);
+// Calls this function when the response header from |addr| is
+// received.  |status_code| is its HTTP status code, and |t| is the
+// time between the request is forwarded and the response header is
+// received.  This function calls downstream_update_latency().
+void downstream_record_response(DownstreamAddr *addr, uint32_t status_code,
+                                ev_tstamp t);
+// Calls this function when a request forwarded to |addr| failed before
+// its response header was received.
+void downstream_record_reset(DownstreamAddr *addr);
+
+// Records the time |t| between a request is forwarded to the backend
+// group |shared_addr| and its response header is received.  It
+// updates the delay of hedged request of the group.
+void downstream_record_hedge_latency(SharedDownstreamAddr *shared_addr,
+                                     ev_tstamp t);
+// Selects an address from |addrs| to send a hedged request of the
+// request forwarded to |primary|.  Only the address other than
+// |primary| which speaks the same protocol as |primary| and is not
+// blocked by ConnectBlocker is selected, and
+// the one which has the least outstanding requests relative to its
+// weight is preferred.  This function returns nullptr if there is no
+// such address.
+DownstreamAddr *select_downstream_addr_hedge(std::vector<DownstreamAddr> &addrs,
+                                             const DownstreamAddr *primary);
+
+// Admits a request to the backend group |shared_addr| if the number
+// of requests in flight is less than its concurrency limit.  This
+// function returns true if the request is admitted.  Each admitted
+// request must be paired with downstream_concurrency_release().
+bool downstream_concurrency_acquire(SharedDownstreamAddr *shared_addr);
+// Calls this function when a request admitted by
+// downstream_concurrency_acquire() completed or was abandoned.
+void downstream_concurrency_release(SharedDownstreamAddr *shared_addr);
+
+// Takes one connection from the budget of the endpoint of |addr|
+// which is shared by all workers.  This function returns false if
+// all workers already hold max-connections connections to the
+// endpoint.  In that case, the other workers are asked to close an
+// idle connection to the endpoint.  It must be called before
+// HttpDownstreamConnection or Http2Session is created for |addr|.
+// Their destructor gives the connection back with
+// downstream_connection_release().
+bool downstream_connection_acquire(DownstreamAddr *addr);
+// Takes one connection from the budget of the endpoint of |addr| to
+// pre-warm it.  Unlike downstream_connection_acquire(), this function
+// returns false while a worker is waiting for a connection to the
+// endpoint, and it never asks the other workers to close one.
+bool downstream_connection_acquire_prewarm(DownstreamAddr *addr);
+// Gives one connection back to the budget of the endpoint of |addr|.
+void downstream_connection_release(DownstreamAddr *addr);
+// Returns true if an idle connection to |addr| should be closed, so
+// that the worker which could not get a connection to the endpoint
+// can make one.  Only one idle connection is closed for each
+// shortage.
+bool downstream_connection_reclaim(DownstreamAddr *addr);
+// Returns true if an idle connection to |addr| should stay open after
+// --backend-keep-alive-timeout expires, so that the worker keeps
+// addr->min_idle pre-warmed connections.  |npooled| is the number of
+// connections in addr->dconn_pool, including the expired one.
+bool downstream_connection_keep_idle(const DownstreamAddr *addr,
+                                     size_t npooled);
+// Records the time |t| between a request is forwarded to the backend
+// group |shared_addr| and its response header is received.  At the
+// end of each sample window, the concurrency limit is multiplied by
+// the ratio of the minimum latency to the average latency of the
+// window, and then the headroom, which is the square root of the
+// limit, is added.  The limit does not grow while less than half of
+// it is used.  The limit is kept in range [|min_limit|, max_limit].
+// |now| is the current time.
+void downstream_record_concurrency_latency(SharedDownstreamAddr *shared_addr,
+                                           size_t min_limit, ev_tstamp t,
+                                           ev_tstamp now);
+
+// Evaluates |addrs| based on the outcome of the responses recorded in
+// the last 2 intervals, and ejects outliers from load balancing
+// through ConnectBlocker.  |now| is the current time.  This function
+// returns the number of addresses ejected by this call.
+size_t detect_downstream_outliers(std::vector<DownstreamAddr> &addrs,
+                                  const DownstreamConfig &downstreamconf,
+                                  ev_tstamp now);
+
+// Selects an address from |addrs| using the power of two choices.
+// It picks 2 addresses at random, and returns the one which has less
+// outstanding requests relative to its weight.  If both addresses
+// have latency measured, the number of outstanding requests is
+// multiplied by it.  Addresses blocked by ConnectBlocker are skipped.
+// This function returns nullptr if all addresses are blocked.
+DownstreamAddr *select_downstream_addr_p2c(std::vector<DownstreamAddr> &addrs,
+                                           std::mt19937 &gen);
+
+// Selects an address from |addrs| using consistent hashing with
+// bounded loads.  |affinity_hash| is the hash ring sorted by hash.
+// This function walks the ring from |hash|, and returns the first
+// address whose outstanding requests are less than |max_load| percent
+// of the mean of the group, rounded up.  Addresses blocked by
+// ConnectBlocker are skipped.  This function returns nullptr if all
+// addresses are blocked.
+DownstreamAddr *
+select_downstream_addr_bounded(std::vector<DownstreamAddr> &addrs,
+                               const std::vector<AffinityHash> &affinity_hash,
+                               uint32_t hash, uint32_t max_load);
+
+// Calls |f| with each group in |groups| whose SharedDownstreamAddr
+// has not been visited yet.  Several groups may share the same
+// SharedDownstreamAddr, and |f| is called only for the first group
+// which refers to it.
+template <typename F>
+void for_each_shared_downstream_addr(
+    const std::vector<std::shared_ptr<DownstreamAddrGroup>> &groups, F f) {
+  std::unordered_set<SharedDownstreamAddr *> seen;
+
+  for (auto &g : groups) {
+    if (seen.emplace(g->shared_addr.get()).second) {
+      f(g);
+    }
+  }
+}
+
 } // namespace shrpx
 
 #endif // SHRPX_WORKER_H
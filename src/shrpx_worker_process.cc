@@ -53,6 +53,7 @@
 #include "shrpx_process.h"
 #include "shrpx_tls.h"
 #include "shrpx_log.h"
+#include "shrpx_accesslog_writer.h"
 #include "util.h"
 #include "app_helper.h"
 #include "template.h"
@@ -142,6 +143,11 @@ void reopen_log(ConnectionHandler *conn_handler) {
   (void)reopen_log_files(loggingconf);
   redirect_stderr_to_errorlog(loggingconf);
 
+  auto writer = get_accesslog_writer();
+  if (writer) {
+    writer->reopen();
+  }
+
   conn_handler->worker_reopen_log_files();
 }
 } // namespace
@@ -396,6 +402,26 @@ int worker_process_event_loop(WorkerProcessConfig *wpconf) {
 
   auto config = get_config();
 
+  std::unique_ptr<AccessLogWriter> accesslog_writer;
+
+#ifndef NOTHREADS
+  auto &accessconf = config->logging.access;
+
+  if (accessconf.async.enabled &&
+      (accessconf.syslog || !accessconf.file.empty())) {
+    accesslog_writer = std::make_unique<AccessLogWriter>(
+        config->logging, accessconf.async.buffer_size,
+        accessconf.async.block_on_overflow);
+
+    if (accesslog_writer->start() != 0) {
+      LOG(FATAL) << "Failed to start access log writer";
+      return -1;
+    }
+
+    set_accesslog_writer(accesslog_writer.get());
+  }
+#endif // !NOTHREADS
+
   if (reopen_log_files(config->logging) != 0) {
     LOG(FATAL) << "Failed to open log file";
     return -1;
@@ -414,6 +440,13 @@ int worker_process_event_loop(WorkerProcessConfig *wpconf) {
   auto conn_handler = std::make_unique<ConnectionHandler>(loop, gen);
 
   for (auto &addr : config->conn.listener.addrs) {
+    // In multi threaded mode, the listener with "reuseport" parameter
+    // is accepted by workers.  See
+    // ConnectionHandler::create_worker_thread().
+    if (addr.reuseport && !config->single_thread) {
+      continue;
+    }
+
     conn_handler->add_acceptor(
         std::make_unique<AcceptHandler>(&addr, conn_handler.get()));
   }
@@ -494,6 +527,16 @@ int worker_process_event_loop(WorkerProcessConfig *wpconf) {
     }
   }
 
+  auto ocsp_enabled =
+      tls::upstream_tls_enabled(config->conn) && !config->tls.ocsp.disabled;
+
+  // This must be done before creating workers so that the acceptors
+  // owned by workers start disabled as well.
+  if (ocsp_enabled && config->tls.ocsp.startup) {
+    conn_handler->set_enable_acceptor_on_ocsp_completion(true);
+    conn_handler->disable_acceptor();
+  }
+
   if (config->single_thread) {
     rv = conn_handler->create_single_worker();
     if (rv != 0) {
@@ -539,12 +582,7 @@ int worker_process_event_loop(WorkerProcessConfig *wpconf) {
   ipcev.data = conn_handler.get();
   ev_io_start(loop, &ipcev);
 
-  if (tls::upstream_tls_enabled(config->conn) && !config->tls.ocsp.disabled) {
-    if (config->tls.ocsp.startup) {
-      conn_handler->set_enable_acceptor_on_ocsp_completion(true);
-      conn_handler->disable_acceptor();
-    }
-
+  if (ocsp_enabled) {
     conn_handler->proceed_next_cert_ocsp();
   }
 
@@ -561,6 +599,18 @@ int worker_process_event_loop(WorkerProcessConfig *wpconf) {
   // worker process aborts.
   conn_handler.reset();
 
+  if (accesslog_writer) {
+    // All worker threads have been joined.  Write the remaining
+    // lines.
+    set_accesslog_writer(nullptr);
+    accesslog_writer->stop();
+
+    auto ndropped = accesslog_writer->get_num_dropped();
+    if (ndropped) {
+      LOG(WARN) << "Dropped " << ndropped << " access log lines";
+    }
+  }
+
 #ifdef HAVE_NEVERBLEED
   assert(nb->daemon_pid > 0);
 
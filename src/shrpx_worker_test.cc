@@ -29,15 +29,43 @@
 #endif // HAVE_UNISTD_H
 
 #include <cstdlib>
+#include <cmath>
 
 #include <CUnit/CUnit.h>
 
 #include "shrpx_worker.h"
 #include "shrpx_connect_blocker.h"
+#include "shrpx_connection_handler.h"
+#include "shrpx_http_downstream_connection.h"
 #include "shrpx_log.h"
+#include "util.h"
 
 namespace shrpx {
 
+namespace {
+// Backend addresses for the tests of the load balancing functions.
+// Each of them has its own ConnectBlocker.
+struct DownstreamAddrFixture {
+  DownstreamAddrFixture(size_t n)
+      : loop(ev_loop_new(EVFLAG_AUTO)), gen(util::make_mt19937()), addrs(n) {
+    for (auto &addr : addrs) {
+      addr.weight = 1;
+      addr.connect_blocker =
+          std::make_unique<ConnectBlocker>(gen, loop, nullptr, nullptr);
+    }
+  }
+  ~DownstreamAddrFixture() {
+    // ConnectBlocker must be destroyed before the loop.
+    addrs.clear();
+    ev_loop_destroy(loop);
+  }
+
+  struct ev_loop *loop;
+  std::mt19937 gen;
+  std::vector<DownstreamAddr> addrs;
+};
+} // namespace
+
 void test_shrpx_worker_match_downstream_addr_group(void) {
   auto groups = std::vector<std::shared_ptr<DownstreamAddrGroup>>();
   for (auto &s : {"nghttp2.org/", "nghttp2.org/alpha/bravo/",
@@ -244,4 +272,677 @@ void test_shrpx_worker_match_downstream_addr_group(void) {
                       StringRef{}, groups, 255, balloc));
 }
 
+void test_shrpx_worker_select_downstream_addr_p2c(void) {
+  DownstreamAddrFixture fixture(3);
+  auto &gen = fixture.gen;
+  auto &addrs = fixture.addrs;
+
+  // The most loaded address is never selected.
+  addrs[0].num_inflight = 10;
+
+  for (size_t i = 0; i < 100; ++i) {
+    auto addr = select_downstream_addr_p2c(addrs, gen);
+
+    CU_ASSERT(&addrs[0] != addr);
+  }
+
+  // Latency is taken into account once all addresses are measured.
+  downstream_update_latency(&addrs[0], 0.01);
+  downstream_update_latency(&addrs[1], 1.);
+  downstream_update_latency(&addrs[2], 0.01);
+
+  for (size_t i = 0; i < 100; ++i) {
+    auto addr = select_downstream_addr_p2c(addrs, gen);
+
+    CU_ASSERT(&addrs[1] != addr);
+  }
+
+  // A blocked address is skipped.
+  addrs[2].connect_blocker->offline();
+
+  for (size_t i = 0; i < 100; ++i) {
+    auto addr = select_downstream_addr_p2c(addrs, gen);
+
+    CU_ASSERT(&addrs[2] != addr);
+  }
+
+  addrs[0].connect_blocker->offline();
+
+  for (size_t i = 0; i < 100; ++i) {
+    CU_ASSERT(&addrs[1] == select_downstream_addr_p2c(addrs, gen));
+  }
+
+  addrs[1].connect_blocker->offline();
+
+  CU_ASSERT(nullptr == select_downstream_addr_p2c(addrs, gen));
+
+  // Latency follows an increase immediately, and decays slowly.
+  downstream_update_latency(&addrs[2], 0.1);
+
+  CU_ASSERT(0.1 == addrs[2].latency);
+
+  downstream_update_latency(&addrs[2], 0.);
+
+  CU_ASSERT(addrs[2].latency > 0.05);
+  CU_ASSERT(addrs[2].latency < 0.1);
+
+  downstream_request_begin(&addrs[2]);
+
+  CU_ASSERT(1 == addrs[2].num_inflight);
+
+  downstream_request_end(&addrs[2]);
+
+  CU_ASSERT(0 == addrs[2].num_inflight);
+}
+
+void test_shrpx_worker_select_downstream_addr_bounded(void) {
+  DownstreamAddrFixture fixture(3);
+  auto &addrs = fixture.addrs;
+
+  // The ring is 0 -> 1 -> 2 -> 0.
+  std::vector<AffinityHash> affinity_hash{
+      {0, 100},
+      {1, 200},
+      {2, 300},
+  };
+
+  CU_ASSERT(&addrs[0] ==
+            select_downstream_addr_bounded(addrs, affinity_hash, 50, 125));
+  CU_ASSERT(&addrs[1] ==
+            select_downstream_addr_bounded(addrs, affinity_hash, 101, 125));
+  CU_ASSERT(&addrs[0] ==
+            select_downstream_addr_bounded(addrs, affinity_hash, 301, 125));
+
+  // The capacity is ceil(1.25 * (4 + 1) / 3) = 3.
+  addrs[1].num_inflight = 3;
+  addrs[2].num_inflight = 1;
+
+  CU_ASSERT(&addrs[2] ==
+            select_downstream_addr_bounded(addrs, affinity_hash, 150, 125));
+
+  // The capacity is ceil(2 * (4 + 1) / 3) = 4.
+  CU_ASSERT(&addrs[1] ==
+            select_downstream_addr_bounded(addrs, affinity_hash, 150, 200));
+
+  // A blocked address is skipped.  The capacity is ceil(1.25 * (1 +
+  // 1) / 3) = 1, and addrs[2] is at capacity.
+  addrs[1].num_inflight = 0;
+  addrs[1].connect_blocker->offline();
+
+  CU_ASSERT(&addrs[0] ==
+            select_downstream_addr_bounded(addrs, affinity_hash, 150, 125));
+
+  // If all available addresses are at capacity, the first one on the
+  // ring is used.
+  addrs[0].num_inflight = 1;
+
+  CU_ASSERT(&addrs[2] ==
+            select_downstream_addr_bounded(addrs, affinity_hash, 150, 100));
+
+  addrs[0].connect_blocker->offline();
+  addrs[2].connect_blocker->offline();
+
+  CU_ASSERT(nullptr ==
+            select_downstream_addr_bounded(addrs, affinity_hash, 150, 125));
+}
+
+void test_shrpx_worker_affinity_hash_consistency(void) {
+  auto config = mod_config();
+  config->worker_event.budget = 16;
+  config->worker_event.queue_size = 16;
+
+  constexpr size_t num_addrs = 8;
+
+  auto create_downstreamconf = [](SessionAffinity affinity) {
+    auto downstreamconf = std::make_shared<DownstreamConfig>();
+
+    downstreamconf->addr_groups.emplace_back(StringRef::from_lit("/"));
+
+    auto &g = downstreamconf->addr_groups[0];
+    g.affinity.type = affinity;
+
+    for (size_t i = 0; i < num_addrs; ++i) {
+      DownstreamAddrConfig addrconf{};
+      addrconf.host = StringRef::from_lit("127.0.0.1");
+      addrconf.port = 8080 + i;
+      addrconf.proto = Proto::HTTP1;
+      addrconf.weight = 1;
+      addrconf.group_weight = 1;
+      addrconf.fall = 1;
+      addrconf.rise = 1;
+
+      g.addrs.push_back(addrconf);
+
+      if (affinity != SessionAffinity::NONE) {
+        // The ring refers to the addresses in the configuration
+        // order.
+        g.affinity_hash.emplace_back(i, (i + 1) * 0x10000000u);
+      }
+    }
+
+    return downstreamconf;
+  };
+
+  auto hashconf = create_downstreamconf(SessionAffinity::HASH);
+  auto noneconf = create_downstreamconf(SessionAffinity::NONE);
+
+  auto old_downstreamconf = config->conn.downstream;
+  config->conn.downstream = hashconf;
+
+  auto loop = ev_loop_new(EVFLAG_AUTO);
+  auto gen = util::make_mt19937();
+
+  {
+    ConnectionHandler conn_handler(loop, gen);
+
+    auto create_worker =
+        [&conn_handler](const std::shared_ptr<DownstreamConfig> &conf) {
+          return std::make_unique<Worker>(ev_loop_new(EVFLAG_AUTO), nullptr,
+                                          nullptr, nullptr, nullptr, nullptr,
+                                          &conn_handler, conf);
+        };
+
+    // Two workers are built from the same configuration, and the
+    // third one gets affinity by the update in place.
+    conn_handler.add_worker(create_worker(hashconf));
+    conn_handler.add_worker(create_worker(hashconf));
+    conn_handler.add_worker(create_worker(noneconf));
+
+    auto &workers = conn_handler.get_workers();
+
+    workers[2]->replace_downstream_config(hashconf);
+
+    for (size_t n = 0; n <= num_addrs; ++n) {
+      // This key falls between the n-th and the (n+1)-th addresses on
+      // the ring, and the last one wraps around.
+      uint32_t hash = n * 0x10000000u + 0x8000000u;
+      std::array<uint16_t, 3> ports;
+
+      for (size_t i = 0; i < workers.size(); ++i) {
+        auto &shared_addr =
+            workers[i]->get_downstream_addr_groups()[0]->shared_addr;
+        auto addr = select_downstream_addr_bounded(
+            shared_addr->addrs, shared_addr->affinity_hash, hash, 125);
+
+        ports[i] = addr->port;
+      }
+
+      // The same key is mapped to the same backend in all workers.
+      auto expected = 8080 + n % num_addrs;
+
+      CU_ASSERT(expected == ports[0]);
+      CU_ASSERT(expected == ports[1]);
+      CU_ASSERT(expected == ports[2]);
+    }
+  }
+
+  ev_loop_destroy(loop);
+
+  config->conn.downstream = std::move(old_downstreamconf);
+}
+
+void test_shrpx_worker_detect_downstream_outliers(void) {
+  DownstreamAddrFixture fixture(4);
+  auto &addrs = fixture.addrs;
+  DownstreamConfig downstreamconf;
+
+  downstreamconf.timeout.max_backoff = 120.;
+
+  auto &outlierconf = downstreamconf.outlier;
+  outlierconf.ejection_time = 30.;
+  outlierconf.error_rate = 50;
+  outlierconf.latency_factor = 10;
+  outlierconf.min_requests = 10;
+  outlierconf.max_ejection = 50;
+
+  auto now = 1000.;
+
+  // addrs[0] returns too many errors, and addrs[3] is too slow.
+  // addrs[2] has not served enough requests to be evaluated.
+  for (size_t i = 0; i < 10; ++i) {
+    downstream_record_response(&addrs[0], i < 6 ? 503 : 200, 0.01);
+    downstream_record_response(&addrs[1], 200, 0.01);
+    downstream_record_response(&addrs[3], 200, 0.5);
+  }
+  for (size_t i = 0; i < 5; ++i) {
+    downstream_record_response(&addrs[2], 200, 0.01);
+  }
+
+  CU_ASSERT(2 == detect_downstream_outliers(addrs, downstreamconf, now));
+  CU_ASSERT(now + 30. == addrs[0].ejected_until);
+  CU_ASSERT(addrs[0].connect_blocker->blocked());
+  CU_ASSERT(0. == addrs[1].ejected_until);
+  CU_ASSERT(!addrs[1].connect_blocker->blocked());
+  CU_ASSERT(0. == addrs[2].ejected_until);
+  CU_ASSERT(5 == addrs[2].outlier_stats[1].num_responses);
+  CU_ASSERT(0 == addrs[2].outlier_stats[0].num_responses);
+  CU_ASSERT(now + 30. == addrs[3].ejected_until);
+  CU_ASSERT(addrs[3].connect_blocker->blocked());
+
+  // At most 50% of addresses can be ejected at the same time.
+  for (size_t i = 0; i < 10; ++i) {
+    downstream_record_reset(&addrs[1]);
+  }
+
+  CU_ASSERT(0 == detect_downstream_outliers(addrs, downstreamconf, now + 1.));
+  CU_ASSERT(0. == addrs[1].ejected_until);
+
+  // addrs[0] and addrs[3] are back, and addrs[1] is ejected because
+  // of the resets recorded in the previous interval.
+  CU_ASSERT(1 == detect_downstream_outliers(addrs, downstreamconf, now + 31.));
+  CU_ASSERT(0. == addrs[0].ejected_until);
+  CU_ASSERT(now + 61. == addrs[1].ejected_until);
+  CU_ASSERT(0. == addrs[3].ejected_until);
+
+  // The consecutive ejection doubles ejection time.
+  for (size_t i = 0; i < 10; ++i) {
+    downstream_record_response(&addrs[0], 500, 0.01);
+  }
+
+  CU_ASSERT(1 == detect_downstream_outliers(addrs, downstreamconf, now + 32.));
+  CU_ASSERT(2 == addrs[0].num_ejections);
+  CU_ASSERT(now + 92. == addrs[0].ejected_until);
+}
+
+void test_shrpx_worker_hedge(void) {
+  DownstreamAddrFixture fixture(4);
+  auto &addrs = fixture.addrs;
+  SharedDownstreamAddr shared_addr;
+
+  shared_addr.hedge.percentile = 50;
+
+  // The delay is not computed until enough samples are recorded.
+  for (size_t i = 1; i < 32; ++i) {
+    downstream_record_hedge_latency(&shared_addr, i * 0.001);
+  }
+
+  CU_ASSERT(0. == shared_addr.hedge.delay);
+
+  downstream_record_hedge_latency(&shared_addr, 32 * 0.001);
+
+  CU_ASSERT(16 * 0.001 == shared_addr.hedge.delay);
+
+  for (auto &addr : addrs) {
+    addr.proto = Proto::HTTP1;
+  }
+
+  addrs[1].proto = Proto::HTTP2;
+  addrs[2].num_inflight = 3;
+  addrs[3].num_inflight = 1;
+
+  // The primary address and the address which speaks the other
+  // protocol are never selected.
+  CU_ASSERT(&addrs[3] == select_downstream_addr_hedge(addrs, &addrs[0]));
+  CU_ASSERT(&addrs[0] == select_downstream_addr_hedge(addrs, &addrs[3]));
+  CU_ASSERT(nullptr == select_downstream_addr_hedge(addrs, &addrs[1]));
+
+  addrs[2].proto = Proto::HTTP2;
+
+  CU_ASSERT(&addrs[2] == select_downstream_addr_hedge(addrs, &addrs[1]));
+  CU_ASSERT(&addrs[1] == select_downstream_addr_hedge(addrs, &addrs[2]));
+
+  addrs[2].proto = Proto::HTTP1;
+
+  // The blocked address is skipped.
+  addrs[0].connect_blocker->block(10.);
+
+  CU_ASSERT(&addrs[2] == select_downstream_addr_hedge(addrs, &addrs[3]));
+
+  addrs[2].connect_blocker->block(10.);
+
+  CU_ASSERT(nullptr == select_downstream_addr_hedge(addrs, &addrs[3]));
+}
+
+void test_shrpx_worker_concurrency_limit(void) {
+  SharedDownstreamAddr shared_addr;
+  auto &concurrency = shared_addr.concurrency;
+
+  concurrency.max_limit = 100;
+  concurrency.limit = 100.;
+
+  for (size_t i = 0; i < 100; ++i) {
+    CU_ASSERT(downstream_concurrency_acquire(&shared_addr));
+  }
+
+  CU_ASSERT(!downstream_concurrency_acquire(&shared_addr));
+
+  downstream_concurrency_release(&shared_addr);
+
+  CU_ASSERT(downstream_concurrency_acquire(&shared_addr));
+  CU_ASSERT(100 == concurrency.inflight);
+
+  auto now = 1000.;
+
+  // The limit never exceeds max_limit.
+  for (size_t i = 0; i < 16; ++i) {
+    downstream_record_concurrency_latency(&shared_addr, 4, 0.01, now);
+  }
+
+  CU_ASSERT(std::abs(0.01 - concurrency.min_rtt) < 1e-9);
+  CU_ASSERT(100. == concurrency.limit);
+
+  // The latency doubled.  The new limit is 100 * 0.5 + sqrt(100),
+  // and it is smoothed.
+  for (size_t i = 0; i < 16; ++i) {
+    downstream_record_concurrency_latency(&shared_addr, 4, 0.02, now);
+  }
+
+  CU_ASSERT(std::abs(0.01 - concurrency.min_rtt) < 1e-9);
+  CU_ASSERT(std::abs(92. - concurrency.limit) < 1e-9);
+
+  // The limit converges, but does not go below the lower bound.
+  for (size_t i = 0; i < 16 * 100; ++i) {
+    downstream_record_concurrency_latency(&shared_addr, 8, 0.02, now);
+  }
+
+  CU_ASSERT(std::abs(8. - concurrency.limit) < 1e-9);
+
+  // The limit does not grow while it is not used.
+  concurrency.inflight = 3;
+
+  for (size_t i = 0; i < 16; ++i) {
+    downstream_record_concurrency_latency(&shared_addr, 8, 0.01, now);
+  }
+
+  CU_ASSERT(std::abs(8. - concurrency.limit) < 1e-9);
+
+  concurrency.inflight = 8;
+
+  for (size_t i = 0; i < 16; ++i) {
+    downstream_record_concurrency_latency(&shared_addr, 8, 0.01, now);
+  }
+
+  CU_ASSERT(concurrency.limit > 8.);
+
+  // The minimum latency is reset after it expires.
+  for (size_t i = 0; i < 16; ++i) {
+    downstream_record_concurrency_latency(&shared_addr, 8, 0.05, now + 30.);
+  }
+
+  CU_ASSERT(std::abs(0.05 - concurrency.min_rtt) < 1e-9);
+}
+
+void test_shrpx_worker_match_downstream_addrs(void) {
+  std::vector<DownstreamAddr> addrs(3);
+  std::vector<DownstreamAddrConfig> src(3);
+  std::vector<size_t> res;
+
+  addrs[0].host = StringRef::from_lit("alpha");
+  addrs[0].port = 80;
+  addrs[0].weight = 1;
+  addrs[1].host = StringRef::from_lit("bravo");
+  addrs[1].port = 80;
+  addrs[2].host = StringRef::from_lit("alpha");
+  addrs[2].port = 8080;
+
+  src[0].host = StringRef::from_lit("alpha");
+  src[0].port = 8080;
+  src[1].host = StringRef::from_lit("alpha");
+  src[1].port = 80;
+  // weight is not compared.
+  src[1].weight = 100;
+  src[2].host = StringRef::from_lit("bravo");
+  src[2].port = 80;
+
+  CU_ASSERT(match_downstream_addrs(res, addrs, src));
+  CU_ASSERT((std::vector<size_t>{2, 0, 1} == res));
+
+  // Different endpoint
+  src[2].tls = true;
+
+  CU_ASSERT(!match_downstream_addrs(res, addrs, src));
+
+  src[2].tls = false;
+  src[2].proto = Proto::HTTP2;
+
+  CU_ASSERT(!match_downstream_addrs(res, addrs, src));
+
+  // Different number of addresses
+  src.resize(2);
+
+  CU_ASSERT(!match_downstream_addrs(res, addrs, src));
+}
+
+void test_shrpx_worker_connection_budget(void) {
+  auto config = mod_config();
+  config->worker_event.budget = 16;
+  config->worker_event.queue_size = 16;
+
+  auto downstreamconf = std::make_shared<DownstreamConfig>();
+
+  DownstreamAddrConfig addrconf{};
+  addrconf.host = StringRef::from_lit("127.0.0.1");
+  addrconf.hostport = StringRef::from_lit("127.0.0.1:8080");
+  addrconf.port = 8080;
+  addrconf.proto = Proto::HTTP1;
+  addrconf.weight = 1;
+  addrconf.group_weight = 1;
+  addrconf.fall = 1;
+  addrconf.rise = 1;
+  addrconf.max_connections = 2;
+
+  downstreamconf->addr_groups.emplace_back(StringRef::from_lit("/"));
+  downstreamconf->addr_groups[0].addrs.push_back(addrconf);
+
+  auto old_downstreamconf = config->conn.downstream;
+  config->conn.downstream = downstreamconf;
+
+  auto loop = ev_loop_new(EVFLAG_AUTO);
+  auto gen = util::make_mt19937();
+
+  {
+    ConnectionHandler conn_handler(loop, gen);
+
+    auto create_worker = [&conn_handler, &downstreamconf]() {
+      return std::make_unique<Worker>(ev_loop_new(EVFLAG_AUTO), nullptr,
+                                      nullptr, nullptr, nullptr, nullptr,
+                                      &conn_handler, downstreamconf);
+    };
+
+    conn_handler.add_worker(create_worker());
+    conn_handler.add_worker(create_worker());
+
+    auto &workers = conn_handler.get_workers();
+    auto worker0 = workers[0].get();
+    auto worker1 = workers[1].get();
+    auto &group0 = worker0->get_downstream_addr_groups()[0];
+    auto &group1 = worker1->get_downstream_addr_groups()[0];
+    auto addr0 = &group0->shared_addr->addrs[0];
+    auto addr1 = &group1->shared_addr->addrs[0];
+    auto &endpoint = *addr0->endpoint;
+
+    // 2 workers share the same endpoint.
+    CU_ASSERT(addr0->endpoint == addr1->endpoint);
+
+    // worker0 holds an idle connection and an active one.
+    CU_ASSERT(downstream_connection_acquire(addr0));
+    addr0->dconn_pool->add_downstream_connection(
+        std::make_unique<HttpDownstreamConnection>(group0, addr0,
+                                                   worker0->get_loop(),
+                                                   worker0));
+    CU_ASSERT(downstream_connection_acquire(addr0));
+    CU_ASSERT(2 == endpoint.num_connections);
+
+    // worker1 runs short, and asks the others to give up an idle
+    // connection.
+    CU_ASSERT(!downstream_connection_acquire(addr1));
+    CU_ASSERT(endpoint.exhausted);
+    CU_ASSERT(endpoint.reclaim);
+
+    // worker0 closes the idle connection in its pool.
+    worker0->process_events();
+    worker1->process_events();
+
+    CU_ASSERT(0 == addr0->dconn_pool->size());
+    CU_ASSERT(1 == endpoint.num_connections);
+    CU_ASSERT(!endpoint.reclaim);
+
+    // Only one idle connection is closed for the shortage.
+    CU_ASSERT(!downstream_connection_reclaim(addr0));
+
+    // Pre-warming does not take the room for worker1.
+    CU_ASSERT(!downstream_connection_acquire_prewarm(addr0));
+    CU_ASSERT(1 == endpoint.num_connections);
+
+    CU_ASSERT(downstream_connection_acquire(addr1));
+    CU_ASSERT(!endpoint.exhausted);
+
+    downstream_connection_release(addr1);
+
+    CU_ASSERT(downstream_connection_acquire_prewarm(addr0));
+    CU_ASSERT(2 == endpoint.num_connections);
+
+    // Without max-connections, connections are only counted.
+    addr1->max_connections = 0;
+
+    CU_ASSERT(downstream_connection_acquire(addr1));
+    CU_ASSERT(3 == endpoint.num_connections);
+
+    downstream_connection_release(addr1);
+    downstream_connection_release(addr0);
+    downstream_connection_release(addr0);
+  }
+
+  ev_loop_destroy(loop);
+
+  config->conn.downstream = std::move(old_downstreamconf);
+}
+
+void test_shrpx_worker_keep_idle(void) {
+  DownstreamAddr addr{};
+  addr.min_idle = 2;
+
+  // Pre-warmed connections survive past the keep-alive timeout.
+  CU_ASSERT(downstream_connection_keep_idle(&addr, 1));
+  CU_ASSERT(downstream_connection_keep_idle(&addr, 2));
+
+  // The ones beyond min-idle are closed.
+  CU_ASSERT(!downstream_connection_keep_idle(&addr, 3));
+
+  // Without min-idle, every idle connection is closed.
+  addr.min_idle = 0;
+
+  CU_ASSERT(!downstream_connection_keep_idle(&addr, 1));
+}
+
+void test_shrpx_worker_for_each_shared_downstream_addr(void) {
+  auto shared_addr1 = std::make_shared<SharedDownstreamAddr>();
+  auto shared_addr2 = std::make_shared<SharedDownstreamAddr>();
+  auto groups = std::vector<std::shared_ptr<DownstreamAddrGroup>>();
+
+  for (auto &shared_addr : {shared_addr1, shared_addr2, shared_addr1}) {
+    auto g = std::make_shared<DownstreamAddrGroup>();
+    g->shared_addr = shared_addr;
+    groups.push_back(std::move(g));
+  }
+
+  std::vector<DownstreamAddrGroup *> visited;
+
+  for_each_shared_downstream_addr(
+      groups, [&visited](const std::shared_ptr<DownstreamAddrGroup> &g) {
+        visited.push_back(g.get());
+      });
+
+  // The third group shares SharedDownstreamAddr with the first one.
+  CU_ASSERT(2 == visited.size());
+  CU_ASSERT(groups[0].get() == visited[0]);
+  CU_ASSERT(groups[1].get() == visited[1]);
+}
+
+void test_shrpx_worker_shared_downstream_health(void) {
+  auto config = mod_config();
+  config->worker_event.budget = 16;
+  config->worker_event.queue_size = 16;
+
+  auto downstreamconf = std::make_shared<DownstreamConfig>();
+
+  DownstreamAddrConfig addrconf{};
+  addrconf.host = StringRef::from_lit("127.0.0.1");
+  addrconf.hostport = StringRef::from_lit("127.0.0.1:8080");
+  addrconf.port = 8080;
+  addrconf.proto = Proto::HTTP1;
+  addrconf.weight = 1;
+  addrconf.group_weight = 1;
+  addrconf.fall = 1;
+  addrconf.rise = 1;
+
+  downstreamconf->addr_groups.emplace_back(StringRef::from_lit("/"));
+  downstreamconf->addr_groups[0].addrs.push_back(addrconf);
+
+  auto old_downstreamconf = config->conn.downstream;
+  config->conn.downstream = downstreamconf;
+
+  auto loop = ev_loop_new(EVFLAG_AUTO);
+  auto gen = util::make_mt19937();
+
+  {
+    ConnectionHandler conn_handler(loop, gen);
+
+    auto create_worker = [&conn_handler, &downstreamconf]() {
+      return std::make_unique<Worker>(ev_loop_new(EVFLAG_AUTO), nullptr,
+                                      nullptr, nullptr, nullptr, nullptr,
+                                      &conn_handler, downstreamconf);
+    };
+
+    conn_handler.add_worker(create_worker());
+    conn_handler.add_worker(create_worker());
+    conn_handler.set_health_worker(create_worker());
+
+    auto get_addr = [](Worker *worker) {
+      return &worker->get_downstream_addr_groups()[0]->shared_addr->addrs[0];
+    };
+
+    auto &workers = conn_handler.get_workers();
+    auto health_worker = conn_handler.get_health_worker();
+    auto addr0 = get_addr(workers[0].get());
+    auto addr1 = get_addr(workers[1].get());
+    auto health_addr = get_addr(health_worker);
+
+    // All workers share the same endpoint.
+    CU_ASSERT(addr0->endpoint == addr1->endpoint);
+    CU_ASSERT(addr0->endpoint == health_addr->endpoint);
+
+    addr0->endpoint->share_health = true;
+
+    // The worker which finds the backend offline tells the others.
+    downstream_failure(addr0, nullptr);
+
+    CU_ASSERT(addr0->connect_blocker->in_offline());
+    CU_ASSERT(addr0->endpoint->offline);
+    CU_ASSERT(!addr1->connect_blocker->in_offline());
+    CU_ASSERT(!health_addr->connect_blocker->in_offline());
+
+    for (auto &worker : workers) {
+      worker->process_events();
+    }
+    health_worker->process_events();
+
+    CU_ASSERT(addr0->connect_blocker->in_offline());
+    CU_ASSERT(addr1->connect_blocker->in_offline());
+    CU_ASSERT(health_addr->connect_blocker->in_offline());
+
+    // Only the health check worker probes the backend, and tells the
+    // others that it is back online.
+    health_addr->live_check->on_success();
+
+    CU_ASSERT(!health_addr->connect_blocker->in_offline());
+    CU_ASSERT(!addr0->endpoint->offline);
+    CU_ASSERT(addr0->connect_blocker->in_offline());
+    CU_ASSERT(addr1->connect_blocker->in_offline());
+
+    for (auto &worker : workers) {
+      worker->process_events();
+    }
+    health_worker->process_events();
+
+    CU_ASSERT(!addr0->connect_blocker->in_offline());
+    CU_ASSERT(!addr1->connect_blocker->in_offline());
+    CU_ASSERT(!health_addr->connect_blocker->in_offline());
+  }
+
+  ev_loop_destroy(loop);
+
+  config->conn.downstream = std::move(old_downstreamconf);
+}
+
 } // namespace shrpx
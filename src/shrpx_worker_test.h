@@ -32,6 +32,17 @@
 namespace shrpx {
 
 void test_shrpx_worker_match_downstream_addr_group(void);
+void test_shrpx_worker_select_downstream_addr_p2c(void);
+void test_shrpx_worker_select_downstream_addr_bounded(void);
+void test_shrpx_worker_affinity_hash_consistency(void);
+void test_shrpx_worker_detect_downstream_outliers(void);
+void test_shrpx_worker_hedge(void);
+void test_shrpx_worker_concurrency_limit(void);
+void test_shrpx_worker_match_downstream_addrs(void);
+void test_shrpx_worker_connection_budget(void);
+void test_shrpx_worker_keep_idle(void);
+void test_shrpx_worker_for_each_shared_downstream_addr(void);
+void test_shrpx_worker_shared_downstream_health(void);
 
 } // namespace shrpx
 
@@ -0,0 +1,228 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_zerocopy.h"
+
+#ifdef HAVE_MSG_ZEROCOPY
+
+#  ifdef HAVE_UNISTD_H
+#    include <unistd.h>
+#  endif // HAVE_UNISTD_H
+#  include <sys/socket.h>
+#  include <netinet/in.h>
+#  include <time.h>
+#  include <linux/errqueue.h>
+
+#  include <cerrno>
+#  include <algorithm>
+#  include <array>
+
+#  include "shrpx_log.h"
+
+using namespace nghttp2;
+
+namespace shrpx {
+
+namespace {
+void lingercb(struct ev_loop *loop, ev_timer *w, int revents) {
+  auto zc = static_cast<Zerocopy *>(w->data);
+
+  zc->reap_lingering();
+}
+} // namespace
+
+Zerocopy::Zerocopy(struct ev_loop *loop, MemchunkPool *mcpool,
+                   size_t min_length, size_t max_pinned,
+                   ev_tstamp linger_timeout)
+    : loop_(loop),
+      mcpool_(mcpool),
+      min_length_(min_length),
+      max_pinned_(max_pinned),
+      pinned_(0),
+      linger_timeout_(linger_timeout) {
+  // Completions usually arrive within a round trip time.
+  ev_timer_init(&lingertimer_, lingercb, 0., 0.1);
+  lingertimer_.data = this;
+}
+
+Zerocopy::~Zerocopy() {
+  ev_timer_stop(loop_, &lingertimer_);
+
+  for (auto &l : lingering_) {
+    close(l.fd);
+    unpin_all(l.zs);
+  }
+}
+
+bool Zerocopy::should_send(size_t n) const {
+  return n >= min_length_ && pinned_ + n <= max_pinned_;
+}
+
+void Zerocopy::pin(ZerocopySend &zs, Memchunk16K *head, size_t n) {
+  auto seq = zs.next_seq++;
+
+  for (auto m = head; n; m = m->next) {
+    auto len = std::min(n, m->len());
+    if (len == 0) {
+      continue;
+    }
+
+    // The data of the chunk which refers to the other chunk live in
+    // the latter.
+    auto owner = m->origin ? m->origin : m;
+    ++owner->nref;
+
+    zs.pins.push_back(ZerocopyPin{owner, len, seq});
+
+    pinned_ += len;
+    n -= len;
+  }
+}
+
+void Zerocopy::unpin(ZerocopySend &zs, uint32_t first, uint32_t last) {
+  // The range may wrap around.
+  auto in_range = [first, last](const ZerocopyPin &pin) {
+    return pin.seq - first <= last - first;
+  };
+
+  // The pins are ordered by the sequence number, and the range is
+  // contiguous.
+  auto it = std::find_if(std::begin(zs.pins), std::end(zs.pins), in_range);
+  auto end = std::find_if_not(it, std::end(zs.pins), in_range);
+
+  for (auto p = it; p != end; ++p) {
+    mcpool_->release((*p).chunk);
+    pinned_ -= (*p).len;
+  }
+
+  zs.pins.erase(it, end);
+}
+
+void Zerocopy::unpin_all(ZerocopySend &zs) {
+  for (auto &pin : zs.pins) {
+    mcpool_->release(pin.chunk);
+    pinned_ -= pin.len;
+  }
+
+  zs.pins.clear();
+}
+
+void Zerocopy::reap(int fd, ZerocopySend &zs) {
+  for (;;) {
+    union {
+      std::array<uint8_t, CMSG_SPACE(sizeof(sock_extended_err))> buf;
+      struct cmsghdr align;
+    } cmsgbuf;
+
+    struct msghdr msg {};
+    msg.msg_control = cmsgbuf.buf.data();
+    msg.msg_controllen = cmsgbuf.buf.size();
+
+    ssize_t rv;
+    while ((rv = recvmsg(fd, &msg, MSG_ERRQUEUE)) == -1 && errno == EINTR)
+      ;
+    if (rv == -1) {
+      return;
+    }
+
+    for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+         cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if (!(cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) &&
+          !(cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)) {
+        continue;
+      }
+
+      auto serr = reinterpret_cast<const sock_extended_err *>(CMSG_DATA(cmsg));
+      if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+        continue;
+      }
+
+      if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+        zs.copied = true;
+      }
+
+      unpin(zs, serr->ee_info, serr->ee_data);
+    }
+  }
+}
+
+void Zerocopy::linger(int fd, ZerocopySend &zs) {
+  lingering_.push_back(Lingering{fd, ZerocopySend{}, 0.});
+
+  auto &l = lingering_.back();
+  l.zs.pins = std::move(zs.pins);
+  l.expiry = ev_now(loop_) + linger_timeout_;
+
+  zs.pins.clear();
+
+  if (LOG_ENABLED(INFO)) {
+    LOG(INFO) << "zerocopy: fd=" << fd << " lingers for " << l.zs.pins.size()
+              << " pinned chunks";
+  }
+
+  ev_timer_again(loop_, &lingertimer_);
+}
+
+void Zerocopy::reap_lingering() {
+  auto now = ev_now(loop_);
+
+  for (auto it = std::begin(lingering_); it != std::end(lingering_);) {
+    auto &l = *it;
+
+    reap(l.fd, l.zs);
+
+    if (!l.zs.pins.empty()) {
+      if (now < l.expiry) {
+        ++it;
+        continue;
+      }
+
+      if (LOG_ENABLED(INFO)) {
+        LOG(INFO) << "zerocopy: fd=" << l.fd
+                  << " timed out waiting for completion; reset connection";
+      }
+
+      // Discard the data in the send buffer, so that the kernel no
+      // longer reads the pinned chunks.
+      struct linger lin {
+        1, 0
+      };
+      setsockopt(l.fd, SOL_SOCKET, SO_LINGER, &lin, sizeof(lin));
+    }
+
+    close(l.fd);
+
+    unpin_all(l.zs);
+
+    it = lingering_.erase(it);
+  }
+
+  if (lingering_.empty()) {
+    ev_timer_stop(loop_, &lingertimer_);
+  }
+}
+
+} // namespace shrpx
+
+#endif // HAVE_MSG_ZEROCOPY
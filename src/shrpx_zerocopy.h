@@ -0,0 +1,131 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef SHRPX_ZEROCOPY_H
+#define SHRPX_ZEROCOPY_H
+
+#include "shrpx.h"
+
+#ifdef HAVE_MSG_ZEROCOPY
+
+#  include <deque>
+#  include <list>
+
+#  include <ev.h>
+
+#  include "memchunk.h"
+
+using namespace nghttp2;
+
+namespace shrpx {
+
+// ZerocopyPin is the chunk which holds the data sent with
+// MSG_ZEROCOPY.  The kernel may read the data until it notifies
+// completion of the send.
+struct ZerocopyPin {
+  // The chunk which owns the memory.  Its reference count is
+  // incremented while it is pinned.
+  Memchunk16K *chunk;
+  // The number of bytes sent from |chunk|.
+  size_t len;
+  // The sequence number of sendmsg(2) call which sent the data.
+  uint32_t seq;
+};
+
+class Zerocopy;
+
+// ZerocopySend is the state of sending data with MSG_ZEROCOPY over a
+// socket.
+struct ZerocopySend {
+  // Non-null if MSG_ZEROCOPY is enabled for the socket.
+  Zerocopy *ctx;
+  // The pinned chunks in the order of sendmsg(2) calls.
+  std::deque<ZerocopyPin> pins;
+  // The kernel numbers sendmsg(2) calls with MSG_ZEROCOPY from 0.
+  // This is the number of the next call.
+  uint32_t next_seq;
+  // true if the kernel copied the data instead of sending them from
+  // the pinned pages.  This happens, for example, if the destination
+  // is the local host.  Then MSG_ZEROCOPY is only an overhead.
+  bool copied;
+};
+
+// Zerocopy manages the memory pinned by MSG_ZEROCOPY sends in a
+// Worker.  A chunk is pinned by taking a reference to it, so that
+// MemchunkPool does not reuse it until the kernel is done with it.
+// The total number of bytes pinned is capped.  If a connection is
+// closed before the completion notifications arrive, its socket is
+// kept open until they arrive.
+class Zerocopy {
+public:
+  // MSG_ZEROCOPY is used only if a single write is at least
+  // |min_length| bytes, and the pinned memory does not exceed
+  // |max_pinned| bytes.  The socket of a closed connection is reset
+  // if the completion does not arrive in |linger_timeout|.
+  Zerocopy(struct ev_loop *loop, MemchunkPool *mcpool, size_t min_length,
+           size_t max_pinned, ev_tstamp linger_timeout);
+  ~Zerocopy();
+  Zerocopy(const Zerocopy &) = delete;
+  Zerocopy &operator=(const Zerocopy &) = delete;
+
+  // Returns true if |n| bytes should be sent with MSG_ZEROCOPY.
+  bool should_send(size_t n) const;
+  // Pins the chunks starting at |head| which hold the first |n| bytes
+  // sent by the next sendmsg(2) call of |zs|.
+  void pin(ZerocopySend &zs, Memchunk16K *head, size_t n);
+  // Reads completion notifications from the error queue of |fd|, and
+  // unpins the chunks whose sends have completed.
+  void reap(int fd, ZerocopySend &zs);
+  // Takes over |fd| and the chunks in |zs| which are still pinned.
+  // |fd| is closed after all completions arrive.
+  void linger(int fd, ZerocopySend &zs);
+  // Reaps the sockets passed to linger().
+  void reap_lingering();
+
+private:
+  void unpin(ZerocopySend &zs, uint32_t first, uint32_t last);
+  void unpin_all(ZerocopySend &zs);
+
+  struct Lingering {
+    int fd;
+    ZerocopySend zs;
+    ev_tstamp expiry;
+  };
+
+  std::list<Lingering> lingering_;
+  ev_timer lingertimer_;
+  struct ev_loop *loop_;
+  MemchunkPool *mcpool_;
+  size_t min_length_;
+  size_t max_pinned_;
+  // The number of bytes currently pinned.
+  size_t pinned_;
+  ev_tstamp linger_timeout_;
+};
+
+} // namespace shrpx
+
+#endif // HAVE_MSG_ZEROCOPY
+
+#endif // SHRPX_ZEROCOPY_H
@@ -52,13 +52,19 @@ int main() {
     return (int)CU_get_error();
   }
 
-  /* add the tests to the suite */
-  if (!CU_add_test(pSuite, "failmalloc_session_send",
+  /* add the tests to the suite.  The session tests are skipped if
+     the library is built without the role they need. */
+  if (
+#ifndef NGHTTP2_SERVER_ONLY
+      !CU_add_test(pSuite, "failmalloc_session_send",
                    test_nghttp2_session_send) ||
+#endif /* !NGHTTP2_SERVER_ONLY */
+#ifndef NGHTTP2_CLIENT_ONLY
       !CU_add_test(pSuite, "failmalloc_session_send_server",
                    test_nghttp2_session_send_server) ||
       !CU_add_test(pSuite, "failmalloc_session_recv",
                    test_nghttp2_session_recv) ||
+#endif /* !NGHTTP2_CLIENT_ONLY */
       !CU_add_test(pSuite, "failmalloc_frame", test_nghttp2_frame) ||
       !CU_add_test(pSuite, "failmalloc_hd", test_nghttp2_hd)) {
     CU_cleanup_registry();
@@ -43,6 +43,30 @@
 
 extern int nghttp2_enable_strict_preface;
 
+/*
+ * The tests which create a session of a role are not registered if
+ * the library is built for the other role only (see
+ * NGHTTP2_SERVER_ONLY and NGHTTP2_CLIENT_ONLY).  Evaluates to nonzero
+ * if the test is skipped.
+ */
+#ifdef NGHTTP2_SERVER_ONLY
+#  define CLIENT_TEST(SUITE, NAME, FUNC) ((void)(FUNC), 1)
+#else /* !NGHTTP2_SERVER_ONLY */
+#  define CLIENT_TEST(SUITE, NAME, FUNC) CU_add_test(SUITE, NAME, FUNC)
+#endif /* !NGHTTP2_SERVER_ONLY */
+
+#ifdef NGHTTP2_CLIENT_ONLY
+#  define SERVER_TEST(SUITE, NAME, FUNC) ((void)(FUNC), 1)
+#else /* !NGHTTP2_CLIENT_ONLY */
+#  define SERVER_TEST(SUITE, NAME, FUNC) CU_add_test(SUITE, NAME, FUNC)
+#endif /* !NGHTTP2_CLIENT_ONLY */
+
+#if defined(NGHTTP2_SERVER_ONLY) || defined(NGHTTP2_CLIENT_ONLY)
+#  define CLIENT_SERVER_TEST(SUITE, NAME, FUNC) ((void)(FUNC), 1)
+#else /* !NGHTTP2_SERVER_ONLY && !NGHTTP2_CLIENT_ONLY */
+#  define CLIENT_SERVER_TEST(SUITE, NAME, FUNC) CU_add_test(SUITE, NAME, FUNC)
+#endif /* !NGHTTP2_SERVER_ONLY && !NGHTTP2_CLIENT_ONLY */
+
 static int init_suite1(void) { return 0; }
 
 static int clean_suite1(void) { return 0; }
@@ -73,281 +97,319 @@ int main() {
       !CU_add_test(pSuite, "map_each_free", test_nghttp2_map_each_free) ||
       !CU_add_test(pSuite, "queue", test_nghttp2_queue) ||
       !CU_add_test(pSuite, "npn", test_nghttp2_npn) ||
-      !CU_add_test(pSuite, "session_recv", test_nghttp2_session_recv) ||
-      !CU_add_test(pSuite, "session_recv_invalid_stream_id",
+      !SERVER_TEST(pSuite, "session_recv", test_nghttp2_session_recv) ||
+      !SERVER_TEST(pSuite, "session_recv_invalid_stream_id",
                    test_nghttp2_session_recv_invalid_stream_id) ||
-      !CU_add_test(pSuite, "session_recv_invalid_frame",
+      !SERVER_TEST(pSuite, "session_recv_invalid_frame",
                    test_nghttp2_session_recv_invalid_frame) ||
-      !CU_add_test(pSuite, "session_recv_eof", test_nghttp2_session_recv_eof) ||
-      !CU_add_test(pSuite, "session_recv_data",
-                   test_nghttp2_session_recv_data) ||
-      !CU_add_test(pSuite, "session_recv_data_no_auto_flow_control",
+      !CLIENT_TEST(pSuite, "session_recv_eof", test_nghttp2_session_recv_eof) ||
+      !CLIENT_SERVER_TEST(pSuite, "session_recv_data",
+                          test_nghttp2_session_recv_data) ||
+      !SERVER_TEST(pSuite, "session_recv_data_no_auto_flow_control",
                    test_nghttp2_session_recv_data_no_auto_flow_control) ||
-      !CU_add_test(pSuite, "session_recv_continuation",
+      !SERVER_TEST(pSuite, "session_recv_continuation",
                    test_nghttp2_session_recv_continuation) ||
-      !CU_add_test(pSuite, "session_recv_headers_with_priority",
+      !SERVER_TEST(pSuite, "session_recv_headers_with_priority",
                    test_nghttp2_session_recv_headers_with_priority) ||
-      !CU_add_test(pSuite, "session_recv_headers_with_padding",
-                   test_nghttp2_session_recv_headers_with_padding) ||
-      !CU_add_test(pSuite, "session_recv_headers_early_response",
+      !CLIENT_SERVER_TEST(pSuite, "session_recv_headers_with_padding",
+                          test_nghttp2_session_recv_headers_with_padding) ||
+      !SERVER_TEST(pSuite, "session_recv_headers_early_response",
                    test_nghttp2_session_recv_headers_early_response) ||
-      !CU_add_test(pSuite, "session_recv_headers_for_closed_stream",
+      !SERVER_TEST(pSuite, "session_recv_headers_for_closed_stream",
                    test_nghttp2_session_recv_headers_for_closed_stream) ||
-      !CU_add_test(pSuite, "session_server_recv_push_response",
+      !SERVER_TEST(pSuite, "session_server_recv_push_response",
                    test_nghttp2_session_server_recv_push_response) ||
-      !CU_add_test(pSuite, "session_recv_premature_headers",
-                   test_nghttp2_session_recv_premature_headers) ||
-      !CU_add_test(pSuite, "session_recv_unknown_frame",
+      !CLIENT_SERVER_TEST(pSuite, "session_recv_premature_headers",
+                          test_nghttp2_session_recv_premature_headers) ||
+      !SERVER_TEST(pSuite, "session_recv_unknown_frame",
                    test_nghttp2_session_recv_unknown_frame) ||
-      !CU_add_test(pSuite, "session_recv_unexpected_continuation",
+      !SERVER_TEST(pSuite, "session_recv_unexpected_continuation",
                    test_nghttp2_session_recv_unexpected_continuation) ||
-      !CU_add_test(pSuite, "session_recv_settings_header_table_size",
+      !CLIENT_TEST(pSuite, "session_recv_settings_header_table_size",
                    test_nghttp2_session_recv_settings_header_table_size) ||
-      !CU_add_test(pSuite, "session_recv_too_large_frame_length",
+      !SERVER_TEST(pSuite, "session_recv_too_large_frame_length",
                    test_nghttp2_session_recv_too_large_frame_length) ||
-      !CU_add_test(pSuite, "session_recv_extension",
-                   test_nghttp2_session_recv_extension) ||
-      !CU_add_test(pSuite, "session_recv_altsvc",
-                   test_nghttp2_session_recv_altsvc) ||
-      !CU_add_test(pSuite, "session_recv_origin",
-                   test_nghttp2_session_recv_origin) ||
-      !CU_add_test(pSuite, "session_continue", test_nghttp2_session_continue) ||
-      !CU_add_test(pSuite, "session_add_frame",
+#ifndef NGHTTP2_NO_EXTENSIONS
+      !CLIENT_SERVER_TEST(pSuite, "session_recv_extension",
+                          test_nghttp2_session_recv_extension) ||
+      !CLIENT_SERVER_TEST(pSuite, "session_recv_altsvc",
+                          test_nghttp2_session_recv_altsvc) ||
+      !CLIENT_SERVER_TEST(pSuite, "session_recv_origin",
+                          test_nghttp2_session_recv_origin) ||
+#endif /* !NGHTTP2_NO_EXTENSIONS */
+      !SERVER_TEST(pSuite, "session_continue", test_nghttp2_session_continue) ||
+      !CLIENT_TEST(pSuite, "session_add_frame",
                    test_nghttp2_session_add_frame) ||
-      !CU_add_test(pSuite, "session_on_request_headers_received",
-                   test_nghttp2_session_on_request_headers_received) ||
-      !CU_add_test(pSuite, "session_on_response_headers_received",
+      !CLIENT_SERVER_TEST(pSuite, "session_on_request_headers_received",
+                          test_nghttp2_session_on_request_headers_received) ||
+      !CLIENT_TEST(pSuite, "session_on_response_headers_received",
                    test_nghttp2_session_on_response_headers_received) ||
-      !CU_add_test(pSuite, "session_on_headers_received",
+      !CLIENT_TEST(pSuite, "session_on_headers_received",
                    test_nghttp2_session_on_headers_received) ||
-      !CU_add_test(pSuite, "session_on_push_response_headers_received",
+      !CLIENT_TEST(pSuite, "session_on_push_response_headers_received",
                    test_nghttp2_session_on_push_response_headers_received) ||
-      !CU_add_test(pSuite, "session_on_priority_received",
+      !SERVER_TEST(pSuite, "session_on_priority_received",
                    test_nghttp2_session_on_priority_received) ||
-      !CU_add_test(pSuite, "session_on_rst_stream_received",
+      !SERVER_TEST(pSuite, "session_on_rst_stream_received",
                    test_nghttp2_session_on_rst_stream_received) ||
-      !CU_add_test(pSuite, "session_on_settings_received",
-                   test_nghttp2_session_on_settings_received) ||
-      !CU_add_test(pSuite, "session_on_push_promise_received",
+      !CLIENT_SERVER_TEST(pSuite, "session_on_settings_received",
+                          test_nghttp2_session_on_settings_received) ||
+#ifndef NGHTTP2_NO_PUSH
+      !CLIENT_TEST(pSuite, "session_on_push_promise_received",
                    test_nghttp2_session_on_push_promise_received) ||
-      !CU_add_test(pSuite, "session_on_ping_received",
-                   test_nghttp2_session_on_ping_received) ||
-      !CU_add_test(pSuite, "session_on_goaway_received",
+#endif /* !NGHTTP2_NO_PUSH */
+      !CLIENT_SERVER_TEST(pSuite, "session_on_ping_received",
+                          test_nghttp2_session_on_ping_received) ||
+      !CLIENT_TEST(pSuite, "session_on_goaway_received",
                    test_nghttp2_session_on_goaway_received) ||
-      !CU_add_test(pSuite, "session_on_window_update_received",
-                   test_nghttp2_session_on_window_update_received) ||
-      !CU_add_test(pSuite, "session_on_data_received",
+      !CLIENT_SERVER_TEST(pSuite, "session_on_window_update_received",
+                          test_nghttp2_session_on_window_update_received) ||
+      !CLIENT_TEST(pSuite, "session_on_data_received",
                    test_nghttp2_session_on_data_received) ||
-      !CU_add_test(pSuite, "session_on_data_received_fail_fast",
+      !SERVER_TEST(pSuite, "session_on_data_received_fail_fast",
                    test_nghttp2_session_on_data_received_fail_fast) ||
-      !CU_add_test(pSuite, "session_on_altsvc_received",
+      !CLIENT_TEST(pSuite, "session_on_altsvc_received",
                    test_nghttp2_session_on_altsvc_received) ||
-      !CU_add_test(pSuite, "session_send_headers_start_stream",
+      !CLIENT_TEST(pSuite, "session_send_headers_start_stream",
                    test_nghttp2_session_send_headers_start_stream) ||
-      !CU_add_test(pSuite, "session_send_headers_reply",
+      !SERVER_TEST(pSuite, "session_send_headers_reply",
                    test_nghttp2_session_send_headers_reply) ||
-      !CU_add_test(pSuite, "session_send_headers_frame_size_error",
+      !CLIENT_TEST(pSuite, "session_send_headers_frame_size_error",
                    test_nghttp2_session_send_headers_frame_size_error) ||
-      !CU_add_test(pSuite, "session_send_headers_push_reply",
+      !SERVER_TEST(pSuite, "session_send_headers_push_reply",
                    test_nghttp2_session_send_headers_push_reply) ||
-      !CU_add_test(pSuite, "session_send_rst_stream",
+      !CLIENT_TEST(pSuite, "session_send_rst_stream",
                    test_nghttp2_session_send_rst_stream) ||
-      !CU_add_test(pSuite, "session_send_push_promise",
-                   test_nghttp2_session_send_push_promise) ||
-      !CU_add_test(pSuite, "session_is_my_stream_id",
-                   test_nghttp2_session_is_my_stream_id) ||
-      !CU_add_test(pSuite, "session_upgrade2", test_nghttp2_session_upgrade2) ||
-      !CU_add_test(pSuite, "session_reprioritize_stream",
+#ifndef NGHTTP2_NO_PUSH
+      !CLIENT_SERVER_TEST(pSuite, "session_send_push_promise",
+                          test_nghttp2_session_send_push_promise) ||
+#endif /* !NGHTTP2_NO_PUSH */
+      !CLIENT_SERVER_TEST(pSuite, "session_is_my_stream_id",
+                          test_nghttp2_session_is_my_stream_id) ||
+      !CLIENT_SERVER_TEST(pSuite, "session_upgrade2",
+                          test_nghttp2_session_upgrade2) ||
+      !SERVER_TEST(pSuite, "session_reprioritize_stream",
                    test_nghttp2_session_reprioritize_stream) ||
-      !CU_add_test(
+      !SERVER_TEST(
           pSuite, "session_reprioritize_stream_with_idle_stream_dep",
           test_nghttp2_session_reprioritize_stream_with_idle_stream_dep) ||
-      !CU_add_test(pSuite, "submit_data", test_nghttp2_submit_data) ||
-      !CU_add_test(pSuite, "submit_data_read_length_too_large",
+      !CLIENT_TEST(pSuite, "submit_data", test_nghttp2_submit_data) ||
+      !CLIENT_TEST(pSuite, "submit_data_read_length_too_large",
                    test_nghttp2_submit_data_read_length_too_large) ||
-      !CU_add_test(pSuite, "submit_data_read_length_smallest",
+      !CLIENT_TEST(pSuite, "submit_data_read_length_smallest",
                    test_nghttp2_submit_data_read_length_smallest) ||
-      !CU_add_test(pSuite, "submit_data_twice",
+      !CLIENT_TEST(pSuite, "submit_data_twice",
                    test_nghttp2_submit_data_twice) ||
-      !CU_add_test(pSuite, "submit_request_with_data",
-                   test_nghttp2_submit_request_with_data) ||
-      !CU_add_test(pSuite, "submit_request_without_data",
+      !CLIENT_SERVER_TEST(pSuite, "submit_request_with_data",
+                          test_nghttp2_submit_request_with_data) ||
+      !CLIENT_TEST(pSuite, "submit_request_without_data",
                    test_nghttp2_submit_request_without_data) ||
-      !CU_add_test(pSuite, "submit_response_with_data",
-                   test_nghttp2_submit_response_with_data) ||
-      !CU_add_test(pSuite, "submit_response_without_data",
+      !CLIENT_TEST(pSuite, "submit_request_rcnv",
+                   test_nghttp2_submit_request_rcnv) ||
+      !CLIENT_SERVER_TEST(pSuite, "submit_response_with_data",
+                          test_nghttp2_submit_response_with_data) ||
+      !SERVER_TEST(pSuite, "submit_response_without_data",
                    test_nghttp2_submit_response_without_data) ||
-      !CU_add_test(pSuite, "Submit_response_push_response",
+      !SERVER_TEST(pSuite, "submit_response_rcnv",
+                   test_nghttp2_submit_response_rcnv) ||
+      !SERVER_TEST(pSuite, "Submit_response_push_response",
                    test_nghttp2_submit_response_push_response) ||
-      !CU_add_test(pSuite, "submit_trailer", test_nghttp2_submit_trailer) ||
-      !CU_add_test(pSuite, "submit_headers_start_stream",
+      !SERVER_TEST(pSuite, "submit_trailer", test_nghttp2_submit_trailer) ||
+      !SERVER_TEST(pSuite, "submit_trailer_rcnv",
+                   test_nghttp2_submit_trailer_rcnv) ||
+      !CLIENT_TEST(pSuite, "submit_headers_start_stream",
                    test_nghttp2_submit_headers_start_stream) ||
-      !CU_add_test(pSuite, "submit_headers_reply",
+      !SERVER_TEST(pSuite, "submit_headers_reply",
                    test_nghttp2_submit_headers_reply) ||
-      !CU_add_test(pSuite, "submit_headers_push_reply",
-                   test_nghttp2_submit_headers_push_reply) ||
-      !CU_add_test(pSuite, "submit_headers", test_nghttp2_submit_headers) ||
-      !CU_add_test(pSuite, "submit_headers_continuation",
+      !CLIENT_SERVER_TEST(pSuite, "submit_headers_push_reply",
+                          test_nghttp2_submit_headers_push_reply) ||
+      !CLIENT_SERVER_TEST(pSuite, "submit_headers",
+                          test_nghttp2_submit_headers) ||
+      !CLIENT_SERVER_TEST(pSuite, "submit_headers_rcnv",
+                          test_nghttp2_submit_headers_rcnv) ||
+      !CLIENT_TEST(pSuite, "submit_headers_continuation",
                    test_nghttp2_submit_headers_continuation) ||
-      !CU_add_test(pSuite, "submit_headers_continuation_extra_large",
+      !CLIENT_TEST(pSuite, "submit_headers_continuation_extra_large",
                    test_nghttp2_submit_headers_continuation_extra_large) ||
-      !CU_add_test(pSuite, "submit_priority", test_nghttp2_submit_priority) ||
-      !CU_add_test(pSuite, "session_submit_settings",
+      !CLIENT_TEST(pSuite, "submit_priority", test_nghttp2_submit_priority) ||
+      !SERVER_TEST(pSuite, "session_submit_settings",
                    test_nghttp2_submit_settings) ||
-      !CU_add_test(pSuite, "session_submit_settings_update_local_window_size",
+      !SERVER_TEST(pSuite, "session_submit_settings_update_local_window_size",
                    test_nghttp2_submit_settings_update_local_window_size) ||
-      !CU_add_test(pSuite, "session_submit_settings_multiple_times",
+      !CLIENT_TEST(pSuite, "session_submit_settings_multiple_times",
                    test_nghttp2_submit_settings_multiple_times) ||
-      !CU_add_test(pSuite, "session_submit_push_promise",
+      !CLIENT_TEST(pSuite, "submit_settings_enable_push",
+                   test_nghttp2_submit_settings_enable_push) ||
+#ifndef NGHTTP2_NO_PUSH
+      !SERVER_TEST(pSuite, "session_submit_push_promise",
                    test_nghttp2_submit_push_promise) ||
-      !CU_add_test(pSuite, "submit_window_update",
+#endif /* !NGHTTP2_NO_PUSH */
+      !CLIENT_TEST(pSuite, "submit_window_update",
                    test_nghttp2_submit_window_update) ||
-      !CU_add_test(pSuite, "submit_window_update_local_window_size",
+      !CLIENT_TEST(pSuite, "submit_window_update_local_window_size",
                    test_nghttp2_submit_window_update_local_window_size) ||
-      !CU_add_test(pSuite, "submit_shutdown_notice",
-                   test_nghttp2_submit_shutdown_notice) ||
-      !CU_add_test(pSuite, "submit_invalid_nv",
-                   test_nghttp2_submit_invalid_nv) ||
-      !CU_add_test(pSuite, "submit_extension", test_nghttp2_submit_extension) ||
-      !CU_add_test(pSuite, "submit_altsvc", test_nghttp2_submit_altsvc) ||
-      !CU_add_test(pSuite, "submit_origin", test_nghttp2_submit_origin) ||
-      !CU_add_test(pSuite, "submit_rst_stream",
+      !CLIENT_SERVER_TEST(pSuite, "submit_shutdown_notice",
+                          test_nghttp2_submit_shutdown_notice) ||
+      !CLIENT_SERVER_TEST(pSuite, "submit_invalid_nv",
+                          test_nghttp2_submit_invalid_nv) ||
+#ifndef NGHTTP2_NO_EXTENSIONS
+      !CLIENT_SERVER_TEST(pSuite, "submit_extension",
+                          test_nghttp2_submit_extension) ||
+      !CLIENT_SERVER_TEST(pSuite, "submit_altsvc",
+                          test_nghttp2_submit_altsvc) ||
+      !CLIENT_SERVER_TEST(pSuite, "submit_origin",
+                          test_nghttp2_submit_origin) ||
+#endif /* !NGHTTP2_NO_EXTENSIONS */
+      !CLIENT_TEST(pSuite, "submit_rst_stream",
                    test_nghttp2_submit_rst_stream) ||
-      !CU_add_test(pSuite, "session_open_stream",
-                   test_nghttp2_session_open_stream) ||
-      !CU_add_test(pSuite, "session_open_stream_with_idle_stream_dep",
+      !CLIENT_SERVER_TEST(pSuite, "session_open_stream",
+                          test_nghttp2_session_open_stream) ||
+      !SERVER_TEST(pSuite, "session_open_stream_with_idle_stream_dep",
                    test_nghttp2_session_open_stream_with_idle_stream_dep) ||
-      !CU_add_test(pSuite, "session_get_next_ob_item",
-                   test_nghttp2_session_get_next_ob_item) ||
-      !CU_add_test(pSuite, "session_pop_next_ob_item",
-                   test_nghttp2_session_pop_next_ob_item) ||
-      !CU_add_test(pSuite, "session_reply_fail",
+      !CLIENT_SERVER_TEST(pSuite, "session_get_next_ob_item",
+                          test_nghttp2_session_get_next_ob_item) ||
+      !CLIENT_SERVER_TEST(pSuite, "session_pop_next_ob_item",
+                          test_nghttp2_session_pop_next_ob_item) ||
+      !SERVER_TEST(pSuite, "session_reply_fail",
                    test_nghttp2_session_reply_fail) ||
-      !CU_add_test(pSuite, "session_max_concurrent_streams",
+      !SERVER_TEST(pSuite, "session_max_concurrent_streams",
                    test_nghttp2_session_max_concurrent_streams) ||
-      !CU_add_test(pSuite, "session_stop_data_with_rst_stream",
+      !SERVER_TEST(pSuite, "session_stop_data_with_rst_stream",
                    test_nghttp2_session_stop_data_with_rst_stream) ||
-      !CU_add_test(pSuite, "session_defer_data",
+      !SERVER_TEST(pSuite, "session_defer_data",
                    test_nghttp2_session_defer_data) ||
-      !CU_add_test(pSuite, "session_flow_control",
+      !CLIENT_TEST(pSuite, "session_flow_control",
                    test_nghttp2_session_flow_control) ||
-      !CU_add_test(pSuite, "session_flow_control_data_recv",
+      !CLIENT_TEST(pSuite, "session_flow_control_data_recv",
                    test_nghttp2_session_flow_control_data_recv) ||
-      !CU_add_test(pSuite, "session_flow_control_data_with_padding_recv",
+      !CLIENT_TEST(pSuite, "session_flow_control_data_with_padding_recv",
                    test_nghttp2_session_flow_control_data_with_padding_recv) ||
-      !CU_add_test(pSuite, "session_data_read_temporal_failure",
+      !CLIENT_TEST(pSuite, "session_data_read_temporal_failure",
                    test_nghttp2_session_data_read_temporal_failure) ||
-      !CU_add_test(pSuite, "session_on_stream_close",
+      !CLIENT_TEST(pSuite, "session_on_stream_close",
                    test_nghttp2_session_on_stream_close) ||
-      !CU_add_test(pSuite, "session_on_ctrl_not_send",
-                   test_nghttp2_session_on_ctrl_not_send) ||
-      !CU_add_test(pSuite, "session_get_outbound_queue_size",
+      !CLIENT_SERVER_TEST(pSuite, "session_on_ctrl_not_send",
+                          test_nghttp2_session_on_ctrl_not_send) ||
+      !CLIENT_TEST(pSuite, "session_get_outbound_queue_size",
                    test_nghttp2_session_get_outbound_queue_size) ||
-      !CU_add_test(pSuite, "session_get_effective_local_window_size",
+      !CLIENT_TEST(pSuite, "session_get_effective_local_window_size",
                    test_nghttp2_session_get_effective_local_window_size) ||
-      !CU_add_test(pSuite, "session_set_option",
+      !CLIENT_TEST(pSuite, "session_set_option",
                    test_nghttp2_session_set_option) ||
-      !CU_add_test(pSuite, "session_data_backoff_by_high_pri_frame",
+      !CLIENT_TEST(pSuite, "session_data_backoff_by_high_pri_frame",
                    test_nghttp2_session_data_backoff_by_high_pri_frame) ||
-      !CU_add_test(pSuite, "session_pack_data_with_padding",
-                   test_nghttp2_session_pack_data_with_padding) ||
-      !CU_add_test(pSuite, "session_pack_headers_with_padding",
-                   test_nghttp2_session_pack_headers_with_padding) ||
+      !CLIENT_SERVER_TEST(pSuite, "session_pack_data_with_padding",
+                          test_nghttp2_session_pack_data_with_padding) ||
+      !CLIENT_SERVER_TEST(pSuite, "session_pack_headers_with_padding",
+                          test_nghttp2_session_pack_headers_with_padding) ||
       !CU_add_test(pSuite, "pack_settings_payload",
                    test_nghttp2_pack_settings_payload) ||
-      !CU_add_test(pSuite, "session_stream_dep_add",
+      !SERVER_TEST(pSuite, "session_stream_dep_add",
                    test_nghttp2_session_stream_dep_add) ||
-      !CU_add_test(pSuite, "session_stream_dep_remove",
+      !SERVER_TEST(pSuite, "session_stream_dep_remove",
                    test_nghttp2_session_stream_dep_remove) ||
-      !CU_add_test(pSuite, "session_stream_dep_add_subtree",
+      !SERVER_TEST(pSuite, "session_stream_dep_add_subtree",
                    test_nghttp2_session_stream_dep_add_subtree) ||
-      !CU_add_test(pSuite, "session_stream_dep_remove_subtree",
+      !SERVER_TEST(pSuite, "session_stream_dep_remove_subtree",
                    test_nghttp2_session_stream_dep_remove_subtree) ||
-      !CU_add_test(
+      !SERVER_TEST(
           pSuite, "session_stream_dep_all_your_stream_are_belong_to_us",
           test_nghttp2_session_stream_dep_all_your_stream_are_belong_to_us) ||
-      !CU_add_test(pSuite, "session_stream_attach_item",
+      !SERVER_TEST(pSuite, "session_stream_attach_item",
                    test_nghttp2_session_stream_attach_item) ||
-      !CU_add_test(pSuite, "session_stream_attach_item_subtree",
+      !SERVER_TEST(pSuite, "session_stream_attach_item_subtree",
                    test_nghttp2_session_stream_attach_item_subtree) ||
-      !CU_add_test(pSuite, "session_stream_get_state",
-                   test_nghttp2_session_stream_get_state) ||
-      !CU_add_test(pSuite, "session_stream_get_something",
+#if !defined(NGHTTP2_NO_PUSH) && !defined(NGHTTP2_NO_REMOTE_PRIORITY)
+      !CLIENT_SERVER_TEST(pSuite, "session_stream_get_state",
+                          test_nghttp2_session_stream_get_state) ||
+#endif /* !NGHTTP2_NO_PUSH && !NGHTTP2_NO_REMOTE_PRIORITY */
+      !SERVER_TEST(pSuite, "session_stream_get_something",
                    test_nghttp2_session_stream_get_something) ||
-      !CU_add_test(pSuite, "session_find_stream",
+      !SERVER_TEST(pSuite, "session_find_stream",
                    test_nghttp2_session_find_stream) ||
-      !CU_add_test(pSuite, "session_keep_closed_stream",
+#ifndef NGHTTP2_NO_REMOTE_PRIORITY
+      !SERVER_TEST(pSuite, "session_keep_closed_stream",
                    test_nghttp2_session_keep_closed_stream) ||
-      !CU_add_test(pSuite, "session_keep_idle_stream",
+#endif /* !NGHTTP2_NO_REMOTE_PRIORITY */
+      !SERVER_TEST(pSuite, "session_keep_idle_stream",
                    test_nghttp2_session_keep_idle_stream) ||
-      !CU_add_test(pSuite, "session_detach_idle_stream",
+      !SERVER_TEST(pSuite, "session_detach_idle_stream",
                    test_nghttp2_session_detach_idle_stream) ||
-      !CU_add_test(pSuite, "session_large_dep_tree",
+      !SERVER_TEST(pSuite, "session_large_dep_tree",
                    test_nghttp2_session_large_dep_tree) ||
-      !CU_add_test(pSuite, "session_graceful_shutdown",
+      !SERVER_TEST(pSuite, "session_graceful_shutdown",
                    test_nghttp2_session_graceful_shutdown) ||
-      !CU_add_test(pSuite, "session_on_header_temporal_failure",
-                   test_nghttp2_session_on_header_temporal_failure) ||
-      !CU_add_test(pSuite, "session_recv_client_magic",
+      !CLIENT_SERVER_TEST(pSuite, "session_on_header_temporal_failure",
+                          test_nghttp2_session_on_header_temporal_failure) ||
+      !SERVER_TEST(pSuite, "session_recv_client_magic",
                    test_nghttp2_session_recv_client_magic) ||
-      !CU_add_test(pSuite, "session_delete_data_item",
+      !SERVER_TEST(pSuite, "session_delete_data_item",
                    test_nghttp2_session_delete_data_item) ||
-      !CU_add_test(pSuite, "session_open_idle_stream",
+#ifndef NGHTTP2_NO_REMOTE_PRIORITY
+      !SERVER_TEST(pSuite, "session_open_idle_stream",
                    test_nghttp2_session_open_idle_stream) ||
-      !CU_add_test(pSuite, "session_cancel_reserved_remote",
+#endif /* !NGHTTP2_NO_REMOTE_PRIORITY */
+      !CLIENT_TEST(pSuite, "session_cancel_reserved_remote",
                    test_nghttp2_session_cancel_reserved_remote) ||
-      !CU_add_test(pSuite, "session_reset_pending_headers",
+      !CLIENT_TEST(pSuite, "session_reset_pending_headers",
                    test_nghttp2_session_reset_pending_headers) ||
-      !CU_add_test(pSuite, "session_send_data_callback",
+      !CLIENT_TEST(pSuite, "session_send_data_callback",
                    test_nghttp2_session_send_data_callback) ||
-      !CU_add_test(pSuite, "session_on_begin_headers_temporal_failure",
-                   test_nghttp2_session_on_begin_headers_temporal_failure) ||
-      !CU_add_test(pSuite, "session_defer_then_close",
+      !CLIENT_SERVER_TEST(
+          pSuite, "session_on_begin_headers_temporal_failure",
+          test_nghttp2_session_on_begin_headers_temporal_failure) ||
+      !CLIENT_TEST(pSuite, "session_defer_then_close",
                    test_nghttp2_session_defer_then_close) ||
-      !CU_add_test(pSuite, "session_detach_item_from_closed_stream",
+      !SERVER_TEST(pSuite, "session_detach_item_from_closed_stream",
                    test_nghttp2_session_detach_item_from_closed_stream) ||
-      !CU_add_test(pSuite, "session_flooding", test_nghttp2_session_flooding) ||
-      !CU_add_test(pSuite, "session_change_stream_priority",
-                   test_nghttp2_session_change_stream_priority) ||
-      !CU_add_test(pSuite, "session_create_idle_stream",
-                   test_nghttp2_session_create_idle_stream) ||
-      !CU_add_test(pSuite, "session_repeated_priority_change",
+      !SERVER_TEST(pSuite, "session_flooding", test_nghttp2_session_flooding) ||
+      !CLIENT_SERVER_TEST(pSuite, "session_change_stream_priority",
+                          test_nghttp2_session_change_stream_priority) ||
+      !CLIENT_SERVER_TEST(pSuite, "session_create_idle_stream",
+                          test_nghttp2_session_create_idle_stream) ||
+#ifndef NGHTTP2_NO_REMOTE_PRIORITY
+      !SERVER_TEST(pSuite, "session_repeated_priority_change",
                    test_nghttp2_session_repeated_priority_change) ||
-      !CU_add_test(pSuite, "session_repeated_priority_submission",
+#endif /* !NGHTTP2_NO_REMOTE_PRIORITY */
+      !CLIENT_TEST(pSuite, "session_repeated_priority_submission",
                    test_nghttp2_session_repeated_priority_submission) ||
-      !CU_add_test(pSuite, "session_set_local_window_size",
+      !CLIENT_TEST(pSuite, "session_set_local_window_size",
                    test_nghttp2_session_set_local_window_size) ||
-      !CU_add_test(pSuite, "session_cancel_from_before_frame_send",
-                   test_nghttp2_session_cancel_from_before_frame_send) ||
-      !CU_add_test(pSuite, "session_too_many_settings",
+      !CLIENT_SERVER_TEST(pSuite, "session_cancel_from_before_frame_send",
+                          test_nghttp2_session_cancel_from_before_frame_send) ||
+      !CLIENT_TEST(pSuite, "session_too_many_settings",
                    test_nghttp2_session_too_many_settings) ||
-      !CU_add_test(pSuite, "session_removed_closed_stream",
+      !SERVER_TEST(pSuite, "session_removed_closed_stream",
                    test_nghttp2_session_removed_closed_stream) ||
-      !CU_add_test(pSuite, "session_pause_data",
+      !SERVER_TEST(pSuite, "session_pause_data",
                    test_nghttp2_session_pause_data) ||
-      !CU_add_test(pSuite, "session_no_closed_streams",
+      !SERVER_TEST(pSuite, "session_no_closed_streams",
                    test_nghttp2_session_no_closed_streams) ||
-      !CU_add_test(pSuite, "session_set_stream_user_data",
+      !CLIENT_TEST(pSuite, "session_set_stream_user_data",
                    test_nghttp2_session_set_stream_user_data) ||
-      !CU_add_test(pSuite, "http_mandatory_headers",
-                   test_nghttp2_http_mandatory_headers) ||
-      !CU_add_test(pSuite, "http_content_length",
-                   test_nghttp2_http_content_length) ||
-      !CU_add_test(pSuite, "http_content_length_mismatch",
-                   test_nghttp2_http_content_length_mismatch) ||
-      !CU_add_test(pSuite, "http_non_final_response",
+      !CLIENT_TEST(pSuite, "session_release_buffers",
+                   test_nghttp2_session_release_buffers) ||
+      !CLIENT_SERVER_TEST(pSuite, "http_mandatory_headers",
+                          test_nghttp2_http_mandatory_headers) ||
+      !CLIENT_SERVER_TEST(pSuite, "http_content_length",
+                          test_nghttp2_http_content_length) ||
+      !CLIENT_SERVER_TEST(pSuite, "http_content_length_mismatch",
+                          test_nghttp2_http_content_length_mismatch) ||
+      !CLIENT_TEST(pSuite, "http_non_final_response",
                    test_nghttp2_http_non_final_response) ||
-      !CU_add_test(pSuite, "http_trailer_headers",
+      !SERVER_TEST(pSuite, "http_trailer_headers",
                    test_nghttp2_http_trailer_headers) ||
-      !CU_add_test(pSuite, "http_ignore_regular_header",
+      !SERVER_TEST(pSuite, "http_ignore_regular_header",
                    test_nghttp2_http_ignore_regular_header) ||
-      !CU_add_test(pSuite, "http_ignore_content_length",
-                   test_nghttp2_http_ignore_content_length) ||
-      !CU_add_test(pSuite, "http_record_request_method",
+      !CLIENT_SERVER_TEST(pSuite, "http_ignore_content_length",
+                          test_nghttp2_http_ignore_content_length) ||
+      !CLIENT_TEST(pSuite, "http_record_request_method",
                    test_nghttp2_http_record_request_method) ||
-      !CU_add_test(pSuite, "http_push_promise",
+#ifndef NGHTTP2_NO_PUSH
+      !CLIENT_TEST(pSuite, "http_push_promise",
                    test_nghttp2_http_push_promise) ||
-      !CU_add_test(pSuite, "http_head_method_upgrade_workaround",
+#endif /* !NGHTTP2_NO_PUSH */
+      !CLIENT_TEST(pSuite, "http_head_method_upgrade_workaround",
                    test_nghttp2_http_head_method_upgrade_workaround) ||
       !CU_add_test(pSuite, "frame_pack_headers",
                    test_nghttp2_frame_pack_headers) ||
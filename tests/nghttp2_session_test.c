@@ -36,6 +36,11 @@
 #include "nghttp2_test_helper.h"
 #include "nghttp2_priority_spec.h"
 
+/* The number of SETTINGS entries which client adds to the ones given
+   by application until SETTINGS_ENABLE_PUSH = 0 is acknowledged.  It
+   is 1 if server push is compiled out. */
+#define CLIENT_EXTRA_NIV (NGHTTP2_PUSH_ENABLED ? 0 : 1)
+
 typedef struct {
   uint8_t buf[65535];
   size_t length;
@@ -1479,8 +1484,14 @@ void test_nghttp2_session_recv_headers_with_priority(void) {
 
   stream = nghttp2_session_get_stream(session, 3);
 
+#ifdef NGHTTP2_NO_REMOTE_PRIORITY
+  /* Priority given by client is ignored */
+  CU_ASSERT(NGHTTP2_DEFAULT_WEIGHT == stream->weight);
+  CU_ASSERT(0 == stream->dep_prev->stream_id);
+#else  /* !NGHTTP2_NO_REMOTE_PRIORITY */
   CU_ASSERT(99 == stream->weight);
   CU_ASSERT(1 == stream->dep_prev->stream_id);
+#endif /* !NGHTTP2_NO_REMOTE_PRIORITY */
 
   nghttp2_bufs_reset(&bufs);
 
@@ -1736,7 +1747,12 @@ void test_nghttp2_session_recv_headers_early_response(void) {
 
   stream = nghttp2_session_get_stream_raw(session, 1);
 
+#ifdef NGHTTP2_NO_REMOTE_PRIORITY
+  /* Closed stream is not retained */
+  CU_ASSERT(NULL == stream);
+#else  /* !NGHTTP2_NO_REMOTE_PRIORITY */
   CU_ASSERT(stream->flags & NGHTTP2_STREAM_FLAG_CLOSED);
+#endif /* !NGHTTP2_NO_REMOTE_PRIORITY */
 
   nghttp2_hd_deflate_free(&deflater);
   nghttp2_session_del(session);
@@ -1948,7 +1964,12 @@ void test_nghttp2_session_recv_premature_headers(void) {
 
   CU_ASSERT(NULL != item);
   CU_ASSERT(NGHTTP2_RST_STREAM == item->frame.hd.type);
+#ifdef NGHTTP2_NO_PUSH
+  /* Client without push refuses PUSH_PROMISE before decoding it */
+  CU_ASSERT(NGHTTP2_CANCEL == item->frame.rst_stream.error_code);
+#else  /* !NGHTTP2_NO_PUSH */
   CU_ASSERT(NGHTTP2_COMPRESSION_ERROR == item->frame.rst_stream.error_code);
+#endif /* !NGHTTP2_NO_PUSH */
   CU_ASSERT(2 == item->frame.hd.stream_id);
   CU_ASSERT(0 == nghttp2_session_send(session));
 
@@ -2935,7 +2956,11 @@ void test_nghttp2_session_on_request_headers_received(void) {
   CU_ASSERT(1 == user_data.begin_headers_cb_called);
   stream = nghttp2_session_get_stream(session, stream_id);
   CU_ASSERT(NGHTTP2_STREAM_OPENING == stream->state);
+#ifdef NGHTTP2_NO_REMOTE_PRIORITY
+  CU_ASSERT(NGHTTP2_DEFAULT_WEIGHT == stream->weight);
+#else  /* !NGHTTP2_NO_REMOTE_PRIORITY */
   CU_ASSERT(255 == stream->weight);
+#endif /* !NGHTTP2_NO_REMOTE_PRIORITY */
 
   nghttp2_frame_headers_free(&frame.headers, mem);
 
@@ -3092,7 +3117,12 @@ void test_nghttp2_session_on_request_headers_received(void) {
 
   CU_ASSERT(NGHTTP2_ERR_IGN_HEADER_BLOCK ==
             nghttp2_session_on_request_headers_received(session, &frame));
+#ifdef NGHTTP2_NO_REMOTE_PRIORITY
+  /* Closed stream is not retained, and HEADERS is just ignored */
+  CU_ASSERT(0 == (session->goaway_flags & NGHTTP2_GOAWAY_TERM_ON_SEND));
+#else  /* !NGHTTP2_NO_REMOTE_PRIORITY */
   CU_ASSERT(session->goaway_flags & NGHTTP2_GOAWAY_TERM_ON_SEND);
+#endif /* !NGHTTP2_NO_REMOTE_PRIORITY */
 
   nghttp2_frame_headers_free(&frame.headers, mem);
 
@@ -3289,6 +3319,27 @@ void test_nghttp2_session_on_priority_received(void) {
   /* depend on stream 0 */
   CU_ASSERT(0 == nghttp2_session_on_priority_received(session, &frame));
 
+#ifdef NGHTTP2_NO_REMOTE_PRIORITY
+  /* PRIORITY from client is ignored */
+  CU_ASSERT(NGHTTP2_DEFAULT_WEIGHT == stream->weight);
+
+  stream = open_sent_stream(session, 2);
+  dep_stream = open_recv_stream(session, 3);
+
+  frame.hd.stream_id = 2;
+
+  nghttp2_priority_spec_init(&frame.priority.pri_spec, 3, 1, 0);
+
+  CU_ASSERT(0 == nghttp2_session_on_priority_received(session, &frame));
+  CU_ASSERT(dep_stream != stream->dep_prev);
+
+  /* PRIORITY against idle stream does not create stream */
+  frame.hd.stream_id = 100;
+
+  CU_ASSERT(0 == nghttp2_session_on_priority_received(session, &frame));
+  CU_ASSERT(NULL ==
+            nghttp2_session_get_stream_raw(session, frame.hd.stream_id));
+#else  /* !NGHTTP2_NO_REMOTE_PRIORITY */
   CU_ASSERT(2 == stream->weight);
 
   stream = open_sent_stream(session, 2);
@@ -3312,6 +3363,7 @@ void test_nghttp2_session_on_priority_received(void) {
 
   CU_ASSERT(NGHTTP2_STREAM_IDLE == stream->state);
   CU_ASSERT(dep_stream == stream->dep_prev);
+#endif /* !NGHTTP2_NO_REMOTE_PRIORITY */
 
   nghttp2_frame_priority_free(&frame.priority);
   nghttp2_session_del(session);
@@ -4112,8 +4164,13 @@ void test_nghttp2_session_on_data_received_fail_fast(void) {
 
   item = nghttp2_session_get_next_ob_item(session);
 
+#ifdef NGHTTP2_NO_REMOTE_PRIORITY
+  /* Closed stream is not retained, and DATA is just ignored */
+  CU_ASSERT(NULL == item);
+#else  /* !NGHTTP2_NO_REMOTE_PRIORITY */
   CU_ASSERT(NULL != item);
   CU_ASSERT(NGHTTP2_GOAWAY == item->frame.hd.type);
+#endif /* !NGHTTP2_NO_REMOTE_PRIORITY */
 
   nghttp2_session_del(session);
 }
@@ -4556,7 +4613,7 @@ void test_nghttp2_session_upgrade2(void) {
   CU_ASSERT(NGHTTP2_SHUT_WR == stream->shut_flags);
   item = nghttp2_session_get_next_ob_item(session);
   CU_ASSERT(NGHTTP2_SETTINGS == item->frame.hd.type);
-  CU_ASSERT(2 == item->frame.settings.niv);
+  CU_ASSERT(2 + CLIENT_EXTRA_NIV == item->frame.settings.niv);
   CU_ASSERT(NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS ==
             item->frame.settings.iv[0].settings_id);
   CU_ASSERT(1 == item->frame.settings.iv[0].value);
@@ -5124,6 +5181,84 @@ void test_nghttp2_submit_request_without_data(void) {
   nghttp2_session_del(session);
 }
 
+void test_nghttp2_submit_request_rcnv(void) {
+  nghttp2_session *session;
+  nghttp2_session_callbacks callbacks;
+  accumulator acc;
+  nghttp2_outbound_item *item;
+  my_user_data ud;
+  nghttp2_hd_inflater inflater;
+  nva_out out;
+  nghttp2_bufs bufs;
+  nghttp2_mem *mem;
+  nghttp2_rcnv rcnva[ARRLEN(reqnv)];
+  size_t i;
+
+  mem = nghttp2_mem_default();
+  frame_pack_bufs_init(&bufs);
+
+  for (i = 0; i < ARRLEN(reqnv); ++i) {
+    nghttp2_rcbuf_new2(&rcnva[i].name, reqnv[i].name, reqnv[i].namelen, mem);
+    nghttp2_rcbuf_new2(&rcnva[i].value, reqnv[i].value, reqnv[i].valuelen,
+                       mem);
+    rcnva[i].flags = NGHTTP2_NV_FLAG_NONE;
+  }
+
+  nva_out_init(&out);
+  acc.length = 0;
+  ud.acc = &acc;
+  memset(&callbacks, 0, sizeof(nghttp2_session_callbacks));
+  callbacks.send_callback = accumulator_send_callback;
+  CU_ASSERT(0 == nghttp2_session_client_new(&session, &callbacks, &ud));
+
+  nghttp2_hd_inflate_init(&inflater, mem);
+  CU_ASSERT(1 == nghttp2_submit_request_rcnv(session, NULL, rcnva,
+                                             ARRLEN(rcnva), NULL, NULL));
+  item = nghttp2_session_get_next_ob_item(session);
+  CU_ASSERT(ARRLEN(reqnv) == item->frame.headers.nvlen);
+  assert_nv_equal(reqnv, item->frame.headers.nva, item->frame.headers.nvlen,
+                  mem);
+  CU_ASSERT(item->frame.hd.flags & NGHTTP2_FLAG_END_STREAM);
+
+  for (i = 0; i < ARRLEN(rcnva); ++i) {
+    CU_ASSERT(2 == rcnva[i].name->ref);
+    CU_ASSERT(2 == rcnva[i].value->ref);
+    CU_ASSERT(rcnva[i].name->base == item->frame.headers.nva[i].name);
+    CU_ASSERT(rcnva[i].value->base == item->frame.headers.nva[i].value);
+  }
+
+  CU_ASSERT(0 == nghttp2_session_send(session));
+
+  for (i = 0; i < ARRLEN(rcnva); ++i) {
+    CU_ASSERT(1 == rcnva[i].name->ref);
+    CU_ASSERT(1 == rcnva[i].value->ref);
+  }
+
+  nghttp2_bufs_add(&bufs, acc.buf, acc.length);
+  inflate_hd(&inflater, &out, &bufs, NGHTTP2_FRAME_HDLEN, mem);
+
+  CU_ASSERT(ARRLEN(reqnv) == out.nvlen);
+  assert_nv_equal(reqnv, out.nva, out.nvlen, mem);
+  nva_out_reset(&out, mem);
+
+  /* References are released if the frame is never sent */
+  CU_ASSERT(3 == nghttp2_submit_request_rcnv(session, NULL, rcnva,
+                                             ARRLEN(rcnva), NULL, NULL));
+  CU_ASSERT(2 == rcnva[0].name->ref);
+
+  nghttp2_session_del(session);
+
+  for (i = 0; i < ARRLEN(rcnva); ++i) {
+    CU_ASSERT(1 == rcnva[i].name->ref);
+    CU_ASSERT(1 == rcnva[i].value->ref);
+    nghttp2_rcbuf_decref(rcnva[i].name);
+    nghttp2_rcbuf_decref(rcnva[i].value);
+  }
+
+  nghttp2_bufs_free(&bufs);
+  nghttp2_hd_inflate_free(&inflater);
+}
+
 void test_nghttp2_submit_response_with_data(void) {
   nghttp2_session *session;
   nghttp2_session_callbacks callbacks;
@@ -5215,6 +5350,61 @@ void test_nghttp2_submit_response_without_data(void) {
   nghttp2_session_del(session);
 }
 
+void test_nghttp2_submit_response_rcnv(void) {
+  nghttp2_session *session;
+  nghttp2_session_callbacks callbacks;
+  accumulator acc;
+  my_user_data ud;
+  nghttp2_hd_inflater inflater;
+  nva_out out;
+  nghttp2_bufs bufs;
+  nghttp2_mem *mem;
+  nghttp2_rcnv rcnva[ARRLEN(resnv)];
+  size_t i;
+
+  mem = nghttp2_mem_default();
+  frame_pack_bufs_init(&bufs);
+
+  for (i = 0; i < ARRLEN(resnv); ++i) {
+    nghttp2_rcbuf_new2(&rcnva[i].name, resnv[i].name, resnv[i].namelen, mem);
+    nghttp2_rcbuf_new2(&rcnva[i].value, resnv[i].value, resnv[i].valuelen,
+                       mem);
+    rcnva[i].flags = NGHTTP2_NV_FLAG_NONE;
+  }
+
+  nva_out_init(&out);
+  acc.length = 0;
+  ud.acc = &acc;
+  memset(&callbacks, 0, sizeof(nghttp2_session_callbacks));
+  callbacks.send_callback = accumulator_send_callback;
+  CU_ASSERT(0 == nghttp2_session_server_new(&session, &callbacks, &ud));
+
+  nghttp2_hd_inflate_init(&inflater, mem);
+  open_recv_stream2(session, 1, NGHTTP2_STREAM_OPENING);
+
+  CU_ASSERT(0 == nghttp2_submit_response_rcnv(session, 1, rcnva,
+                                              ARRLEN(rcnva), NULL));
+
+  /* The library holds its own references */
+  for (i = 0; i < ARRLEN(rcnva); ++i) {
+    nghttp2_rcbuf_decref(rcnva[i].name);
+    nghttp2_rcbuf_decref(rcnva[i].value);
+  }
+
+  CU_ASSERT(0 == nghttp2_session_send(session));
+
+  nghttp2_bufs_add(&bufs, acc.buf, acc.length);
+  inflate_hd(&inflater, &out, &bufs, NGHTTP2_FRAME_HDLEN, mem);
+
+  CU_ASSERT(ARRLEN(resnv) == out.nvlen);
+  assert_nv_equal(resnv, out.nva, out.nvlen, mem);
+
+  nva_out_reset(&out, mem);
+  nghttp2_bufs_free(&bufs);
+  nghttp2_hd_inflate_free(&inflater);
+  nghttp2_session_del(session);
+}
+
 void test_nghttp2_submit_response_push_response(void) {
   nghttp2_session *session;
   nghttp2_session_callbacks callbacks;
@@ -5309,6 +5499,100 @@ void test_nghttp2_submit_trailer(void) {
   nghttp2_session_del(session);
 }
 
+void test_nghttp2_submit_trailer_rcnv(void) {
+  nghttp2_session *session;
+  nghttp2_session_callbacks callbacks;
+  accumulator acc;
+  nghttp2_data_provider data_prd;
+  nghttp2_outbound_item *item;
+  my_user_data ud;
+  nghttp2_hd_inflater inflater;
+  nva_out out;
+  nghttp2_bufs bufs;
+  nghttp2_mem *mem;
+  nghttp2_rcnv rcnva[ARRLEN(trailernv)];
+  size_t i;
+
+  mem = nghttp2_mem_default();
+  frame_pack_bufs_init(&bufs);
+
+  for (i = 0; i < ARRLEN(trailernv); ++i) {
+    nghttp2_rcbuf_new2(&rcnva[i].name, trailernv[i].name, trailernv[i].namelen,
+                       mem);
+    nghttp2_rcbuf_new2(&rcnva[i].value, trailernv[i].value,
+                       trailernv[i].valuelen, mem);
+    rcnva[i].flags = NGHTTP2_NV_FLAG_NONE;
+  }
+
+  data_prd.read_callback = no_end_stream_data_source_read_callback;
+  nva_out_init(&out);
+  acc.length = 0;
+  ud.acc = &acc;
+  memset(&callbacks, 0, sizeof(nghttp2_session_callbacks));
+  callbacks.send_callback = null_send_callback;
+  CU_ASSERT(0 == nghttp2_session_server_new(&session, &callbacks, &ud));
+
+  nghttp2_hd_inflate_init(&inflater, mem);
+  open_recv_stream2(session, 1, NGHTTP2_STREAM_OPENING);
+  CU_ASSERT(0 == nghttp2_submit_response(session, 1, resnv, ARRLEN(resnv),
+                                         &data_prd));
+  CU_ASSERT(0 == nghttp2_session_send(session));
+
+  CU_ASSERT(0 == nghttp2_submit_trailer_rcnv(session, 1, rcnva,
+                                             ARRLEN(rcnva)));
+
+  item = nghttp2_session_get_next_ob_item(session);
+  CU_ASSERT(NGHTTP2_HEADERS == item->frame.hd.type);
+  CU_ASSERT(NGHTTP2_HCAT_HEADERS == item->frame.headers.cat);
+  CU_ASSERT(item->frame.hd.flags & NGHTTP2_FLAG_END_STREAM);
+
+  for (i = 0; i < ARRLEN(rcnva); ++i) {
+    CU_ASSERT(2 == rcnva[i].name->ref);
+    CU_ASSERT(2 == rcnva[i].value->ref);
+    CU_ASSERT(rcnva[i].name->base == item->frame.headers.nva[i].name);
+    CU_ASSERT(rcnva[i].value->base == item->frame.headers.nva[i].value);
+  }
+
+  session->callbacks.send_callback = accumulator_send_callback;
+
+  CU_ASSERT(0 == nghttp2_session_send(session));
+
+  for (i = 0; i < ARRLEN(rcnva); ++i) {
+    CU_ASSERT(1 == rcnva[i].name->ref);
+    CU_ASSERT(1 == rcnva[i].value->ref);
+  }
+
+  nghttp2_bufs_add(&bufs, acc.buf, acc.length);
+  inflate_hd(&inflater, &out, &bufs, NGHTTP2_FRAME_HDLEN, mem);
+
+  CU_ASSERT(ARRLEN(trailernv) == out.nvlen);
+  assert_nv_equal(trailernv, out.nva, out.nvlen, mem);
+
+  nva_out_reset(&out, mem);
+  nghttp2_bufs_free(&bufs);
+  nghttp2_hd_inflate_free(&inflater);
+  nghttp2_session_del(session);
+
+  /* Specifying stream ID <= 0 is error, and no reference is taken */
+  nghttp2_session_server_new(&session, &callbacks, NULL);
+  open_recv_stream(session, 1);
+
+  CU_ASSERT(NGHTTP2_ERR_INVALID_ARGUMENT ==
+            nghttp2_submit_trailer_rcnv(session, 0, rcnva, ARRLEN(rcnva)));
+
+  CU_ASSERT(NGHTTP2_ERR_INVALID_ARGUMENT ==
+            nghttp2_submit_trailer_rcnv(session, -1, rcnva, ARRLEN(rcnva)));
+
+  CU_ASSERT(1 == rcnva[0].name->ref);
+
+  nghttp2_session_del(session);
+
+  for (i = 0; i < ARRLEN(rcnva); ++i) {
+    nghttp2_rcbuf_decref(rcnva[i].name);
+    nghttp2_rcbuf_decref(rcnva[i].value);
+  }
+}
+
 void test_nghttp2_submit_headers_start_stream(void) {
   nghttp2_session *session;
   nghttp2_session_callbacks callbacks;
@@ -5515,6 +5799,136 @@ void test_nghttp2_submit_headers(void) {
   nghttp2_session_del(session);
 }
 
+void test_nghttp2_submit_headers_rcnv(void) {
+  nghttp2_session *session;
+  nghttp2_session_callbacks callbacks;
+  my_user_data ud;
+  nghttp2_outbound_item *item;
+  nghttp2_stream *stream;
+  accumulator acc;
+  nghttp2_hd_inflater inflater;
+  nva_out out;
+  nghttp2_bufs bufs;
+  nghttp2_mem *mem;
+  nghttp2_priority_spec pri_spec;
+  nghttp2_rcnv rcnva[ARRLEN(reqnv)];
+  size_t i;
+
+  mem = nghttp2_mem_default();
+  frame_pack_bufs_init(&bufs);
+
+  for (i = 0; i < ARRLEN(reqnv); ++i) {
+    nghttp2_rcbuf_new2(&rcnva[i].name, reqnv[i].name, reqnv[i].namelen, mem);
+    nghttp2_rcbuf_new2(&rcnva[i].value, reqnv[i].value, reqnv[i].valuelen,
+                       mem);
+    rcnva[i].flags = NGHTTP2_NV_FLAG_NONE;
+  }
+
+  nva_out_init(&out);
+  acc.length = 0;
+  ud.acc = &acc;
+  memset(&callbacks, 0, sizeof(nghttp2_session_callbacks));
+  callbacks.send_callback = accumulator_send_callback;
+  callbacks.on_frame_send_callback = on_frame_send_callback;
+
+  CU_ASSERT(0 == nghttp2_session_client_new(&session, &callbacks, &ud));
+
+  nghttp2_hd_inflate_init(&inflater, mem);
+
+  /* New stream */
+  CU_ASSERT(1 == nghttp2_submit_headers_rcnv(session, NGHTTP2_FLAG_NONE, -1,
+                                             NULL, rcnva, ARRLEN(rcnva),
+                                             NULL));
+  item = nghttp2_session_get_next_ob_item(session);
+  CU_ASSERT(ARRLEN(reqnv) == item->frame.headers.nvlen);
+  assert_nv_equal(reqnv, item->frame.headers.nva, item->frame.headers.nvlen,
+                  mem);
+  CU_ASSERT(NGHTTP2_FLAG_END_HEADERS == item->frame.hd.flags);
+
+  for (i = 0; i < ARRLEN(rcnva); ++i) {
+    CU_ASSERT(2 == rcnva[i].name->ref);
+    CU_ASSERT(2 == rcnva[i].value->ref);
+  }
+
+  ud.frame_send_cb_called = 0;
+  CU_ASSERT(0 == nghttp2_session_send(session));
+  CU_ASSERT(1 == ud.frame_send_cb_called);
+
+  for (i = 0; i < ARRLEN(rcnva); ++i) {
+    CU_ASSERT(1 == rcnva[i].name->ref);
+    CU_ASSERT(1 == rcnva[i].value->ref);
+  }
+
+  nghttp2_bufs_add(&bufs, acc.buf, acc.length);
+  inflate_hd(&inflater, &out, &bufs, NGHTTP2_FRAME_HDLEN, mem);
+
+  CU_ASSERT(ARRLEN(reqnv) == out.nvlen);
+  assert_nv_equal(reqnv, out.nva, out.nvlen, mem);
+
+  nva_out_reset(&out, mem);
+  nghttp2_bufs_reset(&bufs);
+  acc.length = 0;
+
+  /* HEADERS on an existing stream with END_STREAM */
+  stream = nghttp2_session_get_stream(session, 1);
+
+  CU_ASSERT(0 == nghttp2_submit_headers_rcnv(session, NGHTTP2_FLAG_END_STREAM,
+                                             1, NULL, rcnva, ARRLEN(rcnva),
+                                             NULL));
+  ud.frame_send_cb_called = 0;
+  CU_ASSERT(0 == nghttp2_session_send(session));
+  CU_ASSERT(1 == ud.frame_send_cb_called);
+  CU_ASSERT(stream->shut_flags & NGHTTP2_SHUT_WR);
+
+  nghttp2_bufs_add(&bufs, acc.buf, acc.length);
+  inflate_hd(&inflater, &out, &bufs, NGHTTP2_FRAME_HDLEN, mem);
+
+  CU_ASSERT(ARRLEN(reqnv) == out.nvlen);
+  assert_nv_equal(reqnv, out.nva, out.nvlen, mem);
+
+  nva_out_reset(&out, mem);
+  nghttp2_bufs_free(&bufs);
+  nghttp2_hd_inflate_free(&inflater);
+
+  /* Try to depend on itself */
+  nghttp2_priority_spec_init(&pri_spec, 3, 16, 0);
+
+  CU_ASSERT(NGHTTP2_ERR_INVALID_ARGUMENT ==
+            nghttp2_submit_headers_rcnv(session, NGHTTP2_FLAG_NONE, 3,
+                                        &pri_spec, rcnva, ARRLEN(rcnva),
+                                        NULL));
+
+  /* References are released if the frame is never sent */
+  CU_ASSERT(3 == nghttp2_submit_headers_rcnv(session, NGHTTP2_FLAG_NONE, -1,
+                                             NULL, rcnva, ARRLEN(rcnva),
+                                             NULL));
+  CU_ASSERT(2 == rcnva[0].name->ref);
+
+  nghttp2_session_del(session);
+
+  CU_ASSERT(1 == rcnva[0].name->ref);
+
+  /* Error cases with invalid stream ID */
+  nghttp2_session_server_new(&session, &callbacks, NULL);
+
+  CU_ASSERT(NGHTTP2_ERR_PROTO ==
+            nghttp2_submit_headers_rcnv(session, NGHTTP2_FLAG_NONE, -1, NULL,
+                                        rcnva, ARRLEN(rcnva), NULL));
+
+  CU_ASSERT(NGHTTP2_ERR_INVALID_ARGUMENT ==
+            nghttp2_submit_headers_rcnv(session, NGHTTP2_FLAG_NONE, 0, NULL,
+                                        rcnva, ARRLEN(rcnva), NULL));
+
+  nghttp2_session_del(session);
+
+  for (i = 0; i < ARRLEN(rcnva); ++i) {
+    CU_ASSERT(1 == rcnva[i].name->ref);
+    CU_ASSERT(1 == rcnva[i].value->ref);
+    nghttp2_rcbuf_decref(rcnva[i].name);
+    nghttp2_rcbuf_decref(rcnva[i].value);
+  }
+}
+
 void test_nghttp2_submit_headers_continuation(void) {
   nghttp2_session *session;
   nghttp2_session_callbacks callbacks;
@@ -5868,7 +6282,7 @@ void test_nghttp2_submit_settings_multiple_times(void) {
   CU_ASSERT(NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS ==
             inflight_settings->iv[0].settings_id);
   CU_ASSERT(99 == inflight_settings->iv[0].value);
-  CU_ASSERT(1 == inflight_settings->niv);
+  CU_ASSERT(1 + CLIENT_EXTRA_NIV == inflight_settings->niv);
   CU_ASSERT(NULL == inflight_settings->next);
 
   CU_ASSERT(99 == session->pending_local_max_concurrent_stream);
@@ -5886,7 +6300,7 @@ void test_nghttp2_submit_settings_multiple_times(void) {
   CU_ASSERT(NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS ==
             inflight_settings->iv[0].settings_id);
   CU_ASSERT(99 == inflight_settings->iv[0].value);
-  CU_ASSERT(1 == inflight_settings->niv);
+  CU_ASSERT(1 + CLIENT_EXTRA_NIV == inflight_settings->niv);
   CU_ASSERT(NULL == inflight_settings->next);
 
   CU_ASSERT(100 == session->local_settings.max_concurrent_streams);
@@ -5900,6 +6314,67 @@ void test_nghttp2_submit_settings_multiple_times(void) {
   nghttp2_session_del(session);
 }
 
+void test_nghttp2_submit_settings_enable_push(void) {
+  nghttp2_session *session;
+  nghttp2_session_callbacks callbacks;
+  nghttp2_settings_entry iv;
+  nghttp2_outbound_item *item;
+  nghttp2_frame frame;
+
+  memset(&callbacks, 0, sizeof(callbacks));
+  callbacks.send_callback = null_send_callback;
+
+  nghttp2_session_client_new(&session, &callbacks, NULL);
+
+  iv.settings_id = NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS;
+  iv.value = 100;
+
+  CU_ASSERT(0 == nghttp2_submit_settings(session, NGHTTP2_FLAG_NONE, &iv, 1));
+
+  item = nghttp2_session_get_next_ob_item(session);
+
+  CU_ASSERT(NGHTTP2_SETTINGS == item->frame.hd.type);
+  CU_ASSERT(1 + CLIENT_EXTRA_NIV == item->frame.settings.niv);
+  CU_ASSERT(NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS ==
+            item->frame.settings.iv[0].settings_id);
+#ifdef NGHTTP2_NO_PUSH
+  /* Client without push tells server not to push */
+  CU_ASSERT(NGHTTP2_SETTINGS_ENABLE_PUSH ==
+            item->frame.settings.iv[1].settings_id);
+  CU_ASSERT(0 == item->frame.settings.iv[1].value);
+#endif /* NGHTTP2_NO_PUSH */
+
+  CU_ASSERT(0 == nghttp2_session_send(session));
+
+  nghttp2_frame_settings_init(&frame.settings, NGHTTP2_FLAG_ACK, NULL, 0);
+
+  CU_ASSERT(0 == nghttp2_session_on_settings_received(session, &frame, 0));
+  CU_ASSERT(NGHTTP2_PUSH_ENABLED == session->local_settings.enable_push);
+
+  /* Once acknowledged, SETTINGS_ENABLE_PUSH is not added again */
+  CU_ASSERT(0 == nghttp2_submit_settings(session, NGHTTP2_FLAG_NONE, &iv, 1));
+
+  item = nghttp2_session_get_next_ob_item(session);
+
+  CU_ASSERT(1 == item->frame.settings.niv);
+
+  CU_ASSERT(0 == nghttp2_session_send(session));
+  CU_ASSERT(0 == nghttp2_session_on_settings_received(session, &frame, 0));
+
+  /* SETTINGS_ENABLE_PUSH = 1 given by application */
+  iv.settings_id = NGHTTP2_SETTINGS_ENABLE_PUSH;
+  iv.value = 1;
+
+  CU_ASSERT(0 == nghttp2_submit_settings(session, NGHTTP2_FLAG_NONE, &iv, 1));
+
+  item = nghttp2_session_get_next_ob_item(session);
+
+  CU_ASSERT(1 == item->frame.settings.niv);
+  CU_ASSERT(NGHTTP2_PUSH_ENABLED == item->frame.settings.iv[0].value);
+
+  nghttp2_session_del(session);
+}
+
 void test_nghttp2_submit_push_promise(void) {
   nghttp2_session *session;
   nghttp2_session_callbacks callbacks;
@@ -6154,12 +6629,14 @@ void test_nghttp2_submit_invalid_nv(void) {
   CU_ASSERT(0 == nghttp2_submit_response(session, 2, empty_name_nv,
                                          ARRLEN(empty_name_nv), NULL));
 
+#ifndef NGHTTP2_NO_PUSH
   /* nghttp2_submit_push_promise */
   open_recv_stream(session, 1);
 
   CU_ASSERT(0 < nghttp2_submit_push_promise(session, NGHTTP2_FLAG_NONE, 1,
                                             empty_name_nv,
                                             ARRLEN(empty_name_nv), NULL));
+#endif /* !NGHTTP2_NO_PUSH */
 
   nghttp2_session_del(session);
 
@@ -9601,6 +10078,7 @@ void test_nghttp2_session_on_header_temporal_failure(void) {
 
   nghttp2_bufs_reset(&bufs);
 
+#ifndef NGHTTP2_NO_PUSH
   /* Check for PUSH_PROMISE */
   nghttp2_hd_deflate_init(&deflater, mem);
   nghttp2_session_client_new(&session, &callbacks, &ud);
@@ -9624,6 +10102,7 @@ void test_nghttp2_session_on_header_temporal_failure(void) {
 
   nghttp2_session_del(session);
   nghttp2_hd_deflate_free(&deflater);
+#endif /* !NGHTTP2_NO_PUSH */
   nghttp2_bufs_free(&bufs);
 }
 
@@ -9965,6 +10444,7 @@ void test_nghttp2_session_on_begin_headers_temporal_failure(void) {
   nghttp2_hd_deflate_free(&deflater);
 
   nghttp2_bufs_reset(&bufs);
+#ifndef NGHTTP2_NO_PUSH
   /* check for PUSH_PROMISE */
   nghttp2_hd_deflate_init(&deflater, mem);
   nghttp2_session_client_new(&session, &callbacks, &ud);
@@ -9990,6 +10470,7 @@ void test_nghttp2_session_on_begin_headers_temporal_failure(void) {
 
   nghttp2_session_del(session);
   nghttp2_hd_deflate_free(&deflater);
+#endif /* !NGHTTP2_NO_PUSH */
   nghttp2_bufs_free(&bufs);
 }
 
@@ -10688,6 +11169,7 @@ void test_nghttp2_session_cancel_from_before_frame_send(void) {
 
   nghttp2_session_del(session);
 
+#ifndef NGHTTP2_NO_PUSH
   nghttp2_session_server_new(&session, &callbacks, &ud);
 
   open_recv_stream(session, 1);
@@ -10713,6 +11195,7 @@ void test_nghttp2_session_cancel_from_before_frame_send(void) {
   CU_ASSERT(NULL == stream);
 
   nghttp2_session_del(session);
+#endif /* !NGHTTP2_NO_PUSH */
 }
 
 void test_nghttp2_session_too_many_settings(void) {
@@ -11055,6 +11538,56 @@ void test_nghttp2_session_set_stream_user_data(void) {
   nghttp2_session_del(session);
 }
 
+void test_nghttp2_session_release_buffers(void) {
+  nghttp2_session *session;
+  nghttp2_session_callbacks callbacks;
+  int32_t stream_id;
+  const uint8_t *datap;
+  ssize_t datalen;
+
+  memset(&callbacks, 0, sizeof(nghttp2_session_callbacks));
+
+  nghttp2_session_client_new(&session, &callbacks, NULL);
+
+  stream_id = nghttp2_submit_request(session, NULL, reqnv, ARRLEN(reqnv), NULL,
+                                     NULL);
+
+  CU_ASSERT(stream_id > 0);
+
+  /* The data are serialized, but not sent yet. */
+  datalen = nghttp2_session_mem_send(session, &datap);
+
+  CU_ASSERT(datalen > 0);
+  CU_ASSERT(NGHTTP2_ERR_INVALID_STATE ==
+            nghttp2_session_release_buffers(session));
+
+  while ((datalen = nghttp2_session_mem_send(session, &datap)) > 0)
+    ;
+
+  CU_ASSERT(0 == datalen);
+  CU_ASSERT(0 == nghttp2_session_release_buffers(session));
+  CU_ASSERT(NULL == session->aob.framebufs.head);
+
+  /* Releasing again is fine. */
+  CU_ASSERT(0 == nghttp2_session_release_buffers(session));
+
+  /* Nothing to send, and the buffer is not allocated. */
+  datalen = nghttp2_session_mem_send(session, &datap);
+
+  CU_ASSERT(0 == datalen);
+  CU_ASSERT(NULL == session->aob.framebufs.head);
+
+  CU_ASSERT(0 == nghttp2_submit_ping(session, NGHTTP2_FLAG_NONE, NULL));
+
+  datalen = nghttp2_session_mem_send(session, &datap);
+
+  CU_ASSERT(NGHTTP2_FRAME_HDLEN + 8 == datalen);
+  CU_ASSERT(NGHTTP2_PING == datap[3]);
+  CU_ASSERT(NULL != session->aob.framebufs.head);
+
+  nghttp2_session_del(session);
+}
+
 static void check_nghttp2_http_recv_headers_fail(
     nghttp2_session *session, nghttp2_hd_deflater *deflater, int32_t stream_id,
     int stream_state, const nghttp2_nv *nva, size_t nvlen) {
@@ -81,20 +81,25 @@ void test_nghttp2_submit_data_read_length_smallest(void);
 void test_nghttp2_submit_data_twice(void);
 void test_nghttp2_submit_request_with_data(void);
 void test_nghttp2_submit_request_without_data(void);
+void test_nghttp2_submit_request_rcnv(void);
 void test_nghttp2_submit_response_with_data(void);
 void test_nghttp2_submit_response_without_data(void);
+void test_nghttp2_submit_response_rcnv(void);
 void test_nghttp2_submit_response_push_response(void);
 void test_nghttp2_submit_trailer(void);
+void test_nghttp2_submit_trailer_rcnv(void);
 void test_nghttp2_submit_headers_start_stream(void);
 void test_nghttp2_submit_headers_reply(void);
 void test_nghttp2_submit_headers_push_reply(void);
 void test_nghttp2_submit_headers(void);
+void test_nghttp2_submit_headers_rcnv(void);
 void test_nghttp2_submit_headers_continuation(void);
 void test_nghttp2_submit_headers_continuation_extra_large(void);
 void test_nghttp2_submit_priority(void);
 void test_nghttp2_submit_settings(void);
 void test_nghttp2_submit_settings_update_local_window_size(void);
 void test_nghttp2_submit_settings_multiple_times(void);
+void test_nghttp2_submit_settings_enable_push(void);
 void test_nghttp2_submit_push_promise(void);
 void test_nghttp2_submit_window_update(void);
 void test_nghttp2_submit_window_update_local_window_size(void);
@@ -162,6 +167,7 @@ void test_nghttp2_session_removed_closed_stream(void);
 void test_nghttp2_session_pause_data(void);
 void test_nghttp2_session_no_closed_streams(void);
 void test_nghttp2_session_set_stream_user_data(void);
+void test_nghttp2_session_release_buffers(void);
 void test_nghttp2_http_mandatory_headers(void);
 void test_nghttp2_http_content_length(void);
 void test_nghttp2_http_content_length_mismatch(void);
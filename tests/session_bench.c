@@ -0,0 +1,455 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Micro benchmark of nghttp2_session.  It replays prerecorded HTTP/2
+ * traffic through a server session, which is what nghttpx frontend
+ * does, and through a client session, which is what nghttpx backend
+ * does, and reports the cost per request.
+ *
+ * To see the effect of the build time specializations, build this
+ * program against the default library and against the specialized
+ * one, and compare the numbers:
+ *
+ *   $ cmake -DENABLE_LIB_ONLY=1 -DENABLE_LIB_SERVER_ONLY=1 \
+ *       -DENABLE_LIB_PUSH=0 -DENABLE_LIB_REMOTE_PRIORITY=0 \
+ *       -DENABLE_LIB_EXTENSIONS=0 .
+ *   $ make session_bench && tests/session_bench
+ *
+ * Instructions are counted with perf_event_open(2) if the system
+ * supports it.  CPU time is always reported.
+ */
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __linux__
+#  include <linux/perf_event.h>
+#  include <sys/ioctl.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+#endif /* __linux__ */
+
+#include <nghttp2/nghttp2.h>
+
+#define MAKE_NV(NAME, VALUE)                                                   \
+  {                                                                            \
+    (uint8_t *)(NAME), (uint8_t *)(VALUE), sizeof(NAME) - 1,                   \
+        sizeof(VALUE) - 1, NGHTTP2_NV_FLAG_NONE                                \
+  }
+
+#define ARRLEN(ARR) (sizeof(ARR) / sizeof(ARR[0]))
+
+/* The number of requests per connection */
+#define NUM_STREAMS 100
+/* The length of response body */
+#define BODYLEN 100
+
+static nghttp2_nv reqnv[] = {
+    MAKE_NV(":method", "GET"),
+    MAKE_NV(":scheme", "https"),
+    MAKE_NV(":authority", "example.org"),
+    MAKE_NV(":path", "/index.html"),
+    MAKE_NV("user-agent", "session_bench"),
+    MAKE_NV("accept", "*/*"),
+    MAKE_NV("accept-encoding", "gzip, deflate, br"),
+};
+
+static nghttp2_nv resnv[] = {
+    MAKE_NV(":status", "200"),
+    MAKE_NV("content-type", "text/html"),
+    MAKE_NV("content-length", "100"),
+    MAKE_NV("cache-control", "max-age=3600"),
+};
+
+static uint8_t body[BODYLEN];
+
+typedef struct {
+  uint8_t *data;
+  size_t len;
+  size_t cap;
+} buffer;
+
+static void buffer_add(buffer *buf, const uint8_t *data, size_t len) {
+  if (buf->len + len > buf->cap) {
+    buf->cap = (buf->len + len) * 2;
+    buf->data = realloc(buf->data, buf->cap);
+    if (buf->data == NULL) {
+      fprintf(stderr, "out of memory\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+  memcpy(buf->data + buf->len, data, len);
+  buf->len += len;
+}
+
+static void add_frame_hd(buffer *buf, size_t length, uint8_t type,
+                         uint8_t flags, int32_t stream_id) {
+  uint8_t hd[9];
+
+  hd[0] = (uint8_t)(length >> 16);
+  hd[1] = (uint8_t)(length >> 8);
+  hd[2] = (uint8_t)length;
+  hd[3] = type;
+  hd[4] = flags;
+  hd[5] = (uint8_t)(stream_id >> 24);
+  hd[6] = (uint8_t)(stream_id >> 16);
+  hd[7] = (uint8_t)(stream_id >> 8);
+  hd[8] = (uint8_t)stream_id;
+
+  buffer_add(buf, hd, sizeof(hd));
+}
+
+static void add_headers(buffer *buf, nghttp2_hd_deflater *deflater,
+                        uint8_t flags, int32_t stream_id,
+                        const nghttp2_nv *nva, size_t nvlen) {
+  uint8_t block[4096];
+  ssize_t rv;
+
+  rv = nghttp2_hd_deflate_hd(deflater, block, sizeof(block), nva, nvlen);
+  if (rv < 0) {
+    fprintf(stderr, "nghttp2_hd_deflate_hd: %s\n", nghttp2_strerror((int)rv));
+    exit(EXIT_FAILURE);
+  }
+
+  add_frame_hd(buf, (size_t)rv, NGHTTP2_HEADERS,
+               (uint8_t)(flags | NGHTTP2_FLAG_END_HEADERS), stream_id);
+  buffer_add(buf, block, (size_t)rv);
+}
+
+/* Builds the bytes which a client sends to a server. */
+static void make_client_traffic(buffer *buf) {
+  nghttp2_hd_deflater *deflater;
+  int32_t i;
+
+  buffer_add(buf, (const uint8_t *)NGHTTP2_CLIENT_MAGIC,
+             NGHTTP2_CLIENT_MAGIC_LEN);
+  add_frame_hd(buf, 0, NGHTTP2_SETTINGS, NGHTTP2_FLAG_NONE, 0);
+
+  nghttp2_hd_deflate_new(&deflater, 4096);
+
+  for (i = 0; i < NUM_STREAMS; ++i) {
+    add_headers(buf, deflater, NGHTTP2_FLAG_END_STREAM, i * 2 + 1, reqnv,
+                ARRLEN(reqnv));
+  }
+
+  nghttp2_hd_deflate_del(deflater);
+}
+
+/* Builds the bytes which a server sends to a client. */
+static void make_server_traffic(buffer *buf) {
+  nghttp2_hd_deflater *deflater;
+  int32_t i;
+
+  add_frame_hd(buf, 0, NGHTTP2_SETTINGS, NGHTTP2_FLAG_NONE, 0);
+  add_frame_hd(buf, 0, NGHTTP2_SETTINGS, NGHTTP2_FLAG_ACK, 0);
+
+  nghttp2_hd_deflate_new(&deflater, 4096);
+
+  for (i = 0; i < NUM_STREAMS; ++i) {
+    add_headers(buf, deflater, NGHTTP2_FLAG_NONE, i * 2 + 1, resnv,
+                ARRLEN(resnv));
+    add_frame_hd(buf, BODYLEN, NGHTTP2_DATA, NGHTTP2_FLAG_END_STREAM,
+                 i * 2 + 1);
+    buffer_add(buf, body, BODYLEN);
+  }
+
+  nghttp2_hd_deflate_del(deflater);
+}
+
+static ssize_t body_read_callback(nghttp2_session *session, int32_t stream_id,
+                                  uint8_t *buf, size_t length,
+                                  uint32_t *data_flags,
+                                  nghttp2_data_source *source,
+                                  void *user_data) {
+  (void)session;
+  (void)stream_id;
+  (void)length;
+  (void)source;
+  (void)user_data;
+
+  memcpy(buf, body, BODYLEN);
+  *data_flags |= NGHTTP2_DATA_FLAG_EOF;
+
+  return BODYLEN;
+}
+
+static int server_on_frame_recv_callback(nghttp2_session *session,
+                                         const nghttp2_frame *frame,
+                                         void *user_data) {
+  nghttp2_data_provider data_prd;
+  (void)user_data;
+
+  if (frame->hd.type != NGHTTP2_HEADERS ||
+      frame->headers.cat != NGHTTP2_HCAT_REQUEST ||
+      (frame->hd.flags & NGHTTP2_FLAG_END_STREAM) == 0) {
+    return 0;
+  }
+
+  data_prd.source.ptr = NULL;
+  data_prd.read_callback = body_read_callback;
+
+  return nghttp2_submit_response(session, frame->hd.stream_id, resnv,
+                                 ARRLEN(resnv), &data_prd);
+}
+
+static int drain(nghttp2_session *session) {
+  const uint8_t *data;
+  ssize_t nwrite;
+
+  for (;;) {
+    nwrite = nghttp2_session_mem_send(session, &data);
+    if (nwrite < 0) {
+      return (int)nwrite;
+    }
+    if (nwrite == 0) {
+      return 0;
+    }
+  }
+}
+
+/* Runs one connection of server session.  Returns 0 on success, or
+   negative error code. */
+static int run_server(const nghttp2_session_callbacks *callbacks,
+                      const buffer *input) {
+  nghttp2_session *session;
+  nghttp2_settings_entry iv[] = {
+      {NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS, NUM_STREAMS}};
+  ssize_t nread;
+  int rv;
+
+  rv = nghttp2_session_server_new(&session, callbacks, NULL);
+  if (rv != 0) {
+    return rv;
+  }
+
+  rv = nghttp2_submit_settings(session, NGHTTP2_FLAG_NONE, iv, ARRLEN(iv));
+  if (rv == 0) {
+    nread = nghttp2_session_mem_recv(session, input->data, input->len);
+    if (nread < 0) {
+      rv = (int)nread;
+    } else {
+      rv = drain(session);
+    }
+  }
+
+  nghttp2_session_del(session);
+
+  return rv;
+}
+
+/* Runs one connection of client session.  Returns 0 on success, or
+   negative error code. */
+static int run_client(const nghttp2_session_callbacks *callbacks,
+                      const buffer *input) {
+  nghttp2_session *session;
+  ssize_t nread;
+  int32_t stream_id;
+  size_t i;
+  int rv;
+
+  rv = nghttp2_session_client_new(&session, callbacks, NULL);
+  if (rv != 0) {
+    return rv;
+  }
+
+  rv = nghttp2_submit_settings(session, NGHTTP2_FLAG_NONE, NULL, 0);
+
+  for (i = 0; rv == 0 && i < NUM_STREAMS; ++i) {
+    stream_id = nghttp2_submit_request(session, NULL, reqnv, ARRLEN(reqnv),
+                                       NULL, NULL);
+    if (stream_id < 0) {
+      rv = stream_id;
+    }
+  }
+
+  if (rv == 0) {
+    rv = drain(session);
+  }
+
+  if (rv == 0) {
+    nread = nghttp2_session_mem_recv(session, input->data, input->len);
+    if (nread < 0) {
+      rv = (int)nread;
+    } else {
+      rv = drain(session);
+    }
+  }
+
+  nghttp2_session_del(session);
+
+  return rv;
+}
+
+#ifdef __linux__
+static int instructions_open(void) {
+  struct perf_event_attr attr;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.size = sizeof(attr);
+  attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+
+  return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static void instructions_start(int fd) {
+  if (fd == -1) {
+    return;
+  }
+  ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+  ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+}
+
+static long long instructions_stop(int fd) {
+  long long count;
+
+  if (fd == -1) {
+    return -1;
+  }
+  ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+  if (read(fd, &count, sizeof(count)) != sizeof(count)) {
+    return -1;
+  }
+  return count;
+}
+#else  /* !__linux__ */
+static int instructions_open(void) { return -1; }
+
+static void instructions_start(int fd) { (void)fd; }
+
+static long long instructions_stop(int fd) {
+  (void)fd;
+  return -1;
+}
+#endif /* !__linux__ */
+
+static double cputime(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+typedef int (*run_func)(const nghttp2_session_callbacks *, const buffer *);
+
+static int bench(const char *name, run_func run,
+                 const nghttp2_session_callbacks *callbacks,
+                 const buffer *input, size_t rounds, int perf_fd) {
+  size_t i;
+  int rv;
+  double t;
+  long long insns;
+  size_t nreq = rounds * NUM_STREAMS;
+
+  /* Warm up, and check that the role is available in this build */
+  rv = run(callbacks, input);
+  if (rv != 0) {
+    printf("%s: skipped (%s)\n", name, nghttp2_strerror(rv));
+    return 0;
+  }
+
+  instructions_start(perf_fd);
+  t = cputime();
+
+  for (i = 0; i < rounds; ++i) {
+    rv = run(callbacks, input);
+    if (rv != 0) {
+      fprintf(stderr, "%s: %s\n", name, nghttp2_strerror(rv));
+      return -1;
+    }
+  }
+
+  t = cputime() - t;
+  insns = instructions_stop(perf_fd);
+
+  printf("%s: %zu requests, %.1f ns/request", name, nreq,
+         t * 1e9 / (double)nreq);
+  if (insns >= 0) {
+    printf(", %.0f instructions/request", (double)insns / (double)nreq);
+  }
+  printf("\n");
+
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  nghttp2_session_callbacks *callbacks;
+  buffer client_traffic = {NULL, 0, 0}, server_traffic = {NULL, 0, 0};
+  size_t rounds = 2000;
+  int perf_fd;
+  int rv = 0;
+
+  if (argc > 1) {
+    rounds = (size_t)strtoul(argv[1], NULL, 10);
+    if (rounds == 0) {
+      fprintf(stderr, "Usage: %s [ROUNDS]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  memset(body, 'a', sizeof(body));
+
+  make_client_traffic(&client_traffic);
+  make_server_traffic(&server_traffic);
+
+  perf_fd = instructions_open();
+  if (perf_fd == -1) {
+    printf("instruction counter is not available\n");
+  }
+
+  nghttp2_session_callbacks_new(&callbacks);
+
+  nghttp2_session_callbacks_set_on_frame_recv_callback(
+      callbacks, server_on_frame_recv_callback);
+
+  if (bench("server", run_server, callbacks, &client_traffic, rounds,
+            perf_fd) != 0) {
+    rv = 1;
+  }
+
+  nghttp2_session_callbacks_set_on_frame_recv_callback(callbacks, NULL);
+
+  if (bench("client", run_client, callbacks, &server_traffic, rounds,
+            perf_fd) != 0) {
+    rv = 1;
+  }
+
+  nghttp2_session_callbacks_del(callbacks);
+
+  free(client_traffic.data);
+  free(server_traffic.data);
+
+  return rv;
+}